@@ -42,6 +42,7 @@ if (maek.OS === 'linux') {
 		`-L${VULKAN_SDK}/lib`,
 		'-lX11',
 		`-lvulkan`,
+		'-pthread',
 	];
 } else if (maek.OS === 'windows') {
 	VULKAN_SDK = process.env.VULKAN_SDK || `${process.env.USERPROFILE}/VulkanSDK/1.3.275.0`;
@@ -160,10 +161,12 @@ renderer_shaders = [
 	maek.GLSLC('./renderer/shader/simpleForward.vert'),
 	maek.GLSLC('./renderer/shader/simpleForward.frag'),
 	maek.GLSLC('./renderer/shader/materialForward.vert'),
+	maek.GLSLC('./renderer/shader/materialForwardCompact.vert'),
 	maek.GLSLC('./renderer/shader/mirrorForward.frag'),
 	maek.GLSLC('./renderer/shader/environmentForward.frag'),
 	maek.GLSLC('./renderer/shader/lambertianForward.frag'),
 	maek.GLSLC('./renderer/shader/pbrDeferred.vert'),
+	maek.GLSLC('./renderer/shader/pbrDeferredCompact.vert'),
 	maek.GLSLC('./renderer/shader/pbrDeferred.frag'),
 	maek.GLSLC('./renderer/shader/skybox.vert'),
 	maek.GLSLC('./renderer/shader/skybox.frag'),
@@ -185,13 +188,32 @@ const viewer_exe = maek.LINK([
 	maek.CPP('./renderer/EngineInit.cpp', undefined, { depends:[...renderer_shaders] } ),
 	maek.CPP('./renderer/EngineEventCallback.cpp'),
 	maek.CPP('./renderer/EngineUtils.cpp'),
+	maek.CPP('./renderer/AnimationBatch.cpp'),
+	maek.CPP('./renderer/AnimationCache.cpp'),
+	maek.CPP('./renderer/AssetCache.cpp'),
+	maek.CPP('./renderer/BlobCache.cpp'),
+	maek.CPP('./renderer/BlockCompression.cpp'),
+	maek.CPP('./renderer/ChannelPack.cpp'),
 	maek.CPP('./renderer/Culling.cpp'),
 	maek.CPP('./renderer/EventFile.cpp'),
+	maek.CPP('./renderer/GeometryArena.cpp'),
+	maek.CPP('./renderer/HDRFormat.cpp'),
 	maek.CPP('./renderer/HostImage.cpp'),
+	maek.CPP('./renderer/ImageDecodePool.cpp'),
+	maek.CPP('./renderer/JobSystem.cpp'),
+	maek.CPP('./renderer/LoadProfiler.cpp'),
+	maek.CPP('./renderer/MeshWeld.cpp'),
+	maek.CPP('./renderer/MipChain.cpp'),
+	maek.CPP('./renderer/S72Reader.cpp'),
 	maek.CPP('./renderer/Scene72.cpp'),
+	maek.CPP('./renderer/SceneGraph.cpp'),
+	maek.CPP('./renderer/SceneStreamer.cpp'),
+	maek.CPP('./renderer/ScenePack.cpp'),
 	maek.CPP('./renderer/TinyArgParser.cpp'),
 	maek.CPP('./renderer/VirtualSwapchain.cpp'),
 	maek.CPP('./renderer/Texture.cpp'),
+	maek.CPP('./renderer/UploadBatch.cpp'),
+	maek.CPP('./renderer/VertexFormat.cpp'),
 	maek.CPP('./renderer/GBuffer.cpp'),
 	maek.CPP('./renderer/SSAO.cpp'),
 	maek.CPP('./renderer/impl.cpp'),
@@ -205,8 +227,20 @@ const viewer_exe = maek.LINK([
 
 ], './bin/viewer');
 
+const s72pack_exe = maek.LINK([
+	maek.CPP('./pack/main.cpp'),
+	// Object files shared with viewer need their own names, since each file may only be built by one task.
+	maek.CPP('./renderer/BlobCache.cpp', 'objs/pack/BlobCache'),
+	maek.CPP('./renderer/BlockCompression.cpp', 'objs/pack/BlockCompression'),
+	maek.CPP('./renderer/ChannelPack.cpp', 'objs/pack/ChannelPack'),
+	maek.CPP('./renderer/Culling.cpp', 'objs/pack/Culling'),
+	maek.CPP('./renderer/HDRFormat.cpp', 'objs/pack/HDRFormat'),
+	maek.CPP('./renderer/MeshWeld.cpp', 'objs/pack/MeshWeld'),
+	maek.CPP('./renderer/MipChain.cpp', 'objs/pack/MipChain'),
+], './bin/s72pack');
+
 //default targets:
-maek.TARGETS = [viewer_exe, ...renderer_shaders];
+maek.TARGETS = [viewer_exe, s72pack_exe, ...renderer_shaders];
 
 //======================================================================
 //Now, onward to the code that makes all this work:
@@ -0,0 +1,623 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <cstring>
+#include <array>
+#include <map>
+#include <tuple>
+#include <set>
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+#include <vulkan/vulkan.h>
+#include <jjyou/glsl/glsl.hpp>
+#include <jjyou/io/Json.hpp>
+#include <jjyou/utils.hpp>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+#include "../renderer/ScenePack.hpp"
+#include "../renderer/Culling.hpp"
+#include "../renderer/BlobCache.hpp"
+#include "../renderer/MeshWeld.hpp"
+#include "../renderer/MipChain.hpp"
+#include "../renderer/ChannelPack.hpp"
+#include "../renderer/BlockCompression.hpp"
+#include "../renderer/HDRFormat.hpp"
+
+// s72pack converts a .s72 scene, together with its .b72 and image files, into one bundle
+// that Engine::loadPacked can upload straight from a memory mapping.
+// Usage: s72pack --scene path/to/scene.s72 --output path/to/scene.s72pack
+//        [--texture-compression none|bc1|bc7] [--environment-format rgba32f|rgba16f|b10g11r11|e5b9g9r9]
+
+// Bundle being written. Large payloads are appended as soon as they are produced;
+// the object, texture, index and float tables are appended last.
+class PackBuilder {
+
+public:
+
+	PackBuilder(void) : _bundle(sizeof(s72pack::Header)) {}
+
+	s72pack::Range append(const void* data, std::uint64_t size) {
+		this->_bundle.resize((this->_bundle.size() + s72pack::ALIGNMENT - 1) / s72pack::ALIGNMENT * s72pack::ALIGNMENT);
+		s72pack::Range range{ .offset = this->_bundle.size(), .size = size };
+		this->_bundle.resize(this->_bundle.size() + size);
+		if (size > 0)
+			std::memcpy(this->_bundle.data() + range.offset, data, size);
+		return range;
+	}
+
+	s72pack::Range appendString(const std::string& str) {
+		s72pack::Range range{ .offset = this->_bundle.size(), .size = str.size() };
+		this->_bundle.insert(this->_bundle.end(), str.begin(), str.end());
+		return range;
+	}
+
+	s72pack::List addIndices(const std::vector<std::uint32_t>& indices) {
+		s72pack::List list{ .first = static_cast<std::uint32_t>(this->_indices.size()), .count = static_cast<std::uint32_t>(indices.size()) };
+		this->_indices.insert(this->_indices.end(), indices.begin(), indices.end());
+		return list;
+	}
+
+	s72pack::List addFloats(const std::vector<float>& floats) {
+		s72pack::List list{ .first = static_cast<std::uint32_t>(this->_floats.size()), .count = static_cast<std::uint32_t>(floats.size()) };
+		this->_floats.insert(this->_floats.end(), floats.begin(), floats.end());
+		return list;
+	}
+
+	/** @brief	Add a texture whose mip levels are stored back to back in `levels`.
+	  * @return	Index of the texture in the texture table.
+	  */
+	std::uint32_t addTexture(
+		VkFormat format,
+		std::uint32_t width,
+		std::uint32_t height,
+		std::uint32_t mipLevels,
+		bool cubeMap,
+		VkSamplerAddressMode addressMode,
+		const std::vector<std::pair<const void*, std::uint64_t>>& levels
+	) {
+		s72pack::Texture texture{
+			.format = static_cast<std::uint32_t>(format),
+			.width = width,
+			.height = height,
+			.mipLevels = mipLevels,
+			.cubeMap = cubeMap ? 1U : 0U,
+			.addressMode = static_cast<std::uint32_t>(addressMode),
+			.data = {}
+		};
+		for (std::size_t m = 0; m < levels.size(); ++m) {
+			s72pack::Range range = this->append(levels[m].first, levels[m].second);
+			if (m == 0)
+				texture.data.offset = range.offset;
+			texture.data.size = range.offset + range.size - texture.data.offset;
+		}
+		this->_textures.push_back(texture);
+		return static_cast<std::uint32_t>(this->_textures.size() - 1);
+	}
+
+	void write(const std::filesystem::path& path, std::vector<s72pack::Object>& objects, float minTime, float maxTime) {
+		s72pack::Header header{};
+		std::memcpy(header.magic, s72pack::MAGIC, sizeof(s72pack::MAGIC));
+		header.version = s72pack::VERSION;
+		header.numObjects = static_cast<std::uint32_t>(objects.size());
+		header.minTime = minTime;
+		header.maxTime = maxTime;
+		header.objects = this->append(objects.data(), objects.size() * sizeof(s72pack::Object));
+		header.textures = this->append(this->_textures.data(), this->_textures.size() * sizeof(s72pack::Texture));
+		header.indices = this->append(this->_indices.data(), this->_indices.size() * sizeof(std::uint32_t));
+		header.floats = this->append(this->_floats.data(), this->_floats.size() * sizeof(float));
+		std::memcpy(this->_bundle.data(), &header, sizeof(header));
+		std::ofstream fout(path, std::ios::out | std::ios::binary);
+		if (!fout.is_open())
+			throw std::runtime_error("Cannot open output file \"" + path.string() + "\".");
+		fout.write(this->_bundle.data(), this->_bundle.size());
+		if (!fout.good())
+			throw std::runtime_error("Cannot write output file \"" + path.string() + "\".");
+	}
+
+private:
+
+	std::vector<char> _bundle;
+	std::vector<s72pack::Texture> _textures{};
+	std::vector<std::uint32_t> _indices{};
+	std::vector<float> _floats{};
+
+};
+
+// Same choice as materialBlockFormat in Scene72.cpp. `albedoFormat` is NONE if textures are not compressed.
+static BlockFormat packBlockFormat(BlockFormat albedoFormat, const std::string& textureName) {
+	if (albedoFormat == BlockFormat::NONE)
+		return BlockFormat::NONE;
+	if (textureName == "normalMap")
+		return BlockFormat::BC5;
+	if (textureName == "albedo")
+		return albedoFormat;
+	if (textureName == "surface")
+		return BlockFormat::BC7;
+	return BlockFormat::BC4;
+}
+
+// A missing texture becomes a 1x1 texture of the default value, a number or an array becomes a
+// 1x1 constant texture, and an object refers to an image. Engine::loadPacked turns 1x1 textures
+// back into material constants, like loadTexture in Scene72.cpp does for the scene file.
+template <int Length>
+static std::uint32_t packTexture(
+	PackBuilder& builder,
+	std::map<std::tuple<std::string, int, BlockFormat>, std::uint32_t>& imageTextures,
+	BlockFormat albedoFormat,
+	const std::filesystem::path& baseDir,
+	const jjyou::io::Json<>& material,
+	const std::string& textureName,
+	const std::array<unsigned char, Length>& defaultValue,
+	bool normalConversion// normal = texture * 2 - 1
+) requires (Length == 1 || Length == 3 || Length == 4)
+{
+	constexpr int Channels = (Length == 1) ? 1 : 4;
+	VkFormat format = (Length == 1) ? VK_FORMAT_R8_UNORM : VK_FORMAT_R8G8B8A8_UNORM;
+	std::array<unsigned char, Channels> constantValue{};
+	if (material.find(textureName) == material.end()) {
+		for (int i = 0; i < Length; ++i)
+			constantValue[i] = defaultValue[i];
+	}
+	else if (material[textureName].type() != jjyou::io::JsonType::Object) {
+		if constexpr (Length == 1) {
+			if (!normalConversion)
+				constantValue[0] = jjyou::utils::color_cast<unsigned char>(static_cast<float>(material[textureName]));
+			else
+				constantValue[0] = jjyou::utils::color_cast<unsigned char>(static_cast<float>(material[textureName]) / 2.0 + 0.5);
+		}
+		else {
+			if (!normalConversion)
+				for (int i = 0; i < Length; ++i)
+					constantValue[i] = jjyou::utils::color_cast<unsigned char>(static_cast<float>(material[textureName][i]));
+			else
+				for (int i = 0; i < Length; ++i)
+					constantValue[i] = jjyou::utils::color_cast<unsigned char>(static_cast<float>(material[textureName][i]) / 2.0 + 0.5);
+		}
+	}
+	else {
+		// Images shared by several materials are only stored once.
+		std::filesystem::path imagePath = baseDir / static_cast<std::string>(material[textureName]["src"]);
+		BlockFormat blockFormat = packBlockFormat(albedoFormat, textureName);
+		std::tuple<std::string, int, BlockFormat> key(imagePath.lexically_normal().string(), Channels, blockFormat);
+		auto iter = imageTextures.find(key);
+		if (iter != imageTextures.end())
+			return iter->second;
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load(imagePath.string().c_str(), &width, &height, &channels, Channels);
+		if (pixels == nullptr)
+			throw std::runtime_error("Cannot load texture \"" + imagePath.string() + "\".");
+		// The bundle stores the full chain, level 0 included, back to back.
+		std::uint32_t mipLevels = mipLevelCount(width, height);
+		std::vector<unsigned char> chain(pixels, pixels + std::size_t(width) * height * Channels);
+		std::vector<unsigned char> mipChain = buildMipChain(pixels, width, height, Channels);
+		chain.insert(chain.end(), mipChain.begin(), mipChain.end());
+		if (blockFormat != BlockFormat::NONE) {
+			blockFormat = alphaBlockFormat(blockFormat, pixels, width, height, Channels);
+			chain = compressMipChain(blockFormat, pixels, mipChain, width, height, Channels);
+			format = blockVkFormat(blockFormat);
+		}
+		stbi_image_free(pixels);
+		std::uint32_t textureIdx = builder.addTexture(
+			format,
+			static_cast<std::uint32_t>(width),
+			static_cast<std::uint32_t>(height),
+			mipLevels,
+			false,
+			VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			{ { chain.data(), chain.size() } }
+		);
+		imageTextures.emplace(std::move(key), textureIdx);
+		return textureIdx;
+	}
+	if constexpr (Length == 3)
+		constantValue[3] = 255;
+	return builder.addTexture(format, 1, 1, 1, false, VK_SAMPLER_ADDRESS_MODE_REPEAT, { { constantValue.data(), constantValue.size() } });
+}
+
+// Pack the displacement, roughness and metalness of a PBR material into the red, green and blue channels
+// of one surface texture, like loadSurfaceTexture in Scene72.cpp does. Channels without an image are
+// filled with their constant. If no channel has an image, a 1x1 texture holds the three constants.
+static std::uint32_t packSurfaceTexture(
+	PackBuilder& builder,
+	std::map<std::string, std::uint32_t>& surfaceTextures,
+	BlockFormat albedoFormat,
+	const std::filesystem::path& baseDir,
+	const jjyou::io::Json<>& material
+) {
+	BlockFormat blockFormat = packBlockFormat(albedoFormat, "surface");
+	std::array<std::filesystem::path, 3> imagePaths{};
+	std::array<ChannelSource, 3> sources{};
+	std::string key = std::to_string(static_cast<int>(blockFormat));
+	bool anyImage = false;
+	auto packChannel = [&](const jjyou::io::Json<>& textures, const std::string& textureName, std::size_t channel, unsigned char defaultValue) {
+		if (textures.find(textureName) == textures.end())
+			sources[channel].fill = defaultValue;
+		else if (textures[textureName].type() != jjyou::io::JsonType::Object)
+			sources[channel].fill = jjyou::utils::color_cast<unsigned char>(static_cast<float>(textures[textureName]));
+		else {
+			imagePaths[channel] = baseDir / static_cast<std::string>(textures[textureName]["src"]);
+			anyImage = true;
+		}
+		key += "|" + (imagePaths[channel].empty() ? std::to_string(sources[channel].fill) : imagePaths[channel].lexically_normal().string());
+	};
+	packChannel(material, "displacementMap", 0, 0);
+	packChannel(material["pbr"], "roughness", 1, 255);
+	packChannel(material["pbr"], "metalness", 2, 0);
+	if (!anyImage) {
+		std::array<unsigned char, 4> constantValue = { sources[0].fill, sources[1].fill, sources[2].fill, 255 };
+		return builder.addTexture(VK_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, false, VK_SAMPLER_ADDRESS_MODE_REPEAT, { { constantValue.data(), constantValue.size() } });
+	}
+	// Surface textures shared by several materials are only stored once.
+	auto iter = surfaceTextures.find(key);
+	if (iter != surfaceTextures.end())
+		return iter->second;
+	std::array<std::vector<unsigned char>, 3> pixels{};
+	for (std::size_t c = 0; c < imagePaths.size(); ++c) {
+		if (imagePaths[c].empty())
+			continue;
+		int width, height, channels;
+		stbi_uc* data = stbi_load(imagePaths[c].string().c_str(), &width, &height, &channels, STBI_grey);
+		if (data == nullptr)
+			throw std::runtime_error("Cannot load texture \"" + imagePaths[c].string() + "\".");
+		pixels[c].assign(data, data + std::size_t(width) * height);
+		stbi_image_free(data);
+		sources[c].pixels = pixels[c].data();
+		sources[c].width = static_cast<std::uint32_t>(width);
+		sources[c].height = static_cast<std::uint32_t>(height);
+	}
+	std::uint32_t width, height;
+	std::vector<unsigned char> chain = packChannels(sources, width, height);
+	std::uint32_t mipLevels = mipLevelCount(width, height);
+	std::vector<unsigned char> mipChain = buildMipChain(chain.data(), width, height, 4);
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	if (blockFormat != BlockFormat::NONE) {
+		chain = compressMipChain(blockFormat, chain.data(), mipChain, width, height, 4);
+		format = blockVkFormat(blockFormat);
+	}
+	else
+		chain.insert(chain.end(), mipChain.begin(), mipChain.end());
+	std::uint32_t textureIdx = builder.addTexture(format, width, height, mipLevels, false, VK_SAMPLER_ADDRESS_MODE_REPEAT, { { chain.data(), chain.size() } });
+	surfaceTextures.emplace(std::move(key), textureIdx);
+	return textureIdx;
+}
+
+// Decode an RGBE cube map image into `format` texels, appending them to `texels`.
+static VkExtent2D packRGBEImage(const std::filesystem::path& imagePath, HDRFormat format, std::vector<char>& texels) {
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(imagePath.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (pixels == nullptr)
+		throw std::runtime_error("Cannot load environment texture \"" + imagePath.string() + "\".");
+	std::vector<char> converted = convertRGBE(format, pixels, std::size_t(width) * height, 0);
+	texels.insert(texels.end(), converted.begin(), converted.end());
+	stbi_image_free(pixels);
+	return VkExtent2D{
+		.width = static_cast<std::uint32_t>(width),
+		.height = static_cast<std::uint32_t>(height) / 6
+	};
+}
+
+static std::uint32_t checkReference(const std::vector<s72pack::Object>& objects, int objectIdx, s72pack::ObjectType type, const std::string& what) {
+	if (objectIdx <= 0 || objectIdx > static_cast<int>(objects.size()) || objects[objectIdx - 1].type != type)
+		throw std::runtime_error(what + " references " + std::to_string(objectIdx) + " whose type is wrong.");
+	return static_cast<std::uint32_t>(objectIdx);
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		// Parse arguments.
+		std::filesystem::path scenePath, outputPath;
+		BlockFormat albedoFormat = BlockFormat::NONE;
+		HDRFormat environmentFormat = HDRFormat::E5B9G9R9;
+		const std::string usage = "Usage: s72pack --scene \\path\\to\\scene_file --output \\path\\to\\bundle_file [--texture-compression none|bc1|bc7] [--environment-format rgba32f|rgba16f|b10g11r11|e5b9g9r9]";
+		for (int i = 1; i < argc; ++i) {
+			if (std::strcmp(argv[i], "--scene") == 0 && i < argc - 1)
+				scenePath = argv[++i];
+			else if (std::strcmp(argv[i], "--output") == 0 && i < argc - 1)
+				outputPath = argv[++i];
+			else if (std::strcmp(argv[i], "--texture-compression") == 0 && i < argc - 1) {
+				++i;
+				if (std::strcmp(argv[i], "none") == 0)
+					albedoFormat = BlockFormat::NONE;
+				else if (std::strcmp(argv[i], "bc1") == 0)
+					albedoFormat = BlockFormat::BC1;
+				else if (std::strcmp(argv[i], "bc7") == 0)
+					albedoFormat = BlockFormat::BC7;
+				else
+					throw std::runtime_error(usage);
+			}
+			else if (std::strcmp(argv[i], "--environment-format") == 0 && i < argc - 1) {
+				++i;
+				if (std::strcmp(argv[i], "rgba32f") == 0)
+					environmentFormat = HDRFormat::RGBA32F;
+				else if (std::strcmp(argv[i], "rgba16f") == 0)
+					environmentFormat = HDRFormat::RGBA16F;
+				else if (std::strcmp(argv[i], "b10g11r11") == 0)
+					environmentFormat = HDRFormat::B10G11R11;
+				else if (std::strcmp(argv[i], "e5b9g9r9") == 0)
+					environmentFormat = HDRFormat::E5B9G9R9;
+				else
+					throw std::runtime_error(usage);
+			}
+			else
+				throw std::runtime_error(usage);
+		}
+		if (scenePath.empty() || outputPath.empty())
+			throw std::runtime_error(usage);
+		std::filesystem::path baseDir = scenePath.parent_path();
+		const jjyou::io::Json<> json = jjyou::io::Json<>::parse(scenePath);
+		if (json[0].string() != "s72-v1")
+			throw std::runtime_error("Scene72 file must start with \"s72-v1\"");
+
+		PackBuilder builder;
+		BlobCache blobCache;
+		std::map<std::tuple<std::string, int, BlockFormat>, std::uint32_t> imageTextures;
+		std::map<std::string, std::uint32_t> surfaceTextures;
+		std::vector<s72pack::Object> objects(json.size() - 1);
+		float minTime = std::numeric_limits<float>::max();
+		float maxTime = -std::numeric_limits<float>::max();
+		bool hasScene = false, hasEnvironment = false;
+		std::set<std::string> cameraNames;
+		MeshStats meshStats;
+		// Create objects
+		for (int i = 1; i < json.size(); ++i) {
+			const auto& obj = json[i];
+			std::string type(obj["type"]);
+			std::string name(obj["name"]);
+			s72pack::Object& object = objects[i - 1];
+			object.name = builder.appendString(name);
+			if (type == "SCENE") {
+				if (hasScene)
+					throw std::runtime_error("Scene must be unique.");
+				hasScene = true;
+				object.type = s72pack::ObjectType::Scene;
+			}
+			else if (type == "NODE") {
+				object.type = s72pack::ObjectType::Node;
+				for (int j = 0; j < 3; ++j) {
+					object.node.translation[j] = static_cast<float>(obj["translation"][j]);
+					object.node.scale[j] = static_cast<float>(obj["scale"][j]);
+				}
+				for (int j = 0; j < 4; ++j)
+					object.node.rotation[j] = static_cast<float>(obj["rotation"][j]);
+			}
+			else if (type == "MESH") {
+				object.type = s72pack::ObjectType::Mesh;
+				int count(obj["count"]);
+				std::string fileName(obj["attributes"]["POSITION"]["src"]);
+				int offset(obj["attributes"]["POSITION"]["offset"]);
+				int stride(obj["attributes"]["POSITION"]["stride"]);
+				const MappedFile* blob = nullptr;
+				try {
+					blob = &blobCache.open(baseDir / fileName);
+				}
+				catch (const std::exception&) {
+					throw std::runtime_error("Cannot open binary file \"" + fileName + "\".");
+				}
+				std::uint64_t bufferSize = std::uint64_t(stride) * count;
+				if (offset < 0 || static_cast<std::size_t>(offset) + bufferSize > blob->size())
+					throw std::runtime_error("Mesh \"" + name + "\" reads past the end of binary file \"" + fileName + "\".");
+				WeldedMesh welded(blob->data() + offset, count, stride);
+				meshStats.add(welded, welded.optimize());
+				BBox bbox(
+					welded.numVertices,
+					[&](std::size_t i)->jjyou::glsl::vec3 {
+						return *reinterpret_cast<const jjyou::glsl::vec3*>(welded.vertices.data() + i * stride);
+					}
+				);
+				object.mesh.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+				object.mesh.count = welded.numIndices;
+				object.mesh.stride = static_cast<std::uint32_t>(stride);
+				object.mesh.numVertices = welded.numVertices;
+				object.mesh.indexSize = welded.indexSize;
+				object.mesh.vertices = builder.append(welded.vertices.data(), welded.vertices.size());
+				object.mesh.indices = builder.append(welded.indices.data(), welded.indices.size());
+				for (int j = 0; j < 3; ++j) {
+					object.mesh.bboxCenter[j] = bbox.center[j];
+					object.mesh.bboxExtent[j] = bbox.extent[j];
+					for (int k = 0; k < 3; ++k)
+						object.mesh.bboxAxisRotation[j * 3 + k] = bbox.axisRotation[j][k];
+				}
+			}
+			else if (type == "CAMERA") {
+				if (!cameraNames.insert(name).second)
+					throw std::runtime_error("Multiple cameras have the same name \"" + name + "\".");
+				object.type = s72pack::ObjectType::Camera;
+				object.camera.vfov = float(obj["perspective"]["vfov"]);
+				object.camera.aspect = float(obj["perspective"]["aspect"]);
+				object.camera.zNear = float(obj["perspective"]["near"]);
+				object.camera.zFar = float(obj["perspective"]["far"]);
+			}
+			else if (type == "DRIVER") {
+				object.type = s72pack::ObjectType::Driver;
+				std::string channelStr = obj["channel"].string();
+				std::size_t numComponents = 3;
+				if (channelStr == "translation")
+					object.driver.channel = 0;
+				else if (channelStr == "scale")
+					object.driver.channel = 1;
+				else if (channelStr == "rotation") {
+					object.driver.channel = 2;
+					numComponents = 4;
+				}
+				else
+					throw std::runtime_error("Driver \"" + name + "\" has an unknown channel.");
+				std::vector<float> times(obj["times"]);
+				std::vector<float> values(obj["values"]);
+				if (!times.empty()) {
+					minTime = std::min(minTime, times.front());
+					maxTime = std::max(maxTime, times.back());
+				}
+				if (values.size() != times.size() * numComponents)
+					throw std::runtime_error("Driver \"" + name + "\" values do not match times.");
+				object.driver.interpolation = 1; // Linear, as in Engine::load.
+				object.driver.times = builder.addFloats(times);
+				object.driver.values = builder.addFloats(values);
+			}
+			else if (type == "MATERIAL") {
+				object.type = s72pack::ObjectType::Material;
+				s72pack::Material& material = object.material;
+				if (obj.find("simple") != obj.end()) {
+					material.materialType = s72pack::MaterialType::Simple;
+				}
+				else {
+					material.textures[0] = packTexture(builder, imageTextures, albedoFormat, baseDir, obj, "normalMap", std::array<unsigned char, 3>{{127, 127, 255}}, true);
+					// PBR materials pack their displacement into the surface texture instead.
+					if (obj.find("pbr") == obj.end())
+						material.textures[1] = packTexture(builder, imageTextures, albedoFormat, baseDir, obj, "displacementMap", std::array<unsigned char, 1>{{0}}, false);
+					if (obj.find("pbr") != obj.end()) {
+						material.materialType = s72pack::MaterialType::Pbr;
+						material.textures[1] = packSurfaceTexture(builder, surfaceTextures, albedoFormat, baseDir, obj);
+						material.textures[2] = packTexture(builder, imageTextures, albedoFormat, baseDir, obj["pbr"], "albedo", std::array<unsigned char, 3>{{255, 255, 255}}, false);
+					}
+					else if (obj.find("mirror") != obj.end())
+						material.materialType = s72pack::MaterialType::Mirror;
+					else if (obj.find("environment") != obj.end())
+						material.materialType = s72pack::MaterialType::Environment;
+					else if (obj.find("lambertian") != obj.end()) {
+						material.materialType = s72pack::MaterialType::Lambertian;
+						material.textures[2] = packTexture(builder, imageTextures, albedoFormat, baseDir, obj["lambertian"], "albedo", std::array<unsigned char, 3>{{255, 255, 255}}, false);
+					}
+					else
+						throw std::runtime_error("Material \"" + name + "\" must have exactly one of these properties: \"simple\", \"mirror\", \"environment\", \"lambertian\", or \"pbr\".");
+				}
+			}
+			else if (type == "ENVIRONMENT") {
+				if (hasEnvironment)
+					throw std::runtime_error("Find multiple environments.");
+				hasEnvironment = true;
+				object.type = s72pack::ObjectType::Environment;
+				if (obj.find("radiance") == obj.end())
+					throw std::runtime_error("Environment \"" + name + "\" must have a \"radiance\" property to specify the path to the radiance texture.");
+				std::filesystem::path radiancePath = static_cast<std::string>(obj["radiance"]["src"]);
+				// Radiance, with the pre-filtered environment maps as its mip levels
+				{
+					std::vector<char> texels;
+					VkExtent2D extent = packRGBEImage(baseDir / radiancePath, environmentFormat, texels);
+					std::uint32_t mipLevels = 1;
+					for (int j = 1; ; ++j) {
+						std::filesystem::path imagePath = radiancePath;
+						imagePath.replace_filename(imagePath.stem().string() + ".prefilteredenv." + std::to_string(j) + imagePath.extension().string());
+						imagePath = baseDir / imagePath;
+						if (!std::filesystem::exists(imagePath))
+							break;
+						packRGBEImage(imagePath, environmentFormat, texels);
+						++mipLevels;
+					}
+					if (mipLevels == 1)
+						throw std::runtime_error("Environment \"" + name + "\" failed to load any pre-filtered environment texture.");
+					object.environment.textures[0] = builder.addTexture(hdrVkFormat(environmentFormat), extent.width, extent.height, mipLevels, true, VK_SAMPLER_ADDRESS_MODE_REPEAT, { { texels.data(), texels.size() } });
+				}
+				// Lambertian
+				{
+					std::filesystem::path imagePath = radiancePath;
+					imagePath.replace_filename(imagePath.stem().string() + ".lambertian" + imagePath.extension().string());
+					std::vector<char> texels;
+					VkExtent2D extent = packRGBEImage(baseDir / imagePath, environmentFormat, texels);
+					object.environment.textures[1] = builder.addTexture(hdrVkFormat(environmentFormat), extent.width, extent.height, 1, true, VK_SAMPLER_ADDRESS_MODE_REPEAT, { { texels.data(), texels.size() } });
+				}
+				// Environment BRDF
+				{
+					std::filesystem::path imagePath = radiancePath;
+					imagePath.replace_filename("envbrdf.bin");
+					imagePath = baseDir / imagePath;
+					std::ifstream fin(imagePath, std::ios::in | std::ios::binary);
+					if (!fin.is_open())
+						throw std::runtime_error("Environment \"" + name + "\" failed to load environment BRDF lookup table from \"" + imagePath.string() + "\".");
+					std::uint32_t height;
+					fin.read(reinterpret_cast<char*>(&height), sizeof(height));
+					std::vector<float> data(height * height * 2);
+					fin.read(reinterpret_cast<char*>(data.data()), height * height * sizeof(float) * 2);
+					object.environment.textures[2] = builder.addTexture(VK_FORMAT_R32G32_SFLOAT, height, height, 1, false, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, { { data.data(), data.size() * sizeof(float) } });
+				}
+			}
+			else if (type == "LIGHT") {
+				object.type = s72pack::ObjectType::Light;
+				s72pack::Light& light = object.light;
+				for (int j = 0; j < 3; ++j)
+					light.tint[j] = (obj.find("tint") != obj.end()) ? static_cast<float>(obj["tint"][j]) : 1.0f;
+				if (obj.find("shadow") != obj.end())
+					light.shadow = static_cast<std::uint32_t>(static_cast<int>(obj["shadow"]));
+				if (obj.find("sun") != obj.end()) {
+					light.lightType = s72pack::LightType::Sun;
+					light.params[0] = float(obj["sun"]["angle"]);
+					light.params[1] = float(obj["sun"]["strength"]);
+				}
+				else if (obj.find("sphere") != obj.end()) {
+					light.lightType = s72pack::LightType::Sphere;
+					light.params[0] = float(obj["sphere"]["radius"]);
+					light.params[1] = float(obj["sphere"]["power"]);
+					light.params[2] = float(obj["sphere"]["limit"]);
+				}
+				else if (obj.find("spot") != obj.end()) {
+					light.lightType = s72pack::LightType::Spot;
+					light.params[0] = float(obj["spot"]["radius"]);
+					light.params[1] = float(obj["spot"]["power"]);
+					light.params[2] = float(obj["spot"]["fov"]);
+					light.params[3] = float(obj["spot"]["blend"]);
+					light.params[4] = float(obj["spot"]["limit"]);
+				}
+				else
+					throw std::runtime_error("Light \"" + name + "\" has an unknown lighting type.");
+			}
+			else
+				throw std::runtime_error("Unknown object type \"" + type + "\".");
+		}
+		blobCache.clear();
+
+		// Resolve and check object references
+		for (int i = 1; i < json.size(); ++i) {
+			const auto& obj = json[i];
+			s72pack::Object& object = objects[i - 1];
+			std::string what = obj["type"].string() + " \"" + obj["name"].string() + "\"";
+			if (object.type == s72pack::ObjectType::Scene) {
+				std::vector<std::uint32_t> roots;
+				for (const auto& rootIdx : obj["roots"])
+					roots.push_back(checkReference(objects, static_cast<int>(rootIdx), s72pack::ObjectType::Node, what + "\'s roots"));
+				object.scene.roots = builder.addIndices(roots);
+			}
+			else if (object.type == s72pack::ObjectType::Node) {
+				if (obj.find("camera") != obj.end())
+					object.node.camera = checkReference(objects, static_cast<int>(obj["camera"]), s72pack::ObjectType::Camera, what + "\'s camera");
+				if (obj.find("mesh") != obj.end())
+					object.node.mesh = checkReference(objects, static_cast<int>(obj["mesh"]), s72pack::ObjectType::Mesh, what + "\'s mesh");
+				if (obj.find("environment") != obj.end())
+					object.node.environment = checkReference(objects, static_cast<int>(obj["environment"]), s72pack::ObjectType::Environment, what + "\'s environment");
+				if (obj.find("light") != obj.end())
+					object.node.light = checkReference(objects, static_cast<int>(obj["light"]), s72pack::ObjectType::Light, what + "\'s light");
+				std::vector<std::uint32_t> children;
+				if (obj.find("children") != obj.end())
+					for (const auto& childIdx : obj["children"])
+						children.push_back(checkReference(objects, static_cast<int>(childIdx), s72pack::ObjectType::Node, what + "\'s children"));
+				object.node.children = builder.addIndices(children);
+			}
+			else if (object.type == s72pack::ObjectType::Mesh) {
+				bool simple = true;
+				if (obj.find("material") != obj.end()) {
+					object.mesh.material = checkReference(objects, static_cast<int>(obj["material"]), s72pack::ObjectType::Material, what + "\'s material");
+					simple = (objects[object.mesh.material - 1].material.materialType == s72pack::MaterialType::Simple);
+				}
+				bool hasTangent = (obj["attributes"].find("TANGENT") != obj["attributes"].end());
+				if (simple && hasTangent)
+					throw std::runtime_error(what + "\'s material is a simple material, but it has TANGENT/TEXCOORD attributes.");
+				else if (!simple && !hasTangent)
+					throw std::runtime_error(what + "\'s material is not a simple material, but it does not have TANGENT/TEXCOORD attributes.");
+			}
+			else if (object.type == s72pack::ObjectType::Driver) {
+				object.driver.node = checkReference(objects, static_cast<int>(obj["node"]), s72pack::ObjectType::Node, what + "\'s node");
+			}
+		}
+
+		builder.write(outputPath, objects, minTime, maxTime);
+		std::cout << "Packed " << objects.size() << " objects into \"" << outputPath.string() << "\"." << std::endl;
+		meshStats.print(std::cout);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Exception: " << e.what() << std::endl;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,149 @@
+#include "AnimationBatch.hpp"
+#include "Scene72.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void s72::AnimationBatch::add(const Driver& driver, std::uint32_t node) {
+	Group& group = this->_groups[driver.channel][driver.interpolation];
+	int numComponents = (driver.channel == Driver::Channel::Rotation) ? 4 : 3;
+	std::uint32_t numKeys = static_cast<std::uint32_t>(std::min(driver.times.size(), driver.values.size() / numComponents));
+	// A driver without keyframes leaves the node at its own transform.
+	if (numKeys == 0)
+		return;
+	group.drivers.push_back(&driver);
+	group.nodes.push_back(node);
+	group.firstKeys.push_back(static_cast<std::uint32_t>(group.times.size()));
+	group.numKeys.push_back(numKeys);
+	for (std::uint32_t k = 0; k < numKeys; ++k) {
+		group.times.push_back(driver.times[k]);
+		for (int c = 0; c < numComponents; ++c)
+			group.values[c].push_back(driver.values[k * numComponents + c]);
+	}
+	group.weights.push_back(0.0f);
+	group.cosines.push_back(0.0f);
+	group.scales.push_back(0.0f);
+	for (int c = 0; c < numComponents; ++c) {
+		group.begins[c].push_back(0.0f);
+		group.ends[c].push_back(0.0f);
+		group.results[c].push_back(0.0f);
+	}
+}
+
+void s72::AnimationBatch::clear(void) {
+	for (auto& channelGroups : this->_groups)
+		for (Group& group : channelGroups)
+			group = Group{};
+}
+
+std::uint32_t s72::AnimationBatch::numDrivers(void) const {
+	std::size_t numDrivers = 0;
+	for (const auto& channelGroups : this->_groups)
+		for (const Group& group : channelGroups)
+			numDrivers += group.drivers.size();
+	return static_cast<std::uint32_t>(numDrivers);
+}
+
+void s72::AnimationBatch::evaluate(
+	float time,
+	std::vector<jjyou::glsl::vec3>& translations,
+	std::vector<jjyou::glsl::quat>& rotations,
+	std::vector<jjyou::glsl::vec3>& scales,
+	JobSystem& jobSystem
+) {
+	for (int interpolation = 0; interpolation < 3; ++interpolation) {
+		Group& translationGroup = this->_groups[Driver::Channel::Translation][interpolation];
+		jobSystem.parallelFor(translationGroup.drivers.size(), AnimationBatch::LANE_GRAIN_SIZE, [&](std::size_t begin, std::size_t end) {
+			_evaluate(translationGroup, interpolation, 3, time, begin, end);
+			for (std::size_t d = begin; d < end; ++d)
+				translations[translationGroup.nodes[d]] = jjyou::glsl::vec3(translationGroup.results[0][d], translationGroup.results[1][d], translationGroup.results[2][d]);
+		});
+		Group& scaleGroup = this->_groups[Driver::Channel::Scale][interpolation];
+		jobSystem.parallelFor(scaleGroup.drivers.size(), AnimationBatch::LANE_GRAIN_SIZE, [&](std::size_t begin, std::size_t end) {
+			_evaluate(scaleGroup, interpolation, 3, time, begin, end);
+			for (std::size_t d = begin; d < end; ++d)
+				scales[scaleGroup.nodes[d]] = jjyou::glsl::vec3(scaleGroup.results[0][d], scaleGroup.results[1][d], scaleGroup.results[2][d]);
+		});
+		Group& rotationGroup = this->_groups[Driver::Channel::Rotation][interpolation];
+		jobSystem.parallelFor(rotationGroup.drivers.size(), AnimationBatch::LANE_GRAIN_SIZE, [&](std::size_t begin, std::size_t end) {
+			_evaluate(rotationGroup, interpolation, 4, time, begin, end);
+			for (std::size_t d = begin; d < end; ++d)
+				rotations[rotationGroup.nodes[d]] = jjyou::glsl::quat(rotationGroup.results[0][d], rotationGroup.results[1][d], rotationGroup.results[2][d], rotationGroup.results[3][d]);
+		});
+	}
+}
+
+void s72::AnimationBatch::_evaluate(Group& group, int interpolation, int numComponents, float time, std::size_t begin, std::size_t end) {
+	// Gather the keyframe pair around `time` of every driver. Outside of the keyframes the
+	// first or last value is held, as `Driver::sampleVec3` does.
+	for (std::size_t d = begin; d < end; ++d) {
+		int timeIter = group.drivers[d]->timeIter;
+		int numKeys = static_cast<int>(group.numKeys[d]);
+		std::uint32_t key0, key1;
+		float weight = 0.0f;
+		if (timeIter + 1 >= numKeys)
+			key0 = key1 = group.firstKeys[d] + numKeys - 1;
+		else if (timeIter < 0)
+			key0 = key1 = group.firstKeys[d];
+		else {
+			key0 = group.firstKeys[d] + timeIter;
+			key1 = key0 + 1;
+			if (interpolation != Driver::Interpolation::Step)
+				weight = (time - group.times[key0]) / (group.times[key1] - group.times[key0]);
+		}
+		for (int c = 0; c < numComponents; ++c) {
+			group.begins[c][d] = group.values[c][key0];
+			group.ends[c][d] = group.values[c][key1];
+		}
+		group.weights[d] = weight;
+	}
+	// Linear interpolation of every lane. Step lanes have a zero weight.
+	const float* weights = group.weights.data();
+	for (int c = 0; c < numComponents; ++c) {
+		const float* begins = group.begins[c].data();
+		const float* ends = group.ends[c].data();
+		float* results = group.results[c].data();
+		for (std::size_t d = begin; d < end; ++d)
+			results[d] = (1.0f - weights[d]) * begins[d] + weights[d] * ends[d];
+	}
+	if (interpolation != Driver::Interpolation::Slerp)
+		return;
+	// Slerp: normalize the lerp of every rotation lane, then redo the lanes whose keyframes are too far apart.
+	float* cosines = group.cosines.data();
+	for (std::size_t d = begin; d < end; ++d)
+		cosines[d] = 0.0f;
+	for (int c = 0; c < numComponents; ++c) {
+		const float* begins = group.begins[c].data();
+		const float* ends = group.ends[c].data();
+		for (std::size_t d = begin; d < end; ++d)
+			cosines[d] += begins[d] * ends[d];
+	}
+	if (numComponents == 4) {
+		float* scales = group.scales.data();
+		for (std::size_t d = begin; d < end; ++d)
+			scales[d] = 0.0f;
+		for (int c = 0; c < numComponents; ++c) {
+			const float* results = group.results[c].data();
+			for (std::size_t d = begin; d < end; ++d)
+				scales[d] += results[d] * results[d];
+		}
+		for (std::size_t d = begin; d < end; ++d)
+			scales[d] = 1.0f / std::sqrt(scales[d]);
+		for (int c = 0; c < numComponents; ++c) {
+			float* results = group.results[c].data();
+			for (std::size_t d = begin; d < end; ++d)
+				results[d] *= scales[d];
+		}
+	}
+	for (std::size_t d = begin; d < end; ++d) {
+		if (cosines[d] > AnimationBatch::NLERP_COSINE || weights[d] == 0.0f)
+			continue;
+		float theta = std::acos(cosines[d]);
+		float sinTheta = std::sin(theta);
+		float begWeight = std::sin((1.0f - weights[d]) * theta) / sinTheta;
+		float endWeight = std::sin(weights[d] * theta) / sinTheta;
+		for (int c = 0; c < numComponents; ++c)
+			group.results[c][d] = begWeight * group.begins[c][d] + endWeight * group.ends[c][d];
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <jjyou/glsl/glsl.hpp>
+
+namespace s72 {
+
+	// Evaluates all drivers of a scene at once.
+	// Drivers are grouped by channel and interpolation, and the keyframes of each group are stored
+	// as one array per component. Evaluation gathers the keyframe pair of every driver of a group
+	// into contiguous lanes, interpolates all lanes in plain loops the compiler vectorizes, and
+	// scatters the results into the TRS arrays of the scene graph. Lanes are independent, so ranges of
+	// them are evaluated in parallel, and the results do not depend on the number of threads.
+	// Keyframe intervals are read from `Driver::timeIter`, so the drivers must have been advanced first.
+	class AnimationBatch {
+
+	public:
+
+		// Slerp falls back to a normalized lerp above this cosine, where the two are indistinguishable
+		// and the slerp weights divide by a vanishing sine.
+		static constexpr inline float NLERP_COSINE = 0.9995f;
+
+		static constexpr inline std::size_t LANE_GRAIN_SIZE = 2048;
+
+		/** @brief	Add a driver of node `node` of the scene graph.
+		  */
+		void add(const Driver& driver, std::uint32_t node);
+
+		/** @brief	Drop every driver.
+		  */
+		void clear(void);
+
+		/** @brief	Write the values of every driver at `time` into the node arrays of its channel.
+		  *			The lanes of each group are split across `jobSystem`.
+		  */
+		void evaluate(
+			float time,
+			std::vector<jjyou::glsl::vec3>& translations,
+			std::vector<jjyou::glsl::quat>& rotations,
+			std::vector<jjyou::glsl::vec3>& scales,
+			JobSystem& jobSystem
+		);
+
+		std::uint32_t numDrivers(void) const;
+
+	private:
+
+		struct Group {
+			// Per driver.
+			std::vector<const Driver*> drivers{};
+			std::vector<std::uint32_t> nodes{};
+			std::vector<std::uint32_t> firstKeys{};
+			std::vector<std::uint32_t> numKeys{};
+			// Per keyframe.
+			std::vector<float> times{};
+			std::array<std::vector<float>, 4> values{};
+			// Lanes, one per driver, rewritten by every evaluation.
+			std::vector<float> weights{};
+			std::array<std::vector<float>, 4> begins{};
+			std::array<std::vector<float>, 4> ends{};
+			std::array<std::vector<float>, 4> results{};
+			std::vector<float> cosines{};
+			std::vector<float> scales{}; // Reciprocal lengths of the normalized lerps.
+		};
+
+		// Interpolate lanes [`begin`, `end`) of `group`.
+		static void _evaluate(Group& group, int interpolation, int numComponents, float time, std::size_t begin, std::size_t end);
+
+		// Indexed by channel, then by interpolation.
+		std::array<std::array<Group, 3>, 3> _groups{};
+
+	};
+
+}
@@ -0,0 +1,253 @@
+#include "AnimationCache.hpp"
+#include "Scene72.hpp"
+#include "BlobCache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+// The driven channels of the graph, in the order of its driven nodes.
+static std::vector<std::array<std::uint32_t, 4>> graphTracks(const s72::SceneGraph& sceneGraph) {
+	std::vector<std::array<std::uint32_t, 4>> tracks;
+	std::uint32_t numComponents = 0;
+	for (std::uint32_t node : sceneGraph.drivenNodes) {
+		const s72::Driver* drivers[3] = {
+			sceneGraph.translationDrivers[node],
+			sceneGraph.scaleDrivers[node],
+			sceneGraph.rotationDrivers[node]
+		};
+		for (std::uint32_t channel = 0; channel < 3; ++channel) {
+			if (drivers[channel] == nullptr)
+				continue;
+			tracks.push_back({ node, channel, drivers[channel]->interpolation != s72::Driver::Interpolation::Step, numComponents });
+			numComponents += (channel == s72::Driver::Channel::Rotation) ? 4 : 3;
+		}
+	}
+	return tracks;
+}
+
+// Multiply and fold the high bits back, so every input bit reaches every output bit.
+static std::uint64_t mixWord(std::uint64_t word) {
+	word ^= word >> 32;
+	word *= 0xD6E8FEB86659FD93ULL;
+	word ^= word >> 32;
+	return word;
+}
+
+std::uint64_t s72::AnimationCache::hashFile(const std::filesystem::path& path) {
+	MappedFile file(path);
+	const char* data = file.data();
+	std::size_t size = file.size();
+	// Four independent lanes of 8-byte words, so the multiplications overlap.
+	std::uint64_t lanes[4] = { 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x27D4EB2F165667C5ULL };
+	std::size_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		for (int l = 0; l < 4; ++l) {
+			std::uint64_t word;
+			std::memcpy(&word, data + i + 8 * l, sizeof(word));
+			lanes[l] = mixWord(lanes[l] ^ word) + word;
+		}
+	}
+	std::uint64_t hash = size;
+	for (int l = 0; l < 4; ++l)
+		hash = mixWord(hash ^ lanes[l]);
+	// The remaining bytes, zero-padded to whole words.
+	for (; i < size; i += 8) {
+		std::uint64_t word = 0;
+		std::memcpy(&word, data + i, std::min<std::size_t>(8, size - i));
+		hash = mixWord(hash ^ word);
+	}
+	return hash;
+}
+
+void s72::AnimationCache::bake(Scene72& scene72, float rate, bool quantize, JobSystem& jobSystem) {
+	this->clear();
+	SceneGraph& sceneGraph = scene72.sceneGraph;
+	for (const auto& [node, channel, interpolate, firstComponent] : graphTracks(sceneGraph))
+		this->_tracks.push_back(Track{ .node = node, .channel = channel, .interpolate = interpolate, .firstComponent = firstComponent });
+	if (this->_tracks.empty() || !(scene72.maxTime >= scene72.minTime))
+		return;
+	this->_numComponents = this->_tracks.back().firstComponent + ((this->_tracks.back().channel == Driver::Channel::Rotation) ? 4 : 3);
+	this->_numFrames = static_cast<std::uint32_t>(std::ceil((scene72.maxTime - scene72.minTime) * rate)) + 1;
+	this->_rate = rate;
+	this->_minTime = scene72.minTime;
+	this->_maxTime = scene72.maxTime;
+	this->_samples.resize(std::size_t(this->_numFrames) * this->_numComponents);
+	for (std::uint32_t frame = 0; frame < this->_numFrames; ++frame) {
+		float time = std::min(this->_minTime + static_cast<float>(frame) / rate, this->_maxTime);
+		scene72.seek(time);
+		sceneGraph.animation.evaluate(time, sceneGraph.translations, sceneGraph.rotations, sceneGraph.scales, jobSystem);
+		float* row = this->_samples.data() + std::size_t(frame) * this->_numComponents;
+		for (const Track& track : this->_tracks) {
+			float* dst = row + track.firstComponent;
+			if (track.channel == Driver::Channel::Translation)
+				for (int c = 0; c < 3; ++c) dst[c] = sceneGraph.translations[track.node][c];
+			else if (track.channel == Driver::Channel::Scale)
+				for (int c = 0; c < 3; ++c) dst[c] = sceneGraph.scales[track.node][c];
+			else
+				for (int c = 0; c < 4; ++c) dst[c] = sceneGraph.rotations[track.node][c];
+		}
+	}
+	sceneGraph.invalidate();
+	if (!quantize)
+		return;
+	// Each component is scaled to the 16-bit range between its minimum and maximum.
+	this->_quantized = true;
+	this->_offsets.assign(this->_numComponents, std::numeric_limits<float>::max());
+	this->_scales.assign(this->_numComponents, -std::numeric_limits<float>::max());
+	for (std::size_t i = 0; i < this->_samples.size(); ++i) {
+		std::uint32_t c = static_cast<std::uint32_t>(i % this->_numComponents);
+		this->_offsets[c] = std::min(this->_offsets[c], this->_samples[i]);
+		this->_scales[c] = std::max(this->_scales[c], this->_samples[i]);
+	}
+	for (std::uint32_t c = 0; c < this->_numComponents; ++c)
+		this->_scales[c] = (this->_scales[c] - this->_offsets[c]) / 65535.0f;
+	this->_quantizedSamples.resize(this->_samples.size());
+	for (std::size_t i = 0; i < this->_samples.size(); ++i) {
+		std::uint32_t c = static_cast<std::uint32_t>(i % this->_numComponents);
+		float steps = (this->_scales[c] > 0.0f) ? (this->_samples[i] - this->_offsets[c]) / this->_scales[c] : 0.0f;
+		this->_quantizedSamples[i] = static_cast<std::uint16_t>(std::clamp(std::round(steps), 0.0f, 65535.0f));
+	}
+	this->_samples.clear();
+	this->_samples.shrink_to_fit();
+}
+
+bool s72::AnimationCache::load(const std::filesystem::path& path, std::uint64_t sceneHash, float rate, bool quantize, const SceneGraph& sceneGraph) {
+	this->clear();
+	std::ifstream fin(path, std::ios::binary);
+	if (!fin.is_open())
+		return false;
+	Header header{};
+	if (!fin.read(reinterpret_cast<char*>(&header), sizeof(Header)))
+		return false;
+	if (std::memcmp(header.magic, AnimationCache::MAGIC, sizeof(AnimationCache::MAGIC)) != 0 ||
+		header.version != AnimationCache::VERSION ||
+		header.sceneHash != sceneHash ||
+		header.rate != rate ||
+		(header.quantized != 0) != quantize ||
+		header.numFrames == 0)
+		return false;
+	std::vector<std::array<std::uint32_t, 4>> expectedTracks = graphTracks(sceneGraph);
+	if (header.numTracks != expectedTracks.size() || expectedTracks.empty())
+		return false;
+	std::uint32_t numComponents = expectedTracks.back()[3] + ((expectedTracks.back()[1] == Driver::Channel::Rotation) ? 4 : 3);
+	if (header.numComponents != numComponents)
+		return false;
+	this->_tracks.resize(header.numTracks);
+	if (!fin.read(reinterpret_cast<char*>(this->_tracks.data()), this->_tracks.size() * sizeof(Track))) {
+		this->clear();
+		return false;
+	}
+	for (std::size_t t = 0; t < this->_tracks.size(); ++t) {
+		const Track& track = this->_tracks[t];
+		if (track.node != expectedTracks[t][0] || track.channel != expectedTracks[t][1] || track.interpolate != expectedTracks[t][2] || track.firstComponent != expectedTracks[t][3]) {
+			this->clear();
+			return false;
+		}
+	}
+	this->_numComponents = header.numComponents;
+	std::size_t numSamples = std::size_t(header.numFrames) * header.numComponents;
+	bool read = false;
+	if (header.quantized) {
+		this->_offsets.resize(header.numComponents);
+		this->_scales.resize(header.numComponents);
+		this->_quantizedSamples.resize(numSamples);
+		read =
+			fin.read(reinterpret_cast<char*>(this->_offsets.data()), this->_offsets.size() * sizeof(float)) &&
+			fin.read(reinterpret_cast<char*>(this->_scales.data()), this->_scales.size() * sizeof(float)) &&
+			fin.read(reinterpret_cast<char*>(this->_quantizedSamples.data()), this->_quantizedSamples.size() * sizeof(std::uint16_t));
+	}
+	else {
+		this->_samples.resize(numSamples);
+		read = static_cast<bool>(fin.read(reinterpret_cast<char*>(this->_samples.data()), this->_samples.size() * sizeof(float)));
+	}
+	if (!read) {
+		this->clear();
+		return false;
+	}
+	this->_numFrames = header.numFrames;
+	this->_rate = header.rate;
+	this->_minTime = header.minTime;
+	this->_maxTime = header.maxTime;
+	this->_quantized = (header.quantized != 0);
+	return true;
+}
+
+void s72::AnimationCache::save(const std::filesystem::path& path, std::uint64_t sceneHash) const {
+	std::ofstream fout(path, std::ios::binary);
+	if (!fout.is_open())
+		throw std::runtime_error("Cannot write baked animation \"" + path.string() + "\".");
+	Header header{
+		.magic = {},
+		.version = AnimationCache::VERSION,
+		.quantized = this->_quantized,
+		.sceneHash = sceneHash,
+		.rate = this->_rate,
+		.minTime = this->_minTime,
+		.maxTime = this->_maxTime,
+		.numFrames = this->_numFrames,
+		.numTracks = static_cast<std::uint32_t>(this->_tracks.size()),
+		.numComponents = this->_numComponents
+	};
+	std::memcpy(header.magic, AnimationCache::MAGIC, sizeof(AnimationCache::MAGIC));
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	fout.write(reinterpret_cast<const char*>(this->_tracks.data()), this->_tracks.size() * sizeof(Track));
+	if (this->_quantized) {
+		fout.write(reinterpret_cast<const char*>(this->_offsets.data()), this->_offsets.size() * sizeof(float));
+		fout.write(reinterpret_cast<const char*>(this->_scales.data()), this->_scales.size() * sizeof(float));
+		fout.write(reinterpret_cast<const char*>(this->_quantizedSamples.data()), this->_quantizedSamples.size() * sizeof(std::uint16_t));
+	}
+	else {
+		fout.write(reinterpret_cast<const char*>(this->_samples.data()), this->_samples.size() * sizeof(float));
+	}
+	if (!fout)
+		throw std::runtime_error("Cannot write baked animation \"" + path.string() + "\".");
+}
+
+void s72::AnimationCache::sample(
+	float time,
+	std::vector<jjyou::glsl::vec3>& translations,
+	std::vector<jjyou::glsl::quat>& rotations,
+	std::vector<jjyou::glsl::vec3>& scales
+) const {
+	float x = (std::clamp(time, this->_minTime, this->_maxTime) - this->_minTime) * this->_rate;
+	std::uint32_t frame0 = std::min(static_cast<std::uint32_t>(x), this->_numFrames - 1);
+	std::uint32_t frame1 = std::min(frame0 + 1, this->_numFrames - 1);
+	float u = std::clamp(x - static_cast<float>(frame0), 0.0f, 1.0f);
+	for (const Track& track : this->_tracks) {
+		float w = track.interpolate ? u : 0.0f;
+		float values[4];
+		int numComponents = (track.channel == Driver::Channel::Rotation) ? 4 : 3;
+		for (int c = 0; c < numComponents; ++c) {
+			float v0 = this->_value(frame0, track.firstComponent + c);
+			float v1 = this->_value(frame1, track.firstComponent + c);
+			values[c] = (1.0f - w) * v0 + w * v1;
+		}
+		if (track.channel == Driver::Channel::Translation)
+			translations[track.node] = jjyou::glsl::vec3(values[0], values[1], values[2]);
+		else if (track.channel == Driver::Channel::Scale)
+			scales[track.node] = jjyou::glsl::vec3(values[0], values[1], values[2]);
+		else {
+			float norm = std::sqrt(values[0] * values[0] + values[1] * values[1] + values[2] * values[2] + values[3] * values[3]);
+			rotations[track.node] = jjyou::glsl::quat(values[0] / norm, values[1] / norm, values[2] / norm, values[3] / norm);
+		}
+	}
+}
+
+void s72::AnimationCache::clear(void) {
+	this->_tracks.clear();
+	this->_numComponents = 0;
+	this->_numFrames = 0;
+	this->_rate = 0.0f;
+	this->_minTime = 0.0f;
+	this->_maxTime = 0.0f;
+	this->_quantized = false;
+	this->_samples.clear();
+	this->_quantizedSamples.clear();
+	this->_offsets.clear();
+	this->_scales.clear();
+}
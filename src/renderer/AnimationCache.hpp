@@ -0,0 +1,106 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+#include <jjyou/glsl/glsl.hpp>
+
+namespace s72 {
+
+	// The driven channels of a scene, pre-sampled at a fixed rate for repeated playback.
+	// Samples are stored frame by frame, one row of floats (or of 16-bit values scaled to the range
+	// of each component, if quantized) per frame. A frame is served by looking up the two rows
+	// around the play time and interpolating them, instead of seeking and evaluating the drivers.
+	// Caches are saved next to their scene file with the hash of its content, and are only
+	// loaded back for the same scene file and sampling settings.
+	class AnimationCache {
+
+	public:
+
+		static constexpr inline char MAGIC[8] = { 'S', '7', '2', 'A', 'N', 'I', 'M', '\0' };
+		static constexpr inline std::uint32_t VERSION = 2;
+
+		/** @brief	Hash of the content of a file, read 8 bytes at a time.
+		  */
+		static std::uint64_t hashFile(const std::filesystem::path& path);
+
+		/** @brief	Sample the driven channels of `scene72.sceneGraph` from `minTime` to `maxTime` at `rate` samples per second.
+		  *			The drivers are left at `maxTime`, and the scene graph is invalidated.
+		  */
+		void bake(Scene72& scene72, float rate, bool quantize, JobSystem& jobSystem);
+
+		/** @brief	Load a cache saved by `save`. Return false, leaving the cache empty, if the file does not exist
+		  *			or was baked from a different scene file, with different settings, or for a different graph.
+		  */
+		bool load(const std::filesystem::path& path, std::uint64_t sceneHash, float rate, bool quantize, const SceneGraph& sceneGraph);
+
+		/** @brief	Write the cache. Throw std::runtime_error if the file cannot be written.
+		  */
+		void save(const std::filesystem::path& path, std::uint64_t sceneHash) const;
+
+		/** @brief	Write the values of the driven channels at `time` into the node arrays of the scene graph.
+		  */
+		void sample(
+			float time,
+			std::vector<jjyou::glsl::vec3>& translations,
+			std::vector<jjyou::glsl::quat>& rotations,
+			std::vector<jjyou::glsl::vec3>& scales
+		) const;
+
+		void clear(void);
+
+		bool empty(void) const { return this->_numFrames == 0; }
+
+		std::uint32_t numFrames(void) const { return this->_numFrames; }
+
+		/** @brief	Size of the samples in bytes.
+		  */
+		std::size_t sampleBytes(void) const { return this->_samples.size() * sizeof(float) + this->_quantizedSamples.size() * sizeof(std::uint16_t); }
+
+	private:
+
+		// A driven channel of a node of the scene graph.
+		struct Track {
+			std::uint32_t node;
+			std::uint32_t channel; // Driver::Channel
+			std::uint32_t interpolate; // 0 for step drivers, whose samples are held rather than interpolated.
+			std::uint32_t firstComponent; // Column of the track in a row of samples.
+		};
+
+		struct Header {
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t quantized;
+			std::uint64_t sceneHash;
+			float rate;
+			float minTime;
+			float maxTime;
+			std::uint32_t numFrames;
+			std::uint32_t numTracks;
+			std::uint32_t numComponents;
+		};
+
+		float _value(std::uint32_t frame, std::uint32_t component) const {
+			std::size_t idx = std::size_t(frame) * this->_numComponents + component;
+			if (this->_quantized)
+				return this->_offsets[component] + this->_scales[component] * static_cast<float>(this->_quantizedSamples[idx]);
+			return this->_samples[idx];
+		}
+
+		std::vector<Track> _tracks{};
+		std::uint32_t _numComponents = 0;
+		std::uint32_t _numFrames = 0;
+		float _rate = 0.0f;
+		float _minTime = 0.0f;
+		float _maxTime = 0.0f;
+		bool _quantized = false;
+		std::vector<float> _samples{};
+		std::vector<std::uint16_t> _quantizedSamples{};
+		std::vector<float> _offsets{}; // Per component, the value of a quantized 0.
+		std::vector<float> _scales{}; // Per component, the value of one quantization step.
+
+	};
+
+}
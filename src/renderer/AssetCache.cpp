@@ -0,0 +1,101 @@
+#include "AssetCache.hpp"
+
+#include <array>
+#include <system_error>
+
+std::string AssetCache::fileKey(const std::filesystem::path& path) {
+	std::error_code error;
+	std::filesystem::path canonicalPath = std::filesystem::canonical(path, error);
+	if (error)
+		return {};
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(canonicalPath, error);
+	if (error)
+		return {};
+	std::uintmax_t size = std::filesystem::file_size(canonicalPath, error);
+	if (error)
+		return {};
+	return canonicalPath.string() + "|" + std::to_string(writeTime.time_since_epoch().count()) + "|" + std::to_string(size);
+}
+
+AssetCache::Texture AssetCache::findTexture(const std::string& key, const UploadBatch* uploadBatch) const {
+	auto iter = this->_textures.find(key);
+	if (iter != this->_textures.end())
+		return iter->second;
+	auto pendingIter = this->_pending.find(uploadBatch);
+	if (uploadBatch == nullptr || pendingIter == this->_pending.end())
+		return nullptr;
+	iter = pendingIter->second.textures.find(key);
+	return (iter != pendingIter->second.textures.end()) ? iter->second : nullptr;
+}
+
+AssetCache::Texture AssetCache::insertTexture(const std::string& key, jjyou::vk::Texture2D&& texture, const UploadBatch& uploadBatch) {
+	if (!texture.has_value())
+		return nullptr;
+	Texture shared = std::make_shared<jjyou::vk::Texture2D>(std::move(texture));
+	if (!key.empty())
+		this->_pending[&uploadBatch].textures[key] = shared;
+	return shared;
+}
+
+AssetCache::Texture AssetCache::placeholder(const jjyou::vk::Context& context, jjyou::vk::MemoryAllocator& allocator, UploadBatch& uploadBatch) {
+	if (Texture cached = this->findTexture("placeholder", &uploadBatch))
+		return cached;
+	std::array<unsigned char, 4> white = { 255, 255, 255, 255 };
+	jjyou::vk::Texture2D texture;
+	texture.create(
+		context,
+		allocator,
+		uploadBatch,
+		white.data(),
+		VK_FORMAT_R8G8B8A8_UNORM,
+		VkExtent2D{ .width = 1,.height = 1 }
+	);
+	return this->insertTexture("placeholder", std::move(texture), uploadBatch);
+}
+
+AssetCache::Mesh AssetCache::findMesh(const std::string& key, const UploadBatch* uploadBatch) const {
+	auto iter = this->_meshes.find(key);
+	if (iter != this->_meshes.end())
+		return iter->second;
+	auto pendingIter = this->_pending.find(uploadBatch);
+	if (uploadBatch == nullptr || pendingIter == this->_pending.end())
+		return nullptr;
+	iter = pendingIter->second.meshes.find(key);
+	return (iter != pendingIter->second.meshes.end()) ? iter->second : nullptr;
+}
+
+AssetCache::Mesh AssetCache::insertMesh(const std::string& key, MeshGeometry&& mesh, const UploadBatch& uploadBatch) {
+	Mesh shared = std::make_shared<const MeshGeometry>(std::move(mesh));
+	if (!key.empty())
+		this->_pending[&uploadBatch].meshes[key] = shared;
+	return shared;
+}
+
+void AssetCache::commit(const UploadBatch& uploadBatch) {
+	auto iter = this->_pending.find(&uploadBatch);
+	if (iter == this->_pending.end())
+		return;
+	// An asset committed by another batch in the meantime is replaced; scenes keep the one they hold.
+	for (auto& [key, texture] : iter->second.textures)
+		this->_textures[key] = std::move(texture);
+	for (auto& [key, mesh] : iter->second.meshes)
+		this->_meshes[key] = std::move(mesh);
+	this->_pending.erase(iter);
+}
+
+void AssetCache::discard(const UploadBatch& uploadBatch) {
+	this->_pending.erase(&uploadBatch);
+}
+
+void AssetCache::trim(void) {
+	// An asset only referenced by the cache has a use count of one.
+	// Arenas are freed together with the last mesh geometry pointing into them.
+	std::erase_if(this->_textures, [](const auto& entry) { return entry.second.use_count() == 1; });
+	std::erase_if(this->_meshes, [](const auto& entry) { return entry.second.use_count() == 1; });
+}
+
+void AssetCache::clear(void) {
+	this->_textures.clear();
+	this->_meshes.clear();
+	this->_pending.clear();
+}
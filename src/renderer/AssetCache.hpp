@@ -0,0 +1,131 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <jjyou/vk/Vulkan.hpp>
+#include "Texture.hpp"
+#include "Culling.hpp"
+#include "GeometryArena.hpp"
+
+class UploadBatch;
+
+// GPU assets shared between the scenes loaded by one engine.
+// Assets are keyed by the identity of their source file (canonical path, modification time
+// and size) plus every load option that changes their contents, so loading a scene again,
+// or a scene that shares files with a previous one, reuses the uploaded textures and meshes
+// instead of decoding, welding and uploading them again.
+//
+// Scenes hold shared references. Destroying a scene only drops its references; assets that
+// are no longer referenced stay cached until `trim` is called.
+//
+// An asset is inserted together with the upload batch that records its upload, and stays pending
+// until `commit` is called for that batch once its uploads have completed. Pending assets are only
+// found through their own batch, so no other load binds an image or a mesh range that has not been
+// written yet, and `discard` drops them if the batch is abandoned.
+class AssetCache {
+
+public:
+
+	using Texture = std::shared_ptr<jjyou::vk::Texture2D>;
+
+	// Geometry of a mesh, sub-allocated from a geometry arena.
+	// The arena is released once no cached or loaded mesh refers to it.
+	struct MeshGeometry {
+		std::shared_ptr<GeometryArena> arena{};
+		std::uint32_t count = 0;
+		std::uint32_t numVertices = 0;
+		VkBuffer vertexBuffer = nullptr;
+		std::int32_t firstVertex = 0;
+		VkBuffer positionBuffer = nullptr;
+		std::int32_t firstPosition = 0;
+		VkBuffer indexBuffer = nullptr;
+		std::uint32_t firstIndex = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		BBox bbox{};
+	};
+
+	using Mesh = std::shared_ptr<const MeshGeometry>;
+
+	// Discards the assets pending on an upload batch when it goes out of scope, unless they were committed.
+	// Declared right after the batch by loaders, so that a failed load leaves nothing pending behind.
+	class PendingGuard {
+	public:
+		PendingGuard(AssetCache& assetCache, const UploadBatch& uploadBatch) : _assetCache(assetCache), _uploadBatch(uploadBatch) {}
+		PendingGuard(const PendingGuard&) = delete;
+		PendingGuard& operator=(const PendingGuard&) = delete;
+		~PendingGuard(void) { this->_assetCache.discard(this->_uploadBatch); }
+	private:
+		AssetCache& _assetCache;
+		const UploadBatch& _uploadBatch;
+	};
+
+	AssetCache(void) = default;
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+
+	/** @brief	Identity of a file: its canonical path, modification time and size.
+	  *			Return an empty string if the file cannot be queried. Assets with an empty key are never cached.
+	  */
+	static std::string fileKey(const std::filesystem::path& path);
+
+	/** @brief	Get a cached texture, or one pending on `uploadBatch`. Return nullptr if there is none.
+	  */
+	Texture findTexture(const std::string& key, const UploadBatch* uploadBatch = nullptr) const;
+
+	/** @brief	Take ownership of a texture uploaded through `uploadBatch` and cache it under `key`, unless `key` is empty.
+	  *			The texture is pending until `commit(uploadBatch)`.
+	  *			Return the shared texture, or nullptr if `texture` is empty.
+	  */
+	Texture insertTexture(const std::string& key, jjyou::vk::Texture2D&& texture, const UploadBatch& uploadBatch);
+
+	/** @brief	Get the 1x1 white texture bound in place of the textures that materials replace by constants,
+	  *			creating it through `uploadBatch` on first use.
+	  */
+	Texture placeholder(const jjyou::vk::Context& context, jjyou::vk::MemoryAllocator& allocator, UploadBatch& uploadBatch);
+
+	/** @brief	Get cached mesh geometry, or geometry pending on `uploadBatch`. Return nullptr if there is none.
+	  */
+	Mesh findMesh(const std::string& key, const UploadBatch* uploadBatch = nullptr) const;
+
+	/** @brief	Cache mesh geometry uploaded through `uploadBatch` under `key`, unless `key` is empty, and return it.
+	  *			The geometry is pending until `commit(uploadBatch)`.
+	  */
+	Mesh insertMesh(const std::string& key, MeshGeometry&& mesh, const UploadBatch& uploadBatch);
+
+	/** @brief	Share the assets pending on `uploadBatch` with every load. Every upload of the batch must have completed.
+	  */
+	void commit(const UploadBatch& uploadBatch);
+
+	/** @brief	Drop the assets pending on `uploadBatch`, whose uploads were abandoned.
+	  */
+	void discard(const UploadBatch& uploadBatch);
+
+	/** @brief	Release every asset that is not referenced outside the cache.
+	  *			The device must not be using them anymore.
+	  */
+	void trim(void);
+
+	/** @brief	Release all assets, pending ones included. Scenes must have been destroyed.
+	  */
+	void clear(void);
+
+	std::size_t numTextures(void) const { return this->_textures.size(); }
+
+	std::size_t numMeshes(void) const { return this->_meshes.size(); }
+
+private:
+
+	struct Pending {
+		std::map<std::string, Texture> textures{};
+		std::map<std::string, Mesh> meshes{};
+	};
+
+	std::map<std::string, Texture> _textures{};
+	std::map<std::string, Mesh> _meshes{};
+	std::map<const UploadBatch*, Pending> _pending{};
+
+};
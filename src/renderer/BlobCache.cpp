@@ -0,0 +1,120 @@
+#include "BlobCache.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Cannot open file \"" + path.string() + "\".");
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		throw std::runtime_error("Cannot get the size of file \"" + path.string() + "\".");
+	}
+	this->_file = file;
+	this->_size = static_cast<std::size_t>(fileSize.QuadPart);
+	this->_opened = true;
+	if (this->_size == 0)
+		return;
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		this->close();
+		throw std::runtime_error("Cannot map file \"" + path.string() + "\".");
+	}
+	this->_mapping = mapping;
+	this->_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (this->_data == nullptr) {
+		this->close();
+		throw std::runtime_error("Cannot map file \"" + path.string() + "\".");
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Cannot open file \"" + path.string() + "\".");
+	struct stat fileStat {};
+	if (fstat(fd, &fileStat) != 0) {
+		::close(fd);
+		throw std::runtime_error("Cannot get the size of file \"" + path.string() + "\".");
+	}
+	this->_size = static_cast<std::size_t>(fileStat.st_size);
+	this->_opened = true;
+	if (this->_size == 0) {
+		::close(fd);
+		return;
+	}
+	void* data = mmap(nullptr, this->_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed.
+	::close(fd);
+	if (data == MAP_FAILED) {
+		this->_size = 0;
+		this->_opened = false;
+		throw std::runtime_error("Cannot map file \"" + path.string() + "\".");
+	}
+	this->_data = static_cast<const char*>(data);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+	_data(std::exchange(other._data, nullptr)),
+	_size(std::exchange(other._size, 0)),
+	_opened(std::exchange(other._opened, false))
+#ifdef _WIN32
+	,
+	_file(std::exchange(other._file, nullptr)),
+	_mapping(std::exchange(other._mapping, nullptr))
+#endif
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		this->close();
+		this->_data = std::exchange(other._data, nullptr);
+		this->_size = std::exchange(other._size, 0);
+		this->_opened = std::exchange(other._opened, false);
+#ifdef _WIN32
+		this->_file = std::exchange(other._file, nullptr);
+		this->_mapping = std::exchange(other._mapping, nullptr);
+#endif
+	}
+	return *this;
+}
+
+void MappedFile::close(void) {
+#ifdef _WIN32
+	if (this->_data != nullptr)
+		UnmapViewOfFile(this->_data);
+	if (this->_mapping != nullptr)
+		CloseHandle(this->_mapping);
+	if (this->_file != nullptr)
+		CloseHandle(this->_file);
+	this->_mapping = nullptr;
+	this->_file = nullptr;
+#else
+	if (this->_data != nullptr)
+		munmap(const_cast<char*>(this->_data), this->_size);
+#endif
+	this->_data = nullptr;
+	this->_size = 0;
+	this->_opened = false;
+}
+
+const MappedFile& BlobCache::open(const std::filesystem::path& path) {
+	std::string key = path.lexically_normal().string();
+	auto iter = this->_files.find(key);
+	if (iter == this->_files.end())
+		iter = this->_files.emplace(std::move(key), MappedFile(path)).first;
+	return iter->second;
+}
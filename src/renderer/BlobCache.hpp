@@ -0,0 +1,81 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+
+public:
+
+	/** @brief	Construct an empty mapping.
+	  */
+	MappedFile(std::nullptr_t) {}
+
+	/** @brief	Map the file into memory. Throw std::runtime_error if the file cannot be mapped.
+	  */
+	MappedFile(const std::filesystem::path& path);
+
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept;
+
+	~MappedFile(void) { this->close(); }
+
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	/** @brief	Unmap the file.
+	  */
+	void close(void);
+
+	bool has_value(void) const { return this->_data != nullptr || this->_opened; }
+
+	const char* data(void) const { return this->_data; }
+
+	std::size_t size(void) const { return this->_size; }
+
+private:
+
+	const char* _data = nullptr;
+	std::size_t _size = 0;
+	bool _opened = false; // Empty files are opened but have no mapping.
+#ifdef _WIN32
+	void* _file = nullptr;
+	void* _mapping = nullptr;
+#endif
+
+};
+
+// Memory mappings of binary files, keyed by file path.
+// A file referenced by many meshes is only opened and mapped once.
+class BlobCache {
+
+public:
+
+	BlobCache(void) = default;
+	BlobCache(const BlobCache&) = delete;
+	BlobCache(BlobCache&&) = default;
+	BlobCache& operator=(const BlobCache&) = delete;
+	BlobCache& operator=(BlobCache&&) = default;
+
+	/** @brief	Get the mapping of a file, mapping it on first use.
+	  *			Throw std::runtime_error if the file cannot be mapped.
+	  */
+	const MappedFile& open(const std::filesystem::path& path);
+
+	/** @brief	Unmap all files.
+	  */
+	void clear(void) { this->_files.clear(); }
+
+	std::size_t size(void) const { return this->_files.size(); }
+
+private:
+
+	std::map<std::string, MappedFile> _files{};
+
+};
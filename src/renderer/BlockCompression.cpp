@@ -0,0 +1,315 @@
+#include "BlockCompression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using Block = std::array<std::array<float, 4>, 16>;
+
+// Read the 4x4 block at (blockX, blockY), clamping texel coordinates to the image.
+static Block loadBlock(const unsigned char* pixels, std::uint32_t width, std::uint32_t height, std::uint32_t channels, std::uint32_t blockX, std::uint32_t blockY) {
+	Block block;
+	for (std::uint32_t y = 0; y < 4; ++y) {
+		for (std::uint32_t x = 0; x < 4; ++x) {
+			std::uint32_t sx = std::min(blockX * 4 + x, width - 1);
+			std::uint32_t sy = std::min(blockY * 4 + y, height - 1);
+			const unsigned char* texel = pixels + (std::size_t(sy) * width + sx) * channels;
+			std::array<float, 4>& color = block[y * 4 + x];
+			for (std::uint32_t c = 0; c < 4; ++c)
+				color[c] = (c < channels) ? static_cast<float>(texel[c]) : ((c == 3) ? 255.0f : 0.0f);
+		}
+	}
+	return block;
+}
+
+// Fit a line through the first `numChannels` channels of the block along its principal axis,
+// and return the two ends of the projected range.
+static void fitEndpoints(const Block& block, std::uint32_t numChannels, std::array<float, 4>& begin, std::array<float, 4>& end) {
+	std::array<float, 4> mean{}, lo, hi;
+	lo.fill(255.0f);
+	hi.fill(0.0f);
+	for (const auto& color : block)
+		for (std::uint32_t c = 0; c < numChannels; ++c) {
+			mean[c] += color[c] / 16.0f;
+			lo[c] = std::min(lo[c], color[c]);
+			hi[c] = std::max(hi[c], color[c]);
+		}
+	float covariance[4][4]{};
+	for (const auto& color : block)
+		for (std::uint32_t i = 0; i < numChannels; ++i)
+			for (std::uint32_t j = 0; j < numChannels; ++j)
+				covariance[i][j] += (color[i] - mean[i]) * (color[j] - mean[j]);
+	// Power iteration, starting from the diagonal of the bounding box.
+	std::array<float, 4> axis{};
+	for (std::uint32_t c = 0; c < numChannels; ++c)
+		axis[c] = hi[c] - lo[c];
+	for (int iteration = 0; iteration < 8; ++iteration) {
+		std::array<float, 4> next{};
+		for (std::uint32_t i = 0; i < numChannels; ++i)
+			for (std::uint32_t j = 0; j < numChannels; ++j)
+				next[i] += covariance[i][j] * axis[j];
+		float norm = 0.0f;
+		for (std::uint32_t c = 0; c < numChannels; ++c)
+			norm = std::max(norm, std::abs(next[c]));
+		if (norm == 0.0f)
+			break;
+		for (std::uint32_t c = 0; c < numChannels; ++c)
+			axis[c] = next[c] / norm;
+	}
+	float length2 = 0.0f;
+	for (std::uint32_t c = 0; c < numChannels; ++c)
+		length2 += axis[c] * axis[c];
+	if (length2 == 0.0f) {
+		// All texels are equal.
+		begin = end = mean;
+		return;
+	}
+	float tMin = 0.0f, tMax = 0.0f;
+	for (const auto& color : block) {
+		float t = 0.0f;
+		for (std::uint32_t c = 0; c < numChannels; ++c)
+			t += (color[c] - mean[c]) * axis[c];
+		t /= length2;
+		tMin = std::min(tMin, t);
+		tMax = std::max(tMax, t);
+	}
+	for (std::uint32_t c = 0; c < numChannels; ++c) {
+		begin[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+		end[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+	}
+}
+
+// Index of the palette entry closest to `color`.
+template <std::size_t N>
+static std::uint32_t nearest(const std::array<float, 4>& color, const std::array<std::array<float, 4>, N>& palette, std::uint32_t numChannels) {
+	std::uint32_t best = 0;
+	float bestError = std::numeric_limits<float>::max();
+	for (std::uint32_t i = 0; i < N; ++i) {
+		float error = 0.0f;
+		for (std::uint32_t c = 0; c < numChannels; ++c)
+			error += (color[c] - palette[i][c]) * (color[c] - palette[i][c]);
+		if (error < bestError) {
+			bestError = error;
+			best = i;
+		}
+	}
+	return best;
+}
+
+static std::uint16_t toRGB565(const std::array<float, 4>& color) {
+	auto quantize = [](float value, float maxValue) {
+		return static_cast<std::uint16_t>(std::lround(value / 255.0f * maxValue));
+	};
+	return static_cast<std::uint16_t>((quantize(color[0], 31.0f) << 11) | (quantize(color[1], 63.0f) << 5) | quantize(color[2], 31.0f));
+}
+
+static std::array<float, 4> fromRGB565(std::uint16_t packed) {
+	std::uint32_t r = (packed >> 11) & 31U, g = (packed >> 5) & 63U, b = packed & 31U;
+	return {
+		static_cast<float>((r << 3) | (r >> 2)),
+		static_cast<float>((g << 2) | (g >> 4)),
+		static_cast<float>((b << 3) | (b >> 2)),
+		255.0f
+	};
+}
+
+static void encodeBC1(const Block& block, unsigned char* dst) {
+	std::array<float, 4> begin, end;
+	fitEndpoints(block, 3, begin, end);
+	std::uint16_t color0 = toRGB565(end), color1 = toRGB565(begin);
+	// color0 > color1 selects the opaque four-color mode.
+	if (color0 < color1)
+		std::swap(color0, color1);
+	std::uint32_t indices = 0;
+	if (color0 != color1) {
+		std::array<std::array<float, 4>, 4> palette;
+		palette[0] = fromRGB565(color0);
+		palette[1] = fromRGB565(color1);
+		for (std::uint32_t c = 0; c < 3; ++c) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+		for (std::uint32_t i = 0; i < 16; ++i)
+			indices |= nearest(block[i], palette, 3) << (2 * i);
+	}
+	std::memcpy(dst, &color0, 2);
+	std::memcpy(dst + 2, &color1, 2);
+	std::memcpy(dst + 4, &indices, 4);
+}
+
+static void encodeBC4(const Block& block, std::uint32_t channel, unsigned char* dst) {
+	float lo = 255.0f, hi = 0.0f;
+	for (const auto& color : block) {
+		lo = std::min(lo, color[channel]);
+		hi = std::max(hi, color[channel]);
+	}
+	std::uint32_t alpha0 = static_cast<std::uint32_t>(hi), alpha1 = static_cast<std::uint32_t>(lo);
+	std::uint64_t indices = 0;
+	// alpha0 > alpha1 selects the eight-value mode: index 0 is alpha0, 1 is alpha1,
+	// and 2 to 7 step from alpha0 towards alpha1.
+	if (alpha0 > alpha1) {
+		for (std::uint32_t i = 0; i < 16; ++i) {
+			float step = (block[i][channel] - static_cast<float>(alpha1)) * 7.0f / static_cast<float>(alpha0 - alpha1);
+			std::uint64_t k = static_cast<std::uint64_t>(std::clamp(std::lround(step), 0L, 7L));
+			std::uint64_t index = (k == 7) ? 0 : ((k == 0) ? 1 : 8 - k);
+			indices |= index << (3 * i);
+		}
+	}
+	dst[0] = static_cast<unsigned char>(alpha0);
+	dst[1] = static_cast<unsigned char>(alpha1);
+	for (std::uint32_t b = 0; b < 6; ++b)
+		dst[2 + b] = static_cast<unsigned char>(indices >> (8 * b));
+}
+
+static void encodeBC7(const Block& block, unsigned char* dst) {
+	static constexpr std::uint32_t WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	std::array<float, 4> endpoints[2];
+	fitEndpoints(block, 4, endpoints[0], endpoints[1]);
+	// Mode 6 endpoints are 7 bits per channel plus one shared low bit per endpoint.
+	std::uint32_t quantized[2][4], pBits[2];
+	for (std::uint32_t e = 0; e < 2; ++e) {
+		float bestError = std::numeric_limits<float>::max();
+		for (std::uint32_t p = 0; p < 2; ++p) {
+			std::uint32_t candidate[4];
+			float error = 0.0f;
+			for (std::uint32_t c = 0; c < 4; ++c) {
+				candidate[c] = static_cast<std::uint32_t>(std::clamp(std::lround((endpoints[e][c] - static_cast<float>(p)) / 2.0f), 0L, 127L));
+				float reconstructed = static_cast<float>((candidate[c] << 1) | p);
+				error += (reconstructed - endpoints[e][c]) * (reconstructed - endpoints[e][c]);
+			}
+			if (error < bestError) {
+				bestError = error;
+				std::memcpy(quantized[e], candidate, sizeof(candidate));
+				pBits[e] = p;
+			}
+		}
+	}
+	std::array<std::array<float, 4>, 16> palette;
+	for (std::uint32_t i = 0; i < 16; ++i)
+		for (std::uint32_t c = 0; c < 4; ++c) {
+			std::uint32_t value0 = (quantized[0][c] << 1) | pBits[0];
+			std::uint32_t value1 = (quantized[1][c] << 1) | pBits[1];
+			palette[i][c] = static_cast<float>(((64 - WEIGHTS[i]) * value0 + WEIGHTS[i] * value1 + 32) >> 6);
+		}
+	std::uint32_t indices[16];
+	for (std::uint32_t i = 0; i < 16; ++i)
+		indices[i] = nearest(block[i], palette, 4);
+	// The first index is stored without its top bit, so it must be below 8.
+	if (indices[0] >= 8) {
+		std::swap(quantized[0], quantized[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (std::uint32_t& index : indices)
+			index = 15 - index;
+	}
+	std::memset(dst, 0, 16);
+	std::uint32_t position = 0;
+	auto put = [&](std::uint32_t value, std::uint32_t numBits) {
+		for (std::uint32_t b = 0; b < numBits; ++b, ++position)
+			if ((value >> b) & 1U)
+				dst[position >> 3] |= static_cast<unsigned char>(1U << (position & 7U));
+	};
+	put(1U << 6, 7); // Mode 6
+	for (std::uint32_t c = 0; c < 4; ++c) {
+		put(quantized[0][c], 7);
+		put(quantized[1][c], 7);
+	}
+	put(pBits[0], 1);
+	put(pBits[1], 1);
+	put(indices[0], 3);
+	for (std::uint32_t i = 1; i < 16; ++i)
+		put(indices[i], 4);
+}
+
+VkFormat blockVkFormat(BlockFormat format) {
+	switch (format) {
+	case BlockFormat::BC1:
+		return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case BlockFormat::BC4:
+		return VK_FORMAT_BC4_UNORM_BLOCK;
+	case BlockFormat::BC5:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	case BlockFormat::BC7:
+		return VK_FORMAT_BC7_UNORM_BLOCK;
+	default:
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+std::uint32_t blockBytes(BlockFormat format) {
+	switch (format) {
+	case BlockFormat::BC1:
+	case BlockFormat::BC4:
+		return 8;
+	case BlockFormat::BC5:
+	case BlockFormat::BC7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+std::size_t blockCompressedSize(BlockFormat format, std::uint32_t width, std::uint32_t height) {
+	return std::size_t((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+BlockFormat alphaBlockFormat(BlockFormat format, const unsigned char* pixels, std::uint32_t width, std::uint32_t height, std::uint32_t channels) {
+	if (format != BlockFormat::BC1 || channels != 4)
+		return format;
+	std::size_t numTexels = std::size_t(width) * height;
+	for (std::size_t i = 0; i < numTexels; ++i)
+		if (pixels[i * 4 + 3] != 255)
+			return BlockFormat::BC7;
+	return format;
+}
+
+std::vector<unsigned char> compressBlocks(BlockFormat format, const unsigned char* pixels, std::uint32_t width, std::uint32_t height, std::uint32_t channels) {
+	std::vector<unsigned char> blocks(blockCompressedSize(format, width, height));
+	std::uint32_t numBlocksX = (width + 3) / 4, numBlocksY = (height + 3) / 4;
+	unsigned char* dst = blocks.data();
+	for (std::uint32_t by = 0; by < numBlocksY; ++by) {
+		for (std::uint32_t bx = 0; bx < numBlocksX; ++bx) {
+			Block block = loadBlock(pixels, width, height, channels, bx, by);
+			switch (format) {
+			case BlockFormat::BC1:
+				encodeBC1(block, dst);
+				break;
+			case BlockFormat::BC4:
+				encodeBC4(block, 0, dst);
+				break;
+			case BlockFormat::BC5:
+				encodeBC4(block, 0, dst);
+				encodeBC4(block, 1, dst + 8);
+				break;
+			case BlockFormat::BC7:
+				encodeBC7(block, dst);
+				break;
+			default:
+				break;
+			}
+			dst += blockBytes(format);
+		}
+	}
+	return blocks;
+}
+
+std::vector<unsigned char> compressMipChain(
+	BlockFormat format,
+	const unsigned char* pixels,
+	const std::vector<unsigned char>& mipChain,
+	std::uint32_t width,
+	std::uint32_t height,
+	std::uint32_t channels
+) {
+	std::vector<unsigned char> blocks = compressBlocks(format, pixels, width, height, channels);
+	const unsigned char* level = mipChain.data();
+	while (width > 1 || height > 1) {
+		width = std::max(width / 2U, 1U);
+		height = std::max(height / 2U, 1U);
+		std::vector<unsigned char> levelBlocks = compressBlocks(format, level, width, height, channels);
+		blocks.insert(blocks.end(), levelBlocks.begin(), levelBlocks.end());
+		level += std::size_t(width) * height * channels;
+	}
+	return blocks;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Block-compressed texture formats produced by the CPU encoder.
+// Every format stores 4x4 texel blocks; levels whose size is not a multiple of 4
+// are padded by repeating their last row and column.
+//
+// BC1: RGB, 8 bytes per block. Alpha is ignored, so images with alpha use BC7 instead (see alphaBlockFormat).
+// BC4: one channel, 8 bytes per block.
+// BC5: two channels (red and green), 16 bytes per block.
+// BC7: RGBA, 16 bytes per block. Only mode 6 (one subset, 4-bit indices) is produced.
+enum class BlockFormat {
+	NONE = 0,
+	BC1 = 1,
+	BC4 = 2,
+	BC5 = 3,
+	BC7 = 4,
+};
+
+/** @brief	Vulkan format of `format`. Return VK_FORMAT_UNDEFINED for BlockFormat::NONE.
+  */
+VkFormat blockVkFormat(BlockFormat format);
+
+/** @brief	Number of bytes of a 4x4 block. Return 0 for BlockFormat::NONE.
+  */
+std::uint32_t blockBytes(BlockFormat format);
+
+/** @brief	Number of bytes of a `width` x `height` level.
+  */
+std::size_t blockCompressedSize(BlockFormat format, std::uint32_t width, std::uint32_t height);
+
+/** @brief	Format to encode an 8-bit image requested as `format` with.
+  *			BC1 becomes BC7 if the image has 4 channels and any texel with an alpha below 255.
+  */
+BlockFormat alphaBlockFormat(BlockFormat format, const unsigned char* pixels, std::uint32_t width, std::uint32_t height, std::uint32_t channels);
+
+/** @brief	Encode an 8-bit image with `channels` interleaved channels.
+  *			BC1 and BC7 read RGB(A), BC5 reads red and green, and BC4 reads red.
+  *			Missing channels read as 0, except alpha, which reads as 255.
+  */
+std::vector<unsigned char> compressBlocks(BlockFormat format, const unsigned char* pixels, std::uint32_t width, std::uint32_t height, std::uint32_t channels);
+
+/** @brief	Encode level 0 and the mip chain built by buildMipChain, storing all levels back to back.
+  */
+std::vector<unsigned char> compressMipChain(
+	BlockFormat format,
+	const unsigned char* pixels,
+	const std::vector<unsigned char>& mipChain,
+	std::uint32_t width,
+	std::uint32_t height,
+	std::uint32_t channels
+);
@@ -0,0 +1,39 @@
+#include "ChannelPack.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Bilinear sample of `source` at the center of texel (x, y) of a `width` x `height` image.
+static unsigned char sampleChannel(const ChannelSource& source, std::uint32_t x, std::uint32_t y, std::uint32_t width, std::uint32_t height) {
+	if (source.width == width && source.height == height)
+		return source.pixels[std::size_t(y) * width + x];
+	float u = std::max((x + 0.5f) * source.width / width - 0.5f, 0.0f);
+	float v = std::max((y + 0.5f) * source.height / height - 0.5f, 0.0f);
+	std::uint32_t x0 = std::min(static_cast<std::uint32_t>(u), source.width - 1);
+	std::uint32_t y0 = std::min(static_cast<std::uint32_t>(v), source.height - 1);
+	std::uint32_t x1 = std::min(x0 + 1, source.width - 1);
+	std::uint32_t y1 = std::min(y0 + 1, source.height - 1);
+	float fu = u - x0, fv = v - y0;
+	auto texel = [&](std::uint32_t sx, std::uint32_t sy) { return static_cast<float>(source.pixels[std::size_t(sy) * source.width + sx]); };
+	float top = texel(x0, y0) * (1.0f - fu) + texel(x1, y0) * fu;
+	float bottom = texel(x0, y1) * (1.0f - fu) + texel(x1, y1) * fu;
+	return static_cast<unsigned char>(std::clamp(std::round(top * (1.0f - fv) + bottom * fv), 0.0f, 255.0f));
+}
+
+std::vector<unsigned char> packChannels(const std::array<ChannelSource, 3>& sources, std::uint32_t& width, std::uint32_t& height) {
+	width = height = 1;
+	for (const ChannelSource& source : sources) {
+		if (source.pixels != nullptr) {
+			width = std::max(width, source.width);
+			height = std::max(height, source.height);
+		}
+	}
+	std::vector<unsigned char> packed(std::size_t(width) * height * 4, 255);
+	for (std::uint32_t c = 0; c < 3; ++c) {
+		const ChannelSource& source = sources[c];
+		for (std::uint32_t y = 0; y < height; ++y)
+			for (std::uint32_t x = 0; x < width; ++x)
+				packed[(std::size_t(y) * width + x) * 4 + c] = (source.pixels != nullptr) ? sampleChannel(source, x, y, width, height) : source.fill;
+	}
+	return packed;
+}
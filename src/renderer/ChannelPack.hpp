@@ -0,0 +1,20 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// One 8-bit, single-channel image to be interleaved by packChannels.
+// A source without pixels is filled with `fill` instead.
+struct ChannelSource {
+	const unsigned char* pixels = nullptr;
+	std::uint32_t width = 0;
+	std::uint32_t height = 0;
+	unsigned char fill = 0;
+};
+
+/** @brief	Interleave three single-channel images into the red, green and blue channels of an RGBA image.
+  *			Alpha is 255. The result is as wide and as high as the largest sources (1x1 if none has pixels),
+  *			and smaller sources are resampled bilinearly.
+  */
+std::vector<unsigned char> packChannels(const std::array<ChannelSource, 3>& sources, std::uint32_t& width, std::uint32_t& height);
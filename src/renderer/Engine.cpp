@@ -2,6 +2,8 @@
 #include <fstream>
 #include <exception>
 #include <stdexcept>
+#include <future>
+#include <mutex>
 #include <imgui.h>
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_vulkan.h>
@@ -20,6 +22,36 @@ static struct {
 	} ssao;
 } ui;
 
+// Meshes share the buffers of the geometry arena, so consecutive draws
+// usually keep the same bindings. Redundant binds are skipped.
+class GeometryBinding {
+
+public:
+
+	GeometryBinding(VkCommandBuffer commandBuffer) : commandBuffer(commandBuffer) {}
+
+	void bind(VkBuffer vertexBuffer, VkBuffer indexBuffer, VkIndexType indexType) {
+		if (vertexBuffer != this->vertexBuffer) {
+			VkDeviceSize vertexBufferOffset = 0;
+			vkCmdBindVertexBuffers(this->commandBuffer, 0, 1, &vertexBuffer, &vertexBufferOffset);
+			this->vertexBuffer = vertexBuffer;
+		}
+		if (indexBuffer != this->indexBuffer || indexType != this->indexType) {
+			vkCmdBindIndexBuffer(this->commandBuffer, indexBuffer, 0, indexType);
+			this->indexBuffer = indexBuffer;
+			this->indexType = indexType;
+		}
+	}
+
+private:
+
+	VkCommandBuffer commandBuffer;
+	VkBuffer vertexBuffer = nullptr;
+	VkBuffer indexBuffer = nullptr;
+	VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+
+};
+
 void Engine::setCameraMode(CameraMode cameraMode, std::optional<std::string> camera) {
 	switch (cameraMode) {
 	case CameraMode::USER:
@@ -40,6 +72,14 @@ void Engine::setCameraMode(CameraMode cameraMode, std::optional<std::string> cam
 	this->cameraMode = cameraMode;
 }
 
+void Engine::setTextureCompression(TextureCompression compression) {
+	if (compression != TextureCompression::NONE && !this->textureCompressionBC) {
+		std::cerr << "Block-compressed textures are not enabled on this device. Material textures are loaded uncompressed." << std::endl;
+		compression = TextureCompression::NONE;
+	}
+	this->textureCompression = compression;
+}
+
 void Engine::drawFrame() {
 	// Compute play time
 	float now = this->clock->now();
@@ -51,7 +91,14 @@ void Engine::drawFrame() {
 		}
 	}
 	this->currClockTime = now;
+	if (this->pScene72->streamer != nullptr) {
+		// Streaming creates resources, so it waits while a preload holds them.
+		std::unique_lock<std::mutex> resourceLock(this->resourceMutex, std::try_to_lock);
+		if (resourceLock.owns_lock())
+			this->updateStreaming(*this->pScene72);
+	}
 	vkWaitForFences(*this->context.device(), 1, &this->frameData[this->currentFrame].inFlightFence, VK_TRUE, UINT64_MAX);
+	this->destroyRetiredScenes();
 
 	uint32_t imageIndex;
 	if (!this->offscreen) {
@@ -107,7 +154,9 @@ void Engine::drawFrame() {
 	// Traverse the scene to get the instances to render, the environment model matrix, and camera transforms
 	struct InstanceToDraw {
 		jjyou::glsl::mat4 transform;
-		s72::Mesh::Ptr mesh;
+		jjyou::glsl::mat4 normal;
+		s72::Mesh* mesh;
+		const s72::Material* material;
 	};
 	SkyboxUniform skyboxUniform{
 		.model = jjyou::glsl::mat4(1.0f)
@@ -127,127 +176,6 @@ void Engine::drawFrame() {
 	std::array<SphereLightShadowMapUniform, Engine::MAX_NUM_SPHERE_LIGHTS> sphereLightShadowMapUniforms{};
 	std::array<SunLightShadowMapUniform, Engine::MAX_NUM_SUN_LIGHTS> sunLightShadowMapUniforms{};
 	std::unordered_map<std::string, CameraInfo> cameraInfos;
-	std::function<bool(s72::Node::Ptr, const jjyou::glsl::mat4&)> traverseSceneVisitor =
-		[&](s72::Node::Ptr node, const jjyou::glsl::mat4& transform) -> bool {
-		if (!node->mesh.expired()) {
-			s72::Mesh::Ptr mesh = node->mesh.lock();
-			InstanceToDraw instanceToDraw{ .transform = transform, .mesh = mesh };
-			if (mesh->material.lock()->materialType == "simple")
-				simpleInstances.push_back(instanceToDraw);
-			else if (mesh->material.lock()->materialType == "mirror")
-				mirrorInstances.push_back(instanceToDraw);
-			else if (mesh->material.lock()->materialType == "environment")
-				environmentInstances.push_back(instanceToDraw);
-			else if (mesh->material.lock()->materialType == "lambertian")
-				lambertianInstances.push_back(instanceToDraw);
-			else if (mesh->material.lock()->materialType == "pbr")
-				pbrInstances.push_back(instanceToDraw);
-		}
-		if (!node->environment.expired()) {
-			skyboxUniform.model = jjyou::glsl::inverse(jjyou::glsl::mat3(transform));
-		}
-		if (!node->camera.expired()) {
-			s72::Camera::Ptr camera = node->camera.lock();
-			cameraInfos.emplace(
-				camera->name,
-				CameraInfo{
-					.aspectRatio = camera->getAspectRatio(),
-					.projection = camera->getProjectionMatrix(),
-					.view = jjyou::glsl::inverse(transform)
-				}
-			);
-		}
-		if (!node->light.expired()) {
-			s72::Light::Ptr light = node->light.lock();
-			if (light->lightType == "sun") {
-				s72::SunLight::Ptr sunLight = std::reinterpret_pointer_cast<s72::SunLight>(light);
-				jjyou::glsl::vec3 direction = jjyou::glsl::normalized(jjyou::glsl::vec3(transform[2]));
-				jjyou::glsl::vec3 orthoX{ 1.0f, 0.0f, 0.0f };
-				if (jjyou::glsl::norm(orthoX - direction) <= 1e-1f)
-					orthoX = jjyou::glsl::vec3(0.0f, 1.0f, 0.0f);
-				jjyou::glsl::vec3 orthoY = jjyou::glsl::cross(-direction, orthoX);
-				orthoX = jjyou::glsl::cross(orthoY, -direction);
-				Engine::SunLight sunLightUniform{
-					.cascadeSplits = {}, // To set
-					.orthographic = {}, // To set
-					.direction = direction,
-					.angle = sunLight->angle,
-					.tint = sunLight->tint * sunLight->strength,
-					.shadow = static_cast<int>(sunLight->shadow)
-				};
-				Engine::SunLightShadowMapUniform sunLightShadowMapUniform{
-					.orthoX = orthoX,
-					.orthoY = orthoY,
-					.center = {}, // To set
-					.width = {}, // To set
-					.height = {}, // To set
-					.zNear = {}, // To set
-					.zFar = {} // To set
-				};
-				if (sunLight->shadow == 0) {
-					lights.sunLightsNoShadow[lights.numSunLightsNoShadow] = sunLightUniform;
-					++lights.numSunLightsNoShadow;
-				}
-				else {
-					lights.sunLights[lights.numSunLights] = sunLightUniform;
-					sunLightShadowMapUniforms[lights.numSunLights] = sunLightShadowMapUniform;
-					++lights.numSunLights;
-				}
-			}
-			else if (light->lightType == "sphere") {
-				s72::SphereLight::Ptr sphereLight = std::reinterpret_pointer_cast<s72::SphereLight>(light);
-				Engine::SphereLight sphereLightUniform{
-					.position = jjyou::glsl::vec3(transform[3]),
-					.radius = sphereLight->radius,
-					.tint = sphereLight->tint * sphereLight->power,
-					.limit = sphereLight->limit
-				};
-				Engine::SphereLightShadowMapUniform sphereLightShadowMapUniform{
-					.position = sphereLightUniform.position,
-					.radius = sphereLightUniform.radius,
-					.perspective = jjyou::glsl::perspective(std::numbers::pi_v<float> / 2.0f, 1.0f, sphereLightUniform.radius / std::sqrt(2.0f), sphereLightUniform.limit),
-					.limit = sphereLightUniform.limit
-				};
-				if (sphereLight->shadow == 0) {
-					lights.sphereLightsNoShadow[lights.numSphereLightsNoShadow] = sphereLightUniform;
-					++lights.numSphereLightsNoShadow;
-				}
-				else {
-					lights.sphereLights[lights.numSphereLights] = sphereLightUniform;
-					sphereLightShadowMapUniforms[lights.numSphereLights] = sphereLightShadowMapUniform;
-					++lights.numSphereLights;
-				}
-			}
-			else if (light->lightType == "spot") {
-				s72::SpotLight::Ptr spotLight = std::reinterpret_pointer_cast<s72::SpotLight>(light);
-				jjyou::glsl::mat4 invZ = jjyou::glsl::mat4(1.0f); invZ[2][2] = -1.0f; invZ[0][0] = -1.0f;
-				Engine::SpotLight spotLightUniform{
-					.perspective = jjyou::glsl::perspective(spotLight->fov, 1.0f, std::cos(spotLight->fov / 2.0f) * spotLight->radius, spotLight->limit) * invZ * jjyou::glsl::inverse(transform),
-					.position = jjyou::glsl::vec3(transform[3]),
-					.radius = spotLight->radius,
-					.direction = jjyou::glsl::normalized(jjyou::glsl::vec3(transform[2])),
-					.fov = spotLight->fov,
-					.tint = spotLight->tint * spotLight->power,
-					.blend = spotLight->blend,
-					.limit = spotLight->limit,
-					.shadow = static_cast<int>(spotLight->shadow)
-				};
-				Engine::SpotLightShadowMapUniform spotLightShadowMapUniform{
-					.perspective = spotLightUniform.perspective,
-				};
-				if (spotLight->shadow == 0) {
-					lights.spotLightsNoShadow[lights.numSpotLightsNoShadow] = spotLightUniform;
-					++lights.numSpotLightsNoShadow;
-				}
-				else {
-					lights.spotLights[lights.numSpotLights] = spotLightUniform;
-					spotLightShadowMapUniforms[lights.numSpotLights] = spotLightShadowMapUniform;
-					++lights.numSpotLights;
-				}
-			}
-		}
-		return true;
-		};
 	if (this->pScene72 != nullptr) {
 		//Scene72 are "+z" up, however in our coordinate the scene is "-y" up
 		jjyou::glsl::mat4 rootTransform;
@@ -255,11 +183,130 @@ void Engine::drawFrame() {
 		rootTransform[2][1] = -1.0f;
 		rootTransform[1][2] = 1.0f;
 		rootTransform[3][3] = 1.0f;
-		this->pScene72->traverse(
-			this->currPlayTime,
-			rootTransform,
-			traverseSceneVisitor
-		);
+		this->pScene72->update(this->currPlayTime, rootTransform, *this->jobSystem);
+		const s72::SceneGraph& sceneGraph = this->pScene72->sceneGraph;
+		for (std::uint32_t i = 0; i < sceneGraph.numInstances(); ++i) {
+			const jjyou::glsl::mat4& transform = sceneGraph.worldTransforms[i];
+			// Meshes of a progressively loaded scene are skipped until their geometry is resident.
+			s72::Mesh* mesh = sceneGraph.meshes[i];
+			if (mesh != nullptr && mesh->resident()) {
+				const s72::Material* material = sceneGraph.materials[i];
+				InstanceToDraw instanceToDraw{ .transform = transform, .normal = sceneGraph.normalTransforms[i], .mesh = mesh, .material = material };
+				if (material->materialType == "simple")
+					simpleInstances.push_back(instanceToDraw);
+				else if (material->materialType == "mirror")
+					mirrorInstances.push_back(instanceToDraw);
+				else if (material->materialType == "environment")
+					environmentInstances.push_back(instanceToDraw);
+				else if (material->materialType == "lambertian")
+					lambertianInstances.push_back(instanceToDraw);
+				else if (material->materialType == "pbr")
+					pbrInstances.push_back(instanceToDraw);
+			}
+			if (sceneGraph.environments[i]) {
+				skyboxUniform.model = jjyou::glsl::inverse(jjyou::glsl::mat3(transform));
+			}
+			if (sceneGraph.cameras[i] != nullptr) {
+				const s72::Camera* camera = sceneGraph.cameras[i];
+				cameraInfos.emplace(
+					camera->name,
+					CameraInfo{
+						.aspectRatio = camera->getAspectRatio(),
+						.projection = camera->getProjectionMatrix(),
+						.view = jjyou::glsl::inverse(transform)
+					}
+				);
+			}
+			if (sceneGraph.lights[i] != nullptr) {
+				const s72::Light* light = sceneGraph.lights[i];
+				if (light->lightType == "sun") {
+					const s72::SunLight* sunLight = static_cast<const s72::SunLight*>(light);
+					jjyou::glsl::vec3 direction = jjyou::glsl::normalized(jjyou::glsl::vec3(transform[2]));
+					jjyou::glsl::vec3 orthoX{ 1.0f, 0.0f, 0.0f };
+					if (jjyou::glsl::norm(orthoX - direction) <= 1e-1f)
+						orthoX = jjyou::glsl::vec3(0.0f, 1.0f, 0.0f);
+					jjyou::glsl::vec3 orthoY = jjyou::glsl::cross(-direction, orthoX);
+					orthoX = jjyou::glsl::cross(orthoY, -direction);
+					Engine::SunLight sunLightUniform{
+						.cascadeSplits = {}, // To set
+						.orthographic = {}, // To set
+						.direction = direction,
+						.angle = sunLight->angle,
+						.tint = sunLight->tint * sunLight->strength,
+						.shadow = static_cast<int>(sunLight->shadow)
+					};
+					Engine::SunLightShadowMapUniform sunLightShadowMapUniform{
+						.orthoX = orthoX,
+						.orthoY = orthoY,
+						.center = {}, // To set
+						.width = {}, // To set
+						.height = {}, // To set
+						.zNear = {}, // To set
+						.zFar = {} // To set
+					};
+					if (sunLight->shadow == 0) {
+						lights.sunLightsNoShadow[lights.numSunLightsNoShadow] = sunLightUniform;
+						++lights.numSunLightsNoShadow;
+					}
+					else {
+						lights.sunLights[lights.numSunLights] = sunLightUniform;
+						sunLightShadowMapUniforms[lights.numSunLights] = sunLightShadowMapUniform;
+						++lights.numSunLights;
+					}
+				}
+				else if (light->lightType == "sphere") {
+					const s72::SphereLight* sphereLight = static_cast<const s72::SphereLight*>(light);
+					Engine::SphereLight sphereLightUniform{
+						.position = jjyou::glsl::vec3(transform[3]),
+						.radius = sphereLight->radius,
+						.tint = sphereLight->tint * sphereLight->power,
+						.limit = sphereLight->limit
+					};
+					Engine::SphereLightShadowMapUniform sphereLightShadowMapUniform{
+						.position = sphereLightUniform.position,
+						.radius = sphereLightUniform.radius,
+						.perspective = jjyou::glsl::perspective(std::numbers::pi_v<float> / 2.0f, 1.0f, sphereLightUniform.radius / std::sqrt(2.0f), sphereLightUniform.limit),
+						.limit = sphereLightUniform.limit
+					};
+					if (sphereLight->shadow == 0) {
+						lights.sphereLightsNoShadow[lights.numSphereLightsNoShadow] = sphereLightUniform;
+						++lights.numSphereLightsNoShadow;
+					}
+					else {
+						lights.sphereLights[lights.numSphereLights] = sphereLightUniform;
+						sphereLightShadowMapUniforms[lights.numSphereLights] = sphereLightShadowMapUniform;
+						++lights.numSphereLights;
+					}
+				}
+				else if (light->lightType == "spot") {
+					const s72::SpotLight* spotLight = static_cast<const s72::SpotLight*>(light);
+					jjyou::glsl::mat4 invZ = jjyou::glsl::mat4(1.0f); invZ[2][2] = -1.0f; invZ[0][0] = -1.0f;
+					Engine::SpotLight spotLightUniform{
+						.perspective = jjyou::glsl::perspective(spotLight->fov, 1.0f, std::cos(spotLight->fov / 2.0f) * spotLight->radius, spotLight->limit) * invZ * jjyou::glsl::inverse(transform),
+						.position = jjyou::glsl::vec3(transform[3]),
+						.radius = spotLight->radius,
+						.direction = jjyou::glsl::normalized(jjyou::glsl::vec3(transform[2])),
+						.fov = spotLight->fov,
+						.tint = spotLight->tint * spotLight->power,
+						.blend = spotLight->blend,
+						.limit = spotLight->limit,
+						.shadow = static_cast<int>(spotLight->shadow)
+					};
+					Engine::SpotLightShadowMapUniform spotLightShadowMapUniform{
+						.perspective = spotLightUniform.perspective,
+					};
+					if (spotLight->shadow == 0) {
+						lights.spotLightsNoShadow[lights.numSpotLightsNoShadow] = spotLightUniform;
+						++lights.numSpotLightsNoShadow;
+					}
+					else {
+						lights.spotLights[lights.numSpotLights] = spotLightUniform;
+						spotLightShadowMapUniforms[lights.numSpotLights] = spotLightShadowMapUniform;
+						++lights.numSpotLights;
+					}
+				}
+			}
+		}
 	}
 
 	// Get view matrices and culling matrices
@@ -389,16 +436,20 @@ void Engine::drawFrame() {
 	// Fill model matrix dynamic uniform buffer
 	std::size_t instanceCount = 0;
 	for (const auto& instancesToDraw : { std::cref(simpleInstances), std::cref(mirrorInstances), std::cref(environmentInstances), std::cref(lambertianInstances), std::cref(pbrInstances) }) {
-		for (const auto& instanceToDraw : instancesToDraw.get()) {
-			std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
-			instanceCount++;
-			Engine::ObjectLevelUniform objectLevelUniform{
-				.model = instanceToDraw.transform,
-				.normal = jjyou::glsl::transpose(jjyou::glsl::inverse(instanceToDraw.transform))
-			};
-			char* dst = reinterpret_cast<char*>(this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformBufferMemory.mappedAddress()) + dynamicOffset;
-			memcpy(reinterpret_cast<void*>(dst), &objectLevelUniform, sizeof(Engine::ObjectLevelUniform));
-		}
+		std::size_t firstInstance = instanceCount;
+		this->jobSystem->parallelFor(instancesToDraw.get().size(), 1024, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				const InstanceToDraw& instanceToDraw = instancesToDraw.get()[i];
+				std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * (firstInstance + i));
+				Engine::ObjectLevelUniform objectLevelUniform{
+					.model = instanceToDraw.transform,
+					.normal = instanceToDraw.normal
+				};
+				char* dst = reinterpret_cast<char*>(this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformBufferMemory.mappedAddress()) + dynamicOffset;
+				memcpy(reinterpret_cast<void*>(dst), &objectLevelUniform, sizeof(Engine::ObjectLevelUniform));
+			}
+		});
+		instanceCount += instancesToDraw.get().size();
 	}
 	
 	// Record command buffer
@@ -448,14 +499,14 @@ void Engine::drawFrame() {
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &shadowMappingScissor);
 			vkCmdPushConstants(this->frameData[this->currentFrame].graphicsCommandBuffer, this->spotlightPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0U, sizeof(Engine::SpotLightShadowMapUniform), &spotLightShadowMapUniforms[i]);
 			instanceCount = static_cast<std::uint32_t>(simpleInstances.size()); // Skip simple material
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instancesToDraw : { std::cref(mirrorInstances), std::cref(environmentInstances), std::cref(lambertianInstances), std::cref(pbrInstances) }) {
 				for (const auto& instanceToDraw : instancesToDraw.get()) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->positionBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					instanceCount++;
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->spotlightPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstPosition, 0);
 				}
 			}
 			vkCmdEndRenderPass(this->frameData[this->currentFrame].graphicsCommandBuffer);
@@ -494,14 +545,14 @@ void Engine::drawFrame() {
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &shadowMappingScissor);
 			vkCmdPushConstants(this->frameData[this->currentFrame].graphicsCommandBuffer, this->spherelightPipelineLayout, VK_SHADER_STAGE_GEOMETRY_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0U, sizeof(Engine::SphereLightShadowMapUniform), &sphereLightShadowMapUniforms[i]);
 			instanceCount = static_cast<std::uint32_t>(simpleInstances.size()); // Skip simple material
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instancesToDraw : { std::cref(mirrorInstances), std::cref(environmentInstances), std::cref(lambertianInstances), std::cref(pbrInstances) }) {
 				for (const auto& instanceToDraw : instancesToDraw.get()) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->positionBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					instanceCount++;
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->spherelightPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstPosition, 0);
 				}
 			}
 			vkCmdEndRenderPass(this->frameData[this->currentFrame].graphicsCommandBuffer);
@@ -540,14 +591,14 @@ void Engine::drawFrame() {
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &shadowMappingScissor);
 			vkCmdPushConstants(this->frameData[this->currentFrame].graphicsCommandBuffer, this->sunlightPipelineLayout, VK_SHADER_STAGE_GEOMETRY_BIT, 0U, sizeof(Engine::SunLightShadowMapUniform), &sunLightShadowMapUniforms[i]);
 			instanceCount = static_cast<std::uint32_t>(simpleInstances.size()); // Skip simple material
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instancesToDraw : { std::cref(mirrorInstances), std::cref(environmentInstances), std::cref(lambertianInstances), std::cref(pbrInstances) }) {
 				for (const auto& instanceToDraw : instancesToDraw.get()) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->positionBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					instanceCount++;
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->sunlightPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstPosition, 0);
 				}
 			}
 			vkCmdEndRenderPass(this->frameData[this->currentFrame].graphicsCommandBuffer);
@@ -622,21 +673,21 @@ void Engine::drawFrame() {
 			};
 			instanceCount = static_cast<std::uint32_t>(simpleInstances.size() + mirrorInstances.size() + environmentInstances.size() + lambertianInstances.size()); // Skip material other than pbr
 			vkCmdBeginRenderPass(this->frameData[this->currentFrame].graphicsCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-			vkCmdBindPipeline(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrDeferredPipeline);
+			vkCmdBindPipeline(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pScene72->compactVertices ? this->pbrDeferredCompactPipeline : this->pbrDeferredPipeline);
 			vkCmdSetViewport(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneViewport);
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneScissor);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrDeferredPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].viewLevelUniformDescriptorSet, 0, nullptr);
 			//vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrDeferredPipelineLayout, 3, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].skyboxUniformDescriptorSet, 0, nullptr);
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instanceToDraw : pbrInstances) {
 				if (this->cullingMode == CullingMode::NONE ||
 					this->cullingMode == CullingMode::FRUSTUM && instanceToDraw.mesh->bbox.insideFrustum(debugProjection, debugView, instanceToDraw.transform)
 					) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->vertexBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrDeferredPipelineLayout, 1, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrDeferredPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.mesh->material.lock()->idx], 0, nullptr);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrDeferredPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.material->idx], 0, nullptr);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstVertex, 0);
 				}
 				instanceCount++;
 			}
@@ -747,75 +798,75 @@ void Engine::drawFrame() {
 			vkCmdSetViewport(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneViewport);
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneScissor);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->simpleForwardPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].viewLevelUniformDescriptorSet, 0, nullptr);
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instanceToDraw : simpleInstances) {
 				if (this->cullingMode == CullingMode::NONE ||
 					this->cullingMode == CullingMode::FRUSTUM && instanceToDraw.mesh->bbox.insideFrustum(debugProjection, debugView, instanceToDraw.transform)
 					) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->vertexBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->simpleForwardPipelineLayout, 1, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstVertex, 0);
 				}
 				instanceCount++;
 			}
 		}
 		if (!mirrorInstances.empty()) {
-			vkCmdBindPipeline(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->mirrorForwardPipeline);
+			vkCmdBindPipeline(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pScene72->compactVertices ? this->mirrorForwardCompactPipeline : this->mirrorForwardPipeline);
 			vkCmdSetViewport(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneViewport);
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneScissor);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->mirrorForwardPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].viewLevelUniformDescriptorSet, 0, nullptr);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->mirrorForwardPipelineLayout, 3, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].skyboxUniformDescriptorSet, 0, nullptr);
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instanceToDraw : mirrorInstances) {
 				if (this->cullingMode == CullingMode::NONE ||
 					this->cullingMode == CullingMode::FRUSTUM && instanceToDraw.mesh->bbox.insideFrustum(debugProjection, debugView, instanceToDraw.transform)
 					) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->vertexBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->mirrorForwardPipelineLayout, 1, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->mirrorForwardPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.mesh->material.lock()->idx], 0, nullptr);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->mirrorForwardPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.material->idx], 0, nullptr);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstVertex, 0);
 				}
 				instanceCount++;
 			}
 		}
 		if (!environmentInstances.empty()) {
-			vkCmdBindPipeline(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->environmentForwardPipeline);
+			vkCmdBindPipeline(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pScene72->compactVertices ? this->environmentForwardCompactPipeline : this->environmentForwardPipeline);
 			vkCmdSetViewport(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneViewport);
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneScissor);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->environmentForwardPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].viewLevelUniformDescriptorSet, 0, nullptr);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->environmentForwardPipelineLayout, 3, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].skyboxUniformDescriptorSet, 0, nullptr);
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instanceToDraw : environmentInstances) {
 				if (this->cullingMode == CullingMode::NONE ||
 					this->cullingMode == CullingMode::FRUSTUM && instanceToDraw.mesh->bbox.insideFrustum(debugProjection, debugView, instanceToDraw.transform)
 					) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->vertexBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->environmentForwardPipelineLayout, 1, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->environmentForwardPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.mesh->material.lock()->idx], 0, nullptr);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->environmentForwardPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.material->idx], 0, nullptr);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstVertex, 0);
 				}
 				instanceCount++;
 			}
 		}
 		if (!lambertianInstances.empty()) {
-			vkCmdBindPipeline(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->lambertianForwardPipeline);
+			vkCmdBindPipeline(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pScene72->compactVertices ? this->lambertianForwardCompactPipeline : this->lambertianForwardPipeline);
 			vkCmdSetViewport(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneViewport);
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneScissor);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->lambertianForwardPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].viewLevelUniformDescriptorSet, 0, nullptr);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->lambertianForwardPipelineLayout, 3, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].skyboxUniformDescriptorSet, 0, nullptr);
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instanceToDraw : lambertianInstances) {
 				if (this->cullingMode == CullingMode::NONE ||
 					this->cullingMode == CullingMode::FRUSTUM && instanceToDraw.mesh->bbox.insideFrustum(debugProjection, debugView, instanceToDraw.transform)
 					) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->vertexBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->lambertianForwardPipelineLayout, 1, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->lambertianForwardPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.mesh->material.lock()->idx], 0, nullptr);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->lambertianForwardPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.material->idx], 0, nullptr);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstVertex, 0);
 				}
 				instanceCount++;
 			}
@@ -826,16 +877,16 @@ void Engine::drawFrame() {
 			vkCmdSetScissor(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &sceneScissor);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrPipelineLayout, 0, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].viewLevelUniformDescriptorSet, 0, nullptr);
 			vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrPipelineLayout, 3, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].skyboxUniformDescriptorSet, 0, nullptr);
+			GeometryBinding geometryBinding(this->frameData[this->currentFrame].graphicsCommandBuffer);
 			for (const auto& instanceToDraw : pbrInstances) {
 				if (this->cullingMode == CullingMode::NONE ||
 					this->cullingMode == CullingMode::FRUSTUM && instanceToDraw.mesh->bbox.insideFrustum(debugProjection, debugView, instanceToDraw.transform)
 					) {
-					VkDeviceSize vertexBufferOffsets = 0;
-					vkCmdBindVertexBuffers(this->frameData[this->currentFrame].graphicsCommandBuffer, 0, 1, &instanceToDraw.mesh->vertexBuffer, &vertexBufferOffsets);
+					geometryBinding.bind(instanceToDraw.mesh->vertexBuffer, instanceToDraw.mesh->indexBuffer, instanceToDraw.mesh->indexType);
 					std::uint32_t dynamicOffset = static_cast<std::uint32_t>(dynamicBufferOffset * instanceCount);
 					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrPipelineLayout, 1, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].objectLevelUniformDescriptorSet, 1, &dynamicOffset);
-					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.mesh->material.lock()->idx], 0, nullptr);
-					vkCmdDraw(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, 0, 0);
+					vkCmdBindDescriptorSets(this->frameData[this->currentFrame].graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pbrPipelineLayout, 2, 1, &this->pScene72->frameDescriptorSets[this->currentFrame].materialLevelUniformDescriptorSets[instanceToDraw.material->idx], 0, nullptr);
+					vkCmdDrawIndexed(this->frameData[this->currentFrame].graphicsCommandBuffer, instanceToDraw.mesh->count, 1, instanceToDraw.mesh->firstIndex, instanceToDraw.mesh->firstVertex, 0);
 				}
 				instanceCount++;
 			}
@@ -881,7 +932,10 @@ void Engine::drawFrame() {
 		.signalSemaphoreCount = (this->offscreen) ? 0U : 1U,
 		.pSignalSemaphores = (this->offscreen) ? nullptr : &this->frameData[this->currentFrame].renderFinishedSemaphore
 	};
-	JJYOU_VK_UTILS_CHECK(vkQueueSubmit(**this->context.queue(jjyou::vk::Context::QueueType::Main), 1, &submitInfo, this->frameData[this->currentFrame].inFlightFence));
+	{
+		std::lock_guard<std::mutex> queueLock(this->queueMutex);
+		JJYOU_VK_UTILS_CHECK(vkQueueSubmit(**this->context.queue(jjyou::vk::Context::QueueType::Main), 1, &submitInfo, this->frameData[this->currentFrame].inFlightFence));
+	}
 
 	if (!this->offscreen) {
 		VkSwapchainKHR swapChains[] = { *this->swapchain.swapchain() };
@@ -895,7 +949,11 @@ void Engine::drawFrame() {
 			.pImageIndices = &imageIndex,
 			.pResults = nullptr
 		};
-		VkResult presentResult = vkQueuePresentKHR(**this->context.queue(jjyou::vk::Context::QueueType::Main), &presentInfo);
+		VkResult presentResult;
+		{
+			std::lock_guard<std::mutex> queueLock(this->queueMutex);
+			presentResult = vkQueuePresentKHR(**this->context.queue(jjyou::vk::Context::QueueType::Main), &presentInfo);
+		}
 
 		if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || framebufferResized) {
 			framebufferResized = false;
@@ -905,6 +963,7 @@ void Engine::drawFrame() {
 			JJYOU_VK_UTILS_CHECK(presentResult);
 	}
 	this->currentFrame = (this->currentFrame + 1) % Engine::MAX_FRAMES_IN_FLIGHT;
+	++this->frameCount;
 	return;
 }
 
@@ -914,6 +973,7 @@ HostImage Engine::getLastRenderedFrame(void) {
 		return HostImage{};
 	int lastFrame = (this->currentFrame + Engine::MAX_FRAMES_IN_FLIGHT - 1) % Engine::MAX_FRAMES_IN_FLIGHT;
 	vkWaitForFences(*this->context.device(), 1, &this->frameData[lastFrame].inFlightFence, VK_TRUE, UINT64_MAX);
+	std::lock_guard<std::mutex> resourceLock(this->resourceMutex);
 	std::uint32_t imageIndex;
 	JJYOU_VK_UTILS_CHECK(this->virtualSwapchain.acquireLastImage(&imageIndex));
 	// create host visible and host coherent image
@@ -1020,8 +1080,11 @@ HostImage Engine::getLastRenderedFrame(void) {
 		.signalSemaphoreCount = 0,
 		.pSignalSemaphores = nullptr
 	};
-	JJYOU_VK_UTILS_CHECK(vkQueueSubmit(**this->context.queue(jjyou::vk::Context::QueueType::Transfer), 1, &submitInfo, nullptr));
-	JJYOU_VK_UTILS_CHECK(vkQueueWaitIdle(**this->context.queue(jjyou::vk::Context::QueueType::Transfer)));
+	{
+		std::lock_guard<std::mutex> queueLock(this->queueMutex);
+		JJYOU_VK_UTILS_CHECK(vkQueueSubmit(**this->context.queue(jjyou::vk::Context::QueueType::Transfer), 1, &submitInfo, nullptr));
+		JJYOU_VK_UTILS_CHECK(vkQueueWaitIdle(**this->context.queue(jjyou::vk::Context::QueueType::Transfer)));
+	}
 	vkFreeCommandBuffers(*this->context.device(), this->transferCommandPool, 1, &transferCommandBuffer);
 	// copy buffer to cpu memory
 	// Get layout of the image (including row pitch)
@@ -1055,7 +1118,12 @@ void Engine::handleFramebufferResizing(void) {
 		glfwWaitEvents();
 		glfwGetFramebufferSize(window, &width, &height);
 	}
-	vkDeviceWaitIdle(*this->context.device());
+	// A preload may be writing the G-buffer and SSAO textures into its descriptor sets.
+	std::lock_guard<std::mutex> resourceLock(this->resourceMutex);
+	{
+		std::lock_guard<std::mutex> queueLock(this->queueMutex);
+		vkDeviceWaitIdle(*this->context.device());
+	}
 
 	// Destroy frame buffers
 	for (int i = 0; i < this->framebuffers.size(); ++i) {
@@ -1204,9 +1272,61 @@ void Engine::updateGBufferAndSSAOSampler(const s72::Scene72& scene) const {
 	}
 }
 
+// Set on the thread started by `Engine::preload`.
+static thread_local bool onPreloadThread = false;
+
 void Engine::setScene(s72::Scene72::Ptr pScene72) {
 	pScene72->reset();
+	if (this->pScene72 != pScene72) {
+		// The frames in flight still draw the previous scene. It is destroyed once they have completed.
+		if (this->pScene72 != nullptr)
+			this->retiredScenes.emplace_back(this->pScene72, this->frameCount);
+		// A preloaded scene may have been created before the last resize.
+		this->updateGBufferAndSSAOSampler(*pScene72);
+	}
 	this->pScene72 = pScene72;
 	this->currPlayTime = pScene72->minTime;
 	this->resetClockTime();
+}
+
+void Engine::preload(std::function<s72::Scene72::Ptr(void)> load) {
+	if (this->preloadFuture.valid())
+		throw std::runtime_error("A scene is already being preloaded.");
+	this->preloadFuture = std::async(std::launch::async, [this, load = std::move(load)]() {
+		onPreloadThread = true;
+		std::lock_guard<std::mutex> resourceLock(this->resourceMutex);
+		return load();
+	});
+}
+
+bool Engine::preloadReady(void) const {
+	return this->preloadFuture.valid() && this->preloadFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+s72::Scene72::Ptr Engine::takePreloaded(void) {
+	if (!this->preloadFuture.valid())
+		throw std::runtime_error("No scene is being preloaded.");
+	return this->preloadFuture.get();
+}
+
+std::pair<VkCommandPool, VkCommandPool> Engine::loadCommandPools(void) const {
+	if (onPreloadThread)
+		return { this->preloadGraphicsCommandPool, this->preloadTransferCommandPool };
+	return { this->graphicsCommandPool, this->transferCommandPool };
+}
+
+void Engine::destroyRetiredScenes(void) {
+	if (this->retiredScenes.empty())
+		return;
+	// Frame `frameCount - MAX_FRAMES_IN_FLIGHT` used the fence just waited for, so every frame
+	// before it has completed as well.
+	std::unique_lock<std::mutex> resourceLock(this->resourceMutex, std::try_to_lock);
+	if (!resourceLock.owns_lock())
+		return;
+	std::erase_if(this->retiredScenes, [&](auto& retiredScene) {
+		if (retiredScene.second + Engine::MAX_FRAMES_IN_FLIGHT > this->frameCount)
+			return false;
+		this->destroy(*retiredScene.first, false);
+		return true;
+	});
 }
\ No newline at end of file
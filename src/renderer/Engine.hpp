@@ -11,6 +11,10 @@
 #include <utility>
 #include <tuple>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <future>
+#include <mutex>
 
 #include <jjyou/vk/Vulkan.hpp>
 #include "Texture.hpp"
@@ -23,6 +27,10 @@
 #include "Clock.hpp"
 #include "GBuffer.hpp"
 #include "SSAO.hpp"
+#include "HDRFormat.hpp"
+#include "AssetCache.hpp"
+#include "LoadProfiler.hpp"
+#include "JobSystem.hpp"
 
 class Engine {
 
@@ -41,6 +49,14 @@ public:
 		FRUSTUM = 1,
 	};
 
+	// Block compression of material textures loaded from images.
+	// The value names the format of albedo textures; normal maps use BC5 and scalar maps use BC4.
+	enum class TextureCompression {
+		NONE = 0,
+		BC1 = 1,
+		BC7 = 2,
+	};
+
 	enum class CameraMode {
 		SCENE = 0,
 		USER = 1,
@@ -52,7 +68,9 @@ public:
 		bool enableValidation,
 		bool offscreen,
 		int winWidth,
-		int winHeight
+		int winHeight,
+		bool blockCompression = false,
+		int jobThreads = 0
 	);
 
 	~Engine(void);
@@ -62,10 +80,59 @@ public:
 		const std::filesystem::path& baseDir
 	);
 
-	void destroy(s72::Scene72& scene72);
+	// Load a scene file with the streaming reader, which creates objects as it reads them
+	// instead of parsing the whole file into a JSON document first.
+	std::shared_ptr<s72::Scene72> loadStreaming(
+		const std::filesystem::path& scenePath
+	);
+
+	// Load the objects returned by `nextRecord` until it returns false.
+	// Both `load` and `loadStreaming` create their scenes through it.
+	std::shared_ptr<s72::Scene72> loadRecords(
+		const std::function<bool(s72::ObjectRecord&)>& nextRecord,
+		const std::filesystem::path& baseDir
+	);
 
+	// Load a bundle written by s72pack.
+	std::shared_ptr<s72::Scene72> loadPacked(
+		const std::filesystem::path& packPath
+	);
+
+	// Release the resources of a scene. Without `waitIdle`, the caller makes sure that no submitted
+	// frame uses the scene anymore.
+	void destroy(s72::Scene72& scene72, bool waitIdle = true);
+
+	// Pre-sample the animation of a loaded scene at `rate` samples per second for playback. The samples
+	// are read from "<scenePath>.animcache" if it was baked from the same scene file with the same
+	// settings, and otherwise baked and written there.
+	void bakeAnimation(s72::Scene72& scene72, const std::filesystem::path& scenePath, float rate, bool quantize);
+
+	// Create shadow maps, uniform buffers and descriptor sets for a scene whose objects are loaded.
+	void createSceneResources(s72::Scene72& scene72);
+
+	// Write the parameters and the textures of a non-simple material into its descriptor sets.
+	void writeMaterialDescriptorSets(s72::Scene72& scene72, const s72::Material& material);
+
+	// Upload the meshes and textures of a progressively loaded scene that its streamer has
+	// prepared, and swap in those whose uploads have completed. Called once per frame.
+	void updateStreaming(s72::Scene72& scene72);
+
+	// Render `pScene72` from the next frame on. The previous scene is destroyed by the engine
+	// once the frames in flight that use it have retired, so switching scenes does not stall.
 	void setScene(std::shared_ptr<s72::Scene72> pScene72);
 
+	// Load a scene on a background thread while the current one keeps rendering.
+	// `load` runs on that thread and calls one of the load functions above. Its uploads are
+	// recorded into command pools of its own. Only one preload runs at a time.
+	void preload(std::function<std::shared_ptr<s72::Scene72>(void)> load);
+
+	// Whether the scene started by `preload` has finished loading.
+	bool preloadReady(void) const;
+
+	// Wait for the scene started by `preload` and return it, to be passed to `setScene`.
+	// Rethrows the exception of a failed load.
+	std::shared_ptr<s72::Scene72> takePreloaded(void);
+
 	void drawFrame();
 
 	// Only available in offscreen mode
@@ -80,6 +147,12 @@ public:
 	void setCameraMode(CameraMode cameraMode, std::optional<std::string> camera = std::nullopt);
 	void resetClockTime(void) { this->clock->reset(); this->currClockTime = 0.0f; }
 	void setClock(Clock::Ptr&& clock) { this->clock = std::move(clock); }
+	void setLoadThreads(int numThreads) { this->loadThreads = numThreads; }
+	void setCompactVertices(bool whether) { this->compactVertices = whether; }
+	void setTextureCompression(TextureCompression compression);
+	void setEnvironmentFormat(HDRFormat format) { this->environmentFormat = format; }
+	void setProfileLoad(bool whether) { this->loadProfiler.setEnabled(whether); }
+	void setProgressiveLoad(bool whether) { this->progressiveLoad = whether; }
 
 public:
 
@@ -94,6 +167,19 @@ public:
 		jjyou::glsl::mat4 normal{};
 	};
 
+	// Constants a material uses instead of the textures it does not have.
+	// Bit `i` of `textureMask` is set if texture `i` of the material comes from an image.
+	// PBR materials pack displacement, roughness and metalness into texture 1, and set bits 1, 3 and 4
+	// for the channels of it that come from images.
+	struct MaterialParameters {
+		jjyou::glsl::vec4 normal{ 0.0f, 0.0f, 1.0f, 0.0f }; // In tangent space.
+		jjyou::glsl::vec4 albedo{ 1.0f };
+		float displacement = 0.0f;
+		float roughness = 1.0f;
+		float metalness = 0.0f;
+		std::uint32_t textureMask = 0;
+	};
+
 	struct SSAOParameters {
 		std::array<jjyou::glsl::vec4, 256> ssaoSamples{};
 	};
@@ -227,6 +313,7 @@ public:
 
 	/** @brief	Key callback.
 	  */
+	bool nextSceneRequested = false; // Set by the N key. The application switches to its next scene.
 	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 	void handleFramebufferResizing(void);
@@ -251,6 +338,28 @@ public:
 	Clock::Ptr clock{ new SteadyClock()};
 	//@}
 
+	/** @name	Loading Options
+	  */
+	//@{
+	int loadThreads = 0; // Number of threads used to decode images. 0 means all hardware threads.
+	bool compactVertices = false; // Store material mesh vertices in MaterialVertexFormat's compact layout.
+	TextureCompression textureCompression = TextureCompression::NONE; // Encoded on the decode threads while loading.
+	bool textureCompressionBC = false; // Whether the device was created with block-compressed texture support.
+	HDRFormat environmentFormat = HDRFormat::E5B9G9R9; // Texel format of environment cube maps.
+	bool progressiveLoad = false; // Return scenes before their meshes and material images are loaded. See SceneStreamer.
+	//@}
+
+	// Textures and meshes shared between loaded scenes. Assets no longer used by any
+	// scene are released at the end of the next load.
+	AssetCache assetCache{};
+
+	// Phase and asset timings of scene loads, recorded if `--profile-load` is given.
+	LoadProfiler loadProfiler{};
+
+	// Worker threads for the data-parallel stages of a frame: driver evaluation, transform updates
+	// and filling the object uniforms. Created once by the constructor, with `jobThreads` threads.
+	std::unique_ptr<JobSystem> jobSystem{};
+
 	int currentFrame = 0;
 	float currClockTime = 0.0f;
 	jjyou::vis::SceneView sceneViewer{};
@@ -266,6 +375,24 @@ public:
 	vk::raii::DescriptorPool descriptorPool{ nullptr };
 
 	VkCommandPool graphicsCommandPool, transferCommandPool;
+	// Command pools of the preload thread. A command pool must not be used by two threads at once.
+	VkCommandPool preloadGraphicsCommandPool, preloadTransferCommandPool;
+
+	// Held around every queue submission, present and wait-idle, since a preload submits its uploads from another thread.
+	std::mutex queueMutex{};
+	// Held by a preload while it creates its scene, because device memory, descriptor sets and the asset cache
+	// are not thread-safe. The render loop only tries to lock it for work that can wait, such as streaming.
+	std::mutex resourceMutex{};
+	std::future<std::shared_ptr<s72::Scene72>> preloadFuture{};
+	// Scenes replaced by `setScene`, with the frame they were last drawn in.
+	std::vector<std::pair<std::shared_ptr<s72::Scene72>, std::uint64_t>> retiredScenes{};
+	std::uint64_t frameCount = 0; // Frames drawn so far.
+
+	// The graphics and transfer command pools for uploads recorded on the calling thread.
+	std::pair<VkCommandPool, VkCommandPool> loadCommandPools(void) const;
+
+	// Destroy the retired scenes whose frames have completed.
+	void destroyRetiredScenes(void);
 
 	jjyou::vk::MemoryAllocator allocator;
 	
@@ -305,15 +432,19 @@ public:
 
 	VkPipelineLayout mirrorForwardPipelineLayout;
 	VkPipeline mirrorForwardPipeline;
+	VkPipeline mirrorForwardCompactPipeline; // For MaterialVertexFormat::COMPACT_STRIDE vertices
 
 	VkPipelineLayout environmentForwardPipelineLayout;
 	VkPipeline environmentForwardPipeline;
+	VkPipeline environmentForwardCompactPipeline; // For MaterialVertexFormat::COMPACT_STRIDE vertices
 
 	VkPipelineLayout lambertianForwardPipelineLayout;
 	VkPipeline lambertianForwardPipeline;
+	VkPipeline lambertianForwardCompactPipeline; // For MaterialVertexFormat::COMPACT_STRIDE vertices
 
 	VkPipelineLayout pbrDeferredPipelineLayout;
 	VkPipeline pbrDeferredPipeline;
+	VkPipeline pbrDeferredCompactPipeline; // For MaterialVertexFormat::COMPACT_STRIDE vertices
 
 	VkPipelineLayout skyboxPipelineLayout;
 	VkPipeline skyboxPipeline;
@@ -101,4 +101,9 @@ void Engine::keyCallback(GLFWwindow* window, int key, int scancode, int action,
 			}
 		}
 	}
+	else if (key == GLFW_KEY_N) {
+		if (action == GLFW_PRESS) {
+			engine->nextSceneRequested = true;
+		}
+	}
 }
\ No newline at end of file
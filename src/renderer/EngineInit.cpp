@@ -1,4 +1,6 @@
 #include "Engine.hpp"
+#include "Scene72.hpp"
+#include "VertexFormat.hpp"
 #include <fstream>
 #include <random>
 #include <imgui.h>
@@ -10,10 +12,15 @@ Engine::Engine(
 	bool enableValidation,
 	bool offscreen,
 	int winWidth,
-	int winHeight
+	int winHeight,
+	bool blockCompression,
+	int jobThreads
 ) : offscreen(offscreen)
 {
 
+	// Start the job workers. 0 threads means all hardware threads.
+	this->jobSystem = std::make_unique<JobSystem>(jobThreads);
+
 	// Init glfw window.
 	if (!this->offscreen) {
 		glfwInit();
@@ -71,6 +78,22 @@ Engine::Engine(
 				}
 			);
 		builder.selectPhysicalDevice(this->context);
+		// Block-compressed textures are only enabled if they may be used and the device supports them.
+		if (blockCompression) {
+			if (this->context.physicalDevice().getFeatures().textureCompressionBC) {
+				builder.requirePhysicalDeviceFeatures(
+					VkPhysicalDeviceFeatures{
+						.geometryShader = true,
+						.samplerAnisotropy = true,
+						.textureCompressionBC = true,
+					}
+				);
+				this->textureCompressionBC = true;
+			}
+			else {
+				std::cerr << "The physical device does not support block-compressed textures." << std::endl;
+			}
+		}
 		// Device
 		builder.buildDevice(this->context);
 	}
@@ -94,6 +117,24 @@ Engine::Engine(
 		};
 		JJYOU_VK_UTILS_CHECK(vkCreateCommandPool(*this->context.device(), &poolInfo, nullptr, &this->transferCommandPool));
 	}
+	{
+		VkCommandPoolCreateInfo poolInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = *this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main)
+		};
+		JJYOU_VK_UTILS_CHECK(vkCreateCommandPool(*this->context.device(), &poolInfo, nullptr, &this->preloadGraphicsCommandPool));
+	}
+	{
+		VkCommandPoolCreateInfo poolInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = *this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Transfer)
+		};
+		JJYOU_VK_UTILS_CHECK(vkCreateCommandPool(*this->context.device(), &poolInfo, nullptr, &this->preloadTransferCommandPool));
+	}
 
 	// Create command buffers
 	{
@@ -721,7 +762,14 @@ Engine::Engine(
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
 			.pImmutableSamplers = nullptr
 		};
-		std::vector<VkDescriptorSetLayoutBinding> bindings = { mirrorNormalMapSamplerBinding, mirrorDisplacementMapSamplerBinding };
+		VkDescriptorSetLayoutBinding mirrorParametersBinding{
+			.binding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = nullptr
+		};
+		std::vector<VkDescriptorSetLayoutBinding> bindings = { mirrorNormalMapSamplerBinding, mirrorDisplacementMapSamplerBinding, mirrorParametersBinding };
 		VkDescriptorSetLayoutCreateInfo layoutInfo{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
 			.pNext = nullptr,
@@ -746,7 +794,14 @@ Engine::Engine(
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
 			.pImmutableSamplers = nullptr
 		};
-		std::vector<VkDescriptorSetLayoutBinding> bindings = { environmentNormalMapSamplerBinding, environmentDisplacementMapSamplerBinding };
+		VkDescriptorSetLayoutBinding environmentParametersBinding{
+			.binding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = nullptr
+		};
+		std::vector<VkDescriptorSetLayoutBinding> bindings = { environmentNormalMapSamplerBinding, environmentDisplacementMapSamplerBinding, environmentParametersBinding };
 		VkDescriptorSetLayoutCreateInfo layoutInfo{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
 			.pNext = nullptr,
@@ -778,7 +833,14 @@ Engine::Engine(
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
 			.pImmutableSamplers = nullptr
 		};
-		std::vector<VkDescriptorSetLayoutBinding> bindings = { lambertianNormalMapSamplerBinding, lambertianDisplacementMapSamplerBinding, lambertianBaseColorSamplerBinding };
+		VkDescriptorSetLayoutBinding lambertianParametersBinding{
+			.binding = 3,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = nullptr
+		};
+		std::vector<VkDescriptorSetLayoutBinding> bindings = { lambertianNormalMapSamplerBinding, lambertianDisplacementMapSamplerBinding, lambertianBaseColorSamplerBinding, lambertianParametersBinding };
 		VkDescriptorSetLayoutCreateInfo layoutInfo{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
 			.pNext = nullptr,
@@ -796,7 +858,8 @@ Engine::Engine(
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
 			.pImmutableSamplers = nullptr
 		};
-		VkDescriptorSetLayoutBinding pbrDisplacementMapSamplerBinding{
+		// Displacement, roughness and metalness, packed into one texture.
+		VkDescriptorSetLayoutBinding pbrSurfaceSamplerBinding{
 			.binding = 1,
 			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 			.descriptorCount = 1,
@@ -810,21 +873,14 @@ Engine::Engine(
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
 			.pImmutableSamplers = nullptr
 		};
-		VkDescriptorSetLayoutBinding pbrRoughnessSamplerBinding{
+		VkDescriptorSetLayoutBinding pbrParametersBinding{
 			.binding = 3,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.descriptorCount = 1,
-			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-			.pImmutableSamplers = nullptr
-		};
-		VkDescriptorSetLayoutBinding pbrMetalnessSamplerBinding{
-			.binding = 4,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
 			.descriptorCount = 1,
 			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
 			.pImmutableSamplers = nullptr
 		};
-		std::vector<VkDescriptorSetLayoutBinding> bindings = { pbrNormalMapSamplerBinding, pbrDisplacementMapSamplerBinding, pbrAlbedoSamplerBinding, pbrRoughnessSamplerBinding, pbrMetalnessSamplerBinding };
+		std::vector<VkDescriptorSetLayoutBinding> bindings = { pbrNormalMapSamplerBinding, pbrSurfaceSamplerBinding, pbrAlbedoSamplerBinding, pbrParametersBinding };
 		VkDescriptorSetLayoutCreateInfo layoutInfo{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
 			.pNext = nullptr,
@@ -1113,7 +1169,10 @@ Engine::Engine(
 		vk::raii::ShaderModule environmentForwardFragShaderModule = this->createShaderModule("../spv/renderer/shader/environmentForward.frag.spv");
 		vk::raii::ShaderModule lambertianForwardFragShaderModule = this->createShaderModule("../spv/renderer/shader/lambertianForward.frag.spv");
 		
+		vk::raii::ShaderModule materialForwardCompactVertShaderModule = this->createShaderModule("../spv/renderer/shader/materialForwardCompact.vert.spv");
+
 		vk::raii::ShaderModule pbrDeferredVertShaderModule = this->createShaderModule("../spv/renderer/shader/pbrDeferred.vert.spv");
+		vk::raii::ShaderModule pbrDeferredCompactVertShaderModule = this->createShaderModule("../spv/renderer/shader/pbrDeferredCompact.vert.spv");
 		vk::raii::ShaderModule pbrDeferredFragShaderModule = this->createShaderModule("../spv/renderer/shader/pbrDeferred.frag.spv");
 
 		vk::raii::ShaderModule skyboxVertShaderModule = this->createShaderModule("../spv/renderer/shader/skybox.vert.spv");
@@ -1224,6 +1283,49 @@ Engine::Engine(
 				.offset = 48
 			}
 		} };
+		VkVertexInputBindingDescription positionVertexBindingDescription{
+			.binding = 0,
+			.stride = PositionVertexFormat::STRIDE,
+			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+		};
+		// See MaterialVertexFormat for the compact layout.
+		VkVertexInputBindingDescription compactMaterialVertexBindingDescription{
+			.binding = 0,
+			.stride = MaterialVertexFormat::COMPACT_STRIDE,
+			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+		};
+		std::array<VkVertexInputAttributeDescription, 5> compactMaterialAttributeDescriptions = { {
+			VkVertexInputAttributeDescription{
+				.location = 0,
+				.binding = 0,
+				.format = VK_FORMAT_R32G32B32_SFLOAT,
+				.offset = 0
+			},
+			VkVertexInputAttributeDescription{
+				.location = 1,
+				.binding = 0,
+				.format = VK_FORMAT_R16G16_SNORM,
+				.offset = 12
+			},
+			VkVertexInputAttributeDescription{
+				.location = 2,
+				.binding = 0,
+				.format = VK_FORMAT_R16G16_SNORM,
+				.offset = 16
+			},
+			VkVertexInputAttributeDescription{
+				.location = 3,
+				.binding = 0,
+				.format = VK_FORMAT_R16G16_SFLOAT,
+				.offset = 20
+			},
+			VkVertexInputAttributeDescription{
+				.location = 4,
+				.binding = 0,
+				.format = VK_FORMAT_R8G8B8A8_UNORM,
+				.offset = 24
+			}
+		} };
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
 			.pNext = nullptr,
@@ -1389,6 +1491,10 @@ Engine::Engine(
 		pipelineInfo.layout = this->mirrorForwardPipelineLayout;
 		pipelineInfo.renderPass = this->outputRenderPass;
 		JJYOU_VK_UTILS_CHECK(vkCreateGraphicsPipelines(*this->context.device(), nullptr, 1, &pipelineInfo, nullptr, &this->mirrorForwardPipeline));
+		shaderStages[0].module = *materialForwardCompactVertShaderModule;
+		vertexInputInfo.pVertexBindingDescriptions = &compactMaterialVertexBindingDescription;
+		vertexInputInfo.pVertexAttributeDescriptions = compactMaterialAttributeDescriptions.data();
+		JJYOU_VK_UTILS_CHECK(vkCreateGraphicsPipelines(*this->context.device(), nullptr, 1, &pipelineInfo, nullptr, &this->mirrorForwardCompactPipeline));
 
 		shaderStages[0].module = *materialForwardVertShaderModule;
 		shaderStages[1].module = *environmentForwardFragShaderModule;
@@ -1399,6 +1505,10 @@ Engine::Engine(
 		pipelineInfo.layout = this->environmentForwardPipelineLayout;
 		pipelineInfo.renderPass = this->outputRenderPass;
 		JJYOU_VK_UTILS_CHECK(vkCreateGraphicsPipelines(*this->context.device(), nullptr, 1, &pipelineInfo, nullptr, &this->environmentForwardPipeline));
+		shaderStages[0].module = *materialForwardCompactVertShaderModule;
+		vertexInputInfo.pVertexBindingDescriptions = &compactMaterialVertexBindingDescription;
+		vertexInputInfo.pVertexAttributeDescriptions = compactMaterialAttributeDescriptions.data();
+		JJYOU_VK_UTILS_CHECK(vkCreateGraphicsPipelines(*this->context.device(), nullptr, 1, &pipelineInfo, nullptr, &this->environmentForwardCompactPipeline));
 
 		shaderStages[0].module = *materialForwardVertShaderModule;
 		shaderStages[1].module = *lambertianForwardFragShaderModule;
@@ -1409,6 +1519,10 @@ Engine::Engine(
 		pipelineInfo.layout = this->lambertianForwardPipelineLayout;
 		pipelineInfo.renderPass = this->outputRenderPass;
 		JJYOU_VK_UTILS_CHECK(vkCreateGraphicsPipelines(*this->context.device(), nullptr, 1, &pipelineInfo, nullptr, &this->lambertianForwardPipeline));
+		shaderStages[0].module = *materialForwardCompactVertShaderModule;
+		vertexInputInfo.pVertexBindingDescriptions = &compactMaterialVertexBindingDescription;
+		vertexInputInfo.pVertexAttributeDescriptions = compactMaterialAttributeDescriptions.data();
+		JJYOU_VK_UTILS_CHECK(vkCreateGraphicsPipelines(*this->context.device(), nullptr, 1, &pipelineInfo, nullptr, &this->lambertianForwardCompactPipeline));
 
 		colorBlending.attachmentCount = 4;
 		colorBlending.pAttachments = gBufferColorBlendAttachments.data();
@@ -1421,6 +1535,10 @@ Engine::Engine(
 		pipelineInfo.layout = this->pbrDeferredPipelineLayout;
 		pipelineInfo.renderPass = *this->deferredRenderPass;
 		JJYOU_VK_UTILS_CHECK(vkCreateGraphicsPipelines(*this->context.device(), nullptr, 1, &pipelineInfo, nullptr, &this->pbrDeferredPipeline));
+		shaderStages[0].module = *pbrDeferredCompactVertShaderModule;
+		vertexInputInfo.pVertexBindingDescriptions = &compactMaterialVertexBindingDescription;
+		vertexInputInfo.pVertexAttributeDescriptions = compactMaterialAttributeDescriptions.data();
+		JJYOU_VK_UTILS_CHECK(vkCreateGraphicsPipelines(*this->context.device(), nullptr, 1, &pipelineInfo, nullptr, &this->pbrDeferredCompactPipeline));
 		colorBlending.attachmentCount = 1;
 		colorBlending.pAttachments = &colorBlendAttachment;
 
@@ -1479,7 +1597,7 @@ Engine::Engine(
 		shaderStages[0].module = *spotlightVertShaderModule;
 		pipelineInfo.stageCount = 1;
 		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &materialVertexBindingDescription;
+		vertexInputInfo.pVertexBindingDescriptions = &positionVertexBindingDescription;
 		vertexInputInfo.vertexAttributeDescriptionCount = 1; // Only position is needed
 		vertexInputInfo.pVertexAttributeDescriptions = &materialAttributeDescriptions[0];
 		pipelineInfo.layout = this->spotlightPipelineLayout;
@@ -1490,7 +1608,7 @@ Engine::Engine(
 		shaderStages[2].module = *spherelightGeomShaderModule;
 		pipelineInfo.stageCount = 3;
 		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &materialVertexBindingDescription;
+		vertexInputInfo.pVertexBindingDescriptions = &positionVertexBindingDescription;
 		vertexInputInfo.vertexAttributeDescriptionCount = 1; // Only position is needed
 		vertexInputInfo.pVertexAttributeDescriptions = &materialAttributeDescriptions[0];
 		pipelineInfo.layout = this->spherelightPipelineLayout;
@@ -1501,7 +1619,7 @@ Engine::Engine(
 		shaderStages[1].stage = VK_SHADER_STAGE_GEOMETRY_BIT;
 		pipelineInfo.stageCount = 2;
 		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &materialVertexBindingDescription;
+		vertexInputInfo.pVertexBindingDescriptions = &positionVertexBindingDescription;
 		vertexInputInfo.vertexAttributeDescriptionCount = 1; // Only position is needed
 		vertexInputInfo.pVertexAttributeDescriptions = &materialAttributeDescriptions[0];
 		pipelineInfo.layout = this->sunlightPipelineLayout;
@@ -1552,9 +1670,23 @@ Engine::Engine(
 
 Engine::~Engine(void) {
 
+	// A scene still being preloaded is not needed anymore.
+	if (this->preloadFuture.valid()) {
+		try {
+			s72::Scene72::Ptr preloaded = this->preloadFuture.get();
+			this->destroy(*preloaded);
+		}
+		catch (const std::exception&) {
+		}
+	}
+
 	vkDeviceWaitIdle(*this->context.device());
 
+	for (auto& retiredScene : this->retiredScenes)
+		this->destroy(*retiredScene.first, false);
+	this->retiredScenes.clear();
 	this->pScene72 = nullptr;
+	this->assetCache.clear();
 
 	this->ssaoNoise.destroy();
 
@@ -1562,12 +1694,16 @@ Engine::~Engine(void) {
 	vkDestroyPipeline(*this->context.device(), this->simpleForwardPipeline, nullptr);
 	vkDestroyPipelineLayout(*this->context.device(), this->simpleForwardPipelineLayout, nullptr);
 	vkDestroyPipeline(*this->context.device(), this->mirrorForwardPipeline, nullptr);
+	vkDestroyPipeline(*this->context.device(), this->mirrorForwardCompactPipeline, nullptr);
 	vkDestroyPipelineLayout(*this->context.device(), this->mirrorForwardPipelineLayout, nullptr);
 	vkDestroyPipeline(*this->context.device(), this->environmentForwardPipeline, nullptr);
+	vkDestroyPipeline(*this->context.device(), this->environmentForwardCompactPipeline, nullptr);
 	vkDestroyPipelineLayout(*this->context.device(), this->environmentForwardPipelineLayout, nullptr);
 	vkDestroyPipeline(*this->context.device(), this->lambertianForwardPipeline, nullptr);
+	vkDestroyPipeline(*this->context.device(), this->lambertianForwardCompactPipeline, nullptr);
 	vkDestroyPipelineLayout(*this->context.device(), this->lambertianForwardPipelineLayout, nullptr);
 	vkDestroyPipeline(*this->context.device(), this->pbrDeferredPipeline, nullptr);
+	vkDestroyPipeline(*this->context.device(), this->pbrDeferredCompactPipeline, nullptr);
 	vkDestroyPipelineLayout(*this->context.device(), this->pbrDeferredPipelineLayout, nullptr);
 	vkDestroyPipeline(*this->context.device(), this->ssaoPipeline, nullptr);
 	vkDestroyPipelineLayout(*this->context.device(), this->ssaoPipelineLayout, nullptr);
@@ -1645,6 +1781,8 @@ Engine::~Engine(void) {
 	// Destroy command pool
 	vkDestroyCommandPool(*this->context.device(), this->graphicsCommandPool, nullptr);
 	vkDestroyCommandPool(*this->context.device(), this->transferCommandPool, nullptr);
+	vkDestroyCommandPool(*this->context.device(), this->preloadGraphicsCommandPool, nullptr);
+	vkDestroyCommandPool(*this->context.device(), this->preloadTransferCommandPool, nullptr);
 
 	// Destroy descriptor pool
 	this->descriptorPool.clear();
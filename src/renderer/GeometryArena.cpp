@@ -0,0 +1,83 @@
+#include "GeometryArena.hpp"
+#include "UploadBatch.hpp"
+
+#include <algorithm>
+
+void GeometryArena::create(
+	const jjyou::vk::Context& context,
+	jjyou::vk::MemoryAllocator& allocator,
+	VkDeviceSize blockSize
+) {
+	this->destroy();
+	this->_pContext = &context;
+	this->_pAllocator = &allocator;
+	this->_blockSize = blockSize;
+}
+
+GeometryArena::Allocation GeometryArena::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+	// Alignments are vertex strides, which are not necessarily powers of two.
+	auto alignUp = [alignment](VkDeviceSize offset) {
+		return (offset + alignment - 1) / alignment * alignment;
+	};
+	for (Block& block : this->_blocks) {
+		VkDeviceSize offset = alignUp(block.head);
+		if (offset + size <= block.size) {
+			block.head = offset + size;
+			return Allocation{ .buffer = block.buffer, .offset = offset };
+		}
+	}
+	Block& block = this->_createBlock(std::max(size, this->_blockSize));
+	block.head = size;
+	return Allocation{ .buffer = block.buffer, .offset = 0 };
+}
+
+GeometryArena::Allocation GeometryArena::upload(UploadBatch& uploadBatch, const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+	Allocation allocation = this->allocate(size, alignment);
+	uploadBatch.uploadBuffer(allocation.buffer, allocation.offset, data, size);
+	return allocation;
+}
+
+void GeometryArena::destroy(void) {
+	if (this->_pContext == nullptr)
+		return;
+	for (Block& block : this->_blocks) {
+		this->_pAllocator->free(block.memory);
+		vkDestroyBuffer(*this->_pContext->device(), block.buffer, nullptr);
+	}
+	this->_blocks.clear();
+	this->_pContext = nullptr;
+	this->_pAllocator = nullptr;
+}
+
+GeometryArena::Block& GeometryArena::_createBlock(VkDeviceSize size) {
+	std::vector<std::uint32_t> queueFamilyIndices = {
+		*this->_pContext->queueFamilyIndex(jjyou::vk::Context::QueueType::Main),
+		*this->_pContext->queueFamilyIndex(jjyou::vk::Context::QueueType::Transfer)
+	};
+	if (queueFamilyIndices[0] == queueFamilyIndices[1])
+		queueFamilyIndices.pop_back();
+	VkBufferCreateInfo bufferInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		.sharingMode = (queueFamilyIndices.size() >= 2) ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = static_cast<std::uint32_t>(queueFamilyIndices.size()),
+		.pQueueFamilyIndices = queueFamilyIndices.data()
+	};
+	Block block{ .size = size };
+	JJYOU_VK_UTILS_CHECK(vkCreateBuffer(*this->_pContext->device(), &bufferInfo, nullptr, &block.buffer));
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(*this->_pContext->device(), block.buffer, &memRequirements);
+	VkMemoryAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.allocationSize = memRequirements.size,
+		.memoryTypeIndex = this->_pContext->findMemoryType(memRequirements.memoryTypeBits, ::vk::MemoryPropertyFlagBits::eDeviceLocal).value()
+	};
+	JJYOU_VK_UTILS_CHECK(this->_pAllocator->allocate(&allocInfo, block.memory));
+	vkBindBufferMemory(*this->_pContext->device(), block.buffer, block.memory.memory(), block.memory.offset());
+	this->_blocks.push_back(std::move(block));
+	return this->_blocks.back();
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <vector>
+#include <utility>
+#include <jjyou/vk/Vulkan.hpp>
+#include <jjyou/vk/Legacy/Memory.hpp>
+#include "utils.hpp"
+
+class UploadBatch;
+
+// Device-local storage shared by the geometry of all meshes of a scene.
+// Vertex, position and index data are sub-allocated linearly from a few large buffers
+// ("blocks"), so a scene needs a handful of allocations instead of several per mesh, and
+// consecutive draws usually share their vertex and index buffer bindings.
+// Nothing is freed individually; all blocks are released together by `destroy`.
+class GeometryArena {
+
+public:
+
+	static constexpr inline VkDeviceSize DEFAULT_BLOCK_SIZE = VkDeviceSize(32) << 20;
+
+	// Location of a sub-allocation. `offset` is in bytes from the start of `buffer`.
+	struct Allocation {
+		VkBuffer buffer = nullptr;
+		VkDeviceSize offset = 0;
+	};
+
+	/** @brief	Construct an empty arena. Call `create` before allocating.
+	  */
+	GeometryArena(void) = default;
+
+	GeometryArena(const GeometryArena&) = delete;
+
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	~GeometryArena(void) { this->destroy(); }
+
+	void create(
+		const jjyou::vk::Context& context,
+		jjyou::vk::MemoryAllocator& allocator,
+		VkDeviceSize blockSize = GeometryArena::DEFAULT_BLOCK_SIZE
+	);
+
+	/** @brief	Sub-allocate `size` bytes whose offset is a multiple of `alignment`.
+	  *			Requests larger than the block size get a block of their own.
+	  *			The buffers are usable as vertex, index and transfer destination buffers.
+	  */
+	Allocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+	/** @brief	Sub-allocate like `allocate` and copy `size` bytes from `data` through `uploadBatch`.
+	  */
+	Allocation upload(UploadBatch& uploadBatch, const void* data, VkDeviceSize size, VkDeviceSize alignment);
+
+	/** @brief	Free all blocks. The device must not be using them anymore.
+	  */
+	void destroy(void);
+
+	/** @brief	Number of blocks (buffers and memory allocations) in use.
+	  */
+	std::size_t numBlocks(void) const { return this->_blocks.size(); }
+
+private:
+
+	struct Block {
+		VkBuffer buffer = nullptr;
+		jjyou::vk::Memory memory{};
+		VkDeviceSize size = 0;
+		VkDeviceSize head = 0; // Next free byte.
+	};
+
+	const jjyou::vk::Context* _pContext = nullptr;
+	jjyou::vk::MemoryAllocator* _pAllocator = nullptr;
+	VkDeviceSize _blockSize = 0;
+	std::vector<Block> _blocks{};
+
+	Block& _createBlock(VkDeviceSize size);
+
+};
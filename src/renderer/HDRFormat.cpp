@@ -0,0 +1,131 @@
+#include "HDRFormat.hpp"
+#include "HalfFloat.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+// 2^(e - 136), so that a channel is (mantissa + 0.5) * scale, as in unpackRGBE.
+static const std::array<float, 256>& rgbeScales(void) {
+	static const std::array<float, 256> scales = [](void) {
+		std::array<float, 256> scales{};
+		for (int e = 0; e < 256; ++e)
+			scales[e] = std::ldexp(1.0f, e - 136);
+		return scales;
+	}();
+	return scales;
+}
+
+// Unsigned 11-bit (6-bit mantissa) or 10-bit (5-bit mantissa) float.
+// Both share the exponent bias of binary16, so only the mantissa has to be rounded.
+static std::uint32_t toSmallFloat(float value, std::uint32_t mantissaBits) {
+	if (!(value > 0.0f))
+		return 0;
+	std::uint32_t half = floatToHalf(value) & 0x7FFFU;
+	std::uint32_t shift = 10 - mantissaBits;
+	std::uint32_t maxFinite = (30U << mantissaBits) | ((1U << mantissaBits) - 1U);
+	if (half >= 0x7C00U)
+		return maxFinite;
+	return std::min((half + (1U << (shift - 1))) >> shift, maxFinite);
+}
+
+// Pack following the Vulkan specification of VK_FORMAT_E5B9G9R9_UFLOAT_PACK32.
+static std::uint32_t toE5B9G9R9(float r, float g, float b) {
+	constexpr int MANTISSA_BITS = 9, EXPONENT_BIAS = 15, MAX_EXPONENT = 31;
+	const float maxValue = static_cast<float>((1 << MANTISSA_BITS) - 1) / static_cast<float>(1 << MANTISSA_BITS) * std::ldexp(1.0f, MAX_EXPONENT - EXPONENT_BIAS);
+	r = std::clamp(r, 0.0f, maxValue);
+	g = std::clamp(g, 0.0f, maxValue);
+	b = std::clamp(b, 0.0f, maxValue);
+	float maxChannel = std::max(std::max(r, g), b);
+	int exponent = std::max(-EXPONENT_BIAS - 1, (maxChannel > 0.0f) ? static_cast<int>(std::floor(std::log2(maxChannel))) : -EXPONENT_BIAS - 1) + 1 + EXPONENT_BIAS;
+	float scale = std::ldexp(1.0f, MANTISSA_BITS + EXPONENT_BIAS - exponent);
+	if (static_cast<int>(std::floor(maxChannel * scale + 0.5f)) == (1 << MANTISSA_BITS)) {
+		++exponent;
+		scale *= 0.5f;
+	}
+	std::uint32_t rm = static_cast<std::uint32_t>(std::floor(r * scale + 0.5f));
+	std::uint32_t gm = static_cast<std::uint32_t>(std::floor(g * scale + 0.5f));
+	std::uint32_t bm = static_cast<std::uint32_t>(std::floor(b * scale + 0.5f));
+	return (static_cast<std::uint32_t>(exponent) << 27) | (bm << 18) | (gm << 9) | rm;
+}
+
+static void convertRange(HDRFormat format, const unsigned char* rgbe, std::size_t first, std::size_t last, char* dst) {
+	const std::array<float, 256>& scales = rgbeScales();
+	for (std::size_t i = first; i < last; ++i) {
+		const unsigned char* texel = rgbe + i * 4;
+		float rgb[3] = { 0.0f, 0.0f, 0.0f };
+		if (texel[0] != 0 || texel[1] != 0 || texel[2] != 0 || texel[3] != 0) {
+			float scale = scales[texel[3]];
+			for (int c = 0; c < 3; ++c)
+				rgb[c] = (static_cast<float>(texel[c]) + 0.5f) * scale;
+		}
+		switch (format) {
+		case HDRFormat::RGBA32F: {
+			float rgba[4] = { rgb[0], rgb[1], rgb[2], 1.0f };
+			std::memcpy(dst + i * sizeof(rgba), rgba, sizeof(rgba));
+			break;
+		}
+		case HDRFormat::RGBA16F: {
+			std::uint16_t rgba[4] = { floatToHalf(rgb[0]), floatToHalf(rgb[1]), floatToHalf(rgb[2]), 0x3C00U };
+			std::memcpy(dst + i * sizeof(rgba), rgba, sizeof(rgba));
+			break;
+		}
+		case HDRFormat::B10G11R11: {
+			std::uint32_t packed = toSmallFloat(rgb[0], 6) | (toSmallFloat(rgb[1], 6) << 11) | (toSmallFloat(rgb[2], 5) << 22);
+			std::memcpy(dst + i * sizeof(packed), &packed, sizeof(packed));
+			break;
+		}
+		case HDRFormat::E5B9G9R9: {
+			std::uint32_t packed = toE5B9G9R9(rgb[0], rgb[1], rgb[2]);
+			std::memcpy(dst + i * sizeof(packed), &packed, sizeof(packed));
+			break;
+		}
+		}
+	}
+}
+
+VkFormat hdrVkFormat(HDRFormat format) {
+	switch (format) {
+	case HDRFormat::RGBA16F:
+		return VK_FORMAT_R16G16B16A16_SFLOAT;
+	case HDRFormat::B10G11R11:
+		return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+	case HDRFormat::E5B9G9R9:
+		return VK_FORMAT_E5B9G9R9_UFLOAT_PACK32;
+	default:
+		return VK_FORMAT_R32G32B32A32_SFLOAT;
+	}
+}
+
+std::uint32_t hdrTexelBytes(HDRFormat format) {
+	switch (format) {
+	case HDRFormat::RGBA32F:
+		return 16;
+	case HDRFormat::RGBA16F:
+		return 8;
+	default:
+		return 4;
+	}
+}
+
+std::vector<char> convertRGBE(HDRFormat format, const unsigned char* rgbe, std::size_t numTexels, int numThreads) {
+	std::vector<char> converted(numTexels * hdrTexelBytes(format));
+	// Small images are not worth a thread.
+	constexpr std::size_t MIN_TEXELS_PER_THREAD = std::size_t(1) << 16;
+	if (numThreads <= 0)
+		numThreads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+	numThreads = static_cast<int>(std::clamp<std::size_t>((numTexels + MIN_TEXELS_PER_THREAD - 1) / MIN_TEXELS_PER_THREAD, 1, numThreads));
+	std::size_t texelsPerThread = (numTexels + numThreads - 1) / numThreads;
+	std::vector<std::thread> threads; threads.reserve(numThreads - 1);
+	for (int t = 1; t < numThreads; ++t) {
+		std::size_t first = std::min(numTexels, t * texelsPerThread);
+		std::size_t last = std::min(numTexels, first + texelsPerThread);
+		threads.emplace_back(convertRange, format, rgbe, first, last, converted.data());
+	}
+	convertRange(format, rgbe, 0, std::min(numTexels, texelsPerThread), converted.data());
+	for (std::thread& thread : threads)
+		thread.join();
+	return converted;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Texel formats of HDR environment cube maps on the GPU.
+//
+// RGBA32F: R32G32B32A32_SFLOAT, 16 bytes per texel.
+// RGBA16F: R16G16B16A16_SFLOAT, 8 bytes per texel.
+// B10G11R11: B10G11R11_UFLOAT_PACK32, 4 bytes per texel.
+// E5B9G9R9: E5B9G9R9_UFLOAT_PACK32, 4 bytes per texel. 9-bit mantissas with a shared exponent,
+// which keeps the precision of the 8-bit RGBE source images.
+enum class HDRFormat {
+	RGBA32F = 0,
+	RGBA16F = 1,
+	B10G11R11 = 2,
+	E5B9G9R9 = 3,
+};
+
+/** @brief	Vulkan format of `format`.
+  */
+VkFormat hdrVkFormat(HDRFormat format);
+
+/** @brief	Number of bytes of one texel.
+  */
+std::uint32_t hdrTexelBytes(HDRFormat format);
+
+/** @brief	Convert `numTexels` RGBE texels (see RGBE.hpp) to `format`.
+  *			The texels are split into contiguous ranges converted on up to `numThreads` threads.
+  *			`numThreads <= 0` uses all hardware threads.
+  */
+std::vector<char> convertRGBE(HDRFormat format, const unsigned char* rgbe, std::size_t numTexels, int numThreads);
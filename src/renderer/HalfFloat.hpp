@@ -0,0 +1,37 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+// IEEE 754 binary16, rounded to nearest even.
+inline std::uint16_t floatToHalf(float value) {
+	std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+	std::uint32_t sign = (bits >> 16) & 0x8000u;
+	std::uint32_t exponent = (bits >> 23) & 0xFFu;
+	std::uint32_t mantissa = bits & 0x7FFFFFu;
+	if (exponent == 0xFFu) // Inf or NaN
+		return static_cast<std::uint16_t>(sign | 0x7C00u | (mantissa != 0 ? 0x200u : 0u));
+	int halfExponent = static_cast<int>(exponent) - 127 + 15;
+	if (halfExponent >= 31)
+		return static_cast<std::uint16_t>(sign | 0x7C00u);
+	std::uint32_t half, remainder, halfway;
+	if (halfExponent <= 0) {
+		// Subnormal half.
+		if (halfExponent < -10)
+			return static_cast<std::uint16_t>(sign);
+		mantissa |= 0x800000u;
+		std::uint32_t shift = static_cast<std::uint32_t>(14 - halfExponent);
+		half = mantissa >> shift;
+		remainder = mantissa & ((1u << shift) - 1u);
+		halfway = 1u << (shift - 1u);
+	}
+	else {
+		half = (static_cast<std::uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+		remainder = mantissa & 0x1FFFu;
+		halfway = 0x1000u;
+	}
+	// A carry out of the mantissa correctly bumps the exponent.
+	if (remainder > halfway || (remainder == halfway && (half & 1u)))
+		++half;
+	return static_cast<std::uint16_t>(sign | half);
+}
@@ -0,0 +1,130 @@
+#include "ImageDecodePool.hpp"
+#include "MipChain.hpp"
+#include "ChannelPack.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+#include <stb/stb_image.h>
+
+void ImageDecodePool::PixelDeleter::operator()(unsigned char* pixels) const {
+	stbi_image_free(pixels);
+}
+
+void ImageDecodePool::request(const std::filesystem::path& path, int desiredChannels, bool mipChain, BlockFormat blockFormat) {
+	Key key = ImageDecodePool::_key(path, desiredChannels, blockFormat);
+	if (mipChain)
+		this->_mipChainKeys.insert(key);
+	if (this->_images.try_emplace(key).second)
+		this->_pending.push_back(std::move(key));
+}
+
+void ImageDecodePool::requestPacked(const std::array<std::filesystem::path, 3>& paths, bool mipChain, BlockFormat blockFormat) {
+	Key key = ImageDecodePool::_packedKey(paths, blockFormat);
+	if (mipChain)
+		this->_mipChainKeys.insert(key);
+	if (this->_images.try_emplace(key).second)
+		this->_pending.push_back(std::move(key));
+}
+
+// Decode three single-channel files and interleave them. Return nullptr if any file fails to decode.
+// The pixels are allocated with malloc, which is what stbi_image_free releases them with.
+static stbi_uc* loadPackedChannels(const std::vector<std::string>& paths, int& width, int& height) {
+	std::array<ChannelSource, 3> sources{};
+	std::array<std::unique_ptr<stbi_uc[], ImageDecodePool::PixelDeleter>, 3> pixels{};
+	bool failed = false;
+	for (std::size_t c = 0; c < sources.size() && c < paths.size(); ++c) {
+		if (paths[c].empty())
+			continue;
+		int channelWidth, channelHeight, channels;
+		pixels[c].reset(stbi_load(paths[c].c_str(), &channelWidth, &channelHeight, &channels, STBI_grey));
+		if (pixels[c] == nullptr) {
+			failed = true;
+			break;
+		}
+		sources[c] = ChannelSource{
+			.pixels = pixels[c].get(),
+			.width = static_cast<std::uint32_t>(channelWidth),
+			.height = static_cast<std::uint32_t>(channelHeight)
+		};
+	}
+	if (failed)
+		return nullptr;
+	std::uint32_t packedWidth, packedHeight;
+	std::vector<unsigned char> packed = packChannels(sources, packedWidth, packedHeight);
+	stbi_uc* result = static_cast<stbi_uc*>(std::malloc(packed.size()));
+	std::memcpy(result, packed.data(), packed.size());
+	width = static_cast<int>(packedWidth);
+	height = static_cast<int>(packedHeight);
+	return result;
+}
+
+void ImageDecodePool::decode(int numThreads, LoadProfiler* profiler) {
+	if (this->_pending.empty())
+		return;
+	// Look up all entries before starting the workers. std::map never invalidates
+	// references on lookup, so each worker only writes to its own Image.
+	std::vector<std::pair<const Key*, Image*>> jobs; jobs.reserve(this->_pending.size());
+	for (const Key& key : this->_pending) {
+		auto iter = this->_images.find(key);
+		jobs.emplace_back(&iter->first, &iter->second);
+	}
+	std::atomic<std::size_t> nextJob = 0;
+	auto worker = [&](void) {
+		for (std::size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+			const auto& [key, image] = jobs[j];
+			const auto& [paths, desiredChannels, blockFormat] = *key;
+			std::string asset;
+			if (profiler != nullptr)
+				for (const std::string& path : paths)
+					asset += (asset.empty() ? "" : " + ") + (path.empty() ? std::string("-") : path);
+			LoadProfiler::Scope timer(profiler, LoadProfiler::Phase::DecodeTextures, std::move(asset));
+			int width, height, channels;
+			stbi_uc* pixels = (paths.size() == 1) ?
+				stbi_load(paths[0].c_str(), &width, &height, &channels, desiredChannels) :
+				loadPackedChannels(paths, width, height);
+			if (pixels == nullptr)
+				continue;
+			image->width = width;
+			image->height = height;
+			image->channels = desiredChannels;
+			image->pixels.reset(pixels);
+			// Compressed levels cannot be blitted, so the whole chain is filtered and encoded here.
+			if (this->_mipChainKeys.contains(*key) || blockFormat != BlockFormat::NONE)
+				image->mipChain = buildMipChain(pixels, width, height, desiredChannels);
+			if (blockFormat != BlockFormat::NONE) {
+				image->blockFormat = alphaBlockFormat(blockFormat, pixels, width, height, desiredChannels);
+				image->blocks = compressMipChain(image->blockFormat, pixels, image->mipChain, width, height, desiredChannels);
+			}
+			timer.addBytes(std::uint64_t(width) * height * desiredChannels + image->mipChain.size() + image->blocks.size());
+		}
+	};
+	if (numThreads <= 0)
+		numThreads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+	numThreads = std::min(numThreads, static_cast<int>(jobs.size()));
+	std::vector<std::thread> threads; threads.reserve(numThreads - 1);
+	for (int i = 1; i < numThreads; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+	this->_pending.clear();
+	this->_mipChainKeys.clear();
+}
+
+const ImageDecodePool::Image* ImageDecodePool::find(const std::filesystem::path& path, int desiredChannels, BlockFormat blockFormat) const {
+	auto iter = this->_images.find(ImageDecodePool::_key(path, desiredChannels, blockFormat));
+	if (iter == this->_images.end() || iter->second.pixels == nullptr)
+		return nullptr;
+	return &iter->second;
+}
+
+const ImageDecodePool::Image* ImageDecodePool::findPacked(const std::array<std::filesystem::path, 3>& paths, BlockFormat blockFormat) const {
+	auto iter = this->_images.find(ImageDecodePool::_packedKey(paths, blockFormat));
+	if (iter == this->_images.end() || iter->second.pixels == nullptr)
+		return nullptr;
+	return &iter->second;
+}
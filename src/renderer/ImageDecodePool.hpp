@@ -0,0 +1,89 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <array>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <tuple>
+
+#include "BlockCompression.hpp"
+#include "LoadProfiler.hpp"
+
+// Decodes the image files referenced by a scene on a pool of worker threads.
+// All files are registered with `request` first, decoded in parallel by `decode`,
+// and then consumed on the loading thread, so the Vulkan upload order stays the
+// same as the order of objects in the scene file.
+class ImageDecodePool {
+
+public:
+
+	struct PixelDeleter {
+		void operator()(unsigned char* pixels) const;
+	};
+
+	struct Image {
+		int width = 0;
+		int height = 0;
+		int channels = 0; // Number of channels stored in `pixels`, i.e. the requested channels.
+		std::unique_ptr<unsigned char[], PixelDeleter> pixels{};
+		std::vector<unsigned char> mipChain{}; // Mip levels 1 and below (see buildMipChain), if requested.
+		BlockFormat blockFormat = BlockFormat::NONE; // The requested format, except BC7 for BC1 images with alpha.
+		std::vector<unsigned char> blocks{}; // All mip levels, block-compressed in `blockFormat` and stored back to back.
+	};
+
+	ImageDecodePool(void) = default;
+	ImageDecodePool(const ImageDecodePool&) = delete;
+	ImageDecodePool(ImageDecodePool&&) = default;
+	ImageDecodePool& operator=(const ImageDecodePool&) = delete;
+	ImageDecodePool& operator=(ImageDecodePool&&) = default;
+
+	// Register an image file. `desiredChannels` is forwarded to stbi_load.
+	// The same file requested twice with the same channel count is decoded only once.
+	// If `mipChain` is set by any request of the file, its mip chain is box-filtered by the worker too.
+	// If `blockFormat` is not NONE, the worker also compresses the full mip chain into `blocks`.
+	// Requests with different block formats are decoded separately.
+	void request(const std::filesystem::path& path, int desiredChannels, bool mipChain = false, BlockFormat blockFormat = BlockFormat::NONE);
+
+	// Register three single-channel image files, which the worker decodes and interleaves into one
+	// RGBA image with packChannels. An empty path leaves its channel at 0.
+	// `mipChain` and `blockFormat` work as for `request`.
+	void requestPacked(const std::array<std::filesystem::path, 3>& paths, bool mipChain = false, BlockFormat blockFormat = BlockFormat::NONE);
+
+	// Decode all pending requests. `numThreads <= 0` uses all hardware threads.
+	// If `profiler` is not null, the time and decoded size of each image are recorded in it.
+	void decode(int numThreads, LoadProfiler* profiler = nullptr);
+
+	// Get a decoded image. Return nullptr if the image was not requested or failed to decode.
+	const Image* find(const std::filesystem::path& path, int desiredChannels, BlockFormat blockFormat = BlockFormat::NONE) const;
+
+	// Get an image registered with `requestPacked`. Return nullptr if any of its files failed to decode.
+	const Image* findPacked(const std::array<std::filesystem::path, 3>& paths, BlockFormat blockFormat = BlockFormat::NONE) const;
+
+	std::size_t size(void) const { return this->_images.size(); }
+
+private:
+
+	// Files of the image (one, or three for packed images), channels and block format.
+	using Key = std::tuple<std::vector<std::string>, int, BlockFormat>;
+
+	static Key _key(const std::filesystem::path& path, int desiredChannels, BlockFormat blockFormat) {
+		return { { path.lexically_normal().string() }, desiredChannels, blockFormat };
+	}
+
+	static Key _packedKey(const std::array<std::filesystem::path, 3>& paths, BlockFormat blockFormat) {
+		std::vector<std::string> files; files.reserve(paths.size());
+		for (const std::filesystem::path& path : paths)
+			files.push_back(path.empty() ? std::string() : path.lexically_normal().string());
+		return { std::move(files), 4, blockFormat };
+	}
+
+	std::map<Key, Image> _images{};
+	std::vector<Key> _pending{};
+	std::set<Key> _mipChainKeys{};
+
+};
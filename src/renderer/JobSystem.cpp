@@ -0,0 +1,121 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+
+// The pool and queue of the calling thread, if it is a worker.
+static thread_local const JobSystem* workerPool = nullptr;
+static thread_local std::size_t workerQueue = 0;
+
+JobSystem::JobSystem(int numThreads) {
+	if (numThreads <= 0)
+		numThreads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+	this->_queues.reserve(numThreads);
+	for (int i = 0; i < numThreads; ++i)
+		this->_queues.push_back(std::make_unique<Queue>());
+	this->_workers.reserve(numThreads - 1);
+	for (int i = 1; i < numThreads; ++i)
+		this->_workers.emplace_back(&JobSystem::_work, this, static_cast<std::size_t>(i));
+}
+
+JobSystem::~JobSystem(void) {
+	{
+		std::lock_guard<std::mutex> lock(this->_sleepMutex);
+		this->_stop = true;
+	}
+	this->_wake.notify_all();
+	for (std::thread& worker : this->_workers)
+		worker.join();
+}
+
+void JobSystem::parallelFor(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& job) {
+	if (count == 0)
+		return;
+	grainSize = std::max(grainSize, std::size_t(1));
+	std::size_t numChunks = (count + grainSize - 1) / grainSize;
+	if (numChunks == 1 || this->_workers.empty()) {
+		for (std::size_t begin = 0; begin < count; begin += grainSize)
+			job(begin, std::min(begin + grainSize, count));
+		return;
+	}
+	Batch batch;
+	batch.job = &job;
+	batch.remaining = numChunks;
+	// Deal the chunks out round-robin, starting with the queue of this thread.
+	std::size_t self = (workerPool == this) ? workerQueue : 0;
+	this->_numChunks += numChunks;
+	for (std::size_t c = 0; c < numChunks; ++c) {
+		Queue& queue = *this->_queues[(self + c) % this->_queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.chunks.push_back(Chunk{ .batch = &batch, .begin = c * grainSize, .end = std::min((c + 1) * grainSize, count) });
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->_sleepMutex);
+	}
+	this->_wake.notify_all();
+	// Work until no chunk is left to take. Chunks of other batches may be run meanwhile.
+	Chunk chunk;
+	while (batch.remaining.load(std::memory_order_acquire) > 0 && this->_take(self, chunk))
+		_run(chunk);
+	// The rest of the batch is running on other threads.
+	{
+		std::unique_lock<std::mutex> lock(batch.mutex);
+		batch.finished.wait(lock, [&batch](void) { return batch.done; });
+	}
+	if (batch.exception)
+		std::rethrow_exception(batch.exception);
+}
+
+void JobSystem::_work(std::size_t queue) {
+	workerPool = this;
+	workerQueue = queue;
+	Chunk chunk;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(this->_sleepMutex);
+			this->_wake.wait(lock, [this](void) { return this->_stop || this->_numChunks > 0; });
+			if (this->_stop)
+				return;
+		}
+		while (this->_take(queue, chunk))
+			_run(chunk);
+	}
+}
+
+bool JobSystem::_take(std::size_t queue, Chunk& chunk) {
+	for (std::size_t i = 0; i < this->_queues.size(); ++i) {
+		Queue& other = *this->_queues[(queue + i) % this->_queues.size()];
+		std::lock_guard<std::mutex> lock(other.mutex);
+		if (other.chunks.empty())
+			continue;
+		// Own chunks are taken from the back, stolen ones from the front.
+		if (i == 0) {
+			chunk = other.chunks.back();
+			other.chunks.pop_back();
+		}
+		else {
+			chunk = other.chunks.front();
+			other.chunks.pop_front();
+		}
+		--this->_numChunks;
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::_run(const Chunk& chunk) {
+	Batch& batch = *chunk.batch;
+	try {
+		(*batch.job)(chunk.begin, chunk.end);
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> lock(batch.mutex);
+		if (!batch.exception)
+			batch.exception = std::current_exception();
+	}
+	if (batch.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+	// The batch is gone once the caller sees `done`, so it is notified under the lock.
+	std::lock_guard<std::mutex> lock(batch.mutex);
+	batch.done = true;
+	batch.finished.notify_all();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of worker threads for the data-parallel stages of a frame.
+// `parallelFor` splits an index range into fixed chunks, which depend only on the range and the
+// grain size, and deals them out to the queues of the workers. A worker that runs out of chunks
+// steals from the other queues, and the calling thread works on the chunks too, then sleeps until
+// the chunks still running on other threads are done.
+// Jobs that write only to the outputs of their own indices therefore give the same results
+// whichever thread runs them. `parallelFor` may be called from inside a job.
+class JobSystem {
+
+public:
+
+	/** @brief	Start the workers. `numThreads` counts the calling thread, and `numThreads <= 0` uses all hardware threads.
+	  */
+	explicit JobSystem(int numThreads = 0);
+
+	JobSystem(const JobSystem&) = delete;
+
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	/** @brief	Stop and join the workers. No `parallelFor` may be running.
+	  */
+	~JobSystem(void);
+
+	/** @brief	Call `job(begin, end)` on chunks of at most `grainSize` indices covering [0, `count`),
+	  *			and return once every chunk has run. Exceptions thrown by a job are rethrown here.
+	  */
+	void parallelFor(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& job);
+
+	/** @brief	Number of threads running jobs, including the calling thread.
+	  */
+	int numThreads(void) const { return static_cast<int>(this->_workers.size()) + 1; }
+
+private:
+
+	struct Batch {
+		const std::function<void(std::size_t, std::size_t)>* job = nullptr;
+		std::atomic<std::size_t> remaining = 0;
+		std::mutex mutex{};
+		std::condition_variable finished{};
+		bool done = false; // Set by the last chunk, under `mutex`.
+		std::exception_ptr exception{};
+	};
+
+	struct Chunk {
+		Batch* batch = nullptr;
+		std::size_t begin = 0;
+		std::size_t end = 0;
+	};
+
+	struct Queue {
+		std::mutex mutex{};
+		std::deque<Chunk> chunks{};
+	};
+
+	void _work(std::size_t queue);
+	// Pop a chunk from `queue`, or steal one from another queue.
+	bool _take(std::size_t queue, Chunk& chunk);
+	static void _run(const Chunk& chunk);
+
+	// One queue per worker, and queue 0 for the threads that call `parallelFor`.
+	std::vector<std::unique_ptr<Queue>> _queues{};
+	std::vector<std::thread> _workers{};
+	std::atomic<std::size_t> _numChunks = 0; // Chunks queued and not taken yet.
+	std::mutex _sleepMutex{};
+	std::condition_variable _wake{};
+	bool _stop = false;
+
+};
@@ -0,0 +1,172 @@
+#include "LoadProfiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+const char* LoadProfiler::phaseName(Phase phase) {
+	switch (phase) {
+	case Phase::ParseJson:
+		return "parse json";
+	case Phase::CreateObjects:
+		return "create objects";
+	case Phase::DecodeTextures:
+		return "decode textures";
+	case Phase::UploadTextures:
+		return "upload textures";
+	case Phase::ReadMeshes:
+		return "read meshes";
+	case Phase::WaitUploads:
+		return "wait for uploads";
+	case Phase::CreateShadowMaps:
+		return "create shadow maps";
+	case Phase::CreateDescriptors:
+		return "create descriptor sets";
+	default:
+		return "unknown";
+	}
+}
+
+LoadProfiler::Scope::Scope(LoadProfiler* profiler, Phase phase, std::string asset) :
+	_profiler(profiler),
+	_phase(phase),
+	_asset(std::move(asset)),
+	_start(std::chrono::steady_clock::now())
+{}
+
+void LoadProfiler::Scope::stop(void) {
+	if (this->_profiler == nullptr)
+		return;
+	this->_profiler->record(this->_phase, std::move(this->_asset), std::chrono::steady_clock::now() - this->_start, this->_bytes);
+	this->_profiler = nullptr;
+}
+
+void LoadProfiler::record(Phase phase, std::string asset, std::chrono::nanoseconds time, std::uint64_t bytes) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	this->_entries.push_back(Entry{ .phase = phase, .asset = std::move(asset), .time = time, .bytes = bytes });
+}
+
+void LoadProfiler::clear(void) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	this->_entries.clear();
+}
+
+std::vector<LoadProfiler::PhaseTotal> LoadProfiler::_phaseTotals(void) const {
+	std::array<std::chrono::nanoseconds, NUM_PHASES> phaseTimes{}, assetTimes{};
+	std::array<bool, NUM_PHASES> timedAsWhole{};
+	std::array<std::uint64_t, NUM_PHASES> bytes{};
+	std::array<std::size_t, NUM_PHASES> numAssets{};
+	std::array<bool, NUM_PHASES> recorded{};
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		for (const Entry& entry : this->_entries) {
+			std::size_t p = static_cast<std::size_t>(entry.phase);
+			recorded[p] = true;
+			bytes[p] += entry.bytes;
+			if (entry.asset.empty()) {
+				phaseTimes[p] += entry.time;
+				timedAsWhole[p] = true;
+			}
+			else {
+				assetTimes[p] += entry.time;
+				++numAssets[p];
+			}
+		}
+	}
+	std::vector<PhaseTotal> totals;
+	for (std::size_t p = 0; p < NUM_PHASES; ++p) {
+		if (!recorded[p])
+			continue;
+		totals.push_back(PhaseTotal{
+			.phase = static_cast<Phase>(p),
+			.time = timedAsWhole[p] ? phaseTimes[p] : assetTimes[p],
+			.bytes = bytes[p],
+			.numAssets = numAssets[p]
+		});
+	}
+	std::stable_sort(totals.begin(), totals.end(), [](const PhaseTotal& a, const PhaseTotal& b) { return a.time > b.time; });
+	return totals;
+}
+
+std::vector<LoadProfiler::Entry> LoadProfiler::_sortedAssets(void) const {
+	std::vector<Entry> assets;
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		for (const Entry& entry : this->_entries)
+			if (!entry.asset.empty())
+				assets.push_back(entry);
+	}
+	std::stable_sort(assets.begin(), assets.end(), [](const Entry& a, const Entry& b) { return a.time > b.time; });
+	return assets;
+}
+
+static double toMilliseconds(std::chrono::nanoseconds time) {
+	return std::chrono::duration<double, std::milli>(time).count();
+}
+
+void LoadProfiler::printReport(std::ostream& out, std::size_t maxAssets) const {
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(2);
+	out << "Load profile (phases nest, so their times overlap):" << std::endl;
+	out << "  " << std::left << std::setw(24) << "phase" << std::right << std::setw(12) << "ms" << std::setw(16) << "bytes" << std::setw(10) << "assets" << std::endl;
+	for (const PhaseTotal& total : this->_phaseTotals())
+		out << "  " << std::left << std::setw(24) << LoadProfiler::phaseName(total.phase) << std::right << std::setw(12) << toMilliseconds(total.time) << std::setw(16) << total.bytes << std::setw(10) << total.numAssets << std::endl;
+	std::vector<Entry> assets = this->_sortedAssets();
+	if (!assets.empty()) {
+		out << "Slowest assets:" << std::endl;
+		for (std::size_t i = 0; i < assets.size() && i < maxAssets; ++i)
+			out << "  " << std::setw(12) << toMilliseconds(assets[i].time) << " ms " << std::setw(14) << assets[i].bytes << " bytes  " << std::left << std::setw(24) << LoadProfiler::phaseName(assets[i].phase) << std::right << assets[i].asset << std::endl;
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
+
+// Quote and escape a string for JSON.
+static std::string jsonString(const std::string& str) {
+	std::string quoted = "\"";
+	for (char c : str) {
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+			quoted += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			const char* hex = "0123456789abcdef";
+			quoted += "\\u00";
+			quoted += hex[(c >> 4) & 0xF];
+			quoted += hex[c & 0xF];
+		}
+		else
+			quoted += c;
+	}
+	return quoted + "\"";
+}
+
+void LoadProfiler::writeJson(const std::filesystem::path& path) const {
+	std::ofstream fout(path);
+	if (!fout.is_open())
+		throw std::runtime_error("Cannot open load profile file \"" + path.string() + "\".");
+	fout << std::fixed << std::setprecision(3);
+	fout << "{\n\t\"phases\": [";
+	std::vector<PhaseTotal> totals = this->_phaseTotals();
+	for (std::size_t i = 0; i < totals.size(); ++i) {
+		fout << (i == 0 ? "\n" : ",\n");
+		fout << "\t\t{ \"phase\": " << jsonString(LoadProfiler::phaseName(totals[i].phase))
+			<< ", \"ms\": " << toMilliseconds(totals[i].time)
+			<< ", \"bytes\": " << totals[i].bytes
+			<< ", \"assets\": " << totals[i].numAssets << " }";
+	}
+	fout << "\n\t],\n\t\"assets\": [";
+	std::vector<Entry> assets = this->_sortedAssets();
+	for (std::size_t i = 0; i < assets.size(); ++i) {
+		fout << (i == 0 ? "\n" : ",\n");
+		fout << "\t\t{ \"phase\": " << jsonString(LoadProfiler::phaseName(assets[i].phase))
+			<< ", \"asset\": " << jsonString(assets[i].asset)
+			<< ", \"ms\": " << toMilliseconds(assets[i].time)
+			<< ", \"bytes\": " << assets[i].bytes << " }";
+	}
+	fout << "\n\t]\n}\n";
+	if (!fout.good())
+		throw std::runtime_error("Cannot write load profile file \"" + path.string() + "\".");
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Wall-clock timers and byte counters for the phases of a scene load, reported by `--profile-load`.
+// A phase is timed either by one scope around all of it, or by one scope per asset it handles
+// (a texture, a mesh, an object of the scene file). Phases nest: objects are created while
+// their textures are uploaded, so the time of "create objects" includes the uploads.
+// Decode workers record their images concurrently, so per-asset decode times add up to more
+// than the wall-clock time of the decode phase.
+//
+// Nothing is recorded unless the profiler is enabled.
+class LoadProfiler {
+
+public:
+
+	enum class Phase {
+		ParseJson = 0,
+		CreateObjects = 1,
+		DecodeTextures = 2,
+		UploadTextures = 3,
+		ReadMeshes = 4,
+		WaitUploads = 5,
+		CreateShadowMaps = 6,
+		CreateDescriptors = 7,
+	};
+
+	static constexpr inline std::size_t NUM_PHASES = 8;
+
+	/** @brief	Name of a phase in the reports.
+	  */
+	static const char* phaseName(Phase phase);
+
+	// Times from construction until `stop` or destruction, and records the time and the added bytes.
+	class Scope {
+
+	public:
+
+		Scope(LoadProfiler* profiler, Phase phase, std::string asset);
+
+		Scope(const Scope&) = delete;
+
+		Scope& operator=(const Scope&) = delete;
+
+		~Scope(void) { this->stop(); }
+
+		void addBytes(std::uint64_t bytes) { this->_bytes += bytes; }
+
+		/** @brief	Record the entry now. Later calls do nothing.
+		  */
+		void stop(void);
+
+	private:
+
+		LoadProfiler* _profiler;
+		Phase _phase;
+		std::string _asset;
+		std::uint64_t _bytes = 0;
+		std::chrono::steady_clock::time_point _start;
+
+	};
+
+	LoadProfiler(void) = default;
+	LoadProfiler(const LoadProfiler&) = delete;
+	LoadProfiler& operator=(const LoadProfiler&) = delete;
+
+	void setEnabled(bool whether) { this->_enabled = whether; }
+
+	bool enabled(void) const { return this->_enabled; }
+
+	/** @brief	Start timing a phase, or one asset of a phase if `asset` is not empty.
+	  */
+	Scope scope(Phase phase, std::string asset = {}) { return Scope(this->_enabled ? this : nullptr, phase, std::move(asset)); }
+
+	/** @brief	Record an entry measured elsewhere. Safe to call from several threads.
+	  */
+	void record(Phase phase, std::string asset, std::chrono::nanoseconds time, std::uint64_t bytes);
+
+	/** @brief	Drop all entries.
+	  */
+	void clear(void);
+
+	/** @brief	Print the phases, slowest first, followed by the `maxAssets` slowest assets.
+	  */
+	void printReport(std::ostream& out, std::size_t maxAssets = 20) const;
+
+	/** @brief	Write the phases and every asset, slowest first, as JSON.
+	  */
+	void writeJson(const std::filesystem::path& path) const;
+
+private:
+
+	struct Entry {
+		Phase phase;
+		std::string asset; // Empty for an entry covering the whole phase.
+		std::chrono::nanoseconds time;
+		std::uint64_t bytes;
+	};
+
+	struct PhaseTotal {
+		Phase phase;
+		std::chrono::nanoseconds time;
+		std::uint64_t bytes;
+		std::size_t numAssets;
+	};
+
+	// Per-phase totals, slowest first. A phase timed as a whole takes that time;
+	// otherwise it takes the sum of its assets.
+	std::vector<PhaseTotal> _phaseTotals(void) const;
+
+	// Asset entries, slowest first.
+	std::vector<Entry> _sortedAssets(void) const;
+
+	bool _enabled = false;
+	mutable std::mutex _mutex{};
+	std::vector<Entry> _entries{};
+
+};
@@ -0,0 +1,238 @@
+#include "MeshWeld.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+
+WeldedMesh::WeldedMesh(const char* vertexData, std::uint32_t count, std::uint32_t stride) : stride(stride) {
+	// Map each distinct vertex, viewed as raw bytes, to its new index.
+	std::unordered_map<std::string_view, std::uint32_t> uniqueVertices;
+	uniqueVertices.reserve(count);
+	std::vector<std::uint32_t> remap(count);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		std::string_view vertex(vertexData + std::size_t(i) * stride, stride);
+		auto [iter, inserted] = uniqueVertices.try_emplace(vertex, this->numVertices);
+		if (inserted)
+			++this->numVertices;
+		remap[i] = iter->second;
+	}
+	this->vertices.resize(std::size_t(this->numVertices) * stride);
+	for (const auto& [vertex, idx] : uniqueVertices)
+		std::memcpy(this->vertices.data() + std::size_t(idx) * stride, vertex.data(), stride);
+	this->numIndices = count;
+	if (this->numVertices <= std::numeric_limits<std::uint16_t>::max()) {
+		this->indexSize = sizeof(std::uint16_t);
+		this->indices.resize(std::size_t(count) * sizeof(std::uint16_t));
+		std::uint16_t* indices16 = reinterpret_cast<std::uint16_t*>(this->indices.data());
+		for (std::uint32_t i = 0; i < count; ++i)
+			indices16[i] = static_cast<std::uint16_t>(remap[i]);
+	}
+	else {
+		this->indexSize = sizeof(std::uint32_t);
+		this->indices.resize(std::size_t(count) * sizeof(std::uint32_t));
+		std::memcpy(this->indices.data(), remap.data(), this->indices.size());
+	}
+}
+
+std::vector<std::uint32_t> WeldedMesh::_getIndices(void) const {
+	std::vector<std::uint32_t> indices(this->numIndices);
+	if (this->indexSize == sizeof(std::uint16_t)) {
+		const std::uint16_t* indices16 = reinterpret_cast<const std::uint16_t*>(this->indices.data());
+		std::copy(indices16, indices16 + this->numIndices, indices.begin());
+	}
+	else {
+		std::memcpy(indices.data(), this->indices.data(), this->indices.size());
+	}
+	return indices;
+}
+
+void WeldedMesh::_setIndices(const std::vector<std::uint32_t>& indices) {
+	if (this->indexSize == sizeof(std::uint16_t)) {
+		std::uint16_t* indices16 = reinterpret_cast<std::uint16_t*>(this->indices.data());
+		for (std::uint32_t i = 0; i < this->numIndices; ++i)
+			indices16[i] = static_cast<std::uint16_t>(indices[i]);
+	}
+	else {
+		std::memcpy(this->indices.data(), indices.data(), this->indices.size());
+	}
+}
+
+std::uint64_t WeldedMesh::cacheMisses(std::uint32_t cacheSize) const {
+	std::vector<std::uint32_t> indices = this->_getIndices();
+	// A vertex is in the cache if fewer than `cacheSize` misses happened since it was loaded.
+	std::vector<std::uint64_t> loadTime(this->numVertices, 0);
+	std::uint64_t time = std::uint64_t(cacheSize) + 1;
+	std::uint64_t misses = 0;
+	for (std::uint32_t v : indices) {
+		if (time - loadTime[v] > cacheSize) {
+			loadTime[v] = time++;
+			++misses;
+		}
+	}
+	return misses;
+}
+
+std::pair<std::uint64_t, std::uint64_t> WeldedMesh::optimize(void) {
+	std::uint64_t missesBefore = this->cacheMisses();
+	if (this->numIndices % 3 != 0 || this->numVertices == 0)
+		return { missesBefore, missesBefore };
+	std::vector<std::uint32_t> indices = this->_getIndices();
+	std::uint32_t numTriangles = this->numIndices / 3;
+	const std::int64_t cacheSize = WeldedMesh::CACHE_SIZE;
+
+	// Tipsify (Sander et al. 2007, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+	// Vertex-to-triangle adjacency in CSR form.
+	std::vector<std::uint32_t> adjacencyOffset(this->numVertices + 1, 0);
+	for (std::uint32_t v : indices)
+		++adjacencyOffset[v + 1];
+	std::partial_sum(adjacencyOffset.begin(), adjacencyOffset.end(), adjacencyOffset.begin());
+	std::vector<std::uint32_t> adjacency(this->numIndices);
+	{
+		std::vector<std::uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (std::uint32_t i = 0; i < this->numIndices; ++i)
+			adjacency[fill[indices[i]]++] = i / 3;
+	}
+	std::vector<std::uint32_t> liveTriangles(this->numVertices);
+	for (std::uint32_t v = 0; v < this->numVertices; ++v)
+		liveTriangles[v] = adjacencyOffset[v + 1] - adjacencyOffset[v];
+	std::vector<std::int64_t> cacheTime(this->numVertices, 0);
+	std::vector<bool> emitted(numTriangles, false);
+	std::vector<std::uint32_t> deadEnd; deadEnd.reserve(this->numIndices);
+	std::vector<std::uint32_t> order; order.reserve(numTriangles); // Emitted triangles.
+	std::vector<std::uint32_t> clusterBegin{ 0 }; // Clusters start where Tipsify had to jump.
+	std::int64_t time = cacheSize + 1;
+	std::uint32_t cursor = 0;
+	std::int64_t fanning = 0;
+	std::vector<std::uint32_t> candidates;
+	while (fanning >= 0) {
+		candidates.clear();
+		std::uint32_t f = static_cast<std::uint32_t>(fanning);
+		for (std::uint32_t a = adjacencyOffset[f]; a < adjacencyOffset[f + 1]; ++a) {
+			std::uint32_t t = adjacency[a];
+			if (emitted[t])
+				continue;
+			for (int c = 0; c < 3; ++c) {
+				std::uint32_t v = indices[t * 3 + c];
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--liveTriangles[v];
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[t] = true;
+			order.push_back(t);
+		}
+		// Pick the candidate that will still be in the cache and has the fewest live triangles left.
+		fanning = -1;
+		std::int64_t bestPriority = -1;
+		for (std::uint32_t v : candidates) {
+			if (liveTriangles[v] == 0)
+				continue;
+			std::int64_t priority = 0;
+			if (time - cacheTime[v] + 2 * std::int64_t(liveTriangles[v]) <= cacheSize)
+				priority = time - cacheTime[v];
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+		if (fanning < 0) {
+			// Dead end: try recently used vertices, then scan for any vertex with live triangles.
+			while (!deadEnd.empty() && fanning < 0) {
+				std::uint32_t v = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveTriangles[v] > 0)
+					fanning = v;
+			}
+			while (cursor < this->numVertices && fanning < 0) {
+				if (liveTriangles[cursor] > 0)
+					fanning = cursor;
+				++cursor;
+			}
+			if (fanning >= 0 && order.size() != clusterBegin.back())
+				clusterBegin.push_back(static_cast<std::uint32_t>(order.size()));
+		}
+	}
+	clusterBegin.push_back(numTriangles);
+
+	// Overdraw: draw clusters facing away from the mesh center first, since they are likely to occlude the rest.
+	auto position = [&](std::uint32_t v) {
+		std::array<float, 3> p;
+		std::memcpy(p.data(), this->vertices.data() + std::size_t(v) * this->stride, sizeof(p));
+		return p;
+	};
+	std::array<double, 3> meshCenter{ 0.0, 0.0, 0.0 };
+	double meshArea = 0.0;
+	std::size_t numClusters = clusterBegin.size() - 1;
+	std::vector<std::array<double, 3>> clusterCenter(numClusters, { 0.0, 0.0, 0.0 });
+	std::vector<std::array<double, 3>> clusterNormal(numClusters, { 0.0, 0.0, 0.0 });
+	std::vector<double> clusterArea(numClusters, 0.0);
+	for (std::size_t c = 0; c < numClusters; ++c) {
+		for (std::uint32_t o = clusterBegin[c]; o < clusterBegin[c + 1]; ++o) {
+			std::uint32_t t = order[o];
+			std::array<float, 3> p0 = position(indices[t * 3]), p1 = position(indices[t * 3 + 1]), p2 = position(indices[t * 3 + 2]);
+			std::array<double, 3> e1{ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			std::array<double, 3> e2{ p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			std::array<double, 3> normal{ e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			double area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			for (int k = 0; k < 3; ++k) {
+				double center = (double(p0[k]) + p1[k] + p2[k]) / 3.0;
+				clusterCenter[c][k] += center * area;
+				clusterNormal[c][k] += normal[k];
+				meshCenter[k] += center * area;
+			}
+			clusterArea[c] += area;
+			meshArea += area;
+		}
+	}
+	std::vector<double> sortKey(numClusters, 0.0);
+	for (std::size_t c = 0; c < numClusters; ++c) {
+		if (clusterArea[c] <= 0.0 || meshArea <= 0.0)
+			continue;
+		for (int k = 0; k < 3; ++k)
+			sortKey[c] += (clusterCenter[c][k] / clusterArea[c] - meshCenter[k] / meshArea) * clusterNormal[c][k];
+		sortKey[c] /= clusterArea[c];
+	}
+	std::vector<std::uint32_t> clusterOrder(numClusters);
+	std::iota(clusterOrder.begin(), clusterOrder.end(), 0U);
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](std::uint32_t a, std::uint32_t b) { return sortKey[a] > sortKey[b]; });
+	std::vector<std::uint32_t> reordered; reordered.reserve(this->numIndices);
+	for (std::uint32_t c : clusterOrder)
+		for (std::uint32_t o = clusterBegin[c]; o < clusterBegin[c + 1]; ++o)
+			for (int k = 0; k < 3; ++k)
+				reordered.push_back(indices[order[o] * 3 + k]);
+
+	// Vertex fetch: renumber vertices in the order they are first used.
+	std::vector<std::uint32_t> remap(this->numVertices, std::numeric_limits<std::uint32_t>::max());
+	std::uint32_t nextVertex = 0;
+	for (std::uint32_t& v : reordered) {
+		if (remap[v] == std::numeric_limits<std::uint32_t>::max())
+			remap[v] = nextVertex++;
+		v = remap[v];
+	}
+	std::vector<char> vertices(this->vertices.size());
+	for (std::uint32_t v = 0; v < this->numVertices; ++v)
+		if (remap[v] != std::numeric_limits<std::uint32_t>::max())
+			std::memcpy(vertices.data() + std::size_t(remap[v]) * this->stride, this->vertices.data() + std::size_t(v) * this->stride, this->stride);
+	// Welding only creates referenced vertices, so every vertex has been renumbered.
+	this->vertices = std::move(vertices);
+	this->_setIndices(reordered);
+	return { missesBefore, this->cacheMisses() };
+}
+
+void MeshStats::print(std::ostream& out) const {
+	if (this->numInputVertices == 0)
+		return;
+	out << "Welded " << this->numInputVertices << " mesh vertices into " << this->numVertices << " unique vertices (up to "
+		<< 100.0 * (1.0 - static_cast<double>(this->numVertices) / this->numInputVertices) << "% fewer vertex shader invocations per pass)." << std::endl;
+	if (this->numTriangles == 0)
+		return;
+	out << "Vertex cache ACMR (" << WeldedMesh::CACHE_SIZE << " entries): "
+		<< static_cast<double>(this->cacheMissesBefore) / this->numTriangles << " -> "
+		<< static_cast<double>(this->cacheMissesAfter) / this->numTriangles << "." << std::endl;
+}
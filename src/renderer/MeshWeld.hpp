@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <ostream>
+
+// Vertex welding of non-indexed triangle lists.
+// Bitwise identical vertices are merged, and an index buffer is built to reference them.
+class WeldedMesh {
+
+public:
+
+	/** @brief	Number of entries of the FIFO post-transform cache assumed by `optimize` and `cacheMisses`.
+	  */
+	static constexpr inline std::uint32_t CACHE_SIZE = 16;
+
+	std::vector<char> vertices{}; // numVertices * stride bytes.
+	std::uint32_t numVertices = 0;
+	std::uint32_t stride = 0;
+	std::vector<char> indices{}; // numIndices * indexSize bytes.
+	std::uint32_t numIndices = 0;
+	std::uint32_t indexSize = 0; // 2 or 4 bytes.
+
+	WeldedMesh(void) = default;
+
+	/** @brief	Weld `count` interleaved vertices of `stride` bytes each.
+	  *			16-bit indices are used whenever the unique vertices fit.
+	  */
+	WeldedMesh(const char* vertexData, std::uint32_t count, std::uint32_t stride);
+
+	/** @brief	Reorder triangles for the post-transform vertex cache (Tipsify), then reorder
+	  *			the resulting clusters from the outside in to reduce overdraw, and finally
+	  *			renumber vertices in the order they are first referenced for fetch locality.
+	  *			Vertices must start with a float3 position.
+	  * @return	Simulated cache misses before and after the optimization.
+	  */
+	std::pair<std::uint64_t, std::uint64_t> optimize(void);
+
+	/** @brief	Simulate a FIFO post-transform cache and count the misses.
+	  *			ACMR (average cache miss ratio) is the number of misses per triangle.
+	  */
+	std::uint64_t cacheMisses(std::uint32_t cacheSize = WeldedMesh::CACHE_SIZE) const;
+
+private:
+
+	std::vector<std::uint32_t> _getIndices(void) const;
+	void _setIndices(const std::vector<std::uint32_t>& indices);
+
+};
+
+// Totals over all meshes of a scene, for the load log.
+class MeshStats {
+
+public:
+
+	std::uint64_t numInputVertices = 0;
+	std::uint64_t numVertices = 0;
+	std::uint64_t numTriangles = 0;
+	std::uint64_t cacheMissesBefore = 0;
+	std::uint64_t cacheMissesAfter = 0;
+
+	void add(const WeldedMesh& mesh, const std::pair<std::uint64_t, std::uint64_t>& cacheMisses) {
+		this->numInputVertices += mesh.numIndices;
+		this->numVertices += mesh.numVertices;
+		this->numTriangles += mesh.numIndices / 3;
+		this->cacheMissesBefore += cacheMisses.first;
+		this->cacheMissesAfter += cacheMisses.second;
+	}
+
+	void print(std::ostream& out) const;
+
+};
@@ -0,0 +1,39 @@
+#include "MipChain.hpp"
+
+#include <algorithm>
+
+std::vector<unsigned char> buildMipChain(const unsigned char* pixels, std::uint32_t width, std::uint32_t height, std::uint32_t channels) {
+	// Size the chain up front, so that pointers into it stay valid.
+	std::size_t chainSize = 0;
+	for (std::uint32_t w = width, h = height; w > 1 || h > 1; ) {
+		w = std::max(w / 2U, 1U);
+		h = std::max(h / 2U, 1U);
+		chainSize += std::size_t(w) * h * channels;
+	}
+	std::vector<unsigned char> chain(chainSize);
+	const unsigned char* src = pixels;
+	unsigned char* dst = chain.data();
+	while (width > 1 || height > 1) {
+		std::uint32_t dstWidth = std::max(width / 2U, 1U);
+		std::uint32_t dstHeight = std::max(height / 2U, 1U);
+		for (std::uint32_t y = 0; y < dstHeight; ++y) {
+			for (std::uint32_t x = 0; x < dstWidth; ++x) {
+				for (std::uint32_t c = 0; c < channels; ++c) {
+					std::uint32_t sum = 0;
+					for (std::uint32_t dy = 0; dy < 2; ++dy)
+						for (std::uint32_t dx = 0; dx < 2; ++dx) {
+							std::uint32_t sx = std::min(2 * x + dx, width - 1);
+							std::uint32_t sy = std::min(2 * y + dy, height - 1);
+							sum += src[(std::size_t(sy) * width + sx) * channels + c];
+						}
+					dst[(std::size_t(y) * dstWidth + x) * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+		src = dst;
+		dst += std::size_t(dstWidth) * dstHeight * channels;
+		width = dstWidth;
+		height = dstHeight;
+	}
+	return chain;
+}
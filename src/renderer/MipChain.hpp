@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Number of mip levels of a full chain down to 1x1.
+inline std::uint32_t mipLevelCount(std::uint32_t width, std::uint32_t height) {
+	std::uint32_t mipLevels = 1;
+	while (width > 1 || height > 1) {
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+		++mipLevels;
+	}
+	return mipLevels;
+}
+
+// Box-filter an 8-bit image down to 1x1.
+// Returns mip levels 1 to mipLevelCount(width, height) - 1, stored back to back.
+// Level 0 is not included.
+std::vector<unsigned char> buildMipChain(const unsigned char* pixels, std::uint32_t width, std::uint32_t height, std::uint32_t channels);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <jjyou/glsl/glsl.hpp>
+
+// Conversion between linear radiance and the RGBE (shared exponent) encoding of .png environment maps.
+
+inline jjyou::glsl::vec3 unpackRGBE(const jjyou::glsl::vec<unsigned char, 4>& rgbe) {
+	if (rgbe == jjyou::glsl::vec<unsigned char, 4>(0)) {
+		return jjyou::glsl::vec3(0.0f, 0.0f, 0.0f);
+	}
+	else {
+		return pow(2.0f, static_cast<float>(rgbe.a) - 128.0f) * (jjyou::glsl::vec3(rgbe.cast<float>()) + 0.5f) / 256.0f;
+	}
+}
+
+inline jjyou::glsl::vec<unsigned char, 4> packRGBE(jjyou::glsl::vec3 color) {
+	if (color == jjyou::glsl::vec3(0.0))
+		return jjyou::glsl::vec<unsigned char, 4>(0);
+	float maxCoeff = std::max(std::max(color.r, color.g), color.b);
+	int expo = int(std::ceil(std::log2(maxCoeff / (255.5f / 256.0f))));
+	if (expo < -128)
+		return jjyou::glsl::vec<unsigned char, 4>(0);
+	jjyou::glsl::vec<unsigned char, 4> ret{};
+	for (int i = 0; i < 3; ++i)
+		ret[i] = static_cast<unsigned char>(std::clamp<float>(color[i] / std::powf(2.0f, static_cast<float>(expo)) * 256.0f - 0.5f, 0.0f, 255.0f));
+	ret.a = static_cast<unsigned char>(std::clamp<int>(expo + 128, 0, 255));
+	return ret;
+}
@@ -0,0 +1,639 @@
+#include "S72Reader.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace s72 {
+
+	static const std::initializer_list<const char*> MATERIAL_TYPES = { "simple", "pbr", "mirror", "environment", "lambertian" };
+	static const std::initializer_list<const char*> LIGHT_TYPES = { "sun", "sphere", "spot" };
+
+	// Select `candidate` as the type of a material or light if no type is selected yet,
+	// or if it comes before the selected type in `priority`. Return whether it is selected.
+	static bool selectType(std::string& type, const char* candidate, std::initializer_list<const char*> priority) {
+		auto rank = [&](const std::string& name) {
+			return std::find_if(priority.begin(), priority.end(), [&](const char* p) { return name == p; }) - priority.begin();
+		};
+		if (!type.empty() && rank(type) <= rank(candidate))
+			return false;
+		type = candidate;
+		return true;
+	}
+
+	static void clearTexture(TextureRecord& texture) {
+		texture.kind = TextureRecord::Kind::None;
+		texture.value = {};
+		texture.src.clear();
+	}
+
+	void ObjectRecord::clear(void) {
+		this->type.clear();
+		this->name.clear();
+		this->roots.clear();
+		this->translation = { 0.0f, 0.0f, 0.0f };
+		this->rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+		this->scale = { 1.0f, 1.0f, 1.0f };
+		this->children.clear();
+		this->camera.reset();
+		this->mesh.reset();
+		this->environment.reset();
+		this->light.reset();
+		this->count = 0;
+		this->positionSrc.clear();
+		this->positionOffset = 0;
+		this->positionStride = 0;
+		this->hasTangent = false;
+		this->material.reset();
+		this->vfov = this->aspect = this->zNear = this->zFar = 0.0f;
+		this->node.reset();
+		this->channel.clear();
+		this->times.clear();
+		this->values.clear();
+		this->materialType.clear();
+		clearTexture(this->normalMap);
+		clearTexture(this->displacementMap);
+		clearTexture(this->albedo);
+		clearTexture(this->roughness);
+		clearTexture(this->metalness);
+		this->radianceSrc.reset();
+		this->lightType.clear();
+		this->tint = { 1.0f, 1.0f, 1.0f };
+		this->shadow = 0;
+		this->angle = this->strength = 0.0f;
+		this->radius = this->power = this->limit = this->fov = this->blend = 0.0f;
+	}
+
+	// Read a texture property of `textures` that holds `Length` components when it is a constant.
+	template <int Length>
+	static void readTextureRecord(const jjyou::io::Json<>& textures, const std::string& textureName, TextureRecord& texture) {
+		if (textures.find(textureName) == textures.end())
+			return;
+		const jjyou::io::Json<>& value = textures[textureName];
+		if (value.type() == jjyou::io::JsonType::Object) {
+			texture.kind = TextureRecord::Kind::Image;
+			texture.src = static_cast<std::string>(value["src"]);
+			return;
+		}
+		texture.kind = TextureRecord::Kind::Constant;
+		if constexpr (Length == 1)
+			texture.value[0] = static_cast<float>(value);
+		else
+			for (int i = 0; i < Length; ++i)
+				texture.value[i] = static_cast<float>(value[i]);
+	}
+
+	void readObjectRecord(const jjyou::io::Json<>& obj, ObjectRecord& record) {
+		record.clear();
+		auto has = [&](const char* key) { return obj.find(key) != obj.end(); };
+		auto readFloats = [&](const char* key, float* values, int length) {
+			if (has(key))
+				for (int i = 0; i < length; ++i)
+					values[i] = static_cast<float>(obj[key][i]);
+		};
+		auto readIndex = [&](const char* key, std::optional<int>& index) {
+			if (has(key))
+				index = static_cast<int>(obj[key]);
+		};
+		record.type = static_cast<std::string>(obj["type"]);
+		record.name = static_cast<std::string>(obj["name"]);
+		// Scene and node
+		if (has("roots"))
+			for (const auto& rootIdx : obj["roots"])
+				record.roots.push_back(static_cast<int>(rootIdx));
+		readFloats("translation", record.translation.data(), 3);
+		readFloats("rotation", record.rotation.data(), 4);
+		readFloats("scale", record.scale.data(), 3);
+		if (has("children"))
+			for (const auto& childIdx : obj["children"])
+				record.children.push_back(static_cast<int>(childIdx));
+		readIndex("camera", record.camera);
+		readIndex("mesh", record.mesh);
+		readIndex("light", record.light);
+		// Nodes reference an environment, while environment materials have an "environment" object.
+		if (has("environment") && obj["environment"].type() != jjyou::io::JsonType::Object)
+			record.environment = static_cast<int>(obj["environment"]);
+		// Mesh
+		if (has("count"))
+			record.count = static_cast<int>(obj["count"]);
+		if (has("attributes")) {
+			const auto& attributes = obj["attributes"];
+			if (attributes.find("POSITION") != attributes.end()) {
+				record.positionSrc = static_cast<std::string>(attributes["POSITION"]["src"]);
+				record.positionOffset = static_cast<int>(attributes["POSITION"]["offset"]);
+				record.positionStride = static_cast<int>(attributes["POSITION"]["stride"]);
+			}
+			record.hasTangent = (attributes.find("TANGENT") != attributes.end());
+		}
+		readIndex("material", record.material);
+		// Camera
+		if (has("perspective")) {
+			record.vfov = static_cast<float>(obj["perspective"]["vfov"]);
+			record.aspect = static_cast<float>(obj["perspective"]["aspect"]);
+			record.zNear = static_cast<float>(obj["perspective"]["near"]);
+			record.zFar = static_cast<float>(obj["perspective"]["far"]);
+		}
+		// Driver
+		readIndex("node", record.node);
+		if (has("channel"))
+			record.channel = static_cast<std::string>(obj["channel"]);
+		if (has("times"))
+			record.times = std::vector<float>(obj["times"]);
+		if (has("values"))
+			record.values = std::vector<float>(obj["values"]);
+		// Material
+		for (const char* materialType : MATERIAL_TYPES)
+			if (has(materialType) && (std::strcmp(materialType, "environment") != 0 || obj["environment"].type() == jjyou::io::JsonType::Object))
+				selectType(record.materialType, materialType, MATERIAL_TYPES);
+		readTextureRecord<3>(obj, "normalMap", record.normalMap);
+		readTextureRecord<1>(obj, "displacementMap", record.displacementMap);
+		if (record.materialType == "pbr") {
+			readTextureRecord<3>(obj["pbr"], "albedo", record.albedo);
+			readTextureRecord<1>(obj["pbr"], "roughness", record.roughness);
+			readTextureRecord<1>(obj["pbr"], "metalness", record.metalness);
+		}
+		else if (record.materialType == "lambertian")
+			readTextureRecord<3>(obj["lambertian"], "albedo", record.albedo);
+		// Environment
+		if (has("radiance"))
+			record.radianceSrc = static_cast<std::string>(obj["radiance"]["src"]);
+		// Light
+		readFloats("tint", record.tint.data(), 3);
+		if (has("shadow"))
+			record.shadow = static_cast<std::uint32_t>(static_cast<int>(obj["shadow"]));
+		for (const char* lightType : LIGHT_TYPES)
+			if (has(lightType))
+				selectType(record.lightType, lightType, LIGHT_TYPES);
+		if (record.lightType == "sun") {
+			record.angle = static_cast<float>(obj["sun"]["angle"]);
+			record.strength = static_cast<float>(obj["sun"]["strength"]);
+		}
+		else if (record.lightType == "sphere") {
+			record.radius = static_cast<float>(obj["sphere"]["radius"]);
+			record.power = static_cast<float>(obj["sphere"]["power"]);
+			record.limit = static_cast<float>(obj["sphere"]["limit"]);
+		}
+		else if (record.lightType == "spot") {
+			record.radius = static_cast<float>(obj["spot"]["radius"]);
+			record.power = static_cast<float>(obj["spot"]["power"]);
+			record.fov = static_cast<float>(obj["spot"]["fov"]);
+			record.blend = static_cast<float>(obj["spot"]["blend"]);
+			record.limit = static_cast<float>(obj["spot"]["limit"]);
+		}
+	}
+
+	Reader::Reader(const std::filesystem::path& path) :
+		_path(path),
+		_fin(path, std::ios::in | std::ios::binary),
+		_buffer(Reader::BUFFER_SIZE)
+	{
+		if (!this->_fin.is_open())
+			throw std::runtime_error("Cannot open scene file \"" + path.string() + "\".");
+		// Skip a UTF-8 byte order mark.
+		if (this->_peek() == 0xEF) {
+			this->_get();
+			this->_expect('\xBB');
+			this->_expect('\xBF');
+		}
+		this->_expect('[');
+		std::string header;
+		this->_readString(header);
+		if (header != "s72-v1")
+			throw std::runtime_error("Scene72 file must start with \"s72-v1\"");
+	}
+
+	bool Reader::next(ObjectRecord& record) {
+		if (this->_finished)
+			return false;
+		this->_skipWhitespace();
+		int c = this->_get();
+		if (c == ']') {
+			this->_finished = true;
+			return false;
+		}
+		if (c != ',')
+			this->_error("expected ',' or ']' after an object");
+		record.clear();
+		this->_readRecord(record);
+		return true;
+	}
+
+	int Reader::_peek(void) {
+		if (this->_pos == this->_size) {
+			this->_consumed += this->_size;
+			this->_fin.read(this->_buffer.data(), this->_buffer.size());
+			this->_size = static_cast<std::size_t>(this->_fin.gcount());
+			this->_pos = 0;
+			if (this->_size == 0)
+				return EOF;
+		}
+		return static_cast<unsigned char>(this->_buffer[this->_pos]);
+	}
+
+	int Reader::_get(void) {
+		int c = this->_peek();
+		if (c == EOF)
+			return EOF;
+		++this->_pos;
+		if (c == '\n')
+			++this->_line;
+		return c;
+	}
+
+	void Reader::_skipWhitespace(void) {
+		for (int c = this->_peek(); c == ' ' || c == '\t' || c == '\n' || c == '\r'; c = this->_peek())
+			this->_get();
+	}
+
+	void Reader::_expect(char c) {
+		this->_skipWhitespace();
+		if (this->_get() != static_cast<unsigned char>(c))
+			this->_error(std::string("expected '") + c + "'");
+	}
+
+	void Reader::_error(const std::string& message) const {
+		throw std::runtime_error("Scene file \"" + this->_path.string() + "\", line " + std::to_string(this->_line) + ": " + message + ".");
+	}
+
+	// Append a code point to a UTF-8 string.
+	static void appendUtf8(std::string& str, std::uint32_t codePoint) {
+		if (codePoint < 0x80)
+			str += static_cast<char>(codePoint);
+		else if (codePoint < 0x800) {
+			str += static_cast<char>(0xC0 | (codePoint >> 6));
+			str += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000) {
+			str += static_cast<char>(0xE0 | (codePoint >> 12));
+			str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			str += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else {
+			str += static_cast<char>(0xF0 | (codePoint >> 18));
+			str += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+			str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			str += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	void Reader::_readString(std::string& str) {
+		this->_expect('"');
+		str.clear();
+		auto readHex = [&]() {
+			std::uint32_t value = 0;
+			for (int i = 0; i < 4; ++i) {
+				int c = this->_get();
+				value <<= 4;
+				if (c >= '0' && c <= '9')
+					value |= c - '0';
+				else if (c >= 'a' && c <= 'f')
+					value |= c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F')
+					value |= c - 'A' + 10;
+				else
+					this->_error("invalid \\u escape");
+			}
+			return value;
+		};
+		while (true) {
+			int c = this->_get();
+			if (c == EOF)
+				this->_error("unterminated string");
+			if (c == '"')
+				return;
+			if (c != '\\') {
+				str += static_cast<char>(c);
+				continue;
+			}
+			c = this->_get();
+			switch (c) {
+			case '"': str += '"'; break;
+			case '\\': str += '\\'; break;
+			case '/': str += '/'; break;
+			case 'b': str += '\b'; break;
+			case 'f': str += '\f'; break;
+			case 'n': str += '\n'; break;
+			case 'r': str += '\r'; break;
+			case 't': str += '\t'; break;
+			case 'u': {
+				std::uint32_t codePoint = readHex();
+				// Characters outside the basic plane are escaped as surrogate pairs.
+				if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+					if (this->_get() != '\\' || this->_get() != 'u')
+						this->_error("unpaired surrogate in \\u escape");
+					std::uint32_t low = readHex();
+					if (low < 0xDC00 || low >= 0xE000)
+						this->_error("unpaired surrogate in \\u escape");
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(str, codePoint);
+				break;
+			}
+			default:
+				this->_error("invalid escape in string");
+			}
+		}
+	}
+
+	double Reader::_readNumber(void) {
+		this->_skipWhitespace();
+		this->_number.clear();
+		for (int c = this->_peek(); (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; c = this->_peek())
+			this->_number += static_cast<char>(this->_get());
+		if (this->_number.empty())
+			this->_error("expected a number");
+		char* end = nullptr;
+		double value = std::strtod(this->_number.c_str(), &end);
+		if (end != this->_number.c_str() + this->_number.size())
+			this->_error("invalid number \"" + this->_number + "\"");
+		return value;
+	}
+
+	void Reader::_readLiteral(const char* literal) {
+		this->_skipWhitespace();
+		for (const char* c = literal; *c != '\0'; ++c)
+			if (this->_get() != *c)
+				this->_error(std::string("expected \"") + literal + "\"");
+	}
+
+	void Reader::_skipValue(void) {
+		this->_skipWhitespace();
+		int c = this->_peek();
+		if (c == '"') {
+			// Skip the string without storing it.
+			this->_get();
+			for (c = this->_get(); c != '"'; c = this->_get()) {
+				if (c == EOF)
+					this->_error("unterminated string");
+				if (c == '\\')
+					this->_get();
+			}
+		}
+		else if (c == '{')
+			this->_readObject([&](const std::string&) { this->_skipValue(); });
+		else if (c == '[') {
+			this->_get();
+			this->_skipWhitespace();
+			if (this->_peek() == ']') {
+				this->_get();
+				return;
+			}
+			while (true) {
+				this->_skipValue();
+				this->_skipWhitespace();
+				c = this->_get();
+				if (c == ']')
+					return;
+				if (c != ',')
+					this->_error("expected ',' or ']' in an array");
+			}
+		}
+		else if (c == 't')
+			this->_readLiteral("true");
+		else if (c == 'f')
+			this->_readLiteral("false");
+		else if (c == 'n')
+			this->_readLiteral("null");
+		else
+			this->_readNumber();
+	}
+
+	template <class T>
+	void Reader::_readArray(std::vector<T>& values) {
+		values.clear();
+		this->_expect('[');
+		this->_skipWhitespace();
+		if (this->_peek() == ']') {
+			this->_get();
+			return;
+		}
+		while (true) {
+			values.push_back(static_cast<T>(this->_readNumber()));
+			this->_skipWhitespace();
+			int c = this->_get();
+			if (c == ']')
+				return;
+			if (c != ',')
+				this->_error("expected ',' or ']' in an array");
+		}
+	}
+
+	template <std::size_t N>
+	void Reader::_readArray(std::array<float, N>& values) {
+		this->_expect('[');
+		for (std::size_t i = 0; i < N; ++i) {
+			if (i > 0)
+				this->_expect(',');
+			values[i] = this->_readFloat();
+		}
+		this->_expect(']');
+	}
+
+	template <class F>
+	void Reader::_readObject(F&& onKey) {
+		this->_expect('{');
+		this->_skipWhitespace();
+		if (this->_peek() == '}') {
+			this->_get();
+			return;
+		}
+		std::string key;
+		while (true) {
+			this->_readString(key);
+			this->_expect(':');
+			onKey(key);
+			this->_skipWhitespace();
+			int c = this->_get();
+			if (c == '}')
+				return;
+			if (c != ',')
+				this->_error("expected ',' or '}' in an object");
+		}
+	}
+
+	void Reader::_readTexture(TextureRecord& texture) {
+		this->_skipWhitespace();
+		int c = this->_peek();
+		if (c == '{') {
+			texture.kind = TextureRecord::Kind::Image;
+			texture.src.clear();
+			this->_readObject([&](const std::string& key) {
+				if (key == "src")
+					this->_readString(texture.src);
+				else
+					this->_skipValue();
+			});
+			if (texture.src.empty())
+				this->_error("texture has no \"src\"");
+		}
+		else if (c == '[') {
+			texture.kind = TextureRecord::Kind::Constant;
+			this->_readArray(texture.value);
+		}
+		else {
+			texture.kind = TextureRecord::Kind::Constant;
+			texture.value[0] = this->_readFloat();
+		}
+	}
+
+	void Reader::_readRecord(ObjectRecord& record) {
+		this->_readObject([&](const std::string& key) {
+			// Scene and node
+			if (key == "type")
+				this->_readString(record.type);
+			else if (key == "name")
+				this->_readString(record.name);
+			else if (key == "roots")
+				this->_readArray(record.roots);
+			else if (key == "translation")
+				this->_readArray(record.translation);
+			else if (key == "rotation")
+				this->_readArray(record.rotation);
+			else if (key == "scale")
+				this->_readArray(record.scale);
+			else if (key == "children")
+				this->_readArray(record.children);
+			else if (key == "camera")
+				record.camera = this->_readInt();
+			else if (key == "mesh")
+				record.mesh = this->_readInt();
+			else if (key == "light")
+				record.light = this->_readInt();
+			else if (key == "environment") {
+				// Nodes reference an environment, while environment materials have an "environment" object.
+				this->_skipWhitespace();
+				if (this->_peek() == '{') {
+					selectType(record.materialType, "environment", MATERIAL_TYPES);
+					this->_skipValue();
+				}
+				else
+					record.environment = this->_readInt();
+			}
+			// Mesh
+			else if (key == "count")
+				record.count = this->_readInt();
+			else if (key == "attributes") {
+				this->_readObject([&](const std::string& attribute) {
+					if (attribute == "POSITION") {
+						this->_readObject([&](const std::string& property) {
+							if (property == "src")
+								this->_readString(record.positionSrc);
+							else if (property == "offset")
+								record.positionOffset = this->_readInt();
+							else if (property == "stride")
+								record.positionStride = this->_readInt();
+							else
+								this->_skipValue();
+						});
+					}
+					else {
+						if (attribute == "TANGENT")
+							record.hasTangent = true;
+						this->_skipValue();
+					}
+				});
+			}
+			else if (key == "material")
+				record.material = this->_readInt();
+			// Camera
+			else if (key == "perspective") {
+				this->_readObject([&](const std::string& property) {
+					if (property == "vfov")
+						record.vfov = this->_readFloat();
+					else if (property == "aspect")
+						record.aspect = this->_readFloat();
+					else if (property == "near")
+						record.zNear = this->_readFloat();
+					else if (property == "far")
+						record.zFar = this->_readFloat();
+					else
+						this->_skipValue();
+				});
+			}
+			// Driver
+			else if (key == "node")
+				record.node = this->_readInt();
+			else if (key == "channel")
+				this->_readString(record.channel);
+			else if (key == "times")
+				this->_readArray(record.times);
+			else if (key == "values")
+				this->_readArray(record.values);
+			// Material
+			else if (key == "normalMap")
+				this->_readTexture(record.normalMap);
+			else if (key == "displacementMap")
+				this->_readTexture(record.displacementMap);
+			else if (key == "simple" || key == "mirror") {
+				selectType(record.materialType, (key == "simple") ? "simple" : "mirror", MATERIAL_TYPES);
+				this->_skipValue();
+			}
+			else if (key == "pbr" || key == "lambertian") {
+				// Only the textures of the material type that is used are kept.
+				if (!selectType(record.materialType, (key == "pbr") ? "pbr" : "lambertian", MATERIAL_TYPES)) {
+					this->_skipValue();
+					return;
+				}
+				clearTexture(record.albedo);
+				clearTexture(record.roughness);
+				clearTexture(record.metalness);
+				bool pbr = (key == "pbr");
+				this->_readObject([&](const std::string& property) {
+					if (property == "albedo")
+						this->_readTexture(record.albedo);
+					else if (pbr && property == "roughness")
+						this->_readTexture(record.roughness);
+					else if (pbr && property == "metalness")
+						this->_readTexture(record.metalness);
+					else
+						this->_skipValue();
+				});
+			}
+			// Environment
+			else if (key == "radiance") {
+				record.radianceSrc.emplace();
+				this->_readObject([&](const std::string& property) {
+					if (property == "src")
+						this->_readString(*record.radianceSrc);
+					else
+						this->_skipValue();
+				});
+			}
+			// Light
+			else if (key == "tint")
+				this->_readArray(record.tint);
+			else if (key == "shadow")
+				record.shadow = static_cast<std::uint32_t>(this->_readInt());
+			else if (key == "sun" || key == "sphere" || key == "spot") {
+				const char* lightType = (key == "sun") ? "sun" : (key == "sphere") ? "sphere" : "spot";
+				if (!selectType(record.lightType, lightType, LIGHT_TYPES)) {
+					this->_skipValue();
+					return;
+				}
+				this->_readObject([&](const std::string& property) {
+					if (property == "angle")
+						record.angle = this->_readFloat();
+					else if (property == "strength")
+						record.strength = this->_readFloat();
+					else if (property == "radius")
+						record.radius = this->_readFloat();
+					else if (property == "power")
+						record.power = this->_readFloat();
+					else if (property == "limit")
+						record.limit = this->_readFloat();
+					else if (property == "fov")
+						record.fov = this->_readFloat();
+					else if (property == "blend")
+						record.blend = this->_readFloat();
+					else
+						this->_skipValue();
+				});
+			}
+			else
+				this->_skipValue();
+		});
+	}
+
+}
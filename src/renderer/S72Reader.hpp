@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+#include <jjyou/io/Json.hpp>
+
+namespace s72 {
+
+	// A texture property of a material: absent, a constant, or an image file.
+	struct TextureRecord {
+		enum class Kind {
+			None = 0,
+			Constant = 1,
+			Image = 2,
+		};
+		Kind kind = Kind::None;
+		std::array<float, 3> value{}; // Scalar constants are stored in the first component.
+		std::string src{};
+	};
+
+	// The properties of one object of a scene file that the loader uses.
+	// Properties that the object does not have keep their defaults. References are 1-based indices.
+	struct ObjectRecord {
+		std::string type{};
+		std::string name{};
+		// SCENE
+		std::vector<int> roots{};
+		// NODE
+		std::array<float, 3> translation{ 0.0f, 0.0f, 0.0f };
+		std::array<float, 4> rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+		std::array<float, 3> scale{ 1.0f, 1.0f, 1.0f };
+		std::vector<int> children{};
+		std::optional<int> camera{};
+		std::optional<int> mesh{};
+		std::optional<int> environment{};
+		std::optional<int> light{};
+		// MESH
+		int count = 0;
+		std::string positionSrc{};
+		int positionOffset = 0;
+		int positionStride = 0;
+		bool hasTangent = false;
+		std::optional<int> material{};
+		// CAMERA
+		float vfov = 0.0f;
+		float aspect = 0.0f;
+		float zNear = 0.0f;
+		float zFar = 0.0f;
+		// DRIVER
+		std::optional<int> node{};
+		std::string channel{};
+		std::vector<float> times{};
+		std::vector<float> values{};
+		// MATERIAL
+		std::string materialType{}; // "simple", "pbr", "mirror", "environment" or "lambertian". Empty if none is given.
+		TextureRecord normalMap{};
+		TextureRecord displacementMap{};
+		TextureRecord albedo{};
+		TextureRecord roughness{};
+		TextureRecord metalness{};
+		// ENVIRONMENT
+		std::optional<std::string> radianceSrc{};
+		// LIGHT
+		std::string lightType{}; // "sun", "sphere" or "spot". Empty if none is given.
+		std::array<float, 3> tint{ 1.0f, 1.0f, 1.0f };
+		std::uint32_t shadow = 0;
+		float angle = 0.0f;
+		float strength = 0.0f;
+		float radius = 0.0f;
+		float power = 0.0f;
+		float limit = 0.0f;
+		float fov = 0.0f;
+		float blend = 0.0f;
+
+		/** @brief	Reset every property, keeping the storage of strings and arrays for the next object.
+		  */
+		void clear(void);
+	};
+
+	/** @brief	Fill `record` from an object of a parsed scene file.
+	  */
+	void readObjectRecord(const jjyou::io::Json<>& obj, ObjectRecord& record);
+
+	// Pull reader of scene files.
+	// Objects are read one at a time straight from the file, so the scene is never held in memory
+	// as a document tree and properties the loader does not use are skipped without being stored.
+	class Reader {
+
+	public:
+
+		/** @brief	Open a scene file and check its "s72-v1" header.
+		  */
+		explicit Reader(const std::filesystem::path& path);
+
+		Reader(const Reader&) = delete;
+
+		Reader& operator=(const Reader&) = delete;
+
+		/** @brief	Read the next object into `record`. Return false at the end of the file.
+		  */
+		bool next(ObjectRecord& record);
+
+		/** @brief	Number of bytes read so far.
+		  */
+		std::uint64_t bytesRead(void) const { return this->_consumed + this->_pos; }
+
+	private:
+
+		static constexpr inline std::size_t BUFFER_SIZE = 1 << 16;
+
+		int _peek(void);
+		int _get(void);
+		void _skipWhitespace(void);
+		void _expect(char c);
+		[[noreturn]] void _error(const std::string& message) const;
+
+		void _readString(std::string& str);
+		double _readNumber(void);
+		float _readFloat(void) { return static_cast<float>(this->_readNumber()); }
+		int _readInt(void) { return static_cast<int>(this->_readNumber()); }
+		void _readLiteral(const char* literal);
+		void _skipValue(void);
+		template <class T>
+		void _readArray(std::vector<T>& values);
+		template <std::size_t N>
+		void _readArray(std::array<float, N>& values);
+		// Call `onKey(key)` for every key of an object. `onKey` must read or skip the value.
+		template <class F>
+		void _readObject(F&& onKey);
+		void _readTexture(TextureRecord& texture);
+		void _readRecord(ObjectRecord& record);
+
+		std::filesystem::path _path;
+		std::ifstream _fin;
+		std::vector<char> _buffer;
+		std::size_t _pos = 0;
+		std::size_t _size = 0;
+		std::uint64_t _consumed = 0;
+		std::uint64_t _line = 1;
+		bool _finished = false;
+		std::string _number{};
+
+	};
+
+}
@@ -1,34 +1,23 @@
 #include "Scene72.hpp"
 #include "Engine.hpp"
+#include "ImageDecodePool.hpp"
+#include "UploadBatch.hpp"
+#include "BlobCache.hpp"
+#include "BlockCompression.hpp"
+#include "HDRFormat.hpp"
+#include "MeshWeld.hpp"
+#include "MipChain.hpp"
+#include "VertexFormat.hpp"
+#include "S72Reader.hpp"
+#include "SceneStreamer.hpp"
+#include <algorithm>
+#include <chrono>
 #include <type_traits>
 #include <jjyou/utils.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
-inline jjyou::glsl::vec3 unpackRGBE(const jjyou::glsl::vec<unsigned char, 4>& rgbe) {
-	if (rgbe == jjyou::glsl::vec<unsigned char, 4>(0)) {
-		return jjyou::glsl::vec3(0.0f, 0.0f, 0.0f);
-	}
-	else {
-		return pow(2.0f, static_cast<float>(rgbe.a) - 128.0f) * (jjyou::glsl::vec3(rgbe.cast<float>()) + 0.5f) / 256.0f;
-	}
-}
-
-inline jjyou::glsl::vec<unsigned char, 4> packRGBE(jjyou::glsl::vec3 color) {
-	if (color == jjyou::glsl::vec3(0.0))
-		return jjyou::glsl::vec<unsigned char, 4>(0);
-	float maxCoeff = std::max(std::max(color.r, color.g), color.b);
-	int expo = int(std::ceil(std::log2(maxCoeff / (255.5f / 256.0f))));
-	if (expo < -128)
-		return jjyou::glsl::vec<unsigned char, 4>(0);
-	jjyou::glsl::vec<unsigned char, 4> ret{};
-	for (int i = 0; i < 3; ++i)
-		ret[i] = static_cast<unsigned char>(std::clamp<float>(color[i] / std::powf(2.0f, static_cast<float>(expo)) * 256.0f - 0.5f, 0.0f, 255.0f));
-	ret.a = static_cast<unsigned char>(std::clamp<int>(expo + 128, 0, 255));
-	return ret;
-}
-
 template <class V>
 inline V interpolate(s72::Driver::Interpolation interpolation, float begT, float endT, float currT, const V& begV, const V& endV) {
 	if (interpolation == s72::Driver::Interpolation::Step)
@@ -49,161 +38,548 @@ inline V interpolate(s72::Driver::Interpolation interpolation, float begT, float
 	return V{};
 }
 
+// Block format of a material texture loaded from an image.
+// Normal maps keep their X and Y in BC5, and the shaders reconstruct Z.
+// The packed surface texture of PBR materials always uses BC7, because BC1 fits all three
+// of its unrelated channels on one color line.
+static BlockFormat materialBlockFormat(Engine::TextureCompression compression, const std::string& textureName) {
+	if (compression == Engine::TextureCompression::NONE)
+		return BlockFormat::NONE;
+	if (textureName == "normalMap")
+		return BlockFormat::BC5;
+	if (textureName == "albedo")
+		return (compression == Engine::TextureCompression::BC7) ? BlockFormat::BC7 : BlockFormat::BC1;
+	if (textureName == "surface")
+		return BlockFormat::BC7;
+	return BlockFormat::BC4;
+}
+
+// Asset cache key of a material texture loaded from an image.
+static std::string imageTextureKey(const std::filesystem::path& imagePath, int channels, BlockFormat blockFormat) {
+	std::string fileKey = AssetCache::fileKey(imagePath);
+	if (fileKey.empty())
+		return {};
+	return "image|" + fileKey + "|" + std::to_string(channels) + "|" + std::to_string(static_cast<int>(blockFormat));
+}
+
+// Asset cache key of an environment cube map. Pre-filtered levels are part of the radiance map,
+// so every level file is part of its key.
+static std::string environmentTextureKey(const std::vector<std::filesystem::path>& imagePaths, HDRFormat format) {
+	std::string key = "environment|" + std::to_string(static_cast<int>(format));
+	for (const std::filesystem::path& imagePath : imagePaths) {
+		std::string fileKey = AssetCache::fileKey(imagePath);
+		if (fileKey.empty())
+			return {};
+		key += "|" + fileKey;
+	}
+	return key;
+}
+
+// Images packed into the surface texture of a PBR material: displacement, roughness and metalness.
+// Channels given by a constant, or not given, have an empty path.
+static std::array<std::filesystem::path, 3> surfaceImagePaths(const std::filesystem::path& baseDir, const s72::ObjectRecord& material) {
+	std::array<std::filesystem::path, 3> imagePaths{};
+	auto imagePath = [&](const s72::TextureRecord& texture) -> std::filesystem::path {
+		if (texture.kind != s72::TextureRecord::Kind::Image)
+			return {};
+		return baseDir / texture.src;
+	};
+	imagePaths[0] = imagePath(material.displacementMap);
+	imagePaths[1] = imagePath(material.roughness);
+	imagePaths[2] = imagePath(material.metalness);
+	return imagePaths;
+}
+
+// Asset cache key of the surface texture packed from `imagePaths`.
+static std::string surfaceTextureKey(const std::array<std::filesystem::path, 3>& imagePaths, BlockFormat blockFormat) {
+	std::string key = "surface|" + std::to_string(static_cast<int>(blockFormat));
+	for (const std::filesystem::path& imagePath : imagePaths) {
+		if (imagePath.empty()) {
+			key += "|";
+			continue;
+		}
+		std::string fileKey = AssetCache::fileKey(imagePath);
+		if (fileKey.empty())
+			return {};
+		key += "|" + fileKey;
+	}
+	return key;
+}
+
+// Radiance map of an environment followed by its pre-filtered levels.
+static std::vector<std::filesystem::path> radianceImagePaths(const std::filesystem::path& baseDir, const std::filesystem::path& radiancePath) {
+	std::vector<std::filesystem::path> imagePaths = { baseDir / radiancePath };
+	for (int j = 1; ; ++j) {
+		std::filesystem::path imagePath = radiancePath;
+		imagePath.replace_filename(imagePath.stem().string() + ".prefilteredenv." + std::to_string(j) + imagePath.extension().string());
+		imagePath = baseDir / imagePath;
+		if (!std::filesystem::exists(imagePath))
+			break;
+		imagePaths.push_back(imagePath);
+	}
+	return imagePaths;
+}
+
+// Lambertian map of an environment.
+static std::filesystem::path lambertianImagePath(const std::filesystem::path& baseDir, const std::filesystem::path& radiancePath) {
+	std::filesystem::path imagePath = radiancePath;
+	imagePath.replace_filename(imagePath.stem().string() + ".lambertian" + imagePath.extension().string());
+	return baseDir / imagePath;
+}
+
+// Upload a welded mesh into `geometryArena` and cache it under `key`.
+static AssetCache::Mesh uploadWeldedMesh(
+	const std::shared_ptr<GeometryArena>& geometryArena,
+	UploadBatch& uploadBatch,
+	AssetCache& assetCache,
+	const std::string& key,
+	const WeldedMesh& welded
+) {
+	// Ranges are aligned to their element size, so they can be addressed by element offsets.
+	GeometryArena::Allocation vertices = geometryArena->upload(uploadBatch, welded.vertices.data(), welded.vertices.size(), welded.stride);
+	std::vector<char> positions = PositionVertexFormat::extract(welded.vertices.data(), welded.numVertices, welded.stride);
+	GeometryArena::Allocation positionRange = geometryArena->upload(uploadBatch, positions.data(), positions.size(), PositionVertexFormat::STRIDE);
+	GeometryArena::Allocation indices = geometryArena->upload(uploadBatch, welded.indices.data(), welded.indices.size(), welded.indexSize);
+	return assetCache.insertMesh(key, AssetCache::MeshGeometry{
+		.arena = geometryArena,
+		.count = welded.numIndices,
+		.numVertices = welded.numVertices,
+		.vertexBuffer = vertices.buffer,
+		.firstVertex = static_cast<std::int32_t>(vertices.offset / welded.stride),
+		.positionBuffer = positionRange.buffer,
+		.firstPosition = static_cast<std::int32_t>(positionRange.offset / PositionVertexFormat::STRIDE),
+		.indexBuffer = indices.buffer,
+		.firstIndex = static_cast<std::uint32_t>(indices.offset / welded.indexSize),
+		.indexType = (welded.indexSize == sizeof(std::uint16_t)) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+		.bbox = BBox(
+			welded.numVertices,
+			[&](std::size_t i)->jjyou::glsl::vec3 {
+				return *reinterpret_cast<const jjyou::glsl::vec3*>(welded.vertices.data() + i * welded.stride);
+			}
+		)
+	}, uploadBatch);
+}
+
+// Create a material texture from a decoded image and cache it under `key`.
+// `format` is the format of the image if it is not block-compressed.
+// The upload is recorded in `profiler` as `assetName`.
+static AssetCache::Texture createImageTexture(
+	const jjyou::vk::Context& context,
+	jjyou::vk::MemoryAllocator& allocator,
+	UploadBatch& uploadBatch,
+	AssetCache& assetCache,
+	LoadProfiler& profiler,
+	const std::string& assetName,
+	const std::string& key,
+	const ImageDecodePool::Image& image,
+	VkFormat format
+) {
+	LoadProfiler::Scope timer = profiler.scope(LoadProfiler::Phase::UploadTextures, assetName);
+	jjyou::vk::Texture2D texture;
+	VkExtent2D extent{
+		.width = static_cast<std::uint32_t>(image.width),
+		.height = static_cast<std::uint32_t>(image.height)
+	};
+	// Use the mip chain filtered by the decode pool if there is one.
+	// Otherwise the levels are generated by blits on the GPU.
+	std::uint32_t mipLevels = mipLevelCount(extent.width, extent.height);
+	std::vector<void*> mipData;
+	if (image.blockFormat != BlockFormat::NONE) {
+		mipData.reserve(mipLevels - 1);
+		unsigned char* level = const_cast<unsigned char*>(image.blocks.data());
+		VkExtent2D levelExtent = extent;
+		for (std::uint32_t m = 1; m < mipLevels; ++m) {
+			level += blockCompressedSize(image.blockFormat, levelExtent.width, levelExtent.height);
+			levelExtent.width = std::max(levelExtent.width / 2U, 1U);
+			levelExtent.height = std::max(levelExtent.height / 2U, 1U);
+			mipData.push_back(level);
+		}
+		timer.addBytes(image.blocks.size());
+		texture.create(
+			context,
+			allocator,
+			uploadBatch,
+			image.blocks.data(),
+			blockVkFormat(image.blockFormat),
+			extent,
+			static_cast<int>(mipLevels),
+			mipData
+		);
+		return assetCache.insertTexture(key, std::move(texture), uploadBatch);
+	}
+	if (!image.mipChain.empty()) {
+		mipData.reserve(mipLevels - 1);
+		unsigned char* level = const_cast<unsigned char*>(image.mipChain.data());
+		VkExtent2D levelExtent = extent;
+		for (std::uint32_t m = 1; m < mipLevels; ++m) {
+			levelExtent.width = std::max(levelExtent.width / 2U, 1U);
+			levelExtent.height = std::max(levelExtent.height / 2U, 1U);
+			mipData.push_back(level);
+			level += std::size_t(levelExtent.width) * levelExtent.height * image.channels;
+		}
+	}
+	timer.addBytes(std::uint64_t(image.width) * image.height * image.channels + image.mipChain.size());
+	texture.create(
+		context,
+		allocator,
+		uploadBatch,
+		image.pixels.get(),
+		format,
+		extent,
+		static_cast<int>(mipLevels),
+		mipData
+	);
+	return assetCache.insertTexture(key, std::move(texture), uploadBatch);
+}
+
+// Load texture `textureIdx` of a material from an image, or get it from the asset cache if an earlier load created it.
+// If the material gives a constant instead, or nothing, the constant (or `defaultValue`) is stored in `constantValue`
+// and `placeholder` is returned. Otherwise bit `textureIdx` of `parameters.textureMask` is set.
+// If `pending` is given and the image is not decoded, the texture is described in `pending` instead
+// and `placeholder` is returned with the default value, until the texture is swapped in.
 template <int Length>
-static jjyou::vk::Texture2D loadTexture(
+static AssetCache::Texture loadTexture(
 	const std::filesystem::path& baseDir,
 	const jjyou::vk::Context& context,
 	jjyou::vk::MemoryAllocator& allocator,
-	VkCommandPool graphicsCommandPool,
-	VkCommandPool transferCommandPool,
-	const jjyou::io::Json<>& material,
+	UploadBatch& uploadBatch,
+	const ImageDecodePool& decodePool,
+	AssetCache& assetCache,
+	LoadProfiler& profiler,
+	Engine::TextureCompression compression,
+	const AssetCache::Texture& placeholder,
+	const s72::TextureRecord& texture,
 	const std::string& textureName,
-	const std::array<unsigned char, Length>& defaultValue,
-	bool normalConversion// normal = texture * 2 - 1
-) requires (Length == 1 || Length == 3 || Length == 4)
+	std::uint32_t textureIdx,
+	const std::array<float, Length>& defaultValue,
+	Engine::MaterialParameters& parameters,
+	float* constantValue,
+	SceneStreamer::TextureJob* pending = nullptr
+) requires (Length == 1 || Length == 3)
 {
-	using ElementType = std::conditional_t<Length == 3, std::array<unsigned char, Length + 1>, std::array<unsigned char, Length>>;
-	jjyou::vk::Texture2D texture;
-	VkFormat format = VK_FORMAT_UNDEFINED;
-	switch (Length) {
-	case 1:
-		format = VK_FORMAT_R8_UNORM;
-		break;
-	case 3:
-		// Note: VK_FORMAT_R8G8B8_UNORM is usually not supported.
-		// We will use VK_FORMAT_R8G8B8A8_UNORM for 3-dimensional data.
-	case 4:
-		format = VK_FORMAT_R8G8B8A8_UNORM;
-		break;
-	default:
-		return {};
+	if (texture.kind == s72::TextureRecord::Kind::None) {
+		// Texture not found. Use the default value.
+		for (int i = 0; i < Length; ++i)
+			constantValue[i] = defaultValue[i];
+		return placeholder;
 	}
-	if (material.find(textureName) == material.end()) {
-		// Texture not found. Create 1x1 texture with default value.
-		ElementType _defaultValue{};
+	if (texture.kind == s72::TextureRecord::Kind::Constant) {
+		// Constant value.
 		for (int i = 0; i < Length; ++i)
-			_defaultValue[i] = defaultValue[i];
-		if constexpr (Length == 3) {
-			_defaultValue[3] = 255;
+			constantValue[i] = texture.value[i];
+		return placeholder;
+	}
+	// The image has already been decoded by the decode pool.
+	// Note: VK_FORMAT_R8G8B8_UNORM is usually not supported.
+	// We will use VK_FORMAT_R8G8B8A8_UNORM for 3-dimensional data.
+	parameters.textureMask |= 1U << textureIdx;
+	VkFormat format = (Length == 1) ? VK_FORMAT_R8_UNORM : VK_FORMAT_R8G8B8A8_UNORM;
+	std::filesystem::path imagePath = baseDir / texture.src;
+	BlockFormat blockFormat = materialBlockFormat(compression, textureName);
+	int channels = (Length == 1) ? STBI_grey : STBI_rgb_alpha;
+	std::string key = imageTextureKey(imagePath, channels, blockFormat);
+	if (AssetCache::Texture cached = assetCache.findTexture(key, &uploadBatch))
+		return cached;
+	const ImageDecodePool::Image* image = decodePool.find(imagePath, channels, blockFormat);
+	if (image == nullptr && pending != nullptr) {
+		parameters.textureMask &= ~(1U << textureIdx);
+		for (int i = 0; i < Length; ++i)
+			constantValue[i] = defaultValue[i];
+		pending->slot = textureIdx;
+		pending->textureMask = 1U << textureIdx;
+		pending->key = std::move(key);
+		pending->paths[0] = std::move(imagePath);
+		pending->channels = channels;
+		pending->blockFormat = blockFormat;
+		pending->format = format;
+		return placeholder;
+	}
+	if (image == nullptr) {
+		return nullptr;
+	}
+	return createImageTexture(context, allocator, uploadBatch, assetCache, profiler, imagePath.string(), key, *image, format);
+}
+
+// Load the surface texture of a PBR material, which packs its displacement, roughness and metalness
+// into red, green and blue, or get it from the asset cache if an earlier load created it.
+// Channels given by a constant, or not given, are stored in `parameters` and left at 0 in the texture.
+// Bits 1, 3 and 4 of `parameters.textureMask` are set for the channels that come from images.
+// If no channel comes from an image, `placeholder` is returned.
+// `pending` is handled as in `loadTexture`, with the default values of the image channels.
+static AssetCache::Texture loadSurfaceTexture(
+	const std::filesystem::path& baseDir,
+	const jjyou::vk::Context& context,
+	jjyou::vk::MemoryAllocator& allocator,
+	UploadBatch& uploadBatch,
+	const ImageDecodePool& decodePool,
+	AssetCache& assetCache,
+	LoadProfiler& profiler,
+	Engine::TextureCompression compression,
+	const AssetCache::Texture& placeholder,
+	const s72::ObjectRecord& material,
+	Engine::MaterialParameters& parameters,
+	SceneStreamer::TextureJob* pending = nullptr
+) {
+	std::array<std::filesystem::path, 3> imagePaths = surfaceImagePaths(baseDir, material);
+	bool anyImage = false;
+	auto loadChannel = [&](const s72::TextureRecord& texture, std::size_t channel, std::uint32_t textureIdx, float defaultValue, float& constantValue) {
+		if (!imagePaths[channel].empty()) {
+			parameters.textureMask |= 1U << textureIdx;
+			anyImage = true;
 		}
-		texture.create(
-			context,
-			allocator,
-			graphicsCommandPool,
-			transferCommandPool,
-			_defaultValue.data(),
-			format,
-			VkExtent2D{ .width = 1,.height = 1 }
-		);
+		else if (texture.kind == s72::TextureRecord::Kind::Constant)
+			constantValue = texture.value[0];
+		else
+			constantValue = defaultValue;
+	};
+	loadChannel(material.displacementMap, 0, 1, 0.0f, parameters.displacement);
+	loadChannel(material.roughness, 1, 3, 1.0f, parameters.roughness);
+	loadChannel(material.metalness, 2, 4, 0.0f, parameters.metalness);
+	if (!anyImage)
+		return placeholder;
+	BlockFormat blockFormat = materialBlockFormat(compression, "surface");
+	std::string key = surfaceTextureKey(imagePaths, blockFormat);
+	if (AssetCache::Texture cached = assetCache.findTexture(key, &uploadBatch))
+		return cached;
+	const ImageDecodePool::Image* image = decodePool.findPacked(imagePaths, blockFormat);
+	if (image == nullptr && pending != nullptr) {
+		pending->slot = 1;
+		pending->textureMask = parameters.textureMask & ((1U << 1) | (1U << 3) | (1U << 4));
+		parameters.textureMask &= ~pending->textureMask;
+		if (!imagePaths[0].empty())
+			parameters.displacement = 0.0f;
+		if (!imagePaths[1].empty())
+			parameters.roughness = 1.0f;
+		if (!imagePaths[2].empty())
+			parameters.metalness = 0.0f;
+		pending->key = std::move(key);
+		pending->paths = std::move(imagePaths);
+		pending->packed = true;
+		pending->channels = STBI_rgb_alpha;
+		pending->blockFormat = blockFormat;
+		pending->format = VK_FORMAT_R8G8B8A8_UNORM;
+		return placeholder;
 	}
-	else {
-		// Texture found, Check whether the texture is a constant value or an external image.
-		if (material[textureName].type() != jjyou::io::JsonType::Object) {
-			// Constant value.
-			ElementType constantValue{};
-			if constexpr (Length == 1) {
-				if (!normalConversion)
-					constantValue[0] = jjyou::utils::color_cast<unsigned char>(static_cast<float>(material[textureName]));
-				else
-					constantValue[0] = jjyou::utils::color_cast<unsigned char>(static_cast<float>(material[textureName]) / 2.0 + 0.5);
+	if (image == nullptr) {
+		return nullptr;
+	}
+	std::string assetName;
+	for (const std::filesystem::path& imagePath : imagePaths)
+		assetName += (assetName.empty() ? "" : " + ") + (imagePath.empty() ? std::string("-") : imagePath.string());
+	return createImageTexture(context, allocator, uploadBatch, assetCache, profiler, assetName, key, *image, VK_FORMAT_R8G8B8A8_UNORM);
+}
+
+// Register every image referenced by the materials and environments in `objects`,
+// so that they can be decoded in parallel before any texture is created.
+// If `materialMipChains` is set, the mip chains of material images are filtered by the decode workers.
+// If `compression` is not NONE, the decode workers also block-compress them.
+// Images whose textures are already in `assetCache` are skipped.
+// Material images go to `decodePool`, environment images to `environmentPool`, which may be the same pool.
+static void requestSceneImages(
+	const std::vector<std::pair<std::uint32_t, s72::ObjectRecord>>& objects,
+	const std::filesystem::path& baseDir,
+	bool materialMipChains,
+	Engine::TextureCompression compression,
+	HDRFormat environmentFormat,
+	const AssetCache& assetCache,
+	ImageDecodePool& decodePool,
+	ImageDecodePool& environmentPool
+) {
+	auto requestTexture = [&](const s72::TextureRecord& texture, const std::string& textureName, int desiredChannels) {
+		if (texture.kind != s72::TextureRecord::Kind::Image)
+			return;
+		std::filesystem::path imagePath = baseDir / texture.src;
+		BlockFormat blockFormat = materialBlockFormat(compression, textureName);
+		if (assetCache.findTexture(imageTextureKey(imagePath, desiredChannels, blockFormat)) == nullptr)
+			decodePool.request(imagePath, desiredChannels, materialMipChains, blockFormat);
+	};
+	for (const auto& object : objects) {
+		const s72::ObjectRecord& obj = object.second;
+		if (obj.type == "MATERIAL") {
+			if (obj.materialType == "simple")
+				continue;
+			requestTexture(obj.normalMap, "normalMap", STBI_rgb_alpha);
+			if (obj.materialType == "pbr") {
+				// Displacement, roughness and metalness are packed into one surface texture.
+				requestTexture(obj.albedo, "albedo", STBI_rgb_alpha);
+				std::array<std::filesystem::path, 3> imagePaths = surfaceImagePaths(baseDir, obj);
+				BlockFormat blockFormat = materialBlockFormat(compression, "surface");
+				bool anyImage = std::any_of(imagePaths.begin(), imagePaths.end(), [](const std::filesystem::path& imagePath) { return !imagePath.empty(); });
+				if (anyImage && assetCache.findTexture(surfaceTextureKey(imagePaths, blockFormat)) == nullptr)
+					decodePool.requestPacked(imagePaths, materialMipChains, blockFormat);
+				continue;
 			}
-			else {
-				if (!normalConversion)
-					for (int i = 0; i < Length; ++i)
-						constantValue[i] = jjyou::utils::color_cast<unsigned char>(static_cast<float>(material[textureName][i]));
-				else
-					for (int i = 0; i < Length; ++i)
-						constantValue[i] = jjyou::utils::color_cast<unsigned char>(static_cast<float>(material[textureName][i]) / 2.0 + 0.5);
-				if constexpr (Length == 3)
-					constantValue[3] = 255;
+			requestTexture(obj.displacementMap, "displacementMap", STBI_grey);
+			if (obj.materialType == "lambertian") {
+				requestTexture(obj.albedo, "albedo", STBI_rgb_alpha);
 			}
-			texture.create(
-				context,
-				allocator,
-				graphicsCommandPool,
-				transferCommandPool,
-				constantValue.data(),
-				format,
-				VkExtent2D{ .width = 1,.height = 1 }
-			);
 		}
-		else {
-			int texWidth, texHeight, texChannels;
-			std::filesystem::path imagePath = baseDir / static_cast<std::string>(material[textureName]["src"]);
-			stbi_uc* pixels = stbi_load(imagePath.string().c_str(), &texWidth, &texHeight, &texChannels, (Length == 1) ? STBI_grey : STBI_rgb_alpha);
-			if (pixels == nullptr) {
-				return {};
-			}
-			VkExtent2D extent{
-				.width = static_cast<std::uint32_t>(texWidth),
-				.height = static_cast<std::uint32_t>(texHeight)
-			};
-			texture.create(
-				context,
-				allocator,
-				graphicsCommandPool,
-				transferCommandPool,
-				pixels,
-				format,
-				extent
-			);
-			stbi_image_free(pixels);
+		else if (obj.type == "ENVIRONMENT") {
+			if (!obj.radianceSrc.has_value())
+				continue;
+			std::filesystem::path radiancePath = *obj.radianceSrc;
+			std::vector<std::filesystem::path> radiancePaths = radianceImagePaths(baseDir, radiancePath);
+			if (assetCache.findTexture(environmentTextureKey(radiancePaths, environmentFormat)) == nullptr)
+				for (const std::filesystem::path& imagePath : radiancePaths)
+					environmentPool.request(imagePath, STBI_rgb_alpha);
+			std::filesystem::path imagePath = lambertianImagePath(baseDir, radiancePath);
+			if (assetCache.findTexture(environmentTextureKey({ imagePath }, environmentFormat)) == nullptr)
+				environmentPool.request(imagePath, STBI_rgb_alpha);
 		}
 	}
-	return texture;
 }
 
+// References of an object to other objects, resolved once every object is created.
+struct ObjectLinks {
+	std::vector<int> indices{}; // Roots of a scene, or children of a node.
+	std::optional<int> camera{};
+	std::optional<int> mesh{};
+	std::optional<int> environment{};
+	std::optional<int> light{};
+	std::optional<int> material{};
+	std::optional<int> node{};
+	bool hasTangent = false;
+};
+
 s72::Scene72::Ptr Engine::load(
 	const jjyou::io::Json<>& json,
 	const std::filesystem::path& baseDir
+) {
+	if (json[0].string() != "s72-v1")
+		throw std::runtime_error("Scene72 file must start with \"s72-v1\"");
+	int i = 1;
+	return this->loadRecords(
+		[&](s72::ObjectRecord& record) {
+			if (i >= json.size())
+				return false;
+			s72::readObjectRecord(json[i++], record);
+			return true;
+		},
+		baseDir
+	);
+}
+
+s72::Scene72::Ptr Engine::loadStreaming(
+	const std::filesystem::path& scenePath
+) {
+	// Objects are parsed while the previous ones are created, so the parse time is summed up
+	// over the calls to the reader and recorded as one entry.
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	s72::Reader reader(scenePath);
+	std::chrono::nanoseconds parseTime = std::chrono::steady_clock::now() - start;
+	s72::Scene72::Ptr pScene72 = this->loadRecords(
+		[&](s72::ObjectRecord& record) {
+			start = std::chrono::steady_clock::now();
+			bool read = reader.next(record);
+			parseTime += std::chrono::steady_clock::now() - start;
+			return read;
+		},
+		scenePath.parent_path()
+	);
+	if (this->loadProfiler.enabled())
+		this->loadProfiler.record(LoadProfiler::Phase::ParseJson, {}, parseTime, reader.bytesRead());
+	return pScene72;
+}
+
+s72::Scene72::Ptr Engine::loadRecords(
+	const std::function<bool(s72::ObjectRecord&)>& nextRecord,
+	const std::filesystem::path& baseDir
 ) {
 	s72::Scene72::Ptr pScene72(new s72::Scene72);
 	s72::Scene72& scene72 = *pScene72;
 	scene72.minTime = std::numeric_limits<float>::max();
 	scene72.maxTime = -std::numeric_limits<float>::max();
+	scene72.compactVertices = this->compactVertices;
+	// Meshes that are not in the asset cache yet are sub-allocated from a new arena.
+	std::shared_ptr<GeometryArena> geometryArena = std::make_shared<GeometryArena>();
+	geometryArena->create(this->context, this->allocator);
 	// Create a default simple material
 	scene72.defaultMaterial.reset(new s72::SimpleMaterial(std::numeric_limits<std::uint32_t>::max(), "default material"));
-	// Load objects
-	if (json[0].string() != "s72-v1") {
+	// All buffer and texture uploads are recorded into one batch and submitted together.
+	// A preload records into the command pools of its own thread.
+	std::pair<VkCommandPool, VkCommandPool> commandPools = this->loadCommandPools();
+	UploadBatch uploadBatch(
+		this->context,
+		this->allocator,
+		commandPools.first,
+		commandPools.second,
+		&this->queueMutex
+	);
+	AssetCache::PendingGuard pendingAssets(this->assetCache, uploadBatch);
+	// Uploads recorded so far may still be running on the GPU when the load fails.
+	auto destroyScene = [&]() {
+		uploadBatch.discard();
 		this->destroy(scene72);
-		throw std::runtime_error("Scene72 file must start with \"s72-v1\"");
-	}
-	for (int i = 1; i < json.size(); ++i) {
-		const auto& obj = json[i];
-		std::string type(obj["type"]);
-		std::string name(obj["name"]);
+	};
+	// Memory-mapped binary files, shared by all meshes.
+	BlobCache blobCache;
+	// Welding and vertex cache statistics for the load log.
+	MeshStats meshStats;
+	// Texture bound in place of material constants, created with the first non-simple material.
+	AssetCache::Texture placeholder;
+	// References of every object, by graph index.
+	std::vector<ObjectLinks> links;
+	// Materials and environments keep their slot in the graph, but are created after all
+	// other objects, once every image they reference has been decoded.
+	std::vector<std::pair<std::uint32_t, s72::ObjectRecord>> deferredObjects;
+	// Meshes and material textures left to the streamer by a progressive load.
+	std::vector<SceneStreamer::MeshJob> meshJobs;
+	std::vector<SceneStreamer::TextureJob> textureJobs;
+	LoadProfiler::Scope createTimer = this->loadProfiler.scope(LoadProfiler::Phase::CreateObjects);
+	s72::ObjectRecord obj;
+	auto readRecord = [&]() {
+		try {
+			return nextRecord(obj);
+		}
+		catch (const std::exception&) {
+			destroyScene();
+			throw;
+		}
+	};
+	while (readRecord()) {
+		const std::string& type = obj.type;
+		const std::string& name = obj.name;
+		std::uint32_t idx = static_cast<std::uint32_t>(scene72.graph.size() + 1);
+		ObjectLinks& link = links.emplace_back();
+		if (type == "MATERIAL" || type == "ENVIRONMENT") {
+			scene72.graph.push_back(nullptr);
+			deferredObjects.emplace_back(idx, std::move(obj));
+			continue;
+		}
+		LoadProfiler::Scope objectTimer = this->loadProfiler.scope(LoadProfiler::Phase::CreateObjects, type + " \"" + name + "\"");
 		if (type == "SCENE") {
 			if (scene72.scene) {
-				this->destroy(scene72);
+				destroyScene();
 				throw std::runtime_error("Scene must be unique.");
 			}
 			s72::Scene::Ptr scene(new s72::Scene(
-				static_cast<std::uint32_t>(scene72.graph.size() + 1),
+				idx,
 				name,
 				{}
 			));
+			link.indices = std::move(obj.roots);
 			scene72.scene = scene;
 			scene72.graph.push_back(scene);
 		}
 		else if (type == "NODE") {
 			jjyou::glsl::vec3 translation(
-				static_cast<float>(obj["translation"][0]),
-				static_cast<float>(obj["translation"][1]),
-				static_cast<float>(obj["translation"][2])
+				obj.translation[0],
+				obj.translation[1],
+				obj.translation[2]
 			);
 			jjyou::glsl::quat rotation(
-				static_cast<float>(obj["rotation"][0]),
-				static_cast<float>(obj["rotation"][1]),
-				static_cast<float>(obj["rotation"][2]),
-				static_cast<float>(obj["rotation"][3])
+				obj.rotation[0],
+				obj.rotation[1],
+				obj.rotation[2],
+				obj.rotation[3]
 			);
 			jjyou::glsl::vec3 scale(
-				static_cast<float>(obj["scale"][0]),
-				static_cast<float>(obj["scale"][1]),
-				static_cast<float>(obj["scale"][2])
+				obj.scale[0],
+				obj.scale[1],
+				obj.scale[2]
 			);
 			s72::Node::Ptr node(new s72::Node(
-				static_cast<std::uint32_t>(scene72.graph.size() + 1),
+				idx,
 				name,
 				translation,
 				rotation,
@@ -215,80 +591,106 @@ s72::Scene72::Ptr Engine::load(
 				{},
 				{}
 			));
+			link.indices = std::move(obj.children);
+			link.camera = obj.camera;
+			link.mesh = obj.mesh;
+			link.environment = obj.environment;
+			link.light = obj.light;
 			scene72.graph.push_back(node);
 		}
 		else if (type == "MESH") {
-			int count(obj["count"]);
-			std::string fileName(obj["attributes"]["POSITION"]["src"]);
-			int offset(obj["attributes"]["POSITION"]["offset"]);
-			int stride(obj["attributes"]["POSITION"]["stride"]);
-			std::ifstream fin(baseDir / fileName, std::ios::in | std::ios::binary);
-			if (!fin.is_open()) {
-				this->destroy(scene72);
-				throw std::runtime_error("Cannot open binary file \"" + fileName + "\".");
+			int count = obj.count;
+			const std::string& fileName = obj.positionSrc;
+			int offset = obj.positionOffset;
+			int stride = obj.positionStride;
+			// Meshes are cached by the binary file and every option that changes their geometry.
+			std::string key = AssetCache::fileKey(baseDir / fileName);
+			if (!key.empty())
+				key = "mesh|" + key + "|" + std::to_string(offset) + "|" + std::to_string(count) + "|" + std::to_string(stride) + "|" + std::to_string(this->compactVertices);
+			AssetCache::Mesh geometry = this->assetCache.findMesh(key, &uploadBatch);
+			if (geometry == nullptr && this->progressiveLoad) {
+				// The mesh is not drawn until the streamer has welded and uploaded it.
+				s72::Mesh::Ptr mesh(new s72::Mesh(
+					idx,
+					name,
+					VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+					{}
+				));
+				meshJobs.push_back(SceneStreamer::MeshJob{
+					.mesh = mesh,
+					.key = std::move(key),
+					.path = baseDir / fileName,
+					.offset = offset,
+					.count = count,
+					.stride = stride
+				});
+				link.material = obj.material;
+				link.hasTangent = obj.hasTangent;
+				scene72.meshes[name] = mesh;
+				scene72.graph.push_back(mesh);
+				continue;
 			}
-			fin.seekg(offset, std::ios::beg);
-			VkDeviceSize bufferSize = stride * count;
-			VkBuffer vertexBuffer;
-			jjyou::vk::Memory vertexBufferMemory;
-			std::tie(vertexBuffer, vertexBufferMemory) = this->createBuffer(
-				bufferSize,
-				VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-				{ *this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main), *this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Transfer) },
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-			);
-			VkBuffer stagingBuffer;
-			jjyou::vk::Memory stagingBufferMemory;
-			std::tie(stagingBuffer, stagingBufferMemory) = this->createBuffer(
-				bufferSize,
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				{ *this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Transfer) },
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-			);
-			JJYOU_VK_UTILS_CHECK(this->allocator.map(stagingBufferMemory));
-			fin.read(reinterpret_cast<char*>(stagingBufferMemory.mappedAddress()), bufferSize);
-			BBox bbox(
-				count,
-				[&](std::size_t i)->jjyou::glsl::vec3 {
-					const char* bytePtr = reinterpret_cast<const char*>(stagingBufferMemory.mappedAddress());
-					return *reinterpret_cast<const jjyou::glsl::vec3*>(bytePtr + i * stride);
+			if (geometry == nullptr) {
+				LoadProfiler::Scope meshTimer = this->loadProfiler.scope(LoadProfiler::Phase::ReadMeshes, name + " (" + fileName + ")");
+				// Every mesh referencing the same file shares one mapping.
+				const MappedFile* blob = nullptr;
+				try {
+					blob = &blobCache.open(baseDir / fileName);
 				}
-			);
-			JJYOU_VK_UTILS_CHECK(this->allocator.unmap(stagingBufferMemory));
-			this->copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-			this->allocator.free(stagingBufferMemory);
-			vkDestroyBuffer(*this->context.device(), stagingBuffer, nullptr);
+				catch (const std::exception&) {
+					destroyScene();
+					throw std::runtime_error("Cannot open binary file \"" + fileName + "\".");
+				}
+				if (stride < static_cast<int>(PositionVertexFormat::STRIDE)) {
+					destroyScene();
+					throw std::runtime_error("Mesh \"" + name + "\" has a stride smaller than its position.");
+				}
+				VkDeviceSize bufferSize = stride * count;
+				if (offset < 0 || static_cast<std::size_t>(offset) + bufferSize > blob->size()) {
+					destroyScene();
+					throw std::runtime_error("Mesh \"" + name + "\" reads past the end of binary file \"" + fileName + "\".");
+				}
+				// Merge identical vertices so that each one is only shaded once per pass,
+				// then reorder triangles and vertices for the post-transform cache.
+				meshTimer.addBytes(bufferSize);
+				WeldedMesh welded(blob->data() + offset, count, stride);
+				meshStats.add(welded, welded.optimize());
+				if (this->compactVertices && welded.stride == MaterialVertexFormat::STRIDE) {
+					welded.vertices = MaterialVertexFormat::compact(welded.vertices.data(), welded.numVertices);
+					welded.stride = MaterialVertexFormat::COMPACT_STRIDE;
+				}
+				geometry = uploadWeldedMesh(geometryArena, uploadBatch, this->assetCache, key, welded);
+			}
 			s72::Mesh::Ptr mesh(new s72::Mesh(
-				static_cast<std::uint32_t>(scene72.graph.size() + 1),
+				idx,
 				name,
 				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-				count,
-				vertexBuffer,
-				std::move(vertexBufferMemory),
-				{},
-				bbox
+				geometry,
+				{}
 			));
+			link.material = obj.material;
+			link.hasTangent = obj.hasTangent;
 			scene72.meshes[name] = mesh;
 			scene72.graph.push_back(mesh);
 		}
 		else if (type == "CAMERA") {
 			s72::Camera::Ptr camera(new s72::PerspectiveCamera(
-				static_cast<std::uint32_t>(scene72.graph.size() + 1),
+				idx,
 				name,
-				float(obj["perspective"]["vfov"]),
-				float(obj["perspective"]["aspect"]),
-				float(obj["perspective"]["near"]),
-				float(obj["perspective"]["far"])
+				obj.vfov,
+				obj.aspect,
+				obj.zNear,
+				obj.zFar
 			));
 			if (scene72.cameras.find(name) != scene72.cameras.end()) {
-				this->destroy(scene72);
+				destroyScene();
 				throw std::runtime_error("Multiple cameras have the same name \"" + name + "\".");
 			}
 			scene72.cameras[name] = camera;
 			scene72.graph.push_back(camera);
 		}
 		else if (type == "DRIVER") {
-			std::string channelStr = obj["channel"].string();
+			const std::string& channelStr = obj.channel;
 			s72::Driver::Channel channel;
 			if (channelStr == "translation")
 				channel = s72::Driver::Channel::Translation;
@@ -298,9 +700,8 @@ s72::Scene72::Ptr Engine::load(
 				channel = s72::Driver::Channel::Rotation;
 			else
 				throw std::runtime_error("Driver \"" + name + "\" has an unknown channel.");
-			std::vector<float> times(obj["times"]);
-			std::vector<float> values(obj["values"]);
-			times.reserve(obj["times"].size());
+			std::vector<float> times = std::move(obj.times);
+			std::vector<float> values = std::move(obj.values);
 			if (!times.empty()) {
 				scene72.minTime = std::min(scene72.minTime, times.front());
 				scene72.maxTime = std::max(scene72.maxTime, times.back());
@@ -309,12 +710,12 @@ s72::Scene72::Ptr Engine::load(
 				channel == s72::Driver::Channel::Scale && values.size() != times.size() * 3 ||
 				channel == s72::Driver::Channel::Rotation && values.size() != times.size() * 4)
 			{
-				this->destroy(scene72);
+				destroyScene();
 				throw std::runtime_error("Driver \"" + name + "\" values do not match times.");
 			}
 			s72::Driver::Interpolation interpolation = s72::Driver::Interpolation::Linear;
 			s72::Driver::Ptr driver(new s72::Driver(
-				static_cast<std::uint32_t>(scene72.graph.size() + 1),
+				idx,
 				name,
 				{},
 				channel,
@@ -322,292 +723,333 @@ s72::Scene72::Ptr Engine::load(
 				values,
 				interpolation
 			));
+			link.node = obj.node;
 			scene72.drivers.push_back(driver);
 			scene72.graph.push_back(driver);
 		}
-		else if (type == "MATERIAL") {
+		else if (type == "LIGHT") {
+			s72::Light::Ptr light;
+			jjyou::glsl::vec3 tint(obj.tint[0], obj.tint[1], obj.tint[2]);
+			std::uint32_t shadow = obj.shadow;
+			if (obj.lightType == "sun") {
+				// Sun light
+				float angle = obj.angle;
+				float strength = obj.strength;
+				light.reset(new s72::SunLight(
+					idx,
+					name,
+					tint,
+					shadow,
+					angle,
+					strength
+				));
+			}
+			else if (obj.lightType == "sphere") {
+				// Sphere light
+				float radius = obj.radius;
+				float power = obj.power;
+				float limit = obj.limit;
+				light.reset(new s72::SphereLight(
+					idx,
+					name,
+					tint,
+					shadow,
+					radius,
+					power,
+					limit
+				));
+			}
+			else if (obj.lightType == "spot") {
+				// Spot light
+				float radius = obj.radius;
+				float power = obj.power;
+				float fov = obj.fov;
+				float blend = obj.blend;
+				float limit = obj.limit;
+				light.reset(new s72::SpotLight(
+					idx,
+					name,
+					tint,
+					shadow,
+					radius,
+					power,
+					fov,
+					blend,
+					limit
+				));
+			}else {
+				throw std::runtime_error("Light \"" + name + "\" has an unknown lighting type.");
+			}
+			scene72.graph.push_back(light);
+		}
+		else {
+			destroyScene();
+			throw std::runtime_error("Unknown object type \"" + type + "\".");
+		}
+	}
+
+	createTimer.stop();
+
+	// Decode all images of materials and environments in parallel.
+	// Textures are still created in the order they appear in the scene file.
+	// Material textures get full mip chains, blitted on the GPU when the formats support
+	// linear blits, and box-filtered on the decode threads otherwise.
+	bool cpuMipChains = !jjyou::vk::Texture2D::supportsMipmapBlits(this->context, VK_FORMAT_R8_UNORM) ||
+		!jjyou::vk::Texture2D::supportsMipmapBlits(this->context, VK_FORMAT_R8G8B8A8_UNORM);
+	// A progressive load only decodes the environment images here. Material images are decoded
+	// by the streamer while the scene is rendered with placeholders.
+	ImageDecodePool decodePool;
+	ImageDecodePool streamedImages;
+	ImageDecodePool& materialImages = this->progressiveLoad ? streamedImages : decodePool;
+	requestSceneImages(deferredObjects, baseDir, cpuMipChains, this->textureCompression, this->environmentFormat, this->assetCache, materialImages, decodePool);
+	{
+		LoadProfiler::Scope timer = this->loadProfiler.scope(LoadProfiler::Phase::DecodeTextures);
+		decodePool.decode(this->loadThreads, this->loadProfiler.enabled() ? &this->loadProfiler : nullptr);
+	}
+	LoadProfiler::Scope createDeferredTimer = this->loadProfiler.scope(LoadProfiler::Phase::CreateObjects);
+	for (auto& deferredObject : deferredObjects) {
+		std::uint32_t idx = deferredObject.first;
+		s72::ObjectRecord& obj = deferredObject.second;
+		const std::string& type = obj.type;
+		const std::string& name = obj.name;
+		LoadProfiler::Scope objectTimer = this->loadProfiler.scope(LoadProfiler::Phase::CreateObjects, type + " \"" + name + "\"");
+		if (type == "MATERIAL") {
 			s72::Material::Ptr material;
-			if (obj.find("simple") != obj.end()) {
+			if (obj.materialType == "simple") {
 				// Simple material
 				material.reset(new s72::SimpleMaterial(
-					static_cast<std::uint32_t>(scene72.graph.size() + 1),
+					idx,
 					name
 				));
 			}
 			else {
 				// Not simple material. Load normal map and displacement map.
-				// Note: VK_FORMAT_R8G8B8_UNORM is usually not supported. We will use VK_FORMAT_R8G8B8A8_UNORM for 3-dimensional data.
-				jjyou::vk::Texture2D normalMap = loadTexture(
-					baseDir,
-					this->context,
-					this->allocator,
-					this->graphicsCommandPool,
-					this->transferCommandPool,
-					obj,
-					"normalMap",
-					std::array<unsigned char, 3>{{127, 127, 255}},
-					true
-				);
-				if (!normalMap.has_value()) {
-					this->destroy(scene72);
-					throw std::runtime_error("Material \"" + name + "\" failed to create normal map texture.");
-				}
-				jjyou::vk::Texture2D displacementMap = loadTexture(
-					baseDir,
-					this->context,
-					this->allocator,
-					this->graphicsCommandPool,
-					this->transferCommandPool,
-					obj,
-					"displacementMap",
-					std::array<unsigned char, 1>{{0}},
-					false
-				);
-				if (!displacementMap.has_value()) {
-					normalMap.destroy();
-					this->destroy(scene72);
-					throw std::runtime_error("Material \"" + name + "\" failed to create displacement map texture.");
+				// Constants are kept in the material parameters, and all of them share one placeholder texture.
+				if (placeholder == nullptr)
+					placeholder = this->assetCache.placeholder(this->context, this->allocator, uploadBatch);
+				Engine::MaterialParameters parameters{};
+				// Textures whose images are decoded by the streamer, if the load is progressive.
+				std::vector<SceneStreamer::TextureJob> materialJobs;
+				SceneStreamer::TextureJob pending;
+				auto loadMaterialTexture = [&]<int Length>(const s72::TextureRecord& textureRecord, const std::string& textureName, std::uint32_t textureIdx, const std::array<float, Length>& defaultValue, float* constantValue) {
+					pending = SceneStreamer::TextureJob{};
+					AssetCache::Texture texture = loadTexture<Length>(
+						baseDir,
+						this->context,
+						this->allocator,
+						uploadBatch,
+						decodePool,
+						this->assetCache,
+						this->loadProfiler,
+						this->textureCompression,
+						placeholder,
+						textureRecord,
+						textureName,
+						textureIdx,
+						defaultValue,
+						parameters,
+						constantValue,
+						this->progressiveLoad ? &pending : nullptr
+					);
+					if (texture == nullptr) {
+						destroyScene();
+						throw std::runtime_error("Material \"" + name + "\" failed to create " + textureName + " texture.");
+					}
+					if (pending.textureMask != 0)
+						materialJobs.push_back(std::move(pending));
+					return texture;
+				};
+				AssetCache::Texture normalMap = loadMaterialTexture(obj.normalMap, "normalMap", 0, std::array<float, 3>{{0.0f, 0.0f, 1.0f}}, &parameters.normal[0]);
+				// PBR materials pack their displacement into the surface texture instead.
+				AssetCache::Texture displacementMap;
+				if (obj.materialType != "pbr")
+					displacementMap = loadMaterialTexture(obj.displacementMap, "displacementMap", 1, std::array<float, 1>{{0.0f}}, &parameters.displacement);
+				if (obj.materialType == "pbr") {
+					AssetCache::Texture albedo = loadMaterialTexture(obj.albedo, "albedo", 2, std::array<float, 3>{{1.0f, 1.0f, 1.0f}}, &parameters.albedo[0]);
+					pending = SceneStreamer::TextureJob{};
+					AssetCache::Texture surface = loadSurfaceTexture(
+						baseDir,
+						this->context,
+						this->allocator,
+						uploadBatch,
+						decodePool,
+						this->assetCache,
+						this->loadProfiler,
+						this->textureCompression,
+						placeholder,
+						obj,
+						parameters,
+						this->progressiveLoad ? &pending : nullptr
+					);
+					if (pending.textureMask != 0)
+						materialJobs.push_back(std::move(pending));
+					if (surface == nullptr) {
+						destroyScene();
+						throw std::runtime_error("Material \"" + name + "\" failed to create surface texture.");
+					}
+					material.reset(new s72::PbrMaterial(
+						idx,
+						name,
+						std::move(normalMap),
+						std::move(surface),
+						std::move(albedo)
+					));
 				}
-				if (obj.find("mirror") != obj.end()) {
+				else if (obj.materialType == "mirror") {
 					material.reset(new s72::MirrorMaterial(
-						static_cast<std::uint32_t>(scene72.graph.size() + 1),
+						idx,
 						name,
 						std::move(normalMap),
 						std::move(displacementMap)
 					));
 				}
-				else if (obj.find("environment") != obj.end()) {
+				else if (obj.materialType == "environment") {
 					material.reset(new s72::EnvironmentMaterial(
-						static_cast<std::uint32_t>(scene72.graph.size() + 1),
+						idx,
 						name,
 						std::move(normalMap),
 						std::move(displacementMap)
 					));
 				}
-				else if (obj.find("lambertian") != obj.end()) {
-					jjyou::vk::Texture2D albedo = loadTexture(
-						baseDir,
-						this->context,
-						this->allocator,
-						this->graphicsCommandPool,
-						this->transferCommandPool,
-						obj["lambertian"],
-						"albedo",
-						std::array<unsigned char, 3>{{255, 255, 255}},
-						false
-					);
-					if (!albedo.has_value()) {
-						normalMap.destroy();
-						displacementMap.destroy();
-						this->destroy(scene72);
-						throw std::runtime_error("Material \"" + name + "\" failed to create base color texture.");
-					}
+				else if (obj.materialType == "lambertian") {
+					AssetCache::Texture albedo = loadMaterialTexture(obj.albedo, "albedo", 2, std::array<float, 3>{{1.0f, 1.0f, 1.0f}}, &parameters.albedo[0]);
 					material.reset(new s72::LambertianMaterial(
-						static_cast<std::uint32_t>(scene72.graph.size() + 1),
+						idx,
 						name,
 						std::move(normalMap),
 						std::move(displacementMap),
 						std::move(albedo)
 					));
 				}
-				else if (obj.find("pbr") != obj.end()) {
-					jjyou::vk::Texture2D albedo = loadTexture(
-						baseDir,
-						this->context,
-						this->allocator,
-						this->graphicsCommandPool,
-						this->transferCommandPool,
-						obj["pbr"],
-						"albedo",
-						std::array<unsigned char, 3>{{255, 255, 255}},
-						false
-					);
-					if (!albedo.has_value()) {
-						normalMap.destroy();
-						displacementMap.destroy();
-						this->destroy(scene72);
-						throw std::runtime_error("Material \"" + name + "\" failed to create albedo texture.");
-					}
-					jjyou::vk::Texture2D roughness = loadTexture(
-						baseDir,
-						this->context,
-						this->allocator,
-						this->graphicsCommandPool,
-						this->transferCommandPool,
-						obj["pbr"],
-						"roughness",
-						std::array<unsigned char, 1>{{255}},
-						false
-					);
-					if (!roughness.has_value()) {
-						normalMap.destroy();
-						displacementMap.destroy();
-						albedo.destroy();
-						this->destroy(scene72);
-						throw std::runtime_error("Material \"" + name + "\" failed to create roughness texture.");
-					}
-					jjyou::vk::Texture2D metalness = loadTexture(
-						baseDir,
-						this->context,
-						this->allocator,
-						this->graphicsCommandPool,
-						this->transferCommandPool,
-						obj["pbr"],
-						"metalness",
-						std::array<unsigned char, 1>{{0}},
-						false
-					);
-					if (!metalness.has_value()) {
-						normalMap.destroy();
-						displacementMap.destroy();
-						albedo.destroy();
-						roughness.destroy();
-						this->destroy(scene72);
-						throw std::runtime_error("Material \"" + name + "\" failed to create metalness texture.");
-					}
-					material.reset(new s72::PbrMaterial(
-						static_cast<std::uint32_t>(scene72.graph.size() + 1),
-						name,
-						std::move(normalMap),
-						std::move(displacementMap),
-						std::move(albedo),
-						std::move(roughness),
-						std::move(metalness)
-					));
-				}
 				else {
-					normalMap.destroy();
-					displacementMap.destroy();
-					this->destroy(scene72);
+					destroyScene();
 					throw std::runtime_error("Material \"" + name + "\" must have exactly one of these properties: \"simple\", \"mirror\", \"environment\", \"lambertian\", or \"pbr\".");
 				}
+				material->parameters = parameters;
+				for (SceneStreamer::TextureJob& job : materialJobs) {
+					job.material = material;
+					textureJobs.push_back(std::move(job));
+				}
 			}
-			scene72.graph.push_back(material);
+			scene72.graph[idx - 1] = material;
 		}
 		else if (type == "ENVIRONMENT") {
 			if (scene72.environment) {
-				this->destroy(scene72);
+				destroyScene();
 				throw std::runtime_error("Find multiple environments.");
 			}
+			if (!obj.radianceSrc.has_value()) {
+				destroyScene();
+				throw std::runtime_error("Environment \"" + name + "\" must have a \"radiance\" property to specify the path to the radiance texture.");
+			}
+			std::filesystem::path radiancePath = *obj.radianceSrc;
 			// Load radiance map
-			jjyou::vk::Texture2D radiance;
-			{
-				if (obj.find("radiance") == obj.end()) {
-					this->destroy(scene72);
-					throw std::runtime_error("Environment \"" + name + "\" must have a \"radiance\" property to specify the path to the radiance texture.");
+			std::vector<std::filesystem::path> radiancePaths = radianceImagePaths(baseDir, radiancePath);
+			std::string radianceKey = environmentTextureKey(radiancePaths, this->environmentFormat);
+			AssetCache::Texture radiance = this->assetCache.findTexture(radianceKey, &uploadBatch);
+			if (radiance == nullptr) {
+				LoadProfiler::Scope timer = this->loadProfiler.scope(LoadProfiler::Phase::UploadTextures, radiancePaths[0].string());
+				const ImageDecodePool::Image* image = decodePool.find(radiancePaths[0], STBI_rgb_alpha);
+				if (image == nullptr) {
+					destroyScene();
+					throw std::runtime_error("Environment \"" + name + "\" failed to load radiance texture from \"" + radiancePaths[0].string() + "\".");
 				}
-				int texWidth, texHeight, texChannels;
-				std::filesystem::path imagePath = baseDir / static_cast<std::string>(obj["radiance"]["src"]);
-				stbi_uc* pixels = stbi_load(imagePath.string().c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-				if (pixels == nullptr) {
-					this->destroy(scene72);
-					throw std::runtime_error("Environment \"" + name + "\" failed to load radiance texture from \"" + imagePath.string() + "\".");
-				}
-				std::vector<jjyou::glsl::vec4> baseRgb; baseRgb.reserve(texWidth * texHeight);
-				for (int j = 0; j < texWidth * texHeight; ++j)
-					baseRgb.emplace_back(unpackRGBE(reinterpret_cast<jjyou::glsl::vec<unsigned char, 4>*>(pixels)[j]), 1.0f);
-				stbi_image_free(pixels);
+				std::vector<char> baseTexels = convertRGBE(this->environmentFormat, image->pixels.get(), std::size_t(image->width) * image->height, this->loadThreads);
 				VkExtent2D extent{
-					.width = static_cast<std::uint32_t>(texWidth),
-					.height = static_cast<std::uint32_t>(texHeight) / 6
+					.width = static_cast<std::uint32_t>(image->width),
+					.height = static_cast<std::uint32_t>(image->height) / 6
 				};
-				std::vector<std::vector<jjyou::glsl::vec4>> mipRgb; mipRgb.reserve(20);
-				std::vector<void*> mipData; mipData.reserve(20);
-				for (int j = 1; ; ++j) {
-					imagePath = static_cast<std::string>(obj["radiance"]["src"]);
-					imagePath.replace_filename(imagePath.stem().string() + ".prefilteredenv." + std::to_string(j) + imagePath.extension().string());
-					imagePath = baseDir / imagePath;
-					if (!std::filesystem::exists(imagePath))
-						break;
-					pixels = stbi_load(imagePath.string().c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-					if (pixels == nullptr) {
-						this->destroy(scene72);
-						throw std::runtime_error("Environment \"" + name + "\" failed to load pre-filtered environment texture from \"" + imagePath.string() + "\".");
+				std::vector<std::vector<char>> mipTexels; mipTexels.reserve(radiancePaths.size());
+				std::vector<void*> mipData; mipData.reserve(radiancePaths.size());
+				for (std::size_t j = 1; j < radiancePaths.size(); ++j) {
+					image = decodePool.find(radiancePaths[j], STBI_rgb_alpha);
+					if (image == nullptr) {
+						destroyScene();
+						throw std::runtime_error("Environment \"" + name + "\" failed to load pre-filtered environment texture from \"" + radiancePaths[j].string() + "\".");
 					}
-					mipRgb.emplace_back();
-					std::vector<jjyou::glsl::vec4>& rgb = mipRgb.back(); rgb.reserve(texWidth * texHeight);
-					for (int k = 0; k < texWidth * texHeight; ++k)
-						rgb.emplace_back(unpackRGBE(reinterpret_cast<jjyou::glsl::vec<unsigned char, 4>*>(pixels)[k]), 1.0f);
-					stbi_image_free(pixels);
-					mipData.push_back(rgb.data());
+					mipTexels.push_back(convertRGBE(this->environmentFormat, image->pixels.get(), std::size_t(image->width) * image->height, this->loadThreads));
+					mipData.push_back(mipTexels.back().data());
+					timer.addBytes(mipTexels.back().size());
 				}
+				timer.addBytes(baseTexels.size());
 				if (mipData.size() == 0) {
-					this->destroy(scene72);
+					destroyScene();
 					throw std::runtime_error("Environment \"" + name + "\" failed to load any pre-filtered environment texture.");
 				}
-				radiance.create(
+				jjyou::vk::Texture2D texture;
+				texture.create(
 					this->context,
 					this->allocator,
-					this->graphicsCommandPool,
-					this->transferCommandPool,
-					baseRgb.data(),
-					VK_FORMAT_R32G32B32A32_SFLOAT,
+					uploadBatch,
+					baseTexels.data(),
+					hdrVkFormat(this->environmentFormat),
 					extent,
 					static_cast<int>(mipData.size() + 1),
 					mipData,
 					true
 				);
+				radiance = this->assetCache.insertTexture(radianceKey, std::move(texture), uploadBatch);
 			}
 			// Load lambertian map
-			jjyou::vk::Texture2D lambertian;
-			{
-				int texWidth, texHeight, texChannels;
-				std::filesystem::path imagePath = static_cast<std::string>(obj["radiance"]["src"]);
-				imagePath.replace_filename(imagePath.stem().string() + ".lambertian" + imagePath.extension().string());
-				imagePath = baseDir / imagePath;
-				stbi_uc* pixels = stbi_load(imagePath.string().c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-				if (pixels == nullptr) {
-					radiance.destroy();
-					this->destroy(scene72);
-					throw std::runtime_error("Environment \"" + name + "\" failed to load lambertian texture from \"" + imagePath.string() + "\".");
+			std::filesystem::path lambertianPath = lambertianImagePath(baseDir, radiancePath);
+			std::string lambertianKey = environmentTextureKey({ lambertianPath }, this->environmentFormat);
+			AssetCache::Texture lambertian = this->assetCache.findTexture(lambertianKey, &uploadBatch);
+			if (lambertian == nullptr) {
+				LoadProfiler::Scope timer = this->loadProfiler.scope(LoadProfiler::Phase::UploadTextures, lambertianPath.string());
+				const ImageDecodePool::Image* image = decodePool.find(lambertianPath, STBI_rgb_alpha);
+				if (image == nullptr) {
+					destroyScene();
+					throw std::runtime_error("Environment \"" + name + "\" failed to load lambertian texture from \"" + lambertianPath.string() + "\".");
 				}
-				std::vector<jjyou::glsl::vec4>rgb; rgb.reserve(texWidth * texHeight);
-				for (int j = 0; j < texWidth * texHeight; ++j)
-					rgb.emplace_back(unpackRGBE(reinterpret_cast<jjyou::glsl::vec<unsigned char, 4>*>(pixels)[j]), 1.0f);
+				std::vector<char> texels = convertRGBE(this->environmentFormat, image->pixels.get(), std::size_t(image->width) * image->height, this->loadThreads);
+				timer.addBytes(texels.size());
 				VkExtent2D extent{
-					.width = static_cast<std::uint32_t>(texWidth),
-					.height = static_cast<std::uint32_t>(texHeight) / 6
+					.width = static_cast<std::uint32_t>(image->width),
+					.height = static_cast<std::uint32_t>(image->height) / 6
 				};
-				lambertian.create(
+				jjyou::vk::Texture2D texture;
+				texture.create(
 					this->context,
 					this->allocator,
-					this->graphicsCommandPool,
-					this->transferCommandPool,
-					rgb.data(),
-					VK_FORMAT_R32G32B32A32_SFLOAT,
+					uploadBatch,
+					texels.data(),
+					hdrVkFormat(this->environmentFormat),
 					extent,
 					1,
 					{},
 					true
 				);
-				stbi_image_free(pixels);
+				lambertian = this->assetCache.insertTexture(lambertianKey, std::move(texture), uploadBatch);
 			}
 			// Load environment BRDF map
-			jjyou::vk::Texture2D environmentBRDF;
-			{
+			std::filesystem::path environmentBRDFPath = radiancePath;
+			environmentBRDFPath.replace_filename("envbrdf.bin");
+			environmentBRDFPath = baseDir / environmentBRDFPath;
+			std::string environmentBRDFKey = AssetCache::fileKey(environmentBRDFPath);
+			if (!environmentBRDFKey.empty())
+				environmentBRDFKey = "brdf|" + environmentBRDFKey;
+			AssetCache::Texture environmentBRDF = this->assetCache.findTexture(environmentBRDFKey, &uploadBatch);
+			if (environmentBRDF == nullptr) {
+				LoadProfiler::Scope timer = this->loadProfiler.scope(LoadProfiler::Phase::UploadTextures, environmentBRDFPath.string());
 				std::uint32_t height;
-				std::filesystem::path imagePath = static_cast<std::string>(obj["radiance"]["src"]);
-				imagePath.replace_filename("envbrdf.bin");
-				imagePath = baseDir / imagePath;
-				std::ifstream fin(imagePath, std::ios::in | std::ios::binary);
+				std::ifstream fin(environmentBRDFPath, std::ios::in | std::ios::binary);
 				if (!fin.is_open()) {
-					radiance.destroy();
-					lambertian.destroy();
-					this->destroy(scene72);
-					throw std::runtime_error("Environment \"" + name + "\" failed to load environment BRDF lookup table from \"" + imagePath.string() + "\".");
+					destroyScene();
+					throw std::runtime_error("Environment \"" + name + "\" failed to load environment BRDF lookup table from \"" + environmentBRDFPath.string() + "\".");
 				}
 				fin.read(reinterpret_cast<char*>(&height), sizeof(height));
 				std::vector<float> data(height * height * 2);
 				fin.read(reinterpret_cast<char*>(data.data()), height * height * sizeof(float) * 2);
+				timer.addBytes(data.size() * sizeof(float));
 				VkExtent2D extent{
 					.width = height,
 					.height = height
 				};
-				environmentBRDF.create(
+				jjyou::vk::Texture2D texture;
+				texture.create(
 					this->context,
 					this->allocator,
-					this->graphicsCommandPool,
-					this->transferCommandPool,
+					uploadBatch,
 					data.data(),
 					VK_FORMAT_R32G32_SFLOAT,
 					extent,
@@ -616,122 +1058,68 @@ s72::Scene72::Ptr Engine::load(
 					false,
 					VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE
 				);
+				environmentBRDF = this->assetCache.insertTexture(environmentBRDFKey, std::move(texture), uploadBatch);
 			}
 			s72::Environment::Ptr environment(new s72::Environment(
-				static_cast<std::uint32_t>(scene72.graph.size() + 1),
+				idx,
 				name,
-				std::move(radiance),
-				std::move(lambertian),
-				std::move(environmentBRDF)
+				radiance,
+				lambertian,
+				environmentBRDF
 			));
 			scene72.environment = environment;
-			scene72.graph.push_back(environment);
-		}
-		else if (type == "LIGHT") {
-			s72::Light::Ptr light;
-			jjyou::glsl::vec3 tint{ 1.0f };
-			if (obj.find("tint") != obj.end()) {
-				tint[0] = static_cast<float>(obj["tint"][0]);
-				tint[1] = static_cast<float>(obj["tint"][1]);
-				tint[2] = static_cast<float>(obj["tint"][2]);
-			}
-			std::uint32_t shadow = 0U;
-			if (obj.find("shadow") != obj.end())
-				shadow = static_cast<std::uint32_t>(static_cast<int>(obj["shadow"]));
-			if (obj.find("sun") != obj.end()) {
-				// Sun light
-				float angle(obj["sun"]["angle"]);
-				float strength(obj["sun"]["strength"]);
-				light.reset(new s72::SunLight(
-					static_cast<std::uint32_t>(scene72.graph.size() + 1),
-					name,
-					tint,
-					shadow,
-					angle,
-					strength
-				));
-			}
-			else if (obj.find("sphere") != obj.end()) {
-				// Sphere light
-				float radius(obj["sphere"]["radius"]);
-				float power(obj["sphere"]["power"]);
-				float limit(obj["sphere"]["limit"]);
-				light.reset(new s72::SphereLight(
-					static_cast<std::uint32_t>(scene72.graph.size() + 1),
-					name,
-					tint,
-					shadow,
-					radius,
-					power,
-					limit
-				));
-			}
-			else if (obj.find("spot") != obj.end()) {
-				// Spot light
-				float radius(obj["spot"]["radius"]);
-				float power(obj["spot"]["power"]);
-				float fov(obj["spot"]["fov"]);
-				float blend(obj["spot"]["blend"]);
-				float limit(obj["spot"]["limit"]);
-				light.reset(new s72::SpotLight(
-					static_cast<std::uint32_t>(scene72.graph.size() + 1),
-					name,
-					tint,
-					shadow,
-					radius,
-					power,
-					fov,
-					blend,
-					limit
-				));
-			}else {
-				throw std::runtime_error("Light \"" + name + "\" has an unknown lighting type.");
-			}
-			scene72.graph.push_back(light);
-		}
-		else {
-			this->destroy(scene72);
-			throw std::runtime_error("Unknown object type \"" + type + "\".");
+			scene72.graph[idx - 1] = environment;
 		}
 	}
+	deferredObjects.clear();
+	createDeferredTimer.stop();
+
+	// Wait for all uploads.
+	{
+		LoadProfiler::Scope timer = this->loadProfiler.scope(LoadProfiler::Phase::WaitUploads);
+		uploadBatch.finish();
+	}
+	this->assetCache.commit(uploadBatch);
+	blobCache.clear();
+	meshStats.print(std::cout);
+	// Assets of earlier scenes that this scene does not share are not needed anymore.
+	this->assetCache.trim();
 
 	// Set objects reference
-	for (int i = 1; i < json.size(); ++i) {
-		const auto& obj = json[i];
-		std::string type = obj["type"].string();
-		s72::Object::Ptr object = scene72.graph[i - 1];
+	for (std::size_t i = 0; i < links.size(); ++i) {
+		const ObjectLinks& link = links[i];
+		s72::Object::Ptr object = scene72.graph[i];
+		const std::string& type = object->type;
 		if (type == "SCENE") {
 			s72::Scene::Ptr scene = std::reinterpret_pointer_cast<s72::Scene>(object);
-			for (const auto& rootIdx : obj["roots"]) {
-				if (static_cast<int>(rootIdx) <= 0 || static_cast<int>(rootIdx) > scene72.graph.size() || scene72.graph[static_cast<int>(rootIdx) - 1]->type != "NODE") {
+			for (int rootIdx : link.indices) {
+				if (rootIdx <= 0 || rootIdx > scene72.graph.size() || scene72.graph[rootIdx - 1]->type != "NODE") {
 					this->destroy(scene72);
-					throw std::runtime_error("Scene\'s roots reference " + std::to_string(static_cast<int>(rootIdx)) + " whose type is not node.");
+					throw std::runtime_error("Scene\'s roots reference " + std::to_string(rootIdx) + " whose type is not node.");
 				}
-				scene->roots.push_back(std::reinterpret_pointer_cast<s72::Node>(scene72.graph[static_cast<int>(rootIdx) - 1]));
+				scene->roots.push_back(std::reinterpret_pointer_cast<s72::Node>(scene72.graph[rootIdx - 1]));
 			}
 		}
 		else if (type == "NODE") {
 			s72::Node::Ptr node = std::reinterpret_pointer_cast<s72::Node>(object);
-			if (obj.find("camera") != obj.end()) {
-				int cameraIdx(obj["camera"]);
+			if (link.camera.has_value()) {
+				int cameraIdx = *link.camera;
 				if (cameraIdx <= 0 || cameraIdx > scene72.graph.size() || scene72.graph[cameraIdx - 1]->type != "CAMERA") {
 					this->destroy(scene72);
 					throw std::runtime_error("Node" + std::to_string(node->idx) + "\'s camera references " + std::to_string(cameraIdx) + " whose type is not camera.");
 				}
 				node->camera = std::reinterpret_pointer_cast<s72::Camera>(scene72.graph[cameraIdx - 1]);
 			}
-			if (obj.find("mesh") != obj.end()) {
-				int meshIdx(obj["mesh"]);
+			if (link.mesh.has_value()) {
+				int meshIdx = *link.mesh;
 				if (meshIdx <= 0 || meshIdx > scene72.graph.size() || scene72.graph[meshIdx - 1]->type != "MESH") {
 					this->destroy(scene72);
 					throw std::runtime_error("Node" + std::to_string(node->idx) + "\'s mesh references " + std::to_string(meshIdx) + " whose type is not mesh.");
 				}
 				node->mesh = std::reinterpret_pointer_cast<s72::Mesh>(scene72.graph[meshIdx - 1]);
 			}
-			if (obj.find("children") != obj.end()) {
-				const auto& children = obj["children"];
-				for (const auto& childId : children) {
-					int childIdx(childId);
+			if (!link.indices.empty()) {
+				for (int childIdx : link.indices) {
 					if (childIdx <= 0 || childIdx > scene72.graph.size() || scene72.graph[childIdx - 1]->type != "NODE") {
 						this->destroy(scene72);
 						throw std::runtime_error("Node" + std::to_string(node->idx) + "\'s children reference " + std::to_string(childIdx) + " whose type is not node.");
@@ -739,16 +1127,16 @@ s72::Scene72::Ptr Engine::load(
 					node->children.push_back(std::reinterpret_pointer_cast<s72::Node>(scene72.graph[childIdx - 1]));
 				}
 			}
-			if (obj.find("environment") != obj.end()) {
-				int environmentIdx(obj["environment"]);
+			if (link.environment.has_value()) {
+				int environmentIdx = *link.environment;
 				if (environmentIdx <= 0 || environmentIdx > scene72.graph.size() || scene72.graph[environmentIdx - 1]->type != "ENVIRONMENT") {
 					this->destroy(scene72);
 					throw std::runtime_error("Node" + std::to_string(node->idx) + "\'s environment reference " + std::to_string(environmentIdx) + " whose type is not environment.");
 				}
 				node->environment = std::reinterpret_pointer_cast<s72::Environment>(scene72.graph[environmentIdx - 1]);
 			}
-			if (obj.find("light") != obj.end()) {
-				int lightIdx(obj["light"]);
+			if (link.light.has_value()) {
+				int lightIdx = *link.light;
 				if (lightIdx <= 0 || lightIdx > scene72.graph.size() || scene72.graph[lightIdx - 1]->type != "LIGHT") {
 					this->destroy(scene72);
 					throw std::runtime_error("Node" + std::to_string(node->idx) + "\'s light reference " + std::to_string(lightIdx) + " whose type is not light.");
@@ -758,8 +1146,8 @@ s72::Scene72::Ptr Engine::load(
 		}
 		else if (type == "MESH") {
 			s72::Mesh::Ptr mesh = std::reinterpret_pointer_cast<s72::Mesh>(object);
-			if (obj.find("material") != obj.end()) {
-				int materialIdx(obj["material"]);
+			if (link.material.has_value()) {
+				int materialIdx = *link.material;
 				if (materialIdx <= 0 || materialIdx > scene72.graph.size() || scene72.graph[materialIdx - 1]->type != "MATERIAL") {
 					this->destroy(scene72);
 					throw std::runtime_error("Mesh" + std::to_string(mesh->idx) + "\'s material reference " + std::to_string(materialIdx) + " whose type is not material.");
@@ -769,11 +1157,11 @@ s72::Scene72::Ptr Engine::load(
 			else {
 				mesh->material = scene72.defaultMaterial;
 			}
-			if (mesh->material.lock()->materialType == "simple" && obj["attributes"].find("TANGENT") != obj["attributes"].end()) {
+			if (mesh->material.lock()->materialType == "simple" && link.hasTangent) {
 				this->destroy(scene72);
 				throw std::runtime_error("Mesh" + std::to_string(mesh->idx) + "\'s material is a simple material, but it has TANGENT/TEXCOORD attributes.");
 			}
-			else if (mesh->material.lock()->materialType != "simple" && obj["attributes"].find("TANGENT") == obj["attributes"].end()) {
+			else if (mesh->material.lock()->materialType != "simple" && !link.hasTangent) {
 				this->destroy(scene72);
 				throw std::runtime_error("Mesh" + std::to_string(mesh->idx) + "\'s material is not a simple material, but it does not have TANGENT/TEXCOORD attributes.");
 			}
@@ -782,7 +1170,7 @@ s72::Scene72::Ptr Engine::load(
 		}
 		else if (type == "DRIVER") {
 			s72::Driver::Ptr driver = std::reinterpret_pointer_cast<s72::Driver>(object);
-			int nodeIdx(obj["node"]);
+			int nodeIdx = link.node.value_or(0);
 			if (nodeIdx <= 0 || nodeIdx > scene72.graph.size() || scene72.graph[nodeIdx - 1]->type != "NODE") {
 				this->destroy(scene72);
 				throw std::runtime_error("Driver" + std::to_string(driver->idx) + "\'s node references " + std::to_string(nodeIdx) + " whose type is not node.");
@@ -800,6 +1188,128 @@ s72::Scene72::Ptr Engine::load(
 	}
 
 
+	// Create shadow maps and descriptor sets
+	this->createSceneResources(scene72);
+	if (!meshJobs.empty() || !textureJobs.empty()) {
+		scene72.streamer = std::make_shared<SceneStreamer>(
+			std::move(meshJobs),
+			std::move(textureJobs),
+			std::move(streamedImages),
+			this->compactVertices,
+			this->loadThreads
+		);
+		// Streaming uploads are recorded by the render loop, even if the scene is preloaded.
+		scene72.streamer->uploadBatch = std::make_unique<UploadBatch>(
+			this->context,
+			this->allocator,
+			this->graphicsCommandPool,
+			this->transferCommandPool,
+			&this->queueMutex
+		);
+		scene72.streamer->geometryArena = geometryArena;
+	}
+	return pScene72;
+}
+
+void Engine::updateStreaming(s72::Scene72& scene72) {
+	// Bytes of geometry and image data uploaded per frame, so that streaming does not stall the render loop.
+	constexpr std::size_t FRAME_UPLOAD_BUDGET = std::size_t(16) << 20;
+	SceneStreamer& streamer = *scene72.streamer;
+	// One batch is in flight at a time. Its assets are swapped in once it has completed.
+	if (!streamer.uploadBatch->poll())
+		return;
+	this->assetCache.commit(*streamer.uploadBatch);
+	if (!streamer.meshSwaps.empty() || !streamer.textureSwaps.empty()) {
+		// Frames still in flight read the descriptor sets and parameters rewritten below.
+		std::array<VkFence, Engine::MAX_FRAMES_IN_FLIGHT> fences;
+		for (std::uint32_t i = 0; i < Engine::MAX_FRAMES_IN_FLIGHT; ++i)
+			fences[i] = this->frameData[i].inFlightFence;
+		vkWaitForFences(*this->context.device(), static_cast<std::uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+		for (auto& meshSwap : streamer.meshSwaps)
+			meshSwap.first->setGeometry(meshSwap.second);
+		std::set<s72::Material*> materials;
+		for (auto& textureSwap : streamer.textureSwaps) {
+			s72::Material& material = *textureSwap.first.material;
+			material.setTexture(textureSwap.first.slot, std::move(textureSwap.second));
+			material.parameters.textureMask |= textureSwap.first.textureMask;
+			materials.insert(&material);
+		}
+		for (s72::Material* material : materials)
+			this->writeMaterialDescriptorSets(scene72, *material);
+		streamer.meshSwaps.clear();
+		streamer.textureSwaps.clear();
+	}
+	for (const std::string& error : streamer.takeErrors())
+		std::cerr << error << std::endl;
+	if (streamer.finished()) {
+		streamer.meshStats().print(std::cout);
+		scene72.streamer.reset();
+		this->assetCache.trim();
+		return;
+	}
+	std::size_t numBytes = 0;
+	for (SceneStreamer::WeldedMeshJob& job : streamer.takeWeldedMeshes(FRAME_UPLOAD_BUDGET)) {
+		// Another mesh of the scene may have uploaded the same geometry already.
+		AssetCache::Mesh geometry = this->assetCache.findMesh(job.key, streamer.uploadBatch.get());
+		if (geometry == nullptr) {
+			geometry = uploadWeldedMesh(streamer.geometryArena, *streamer.uploadBatch, this->assetCache, job.key, job.welded);
+			numBytes += job.welded.vertices.size() + job.welded.indices.size();
+		}
+		streamer.meshSwaps.emplace_back(std::move(job.mesh), std::move(geometry));
+	}
+	if (streamer.imagesDecoded()) {
+		std::deque<SceneStreamer::TextureJob>& textures = streamer.textures();
+		while (!textures.empty() && numBytes < FRAME_UPLOAD_BUDGET) {
+			SceneStreamer::TextureJob job = std::move(textures.front());
+			textures.pop_front();
+			AssetCache::Texture texture = this->assetCache.findTexture(job.key, streamer.uploadBatch.get());
+			if (texture == nullptr) {
+				const ImageDecodePool::Image* image = job.packed ?
+					streamer.decodePool().findPacked(job.paths, job.blockFormat) :
+					streamer.decodePool().find(job.paths[0], job.channels, job.blockFormat);
+				std::string assetName;
+				for (const std::filesystem::path& imagePath : job.paths)
+					if (!imagePath.empty())
+						assetName += (assetName.empty() ? "" : " + ") + imagePath.string();
+				if (image == nullptr) {
+					// The material keeps the placeholder and its default values.
+					std::cerr << "Material \"" << job.material->name << "\" failed to load texture from \"" << assetName << "\"." << std::endl;
+					continue;
+				}
+				texture = createImageTexture(this->context, this->allocator, *streamer.uploadBatch, this->assetCache, this->loadProfiler, assetName, job.key, *image, job.format);
+				numBytes += (image->blockFormat != BlockFormat::NONE) ? image->blocks.size() : std::size_t(image->width) * image->height * image->channels;
+			}
+			streamer.textureSwaps.emplace_back(std::move(job), std::move(texture));
+		}
+	}
+	if (!streamer.meshSwaps.empty() || !streamer.textureSwaps.empty())
+		streamer.uploadBatch->submit();
+}
+
+void Engine::bakeAnimation(s72::Scene72& scene72, const std::filesystem::path& scenePath, float rate, bool quantize) {
+	s72::AnimationCache& cache = scene72.sceneGraph.bakedAnimation;
+	std::uint64_t sceneHash = s72::AnimationCache::hashFile(scenePath);
+	std::filesystem::path cachePath = scenePath;
+	cachePath += ".animcache";
+	if (cache.load(cachePath, sceneHash, rate, quantize, scene72.sceneGraph)) {
+		std::cout << "Loaded baked animation from \"" << cachePath.string() << "\" (" << cache.numFrames() << " frames, " << cache.sampleBytes() << " bytes)." << std::endl;
+		return;
+	}
+	cache.bake(scene72, rate, quantize, *this->jobSystem);
+	if (cache.empty())
+		return;
+	std::cout << "Baked animation (" << cache.numFrames() << " frames, " << cache.sampleBytes() << " bytes)." << std::endl;
+	try {
+		cache.save(cachePath, sceneHash);
+	}
+	catch (const std::exception& e) {
+		// The baked samples are still used for this run.
+		std::cerr << e.what() << std::endl;
+	}
+}
+
+void Engine::createSceneResources(s72::Scene72& scene72) {
+	scene72.sceneGraph.build(scene72);
 	// Get some values for creating descriptor sets
 	std::uint32_t numMirrorMaterials = 0;
 	std::uint32_t numEnvironmentMaterials = 0;
@@ -822,6 +1332,8 @@ s72::Scene72::Ptr Engine::load(
 		this->destroy(scene72);
 		throw std::runtime_error("The scene has non simple materials, but does not have an environment object.");
 	}
+	// Shadow maps are D32 images with one layer per cascade or cube face.
+	LoadProfiler::Scope shadowTimer = this->loadProfiler.scope(LoadProfiler::Phase::CreateShadowMaps);
 	std::uint32_t numInstances = 0;
 	std::uint32_t numSunLights = 0;
 	std::uint32_t numSunLightsNoShadow = 0;
@@ -857,6 +1369,7 @@ s72::Scene72::Ptr Engine::load(
 							Engine::NUM_CASCADE_LEVELS,
 							this->shadowMappingRenderPass
 						));
+						shadowTimer.addBytes(std::uint64_t(sunLight->shadow) * sunLight->shadow * 4 * Engine::NUM_CASCADE_LEVELS);
 						++numSunLights;
 					}
 				}
@@ -879,6 +1392,7 @@ s72::Scene72::Ptr Engine::load(
 							6,
 							this->shadowMappingRenderPass
 						));
+						shadowTimer.addBytes(std::uint64_t(sphereLight->shadow) * sphereLight->shadow * 4 * 6);
 						++numSphereLights;
 					}
 				}
@@ -901,6 +1415,7 @@ s72::Scene72::Ptr Engine::load(
 							1,
 							this->shadowMappingRenderPass
 						));
+						shadowTimer.addBytes(std::uint64_t(spotLight->shadow) * spotLight->shadow * 4);
 						++numSpotLights;
 					}
 				}
@@ -918,11 +1433,14 @@ s72::Scene72::Ptr Engine::load(
 			1,
 			this->shadowMappingRenderPass
 		));
-		scene72.spotLightShadowMaps.back().transferImageLayout(
-			this->graphicsCommandPool,
-			**this->context.queue(jjyou::vk::Context::QueueType::Main),
-			*this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main)
-		);
+		{
+			std::lock_guard<std::mutex> queueLock(this->queueMutex);
+			scene72.spotLightShadowMaps.back().transferImageLayout(
+				this->loadCommandPools().first,
+				**this->context.queue(jjyou::vk::Context::QueueType::Main),
+				*this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main)
+			);
+		}
 	}
 	if (numSphereLights == 0) {
 		scene72.sphereLightShadowMaps.push_back(ShadowMap(
@@ -934,11 +1452,14 @@ s72::Scene72::Ptr Engine::load(
 			6,
 			this->shadowMappingRenderPass
 		));
-		scene72.sphereLightShadowMaps.back().transferImageLayout(
-			this->graphicsCommandPool,
-			**this->context.queue(jjyou::vk::Context::QueueType::Main),
-			*this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main)
-		);
+		{
+			std::lock_guard<std::mutex> queueLock(this->queueMutex);
+			scene72.sphereLightShadowMaps.back().transferImageLayout(
+				this->loadCommandPools().first,
+				**this->context.queue(jjyou::vk::Context::QueueType::Main),
+				*this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main)
+			);
+		}
 	}
 	if (numSunLights == 0) {
 		scene72.sunLightShadowMaps.push_back(ShadowMap(
@@ -950,11 +1471,14 @@ s72::Scene72::Ptr Engine::load(
 			Engine::NUM_CASCADE_LEVELS,
 			this->shadowMappingRenderPass
 		));
-		scene72.sunLightShadowMaps.back().transferImageLayout(
-			this->graphicsCommandPool,
-			**this->context.queue(jjyou::vk::Context::QueueType::Main),
-			*this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main)
-		);
+		{
+			std::lock_guard<std::mutex> queueLock(this->queueMutex);
+			scene72.sunLightShadowMaps.back().transferImageLayout(
+				this->loadCommandPools().first,
+				**this->context.queue(jjyou::vk::Context::QueueType::Main),
+				*this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main)
+			);
+		}
 	}
 	// Create shadow map sampler
 	{
@@ -978,7 +1502,10 @@ s72::Scene72::Ptr Engine::load(
 		);
 		scene72.shadowMapSampler = this->context.device().createSampler(samplerCreateInfo);
 	}
+	shadowTimer.stop();
 	
+	// Everything from here on allocates and writes descriptor sets, and the buffers they refer to.
+	LoadProfiler::Scope descriptorTimer = this->loadProfiler.scope(LoadProfiler::Phase::CreateDescriptors);
 	// Create view level descriptor sets
 	{
 		std::vector<VkDescriptorSetLayout> layouts(Engine::MAX_FRAMES_IN_FLIGHT, this->viewLevelUniformDescriptorSetLayout);
@@ -1437,18 +1964,18 @@ s72::Scene72::Ptr Engine::load(
 				.range = sizeof(Engine::SkyboxUniform)
 			};
 			VkDescriptorImageInfo radianceImageInfo{
-				.sampler = scene72.environment->radiance.sampler(),
-				.imageView = scene72.environment->radiance.imageView(),
+				.sampler = scene72.environment->radiance->sampler(),
+				.imageView = scene72.environment->radiance->imageView(),
 				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 			};
 			VkDescriptorImageInfo lambertianImageInfo{
-				.sampler = scene72.environment->lambertian.sampler(),
-				.imageView = scene72.environment->lambertian.imageView(),
+				.sampler = scene72.environment->lambertian->sampler(),
+				.imageView = scene72.environment->lambertian->imageView(),
 				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 			};
 			VkDescriptorImageInfo environmentBRDFImageInfo{
-				.sampler = scene72.environment->environmentBRDF.sampler(),
-				.imageView = scene72.environment->environmentBRDF.imageView(),
+				.sampler = scene72.environment->environmentBRDF->sampler(),
+				.imageView = scene72.environment->environmentBRDF->imageView(),
 				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 			};
 			std::vector<VkWriteDescriptorSet> descriptorWrites = {
@@ -1506,6 +2033,24 @@ s72::Scene72::Ptr Engine::load(
 	}
 	// Create material level descriptor sets
 	{
+		// The parameters of all materials share one uniform buffer, one aligned entry each.
+		VkDeviceSize parametersStride = sizeof(Engine::MaterialParameters);
+		VkDeviceSize minAlignment = this->context.physicalDevice().getProperties().limits.minUniformBufferOffsetAlignment;
+		if (minAlignment > 0)
+			parametersStride = (parametersStride + minAlignment - 1) & ~(minAlignment - 1);
+		std::uint32_t numMaterials = numMirrorMaterials + numEnvironmentMaterials + numLambertianMaterials + numPbrMaterials;
+		if (numMaterials > 0) {
+			std::tie(scene72.materialParametersBuffer, scene72.materialParametersBufferMemory) =
+				this->createBuffer(
+					numMaterials * parametersStride,
+					VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+					{ *this->context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main) },
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+				);
+			this->allocator.map(scene72.materialParametersBufferMemory);
+			descriptorTimer.addBytes(numMaterials * parametersStride);
+		}
+		VkDeviceSize parametersOffset = 0;
 		for (const auto& object : scene72.graph) {
 			if (object->type == "MATERIAL") {
 				s72::Material::Ptr material = std::reinterpret_pointer_cast<s72::Material>(object);
@@ -1537,61 +2082,97 @@ s72::Scene72::Ptr Engine::load(
 				for (size_t i = 0; i < Engine::MAX_FRAMES_IN_FLIGHT; i++) {
 					scene72.frameDescriptorSets[i].materialLevelUniformDescriptorSets[material->idx] = materialLevelUniformDescriptorSets[i];
 				}
-				for (size_t i = 0; i < Engine::MAX_FRAMES_IN_FLIGHT; i++) {
-					std::vector<VkWriteDescriptorSet> descriptorWrites;
-					std::vector<VkDescriptorImageInfo> imageInfos;
-					descriptorWrites.reserve(material->numTextures());
-					imageInfos.reserve(material->numTextures());
-					for (std::uint32_t j = 0; j < material->numTextures(); ++j) {
-						VkDescriptorImageInfo imageInfo{
-							.sampler = material->texture(j).sampler(),
-							.imageView = material->texture(j).imageView(),
-							.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-						};
-						imageInfos.push_back(imageInfo);
-						VkWriteDescriptorSet descriptorWrite{
-							.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-							.pNext = nullptr,
-							.dstSet = scene72.frameDescriptorSets[i].materialLevelUniformDescriptorSets[material->idx],
-							.dstBinding = j,
-							.dstArrayElement = 0,
-							.descriptorCount = 1,
-							.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-							.pImageInfo = &imageInfos.back(),
-							.pBufferInfo = nullptr,
-							.pTexelBufferView = nullptr
-						};
-						descriptorWrites.push_back(descriptorWrite);
-					}
-					vkUpdateDescriptorSets(*this->context.device(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-				}
+				material->parametersOffset = parametersOffset;
+				parametersOffset += parametersStride;
+				this->writeMaterialDescriptorSets(scene72, *material);
 			}
 		}
 	}
-	return pScene72;
 }
 
-void Engine::destroy(s72::Scene72& scene72) {
-	vkDeviceWaitIdle(*this->context.device());
-	// Destroy vertex buffer and textures
+void Engine::writeMaterialDescriptorSets(s72::Scene72& scene72, const s72::Material& material) {
+	memcpy(reinterpret_cast<char*>(scene72.materialParametersBufferMemory.mappedAddress()) + material.parametersOffset, &material.parameters, sizeof(Engine::MaterialParameters));
+	VkDescriptorBufferInfo parametersInfo{
+		.buffer = scene72.materialParametersBuffer,
+		.offset = material.parametersOffset,
+		.range = sizeof(Engine::MaterialParameters)
+	};
+	for (size_t i = 0; i < Engine::MAX_FRAMES_IN_FLIGHT; i++) {
+		std::vector<VkWriteDescriptorSet> descriptorWrites;
+		std::vector<VkDescriptorImageInfo> imageInfos;
+		descriptorWrites.reserve(material.numTextures() + 1);
+		imageInfos.reserve(material.numTextures());
+		for (std::uint32_t j = 0; j < material.numTextures(); ++j) {
+			VkDescriptorImageInfo imageInfo{
+				.sampler = material.texture(j).sampler(),
+				.imageView = material.texture(j).imageView(),
+				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			};
+			imageInfos.push_back(imageInfo);
+			VkWriteDescriptorSet descriptorWrite{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = scene72.frameDescriptorSets[i].materialLevelUniformDescriptorSets[material.idx],
+				.dstBinding = j,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = &imageInfos.back(),
+				.pBufferInfo = nullptr,
+				.pTexelBufferView = nullptr
+			};
+			descriptorWrites.push_back(descriptorWrite);
+		}
+		// The parameters follow the textures.
+		descriptorWrites.push_back(VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext = nullptr,
+			.dstSet = scene72.frameDescriptorSets[i].materialLevelUniformDescriptorSets[material.idx],
+			.dstBinding = material.numTextures(),
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.pImageInfo = nullptr,
+			.pBufferInfo = &parametersInfo,
+			.pTexelBufferView = nullptr
+		});
+		vkUpdateDescriptorSets(*this->context.device(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+void Engine::destroy(s72::Scene72& scene72, bool waitIdle) {
+	// Stop streaming first. Its worker still references the meshes and materials.
+	// Assets of its last batch are not cached, since the batch may not have been submitted.
+	if (scene72.streamer != nullptr && scene72.streamer->uploadBatch != nullptr)
+		this->assetCache.discard(*scene72.streamer->uploadBatch);
+	scene72.streamer.reset();
+	if (waitIdle) {
+		std::lock_guard<std::mutex> queueLock(this->queueMutex);
+		vkDeviceWaitIdle(*this->context.device());
+	}
+	// Release the geometry and textures. They belong to the asset cache, which keeps them
+	// for later loads until they are trimmed.
 	for (const auto& object : scene72.graph) {
+		// Materials and environments are still null if the load failed before creating them.
+		if (object == nullptr)
+			continue;
 		if (object->type == "MESH") {
 			s72::Mesh::Ptr mesh = std::reinterpret_pointer_cast<s72::Mesh>(object);
-			this->allocator.free(mesh->vertexBufferMemory);
-			vkDestroyBuffer(*this->context.device(), mesh->vertexBuffer, nullptr);
 			mesh->vertexBuffer = nullptr;
+			mesh->positionBuffer = nullptr;
+			mesh->indexBuffer = nullptr;
+			mesh->geometry.reset();
 		}
 		else if (object->type == "MATERIAL") {
 			s72::Material::Ptr material = std::reinterpret_pointer_cast<s72::Material>(object);
-			for (std::uint32_t i = 0; i < material->numTextures(); ++i)
-				material->texture(i).destroy();
+			material->releaseTextures();
 		}
 		else if (object->type == "ENVIRONMENT") {
 			s72::Environment::Ptr environment = std::reinterpret_pointer_cast<s72::Environment>(object);
-			for (std::uint32_t i = 0; i < environment->numTextures(); ++i)
-				environment->texture(i).destroy();
+			environment->releaseTextures();
 		}
 	}
+	scene72.sceneGraph.clear();
 	scene72.cameras.clear();
 	scene72.meshes.clear();
 	scene72.drivers.clear();
@@ -1621,9 +2202,37 @@ void Engine::destroy(s72::Scene72& scene72) {
 			this->allocator.free(scene72.frameDescriptorSets[i].skyboxUniformBufferMemory);
 		}
 	}
+	// Free the descriptor sets, so that scenes loaded one after another do not exhaust the pool.
+	std::vector<VkDescriptorSet> descriptorSets;
+	for (int i = 0; i < Engine::MAX_FRAMES_IN_FLIGHT; ++i) {
+		s72::Scene72::FrameDescriptorSets& frameDescriptorSets = scene72.frameDescriptorSets[i];
+		for (VkDescriptorSet* descriptorSet : {
+			&frameDescriptorSets.viewLevelUniformDescriptorSet,
+			&frameDescriptorSets.viewLevelUniformWithSSAODescriptorSet,
+			&frameDescriptorSets.objectLevelUniformDescriptorSet,
+			&frameDescriptorSets.skyboxUniformDescriptorSet
+		}) {
+			if (*descriptorSet != nullptr)
+				descriptorSets.push_back(*descriptorSet);
+			*descriptorSet = nullptr;
+		}
+		for (const auto& materialDescriptorSet : frameDescriptorSets.materialLevelUniformDescriptorSets)
+			descriptorSets.push_back(materialDescriptorSet.second);
+		frameDescriptorSets.materialLevelUniformDescriptorSets.clear();
+	}
+	if (!descriptorSets.empty())
+		vkFreeDescriptorSets(*this->context.device(), *this->descriptorPool, static_cast<std::uint32_t>(descriptorSets.size()), descriptorSets.data());
+	scene72.ssaoDescriptorSet.clear();
+	scene72.ssaoBlurDescriptorSet.clear();
 	this->allocator.unmap(scene72.ssaoSampleUniformBufferMemory);
 	vkDestroyBuffer(*this->context.device(), scene72.ssaoSampleUniformBuffer, nullptr);
 	this->allocator.free(scene72.ssaoSampleUniformBufferMemory);
+	if (scene72.materialParametersBuffer != nullptr) {
+		this->allocator.unmap(scene72.materialParametersBufferMemory);
+		vkDestroyBuffer(*this->context.device(), scene72.materialParametersBuffer, nullptr);
+		this->allocator.free(scene72.materialParametersBufferMemory);
+		scene72.materialParametersBuffer = nullptr;
+	}
 	
 	// Destroy shadow map
 	scene72.sunLightShadowMaps.clear();
@@ -1631,11 +2240,46 @@ void Engine::destroy(s72::Scene72& scene72) {
 	scene72.spotLightShadowMaps.clear();
 }
 
-bool s72::Scene72::traverse(
-	float playTime,
-	jjyou::glsl::mat4 rootTransform,
-	const std::function<bool(s72::Node::Ptr, const jjyou::glsl::mat4&)>& visit
-) {
+void s72::Driver::seek(float time) {
+	int numTimes = static_cast<int>(this->times.size());
+	this->timeIter = std::clamp(this->timeIter, -1, numTimes - 1);
+	for (int step = 0; step < Driver::MAX_SEEK_STEPS; ++step) {
+		if (this->timeIter + 1 < numTimes && time >= this->times[this->timeIter + 1])
+			++this->timeIter;
+		else if (this->timeIter >= 0 && time < this->times[this->timeIter])
+			--this->timeIter;
+		else
+			return;
+	}
+	// Still not there: the play time jumped, for example by a scrub or a PLAY event.
+	this->timeIter = static_cast<int>(std::upper_bound(this->times.begin(), this->times.end(), time) - this->times.begin()) - 1;
+}
+
+jjyou::glsl::vec3 s72::Driver::sampleVec3(float time) const {
+	if (this->timeIter + 1 == static_cast<int>(this->times.size()))
+		return jjyou::glsl::vec3(this->values[this->timeIter * 3 + 0], this->values[this->timeIter * 3 + 1], this->values[this->timeIter * 3 + 2]);
+	if (this->timeIter == -1)
+		return jjyou::glsl::vec3(this->values[0], this->values[1], this->values[2]);
+	float begT = this->times[this->timeIter];
+	jjyou::glsl::vec3 begV(this->values[this->timeIter * 3 + 0], this->values[this->timeIter * 3 + 1], this->values[this->timeIter * 3 + 2]);
+	float endT = this->times[this->timeIter + 1];
+	jjyou::glsl::vec3 endV(this->values[this->timeIter * 3 + 3], this->values[this->timeIter * 3 + 4], this->values[this->timeIter * 3 + 5]);
+	return interpolate(this->interpolation, begT, endT, time, begV, endV);
+}
+
+jjyou::glsl::quat s72::Driver::sampleQuat(float time) const {
+	if (this->timeIter + 1 == static_cast<int>(this->times.size()))
+		return jjyou::glsl::quat(this->values[this->timeIter * 4 + 0], this->values[this->timeIter * 4 + 1], this->values[this->timeIter * 4 + 2], this->values[this->timeIter * 4 + 3]);
+	if (this->timeIter == -1)
+		return jjyou::glsl::quat(this->values[0], this->values[1], this->values[2], this->values[3]);
+	float begT = this->times[this->timeIter];
+	jjyou::glsl::quat begV(this->values[this->timeIter * 4 + 0], this->values[this->timeIter * 4 + 1], this->values[this->timeIter * 4 + 2], this->values[this->timeIter * 4 + 3]);
+	float endT = this->times[this->timeIter + 1];
+	jjyou::glsl::quat endV(this->values[this->timeIter * 4 + 4], this->values[this->timeIter * 4 + 5], this->values[this->timeIter * 4 + 6], this->values[this->timeIter * 4 + 7]);
+	return interpolate(this->interpolation, begT, endT, time, begV, endV);
+}
+
+void s72::Scene72::seek(float playTime) {
 	// update driver times
 	if (playTime <= this->minTime) {
 		for (auto& driver : this->drivers) {
@@ -1647,19 +2291,29 @@ bool s72::Scene72::traverse(
 			driver->timeIter = static_cast<int>(driver->times.size()) - 1;
 		}
 	}
-	else if (playTime > this->currPlayTime) {
+	else if (playTime != this->currPlayTime) {
 		for (auto& driver : this->drivers) {
-			while (driver->timeIter + 1 < driver->times.size() && playTime >= driver->times[driver->timeIter + 1])
-				++driver->timeIter;
-		}
-	}
-	else if (playTime < this->currPlayTime) {
-		for (auto& driver : this->drivers) {
-			while (driver->timeIter >= 0 && playTime < driver->times[driver->timeIter])
-				--driver->timeIter;
+			driver->seek(playTime);
 		}
 	}
 	this->currPlayTime = playTime;
+}
+
+void s72::Scene72::update(float playTime, const jjyou::glsl::mat4& rootTransform, JobSystem& jobSystem) {
+	// Baked animations are sampled without the drivers.
+	if (this->sceneGraph.bakedAnimation.empty())
+		this->seek(playTime);
+	else
+		this->currPlayTime = playTime;
+	this->sceneGraph.update(this->currPlayTime, rootTransform, jobSystem);
+}
+
+bool s72::Scene72::traverse(
+	float playTime,
+	jjyou::glsl::mat4 rootTransform,
+	const std::function<bool(s72::Node::Ptr, const jjyou::glsl::mat4&)>& visit
+) {
+	this->seek(playTime);
 	// traverse
 	for (s72::Node::WeakPtr node : this->scene->roots)
 		if (!this->_traverse(node.lock(), rootTransform, visit))
@@ -1674,69 +2328,24 @@ bool s72::Scene72::_traverse(
 ) {
 	jjyou::glsl::mat4 translate(1.0f);
 	if (!node->drivers[s72::Driver::Channel::Translation].expired()) {
-		const auto& driver = node->drivers[s72::Driver::Channel::Translation].lock();
-		if (driver->timeIter + 1 == driver->times.size()) {
-			translate[3] = jjyou::glsl::vec4(driver->values[driver->timeIter * 3 + 0], driver->values[driver->timeIter * 3 + 1], driver->values[driver->timeIter * 3 + 2], 1.0f);
-		}
-		else if (driver->timeIter == -1) {
-			translate[3] = jjyou::glsl::vec4(driver->values[0], driver->values[1], driver->values[2], 1.0f);
-		}
-		else {
-			float begT = driver->times[driver->timeIter];
-			jjyou::glsl::vec3 begV(driver->values[driver->timeIter * 3 + 0], driver->values[driver->timeIter * 3 + 1], driver->values[driver->timeIter * 3 + 2]);
-			float endT = driver->times[driver->timeIter + 1];
-			jjyou::glsl::vec3 endV(driver->values[driver->timeIter * 3 + 3], driver->values[driver->timeIter * 3 + 4], driver->values[driver->timeIter * 3 + 5]);
-			jjyou::glsl::vec3 interp = interpolate(driver->interpolation, begT, endT, this->currPlayTime, begV, endV);
-			translate[3] = jjyou::glsl::vec4(interp, 1.0f);
-		}
+		translate[3] = jjyou::glsl::vec4(node->drivers[s72::Driver::Channel::Translation].lock()->sampleVec3(this->currPlayTime), 1.0f);
 	}
 	else {
 		translate[3] = jjyou::glsl::vec4(node->translation, 1.0f);
 	}
 	jjyou::glsl::mat4 rotate(1.0f);
 	if (!node->drivers[s72::Driver::Channel::Rotation].expired()) {
-		const auto& driver = node->drivers[s72::Driver::Channel::Rotation].lock();
-		if (driver->timeIter + 1 == driver->times.size()) {
-			rotate = jjyou::glsl::mat4(jjyou::glsl::quat(driver->values[driver->timeIter * 4 + 0], driver->values[driver->timeIter * 4 + 1], driver->values[driver->timeIter * 4 + 2], driver->values[driver->timeIter * 4 + 3]));
-		}
-		else if (driver->timeIter == -1) {
-			rotate = jjyou::glsl::mat4(jjyou::glsl::quat(driver->values[0], driver->values[1], driver->values[2], driver->values[3]));
-		}
-		else {
-			float begT = driver->times[driver->timeIter];
-			jjyou::glsl::quat begV(driver->values[driver->timeIter * 4 + 0], driver->values[driver->timeIter * 4 + 1], driver->values[driver->timeIter * 4 + 2], driver->values[driver->timeIter * 4 + 3]);
-			float endT = driver->times[driver->timeIter + 1];
-			jjyou::glsl::quat endV(driver->values[driver->timeIter * 4 + 4], driver->values[driver->timeIter * 4 + 5], driver->values[driver->timeIter * 4 + 6], driver->values[driver->timeIter * 4 + 7]);
-			jjyou::glsl::quat interp = interpolate(driver->interpolation, begT, endT, this->currPlayTime, begV, endV);
-			rotate = jjyou::glsl::mat4(interp);
-		}
+		rotate = jjyou::glsl::mat4(node->drivers[s72::Driver::Channel::Rotation].lock()->sampleQuat(this->currPlayTime));
 	}
 	else {
 		rotate = jjyou::glsl::mat4(node->rotation);
 	}
 	jjyou::glsl::mat4 scale(1.0f);
 	if (!node->drivers[s72::Driver::Channel::Scale].expired()) {
-		const auto& driver = node->drivers[s72::Driver::Channel::Scale].lock();
-		if (driver->timeIter + 1 == driver->times.size()) {
-			scale[0][0] = driver->values[driver->timeIter * 3 + 0];
-			scale[1][1] = driver->values[driver->timeIter * 3 + 1];
-			scale[2][2] = driver->values[driver->timeIter * 3 + 2];
-		}
-		else if (driver->timeIter == -1) {
-			scale[0][0] = driver->values[0];
-			scale[1][1] = driver->values[1];
-			scale[2][2] = driver->values[2];
-		}
-		else {
-			float begT = driver->times[driver->timeIter];
-			jjyou::glsl::vec3 begV(driver->values[driver->timeIter * 3 + 0], driver->values[driver->timeIter * 3 + 1], driver->values[driver->timeIter * 3 + 2]);
-			float endT = driver->times[driver->timeIter + 1];
-			jjyou::glsl::vec3 endV(driver->values[driver->timeIter * 3 + 3], driver->values[driver->timeIter * 3 + 4], driver->values[driver->timeIter * 3 + 5]);
-			jjyou::glsl::vec3 interp = interpolate(driver->interpolation, begT, endT, this->currPlayTime, begV, endV);
-			scale[0][0] = interp[0];
-			scale[1][1] = interp[1];
-			scale[2][2] = interp[2];
-		}
+		jjyou::glsl::vec3 interp = node->drivers[s72::Driver::Channel::Scale].lock()->sampleVec3(this->currPlayTime);
+		scale[0][0] = interp[0];
+		scale[1][1] = interp[1];
+		scale[2][2] = interp[2];
 	}
 	else {
 		scale[0][0] = node->scale[0]; scale[1][1] = node->scale[1]; scale[2][2] = node->scale[2];
@@ -1748,4 +2357,4 @@ bool s72::Scene72::_traverse(
 		if (!this->_traverse(child.lock(), currentTransform, visit))
 			return false;
 	return true;
-}
\ No newline at end of file
+}
@@ -17,6 +17,8 @@
 #include <jjyou/glsl/glsl.hpp>
 #include "Engine.hpp"
 #include "Culling.hpp"
+#include "AssetCache.hpp"
+#include "SceneGraph.hpp"
 
 namespace s72 {
 
@@ -111,7 +113,11 @@ namespace s72 {
 		virtual std::uint32_t numTextures(void) const = 0;
 		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const = 0;
 		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) = 0;
+		virtual void releaseTextures(void) = 0; // Drop the references to the shared textures.
+		virtual void setTexture(std::uint32_t idx, AssetCache::Texture texture) = 0; // Replace a placeholder of a progressively loaded scene.
 		std::string materialType;
+		Engine::MaterialParameters parameters{};
+		VkDeviceSize parametersOffset = 0; // Offset of `parameters` in the scene's material parameters buffer.
 	};
 
 	class SimpleMaterial : public Material {
@@ -126,6 +132,8 @@ namespace s72 {
 		virtual std::uint32_t numTextures(void) const override { return 0; }
 		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { throw std::runtime_error("Simple material has no textures."); }
 		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { throw std::runtime_error("Simple material has no textures."); }
+		virtual void releaseTextures(void) override {}
+		virtual void setTexture(std::uint32_t idx, AssetCache::Texture texture) override { throw std::runtime_error("Simple material has no textures."); }
 	};
 
 	class EnvironmentMaterial : public Material {
@@ -135,15 +143,17 @@ namespace s72 {
 		EnvironmentMaterial(
 			std::uint32_t idx,
 			const std::string& name,
-			jjyou::vk::Texture2D&& normalMap,
-			jjyou::vk::Texture2D&& displacementMap
+			AssetCache::Texture normalMap,
+			AssetCache::Texture displacementMap
 		) : Material(idx, name, "environment"), normalMap(std::move(normalMap)), displacementMap(std::move(displacementMap)) {}
 		virtual ~EnvironmentMaterial(void) override {}
 		virtual std::uint32_t numTextures(void) const override { return 2; }
-		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { switch (idx) { case 0:return this->normalMap; case 1:return this->displacementMap; default: throw std::runtime_error("Environment material has exactly 2 textures."); } }
-		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { switch (idx) { case 0:return this->normalMap; case 1:return this->displacementMap; default: throw std::runtime_error("Environment material has exactly 2 textures."); } }
-		jjyou::vk::Texture2D normalMap;
-		jjyou::vk::Texture2D displacementMap;
+		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { switch (idx) { case 0:return *this->normalMap; case 1:return *this->displacementMap; default: throw std::runtime_error("Environment material has exactly 2 textures."); } }
+		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { switch (idx) { case 0:return *this->normalMap; case 1:return *this->displacementMap; default: throw std::runtime_error("Environment material has exactly 2 textures."); } }
+		virtual void releaseTextures(void) override { this->normalMap.reset(); this->displacementMap.reset(); }
+		virtual void setTexture(std::uint32_t idx, AssetCache::Texture texture) override { switch (idx) { case 0: this->normalMap = std::move(texture); break; case 1: this->displacementMap = std::move(texture); break; default: throw std::runtime_error("Environment material has exactly 2 textures."); } }
+		AssetCache::Texture normalMap;
+		AssetCache::Texture displacementMap;
 	};
 
 	class MirrorMaterial : public Material {
@@ -153,15 +163,17 @@ namespace s72 {
 		MirrorMaterial(
 			std::uint32_t idx,
 			const std::string& name,
-			jjyou::vk::Texture2D&& normalMap,
-			jjyou::vk::Texture2D&& displacementMap
+			AssetCache::Texture normalMap,
+			AssetCache::Texture displacementMap
 		) : Material(idx, name, "mirror"), normalMap(std::move(normalMap)), displacementMap(std::move(displacementMap)) {}
 		virtual ~MirrorMaterial(void) override {}
 		virtual std::uint32_t numTextures(void) const override { return 2; }
-		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { switch (idx) { case 0:return this->normalMap; case 1:return this->displacementMap; default: throw std::runtime_error("Mirror material has exactly 2 textures."); } }
-		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { switch (idx) { case 0:return this->normalMap; case 1:return this->displacementMap; default: throw std::runtime_error("Mirror material has exactly 2 textures."); } }
-		jjyou::vk::Texture2D normalMap;
-		jjyou::vk::Texture2D displacementMap;
+		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { switch (idx) { case 0:return *this->normalMap; case 1:return *this->displacementMap; default: throw std::runtime_error("Mirror material has exactly 2 textures."); } }
+		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { switch (idx) { case 0:return *this->normalMap; case 1:return *this->displacementMap; default: throw std::runtime_error("Mirror material has exactly 2 textures."); } }
+		virtual void releaseTextures(void) override { this->normalMap.reset(); this->displacementMap.reset(); }
+		virtual void setTexture(std::uint32_t idx, AssetCache::Texture texture) override { switch (idx) { case 0: this->normalMap = std::move(texture); break; case 1: this->displacementMap = std::move(texture); break; default: throw std::runtime_error("Mirror material has exactly 2 textures."); } }
+		AssetCache::Texture normalMap;
+		AssetCache::Texture displacementMap;
 	};
 
 	class LambertianMaterial : public Material {
@@ -171,19 +183,23 @@ namespace s72 {
 		LambertianMaterial(
 			std::uint32_t idx,
 			const std::string& name,
-			jjyou::vk::Texture2D&& normalMap,
-			jjyou::vk::Texture2D&& displacementMap,
-			jjyou::vk::Texture2D&& albedo
+			AssetCache::Texture normalMap,
+			AssetCache::Texture displacementMap,
+			AssetCache::Texture albedo
 		) : Material(idx, name, "lambertian"), normalMap(std::move(normalMap)), displacementMap(std::move(displacementMap)), albedo(std::move(albedo)) {}
 		virtual ~LambertianMaterial(void) override {}
 		virtual std::uint32_t numTextures(void) const override { return 3; }
-		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { switch (idx) { case 0:return this->normalMap; case 1:return this->displacementMap; case 2: return this->albedo; default: throw std::runtime_error("Lambertian material has exactly 3 textures."); } }
-		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { switch (idx) { case 0:return this->normalMap; case 1:return this->displacementMap; case 2: return this->albedo; default: throw std::runtime_error("Lambertian material has exactly 3 textures."); } }
-		jjyou::vk::Texture2D normalMap;
-		jjyou::vk::Texture2D displacementMap;
-		jjyou::vk::Texture2D albedo;
+		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { switch (idx) { case 0:return *this->normalMap; case 1:return *this->displacementMap; case 2: return *this->albedo; default: throw std::runtime_error("Lambertian material has exactly 3 textures."); } }
+		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { switch (idx) { case 0:return *this->normalMap; case 1:return *this->displacementMap; case 2: return *this->albedo; default: throw std::runtime_error("Lambertian material has exactly 3 textures."); } }
+		virtual void releaseTextures(void) override { this->normalMap.reset(); this->displacementMap.reset(); this->albedo.reset(); }
+		virtual void setTexture(std::uint32_t idx, AssetCache::Texture texture) override { switch (idx) { case 0: this->normalMap = std::move(texture); break; case 1: this->displacementMap = std::move(texture); break; case 2: this->albedo = std::move(texture); break; default: throw std::runtime_error("Lambertian material has exactly 3 textures."); } }
+		AssetCache::Texture normalMap;
+		AssetCache::Texture displacementMap;
+		AssetCache::Texture albedo;
 	};
 
+	// Displacement, roughness and metalness are packed into the red, green and blue channels
+	// of one surface texture, which takes the place of the displacement map.
 	class PbrMaterial : public Material {
 	public:
 		using Ptr = std::shared_ptr<PbrMaterial>;
@@ -191,21 +207,19 @@ namespace s72 {
 		PbrMaterial(
 			std::uint32_t idx,
 			const std::string& name,
-			jjyou::vk::Texture2D&& normalMap,
-			jjyou::vk::Texture2D&& displacementMap,
-			jjyou::vk::Texture2D&& albedo,
-			jjyou::vk::Texture2D&& roughness,
-			jjyou::vk::Texture2D&& metalness
-		) : Material(idx, name, "pbr"), normalMap(std::move(normalMap)), displacementMap(std::move(displacementMap)), albedo(std::move(albedo)), roughness(std::move(roughness)), metalness(std::move(metalness)) {}
+			AssetCache::Texture normalMap,
+			AssetCache::Texture surface,
+			AssetCache::Texture albedo
+		) : Material(idx, name, "pbr"), normalMap(std::move(normalMap)), surface(std::move(surface)), albedo(std::move(albedo)) {}
 		virtual ~PbrMaterial(void) override {}
-		virtual std::uint32_t numTextures(void) const override { return 5; }
-		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { switch (idx) { case 0:return this->normalMap; case 1:return this->displacementMap; case 2: return this->albedo; case 3: return this->roughness; case 4: return this->metalness; default: throw std::runtime_error("Pbr material has exactly 5 textures."); } }
-		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { switch (idx) { case 0:return this->normalMap; case 1:return this->displacementMap; case 2: return this->albedo; case 3: return this->roughness; case 4: return this->metalness; default: throw std::runtime_error("Pbr material has exactly 5 textures."); } }
-		jjyou::vk::Texture2D normalMap;
-		jjyou::vk::Texture2D displacementMap;
-		jjyou::vk::Texture2D albedo;
-		jjyou::vk::Texture2D roughness;
-		jjyou::vk::Texture2D metalness;
+		virtual std::uint32_t numTextures(void) const override { return 3; }
+		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const override { switch (idx) { case 0:return *this->normalMap; case 1:return *this->surface; case 2: return *this->albedo; default: throw std::runtime_error("Pbr material has exactly 3 textures."); } }
+		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) override { switch (idx) { case 0:return *this->normalMap; case 1:return *this->surface; case 2: return *this->albedo; default: throw std::runtime_error("Pbr material has exactly 3 textures."); } }
+		virtual void releaseTextures(void) override { this->normalMap.reset(); this->surface.reset(); this->albedo.reset(); }
+		virtual void setTexture(std::uint32_t idx, AssetCache::Texture texture) override { switch (idx) { case 0: this->normalMap = std::move(texture); break; case 1: this->surface = std::move(texture); break; case 2: this->albedo = std::move(texture); break; default: throw std::runtime_error("Pbr material has exactly 3 textures."); } }
+		AssetCache::Texture normalMap;
+		AssetCache::Texture surface;
+		AssetCache::Texture albedo;
 	};
 
 	class Environment : public Object {
@@ -215,17 +229,18 @@ namespace s72 {
 		Environment(
 			std::uint32_t idx,
 			const std::string& name,
-			jjyou::vk::Texture2D&& radiance,
-			jjyou::vk::Texture2D&& lambertian,
-			jjyou::vk::Texture2D&& environmentBRDF
+			AssetCache::Texture radiance,
+			AssetCache::Texture lambertian,
+			AssetCache::Texture environmentBRDF
 		) : Object(idx, "ENVIRONMENT", name), radiance(std::move(radiance)), lambertian(std::move(lambertian)), environmentBRDF(std::move(environmentBRDF)) {}
 		virtual ~Environment(void) override {}
 		virtual std::uint32_t numTextures(void) const { return 3; }
-		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const { switch (idx) { case 0:return this->radiance; case 1:return this->lambertian; case 2:return this->environmentBRDF; default: throw std::runtime_error("Environment has exactly 3 textures."); } }
-		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) { switch (idx) { case 0:return this->radiance; case 1:return this->lambertian; case 2:return this->environmentBRDF; default: throw std::runtime_error("Environment has exactly 3 textures."); } }
-		jjyou::vk::Texture2D radiance;
-		jjyou::vk::Texture2D lambertian;
-		jjyou::vk::Texture2D environmentBRDF;
+		virtual const jjyou::vk::Texture2D& texture(std::uint32_t idx) const { switch (idx) { case 0:return *this->radiance; case 1:return *this->lambertian; case 2:return *this->environmentBRDF; default: throw std::runtime_error("Environment has exactly 3 textures."); } }
+		virtual jjyou::vk::Texture2D& texture(std::uint32_t idx) { switch (idx) { case 0:return *this->radiance; case 1:return *this->lambertian; case 2:return *this->environmentBRDF; default: throw std::runtime_error("Environment has exactly 3 textures."); } }
+		virtual void releaseTextures(void) { this->radiance.reset(); this->lambertian.reset(); this->environmentBRDF.reset(); }
+		AssetCache::Texture radiance;
+		AssetCache::Texture lambertian;
+		AssetCache::Texture environmentBRDF;
 	};
 
 	class Mesh : public Object {
@@ -233,23 +248,50 @@ namespace s72 {
 		using Ptr = std::shared_ptr<Mesh>;
 		using WeakPtr = std::weak_ptr<Mesh>;
 		VkPrimitiveTopology topology;
-		std::uint32_t count;
+		std::uint32_t count; // Number of indices.
+		std::uint32_t numVertices; // Number of unique vertices after welding.
+		// Ranges inside a geometry arena of the asset cache. Buffers are shared between meshes.
 		VkBuffer vertexBuffer;
-		jjyou::vk::Memory vertexBufferMemory;
+		std::int32_t firstVertex; // vertexOffset of the draws.
+		VkBuffer positionBuffer; // Positions only, for the shadow passes.
+		std::int32_t firstPosition; // vertexOffset of the shadow pass draws.
+		VkBuffer indexBuffer;
+		std::uint32_t firstIndex;
+		VkIndexType indexType;
 		Material::WeakPtr material;
 		BBox bbox;
+		AssetCache::Mesh geometry; // Keeps the ranges above alive.
 		Mesh(
 			std::uint32_t idx,
 			const std::string& name,
 			VkPrimitiveTopology topology,
-			std::uint32_t count,
-			VkBuffer vertexBuffer,
-			jjyou::vk::Memory&& vertexBufferMemory,
-			Material::WeakPtr material,
-			const BBox& bbox
-		) : Object(idx, "MESH", name), topology(topology), count(count), vertexBuffer(vertexBuffer), vertexBufferMemory(std::move(vertexBufferMemory)), material(material), bbox(bbox)
+			const AssetCache::Mesh& geometry,
+			Material::WeakPtr material
+		) : Object(idx, "MESH", name), topology(topology), count(geometry->count), numVertices(geometry->numVertices), vertexBuffer(geometry->vertexBuffer), firstVertex(geometry->firstVertex), positionBuffer(geometry->positionBuffer), firstPosition(geometry->firstPosition), indexBuffer(geometry->indexBuffer), firstIndex(geometry->firstIndex), indexType(geometry->indexType), material(material), bbox(geometry->bbox), geometry(geometry)
+		{}
+		// A mesh of a progressively loaded scene whose geometry is not resident yet.
+		Mesh(
+			std::uint32_t idx,
+			const std::string& name,
+			VkPrimitiveTopology topology,
+			Material::WeakPtr material
+		) : Object(idx, "MESH", name), topology(topology), count(0), numVertices(0), vertexBuffer(nullptr), firstVertex(0), positionBuffer(nullptr), firstPosition(0), indexBuffer(nullptr), firstIndex(0), indexType(VK_INDEX_TYPE_UINT32), material(material), bbox(), geometry()
 		{}
 		virtual ~Mesh(void) override {}
+		bool resident(void) const { return this->geometry != nullptr; }
+		void setGeometry(const AssetCache::Mesh& geometry) {
+			this->count = geometry->count;
+			this->numVertices = geometry->numVertices;
+			this->vertexBuffer = geometry->vertexBuffer;
+			this->firstVertex = geometry->firstVertex;
+			this->positionBuffer = geometry->positionBuffer;
+			this->firstPosition = geometry->firstPosition;
+			this->indexBuffer = geometry->indexBuffer;
+			this->firstIndex = geometry->firstIndex;
+			this->indexType = geometry->indexType;
+			this->bbox = geometry->bbox;
+			this->geometry = geometry;
+		}
 	};
 
 	class Light : public Object {
@@ -407,6 +449,14 @@ namespace s72 {
 		) : Object(idx, "DRIVER", name), node(node), channel(channel), times(times), values(values), interpolation(interpolation)
 		{}
 		virtual ~Driver(void) override {}
+		// Move `timeIter` to the last keyframe at or before `time`, or to -1 if `time` is before the first one.
+		// Nearby keyframes are stepped to, and jumps further than MAX_SEEK_STEPS keyframes are binary-searched.
+		static constexpr inline int MAX_SEEK_STEPS = 4;
+		void seek(float time);
+		// Value at `time`, which must lie in the keyframe interval selected by `timeIter`.
+		// Translation and scale drivers are sampled as vec3, rotation drivers as quat.
+		jjyou::glsl::vec3 sampleVec3(float time) const;
+		jjyou::glsl::quat sampleQuat(float time) const;
 	};
 
 	class Scene72 {
@@ -421,9 +471,12 @@ namespace s72 {
 
 		SimpleMaterial::Ptr defaultMaterial;
 
+		std::shared_ptr<SceneStreamer> streamer{}; // Set while a progressively loaded scene is being completed.
+
 		std::vector<Object::Ptr> graph;
 		float minTime = 0.0f;
 		float maxTime = 0.0f;
+		bool compactVertices = false; // Material meshes use the compact layout of MaterialVertexFormat.
 
 		// Reset timestamp related variables
 		void reset(void) {
@@ -432,8 +485,17 @@ namespace s72 {
 			}
 		}
 
-		// Traverse the scene graph
+		// Flattened scene graph, built once the scene is loaded.
+		SceneGraph sceneGraph{};
+
+		// Advance the drivers to `playTime`
 		float currPlayTime = 0.0f;
+		void seek(float playTime);
+
+		// Advance the drivers to `playTime` and update the world transforms of `sceneGraph`
+		void update(float playTime, const jjyou::glsl::mat4& rootTransform, JobSystem& jobSystem);
+
+		// Traverse the scene graph
 		bool traverse(
 			float playTime,
 			jjyou::glsl::mat4 rootTransform,
@@ -466,6 +528,8 @@ namespace s72 {
 		vk::raii::DescriptorSet ssaoBlurDescriptorSet{ nullptr };
 		VkBuffer ssaoSampleUniformBuffer = nullptr;
 		jjyou::vk::Memory ssaoSampleUniformBufferMemory{};
+		VkBuffer materialParametersBuffer = nullptr; // Engine::MaterialParameters of all non-simple materials.
+		jjyou::vk::Memory materialParametersBufferMemory{};
 
 		std::vector<ShadowMap> sunLightShadowMaps{};
 		std::vector<ShadowMap> sphereLightShadowMaps{};
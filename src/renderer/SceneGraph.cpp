@@ -0,0 +1,225 @@
+#include "SceneGraph.hpp"
+#include "Scene72.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+void s72::SceneGraph::build(const Scene72& scene72) {
+	this->clear();
+	if (scene72.scene == nullptr)
+		return;
+	// Nodes get their index the first time they are reached.
+	std::unordered_map<const Node*, std::uint32_t> nodeIndices;
+	auto nodeIndex = [&](const Node& node) -> std::uint32_t {
+		auto [iter, inserted] = nodeIndices.emplace(&node, this->numNodes());
+		if (inserted) {
+			this->translations.push_back(node.translation);
+			this->rotations.push_back(node.rotation);
+			this->scales.push_back(node.scale);
+			this->translationDrivers.push_back(node.drivers[Driver::Channel::Translation].lock().get());
+			this->rotationDrivers.push_back(node.drivers[Driver::Channel::Rotation].lock().get());
+			this->scaleDrivers.push_back(node.drivers[Driver::Channel::Scale].lock().get());
+			for (const Driver* driver : { this->translationDrivers.back(), this->rotationDrivers.back(), this->scaleDrivers.back() })
+				if (driver != nullptr)
+					this->animation.add(*driver, iter->second);
+			if (this->translationDrivers.back() != nullptr || this->rotationDrivers.back() != nullptr || this->scaleDrivers.back() != nullptr)
+				this->drivenNodes.push_back(iter->second);
+		}
+		return iter->second;
+	};
+	// Depth-first, visiting children in order, like `Scene72::traverse`.
+	std::vector<std::pair<const Node*, std::int32_t>> stack;
+	for (auto root = scene72.scene->roots.rbegin(); root != scene72.scene->roots.rend(); ++root)
+		stack.emplace_back(root->lock().get(), -1);
+	while (!stack.empty()) {
+		auto [node, parent] = stack.back();
+		stack.pop_back();
+		std::int32_t instance = static_cast<std::int32_t>(this->numInstances());
+		std::uint32_t nodeIdx = nodeIndex(*node);
+		bool driven = this->translationDrivers[nodeIdx] != nullptr || this->rotationDrivers[nodeIdx] != nullptr || this->scaleDrivers[nodeIdx] != nullptr;
+		bool dynamic = driven || (parent >= 0 && this->dynamic[parent]);
+		this->instanceNodes.push_back(nodeIdx);
+		this->parents.push_back(parent);
+		this->dynamic.push_back(dynamic);
+		if (dynamic)
+			this->dynamicInstances.push_back(instance);
+		if (parent < 0)
+			this->rootInstances.push_back(instance);
+		if (dynamic && (parent < 0 || !this->dynamic[parent]))
+			this->dynamicRoots.push_back(instance);
+		Mesh* mesh = node->mesh.lock().get();
+		this->meshes.push_back(mesh);
+		this->materials.push_back((mesh != nullptr) ? mesh->material.lock().get() : nullptr);
+		this->cameras.push_back(node->camera.lock().get());
+		this->lights.push_back(node->light.lock().get());
+		this->environments.push_back(!node->environment.expired());
+		for (auto child = node->children.rbegin(); child != node->children.rend(); ++child)
+			stack.emplace_back(child->lock().get(), instance);
+	}
+	// Children follow their parent, so a subtree ends where the last subtree of its children ends.
+	this->subtreeEnds.resize(this->numInstances());
+	for (std::uint32_t i = this->numInstances(); i-- > 0;) {
+		this->subtreeEnds[i] = std::max(this->subtreeEnds[i], i + 1);
+		if (this->parents[i] >= 0)
+			this->subtreeEnds[this->parents[i]] = std::max(this->subtreeEnds[this->parents[i]], this->subtreeEnds[i]);
+	}
+	this->_subtreeRanges = this->_splitSubtrees(this->rootInstances);
+	this->_dynamicRanges = this->_splitSubtrees(this->dynamicRoots);
+	this->localTransforms.resize(this->numNodes());
+	this->worldTransforms.resize(this->numInstances());
+	this->normalTransforms.resize(this->numInstances());
+}
+
+void s72::SceneGraph::clear(void) {
+	this->translations.clear();
+	this->rotations.clear();
+	this->scales.clear();
+	this->translationDrivers.clear();
+	this->rotationDrivers.clear();
+	this->scaleDrivers.clear();
+	this->localTransforms.clear();
+	this->drivenNodes.clear();
+	this->animation.clear();
+	this->bakedAnimation.clear();
+	this->instanceNodes.clear();
+	this->parents.clear();
+	this->meshes.clear();
+	this->materials.clear();
+	this->cameras.clear();
+	this->lights.clear();
+	this->environments.clear();
+	this->worldTransforms.clear();
+	this->normalTransforms.clear();
+	this->dynamic.clear();
+	this->dynamicInstances.clear();
+	this->subtreeEnds.clear();
+	this->rootInstances.clear();
+	this->dynamicRoots.clear();
+	this->_subtreeRanges = SubtreeRanges{};
+	this->_dynamicRanges = SubtreeRanges{};
+	this->_valid = false;
+}
+
+void s72::SceneGraph::update(float playTime, const jjyou::glsl::mat4& rootTransform, JobSystem& jobSystem) {
+	bool rootChanged = false;
+	for (int c = 0; c < 4; ++c)
+		for (int r = 0; r < 4; ++r)
+			rootChanged = rootChanged || (rootTransform[c][r] != this->_rootTransform[c][r]);
+	bool all = !this->_valid || rootChanged;
+	if (all || playTime != this->_playTime) {
+		if (this->bakedAnimation.empty())
+			this->animation.evaluate(playTime, this->translations, this->rotations, this->scales, jobSystem);
+		else
+			this->bakedAnimation.sample(playTime, this->translations, this->rotations, this->scales);
+		// Nodes are independent, and so are the subtrees below the roots or the dynamic roots.
+		if (all) {
+			jobSystem.parallelFor(this->numNodes(), SceneGraph::NODE_GRAIN_SIZE, [&](std::size_t begin, std::size_t end) {
+				for (std::size_t n = begin; n < end; ++n)
+					this->_updateLocalTransform(static_cast<std::uint32_t>(n));
+			});
+		}
+		else {
+			jobSystem.parallelFor(this->drivenNodes.size(), SceneGraph::NODE_GRAIN_SIZE, [&](std::size_t begin, std::size_t end) {
+				for (std::size_t n = begin; n < end; ++n)
+					this->_updateLocalTransform(this->drivenNodes[n]);
+			});
+		}
+		const SubtreeRanges& subtrees = all ? this->_subtreeRanges : this->_dynamicRanges;
+		std::uint32_t waveBegin = 0;
+		for (std::uint32_t waveEnd : subtrees.waveEnds) {
+			jobSystem.parallelFor(waveEnd - waveBegin, 1, [&](std::size_t begin, std::size_t end) {
+				for (std::size_t r = waveBegin + begin; r < waveBegin + end; ++r)
+					for (std::uint32_t i = subtrees.ranges[r].first; i < subtrees.ranges[r].second; ++i)
+						this->_updateWorldTransform(i, rootTransform);
+			});
+			waveBegin = waveEnd;
+		}
+	}
+	this->_valid = true;
+	this->_playTime = playTime;
+	this->_rootTransform = rootTransform;
+}
+
+s72::SceneGraph::SubtreeRanges s72::SceneGraph::_splitSubtrees(const std::vector<std::uint32_t>& roots) const {
+	std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> waves;
+	// Ranges are added to their wave in depth-first order, so a range that directly follows the last
+	// range of its wave is merged into it while they fit in a job.
+	auto addRange = [&](std::uint32_t wave, std::uint32_t begin, std::uint32_t end) {
+		if (waves.size() <= wave)
+			waves.resize(wave + 1);
+		auto& ranges = waves[wave];
+		if (!ranges.empty() && ranges.back().second == begin && end - ranges.back().first <= SceneGraph::SUBTREE_GRAIN_SIZE)
+			ranges.back().second = end;
+		else
+			ranges.emplace_back(begin, end);
+	};
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> stack; // Subtree root and wave.
+	for (auto root = roots.rbegin(); root != roots.rend(); ++root)
+		stack.emplace_back(*root, 0);
+	while (!stack.empty()) {
+		auto [root, wave] = stack.back();
+		stack.pop_back();
+		std::uint32_t end = this->subtreeEnds[root];
+		if (end - root <= SceneGraph::SUBTREE_GRAIN_SIZE) {
+			addRange(wave, root, end);
+			continue;
+		}
+		// Follow the path down through the only child too large for a job, and split where no child or
+		// several children are too large. The smaller children before the path are updated with it, as
+		// long as they fit in a job or are no longer than the path, the ones after it in the next wave.
+		std::vector<std::uint32_t> children;
+		std::uint32_t last = root;
+		std::uint32_t pathLength = 1, offPath = 0;
+		while (true) {
+			std::uint32_t largeChild = 0, numLargeChildren = 0;
+			for (std::uint32_t child = last + 1; child < this->subtreeEnds[last]; child = this->subtreeEnds[child]) {
+				if (this->subtreeEnds[child] - child > SceneGraph::SUBTREE_GRAIN_SIZE) {
+					largeChild = child;
+					++numLargeChildren;
+				}
+			}
+			if (numLargeChildren != 1)
+				break;
+			offPath += largeChild - last - 1;
+			if (offPath > std::max<std::size_t>(SceneGraph::SUBTREE_GRAIN_SIZE, pathLength))
+				break;
+			++pathLength;
+			for (std::uint32_t child = this->subtreeEnds[largeChild]; child < this->subtreeEnds[last]; child = this->subtreeEnds[child])
+				children.push_back(child);
+			last = largeChild;
+		}
+		addRange(wave, root, last + 1);
+		for (std::uint32_t child = last + 1; child < this->subtreeEnds[last]; child = this->subtreeEnds[child])
+			children.push_back(child);
+		std::sort(children.begin(), children.end());
+		for (auto child = children.rbegin(); child != children.rend(); ++child)
+			stack.emplace_back(*child, wave + 1);
+	}
+	SubtreeRanges subtreeRanges;
+	for (const auto& ranges : waves) {
+		subtreeRanges.ranges.insert(subtreeRanges.ranges.end(), ranges.begin(), ranges.end());
+		subtreeRanges.waveEnds.push_back(static_cast<std::uint32_t>(subtreeRanges.ranges.size()));
+	}
+	return subtreeRanges;
+}
+
+void s72::SceneGraph::_updateLocalTransform(std::uint32_t node) {
+	const jjyou::glsl::vec3& translation = this->translations[node];
+	const jjyou::glsl::quat& rotation = this->rotations[node];
+	const jjyou::glsl::vec3& scale = this->scales[node];
+	// translate * rotate * scale, without the matrix products.
+	jjyou::glsl::mat4& local = this->localTransforms[node];
+	local = jjyou::glsl::mat4(rotation);
+	local[0] = scale[0] * local[0];
+	local[1] = scale[1] * local[1];
+	local[2] = scale[2] * local[2];
+	local[3] = jjyou::glsl::vec4(translation, 1.0f);
+}
+
+void s72::SceneGraph::_updateWorldTransform(std::uint32_t instance, const jjyou::glsl::mat4& rootTransform) {
+	const jjyou::glsl::mat4& parentTransform = (this->parents[instance] < 0) ? rootTransform : this->worldTransforms[this->parents[instance]];
+	this->worldTransforms[instance] = parentTransform * this->localTransforms[this->instanceNodes[instance]];
+	this->normalTransforms[instance] = jjyou::glsl::transpose(jjyou::glsl::inverse(this->worldTransforms[instance]));
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <jjyou/glsl/glsl.hpp>
+#include "AnimationBatch.hpp"
+#include "AnimationCache.hpp"
+
+namespace s72 {
+
+	// The scene graph of a loaded scene, flattened for the per-frame update.
+	// Node properties are stored once per node, in arrays indexed by node. A node reachable through
+	// several paths from the roots is drawn once per path, so every path is one instance. Instances
+	// are stored in depth-first order, which puts parents before their children, and world transforms
+	// are computed in one pass over them.
+	// Instances are dynamic if their node or one of its ancestors is driven. The transforms of static
+	// instances are computed once and cached, and only dynamic instances are updated when the play time
+	// changes. Nothing is updated while the play time stays the same.
+	// The subtree of an instance is a contiguous range of instances, so subtrees are updated in parallel.
+	// Subtrees larger than SUBTREE_GRAIN_SIZE are split below their root: the range from the root down
+	// to its first branching is updated first, then the subtrees of its children, split the same way.
+	// Objects are referenced by raw pointers. They are owned by the scene, which must outlive the graph.
+	class SceneGraph {
+
+	public:
+
+		static constexpr inline std::size_t NODE_GRAIN_SIZE = 1024;
+		static constexpr inline std::size_t SUBTREE_GRAIN_SIZE = 256; // Instances per job of the world transform update.
+
+		/** @brief	Flatten the graph under the roots of `scene72.scene`.
+		  */
+		void build(const Scene72& scene72);
+
+		/** @brief	Drop every node and instance.
+		  */
+		void clear(void);
+
+		/** @brief	Update the local transforms of the nodes and the world and normal transforms of the instances to `playTime`.
+		  *			Only dynamic ones are recomputed, unless the graph was rebuilt or `rootTransform` changed.
+		  *			The drivers must have been advanced to `playTime` already. Nodes and subtrees are split across `jobSystem`.
+		  */
+		void update(float playTime, const jjyou::glsl::mat4& rootTransform, JobSystem& jobSystem);
+
+		/** @brief	Recompute every transform on the next update, for example after the drivers were edited.
+		  */
+		void invalidate(void) { this->_valid = false; }
+
+		std::uint32_t numNodes(void) const { return static_cast<std::uint32_t>(this->translations.size()); }
+
+		std::uint32_t numInstances(void) const { return static_cast<std::uint32_t>(this->instanceNodes.size()); }
+
+		std::uint32_t numDynamicInstances(void) const { return static_cast<std::uint32_t>(this->dynamicInstances.size()); }
+
+		// Per node. Driven channels hold their value at the last update.
+		std::vector<jjyou::glsl::vec3> translations{};
+		std::vector<jjyou::glsl::quat> rotations{};
+		std::vector<jjyou::glsl::vec3> scales{};
+		std::vector<const Driver*> translationDrivers{}; // Null if the channel is not driven.
+		std::vector<const Driver*> rotationDrivers{};
+		std::vector<const Driver*> scaleDrivers{};
+		std::vector<jjyou::glsl::mat4> localTransforms{};
+		std::vector<std::uint32_t> drivenNodes{}; // Nodes with at least one driver.
+		AnimationBatch animation{}; // Drivers of the nodes.
+		AnimationCache bakedAnimation{}; // Used instead of `animation` if not empty.
+
+		// Per instance.
+		std::vector<std::uint32_t> instanceNodes{};
+		std::vector<std::int32_t> parents{}; // Instance index of the parent, or -1 for roots.
+		std::vector<Mesh*> meshes{}; // Null if the node has no mesh.
+		std::vector<const Material*> materials{}; // Material of the mesh.
+		std::vector<const Camera*> cameras{};
+		std::vector<const Light*> lights{};
+		std::vector<std::uint8_t> environments{}; // Whether the node holds the environment.
+		std::vector<jjyou::glsl::mat4> worldTransforms{};
+		std::vector<jjyou::glsl::mat4> normalTransforms{}; // Inverse transpose of the world transform.
+		std::vector<std::uint8_t> dynamic{};
+		std::vector<std::uint32_t> dynamicInstances{}; // In depth-first order, like the instances.
+		std::vector<std::uint32_t> subtreeEnds{}; // One past the last instance of the subtree of each instance.
+		std::vector<std::uint32_t> rootInstances{};
+		std::vector<std::uint32_t> dynamicRoots{}; // Dynamic instances with a static parent or none.
+
+	private:
+
+		// Instance ranges of at most SUBTREE_GRAIN_SIZE instances, unless they contain a longer path, whose
+		// parents are outside of the range. Ranges are grouped in waves, which are updated one after
+		// the other, and the ranges of a wave only depend on the ranges of earlier waves.
+		struct SubtreeRanges {
+			std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges{};
+			std::vector<std::uint32_t> waveEnds{}; // One past the last range of each wave.
+		};
+
+		SubtreeRanges _splitSubtrees(const std::vector<std::uint32_t>& roots) const;
+		void _updateLocalTransform(std::uint32_t node);
+		void _updateWorldTransform(std::uint32_t instance, const jjyou::glsl::mat4& rootTransform);
+
+		SubtreeRanges _subtreeRanges{}; // Covering every instance.
+		SubtreeRanges _dynamicRanges{}; // Covering the dynamic instances.
+
+		bool _valid = false;
+		float _playTime = 0.0f;
+		jjyou::glsl::mat4 _rootTransform{};
+
+	};
+
+}
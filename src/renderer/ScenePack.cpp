@@ -0,0 +1,464 @@
+#include "ScenePack.hpp"
+#include "Scene72.hpp"
+#include "Engine.hpp"
+#include "UploadBatch.hpp"
+#include "BlobCache.hpp"
+#include "VertexFormat.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+// Get a pointer to `count` records of type T stored at `range`, checking that they lie inside the bundle.
+template <class T>
+static const T* packView(const MappedFile& bundle, const s72pack::Range& range, std::uint64_t count) {
+	if (range.offset % alignof(T) != 0 ||
+		range.offset > bundle.size() ||
+		range.size > bundle.size() - range.offset ||
+		count > range.size / sizeof(T))
+		throw std::runtime_error("Packed scene bundle is corrupted.");
+	return reinterpret_cast<const T*>(bundle.data() + range.offset);
+}
+
+template <class T>
+static std::vector<T> packList(const T* elements, std::uint64_t numElements, const s72pack::List& list) {
+	if (static_cast<std::uint64_t>(list.first) + list.count > numElements)
+		throw std::runtime_error("Packed scene bundle is corrupted.");
+	return std::vector<T>(elements + list.first, elements + list.first + list.count);
+}
+
+static VkDeviceSize packLevelSize(std::uint32_t format, VkExtent2D extent) {
+	VkDeviceSize numTexels = VkDeviceSize(extent.width) * extent.height;
+	VkDeviceSize numBlocks = VkDeviceSize((extent.width + 3) / 4) * ((extent.height + 3) / 4);
+	switch (static_cast<VkFormat>(format)) {
+	case VK_FORMAT_R8_UNORM:
+		return numTexels;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+	case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+		return numTexels * 4;
+	case VK_FORMAT_R32G32_SFLOAT:
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+		return numTexels * 8;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return numTexels * 16;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return numBlocks * 8;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return numBlocks * 16;
+	default:
+		throw std::runtime_error("Packed scene bundle has a texture of unsupported format " + std::to_string(format) + ".");
+	}
+}
+
+static bool packBlockCompressed(std::uint32_t format) {
+	switch (static_cast<VkFormat>(format)) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return true;
+	default:
+		return false;
+	}
+}
+
+s72::Scene72::Ptr Engine::loadPacked(
+	const std::filesystem::path& packPath
+) {
+	MappedFile bundle(packPath);
+	const s72pack::Header* header = packView<s72pack::Header>(bundle, s72pack::Range{ .offset = 0, .size = bundle.size() }, 1);
+	if (std::memcmp(header->magic, s72pack::MAGIC, sizeof(s72pack::MAGIC)) != 0)
+		throw std::runtime_error("\"" + packPath.string() + "\" is not a packed scene bundle.");
+	if (header->version != s72pack::VERSION)
+		throw std::runtime_error("Packed scene bundle \"" + packPath.string() + "\" has version " + std::to_string(header->version) + ", but version " + std::to_string(s72pack::VERSION) + " is required. Please run s72pack again.");
+	const s72pack::Object* objects = packView<s72pack::Object>(bundle, header->objects, header->numObjects);
+	std::uint64_t numTextures = header->textures.size / sizeof(s72pack::Texture);
+	const s72pack::Texture* textures = packView<s72pack::Texture>(bundle, header->textures, numTextures);
+	std::uint64_t numIndices = header->indices.size / sizeof(std::uint32_t);
+	const std::uint32_t* indices = packView<std::uint32_t>(bundle, header->indices, numIndices);
+	std::uint64_t numFloats = header->floats.size / sizeof(float);
+	const float* floats = packView<float>(bundle, header->floats, numFloats);
+
+	s72::Scene72::Ptr pScene72(new s72::Scene72);
+	s72::Scene72& scene72 = *pScene72;
+	scene72.minTime = header->minTime;
+	scene72.maxTime = header->maxTime;
+	scene72.compactVertices = this->compactVertices;
+	// Meshes that are not in the asset cache yet are sub-allocated from a new arena.
+	std::shared_ptr<GeometryArena> geometryArena = std::make_shared<GeometryArena>();
+	geometryArena->create(this->context, this->allocator);
+	// Assets of a bundle are cached by the identity of the bundle file and their index in it.
+	std::string bundleKey = AssetCache::fileKey(packPath);
+	scene72.defaultMaterial.reset(new s72::SimpleMaterial(std::numeric_limits<std::uint32_t>::max(), "default material"));
+	// A preload records into the command pools of its own thread.
+	std::pair<VkCommandPool, VkCommandPool> commandPools = this->loadCommandPools();
+	UploadBatch uploadBatch(
+		this->context,
+		this->allocator,
+		commandPools.first,
+		commandPools.second,
+		&this->queueMutex
+	);
+	AssetCache::PendingGuard pendingAssets(this->assetCache, uploadBatch);
+	// Create a texture straight from the mapped payload.
+	auto createTexture = [&](std::uint32_t textureIdx) -> AssetCache::Texture {
+		if (textureIdx >= numTextures)
+			throw std::runtime_error("Packed scene bundle is corrupted.");
+		std::string key = bundleKey.empty() ? std::string() : "pack|" + bundleKey + "|texture|" + std::to_string(textureIdx);
+		if (AssetCache::Texture cached = this->assetCache.findTexture(key, &uploadBatch))
+			return cached;
+		const s72pack::Texture& packed = textures[textureIdx];
+		if (packBlockCompressed(packed.format) && !this->textureCompressionBC)
+			throw std::runtime_error("Packed scene bundle \"" + packPath.string() + "\" has block-compressed textures, which are not enabled on this device. Please run s72pack with \"--texture-compression none\".");
+		LoadProfiler::Scope timer = this->loadProfiler.scope(LoadProfiler::Phase::UploadTextures, "texture " + std::to_string(textureIdx));
+		timer.addBytes(packed.data.size);
+		const char* data = packView<char>(bundle, packed.data, packed.data.size);
+		std::vector<void*> mipData; mipData.reserve(packed.mipLevels);
+		jjyou::vk::Texture2D texture;
+		VkDeviceSize offset = 0;
+		VkExtent2D levelExtent{ .width = packed.width, .height = packed.height };
+		for (std::uint32_t m = 0; m < packed.mipLevels; ++m) {
+			if (m > 0)
+				mipData.push_back(const_cast<char*>(data + offset)); // Texture2D::create only reads mip data.
+			offset += packLevelSize(packed.format, levelExtent) * (packed.cubeMap ? 6 : 1);
+			levelExtent.width = std::max(levelExtent.width / 2U, 1U);
+			levelExtent.height = std::max(levelExtent.height / 2U, 1U);
+		}
+		if (packed.mipLevels == 0 || offset > packed.data.size)
+			throw std::runtime_error("Packed scene bundle is corrupted.");
+		texture.create(
+			this->context,
+			this->allocator,
+			uploadBatch,
+			data,
+			static_cast<VkFormat>(packed.format),
+			VkExtent2D{ .width = packed.width, .height = packed.height },
+			static_cast<int>(packed.mipLevels),
+			mipData,
+			packed.cubeMap != 0,
+			static_cast<VkSamplerAddressMode>(packed.addressMode)
+		);
+		return this->assetCache.insertTexture(key, std::move(texture), uploadBatch);
+	};
+	// Material constants are packed as 1x1 textures. They become material parameters again,
+	// and the materials bind one shared placeholder texture instead.
+	AssetCache::Texture placeholder;
+	auto createMaterialTexture = [&](const s72pack::Material& packed, std::uint32_t slot, Engine::MaterialParameters& parameters, float* constantValue, int length) -> AssetCache::Texture {
+		std::uint32_t textureIdx = packed.textures[slot];
+		if (textureIdx < numTextures) {
+			const s72pack::Texture& texture = textures[textureIdx];
+			VkFormat format = static_cast<VkFormat>(texture.format);
+			if (texture.width == 1 && texture.height == 1 && texture.cubeMap == 0 &&
+				((format == VK_FORMAT_R8_UNORM && length == 1) || (format == VK_FORMAT_R8G8B8A8_UNORM && length == 3)))
+			{
+				const unsigned char* value = packView<unsigned char>(bundle, texture.data, format == VK_FORMAT_R8_UNORM ? 1 : 4);
+				for (int i = 0; i < length; ++i) {
+					constantValue[i] = value[i] / 255.0f;
+					if (slot == 0)
+						constantValue[i] = constantValue[i] * 2.0f - 1.0f; // Normals are packed as texture * 2 - 1.
+				}
+				if (placeholder == nullptr)
+					placeholder = this->assetCache.placeholder(this->context, this->allocator, uploadBatch);
+				return placeholder;
+			}
+		}
+		parameters.textureMask |= 1U << slot;
+		return createTexture(textureIdx);
+	};
+	// The surface texture of PBR materials packs displacement, roughness and metalness, with constants
+	// already filled in. A 1x1 surface texture only holds constants.
+	auto createSurfaceTexture = [&](const s72pack::Material& packed, Engine::MaterialParameters& parameters) -> AssetCache::Texture {
+		std::uint32_t textureIdx = packed.textures[1];
+		if (textureIdx < numTextures) {
+			const s72pack::Texture& texture = textures[textureIdx];
+			if (texture.width == 1 && texture.height == 1 && texture.cubeMap == 0 && static_cast<VkFormat>(texture.format) == VK_FORMAT_R8G8B8A8_UNORM) {
+				const unsigned char* value = packView<unsigned char>(bundle, texture.data, 4);
+				parameters.displacement = value[0] / 255.0f;
+				parameters.roughness = value[1] / 255.0f;
+				parameters.metalness = value[2] / 255.0f;
+				if (placeholder == nullptr)
+					placeholder = this->assetCache.placeholder(this->context, this->allocator, uploadBatch);
+				return placeholder;
+			}
+		}
+		parameters.textureMask |= (1U << 1) | (1U << 3) | (1U << 4);
+		return createTexture(textureIdx);
+	};
+	// Create objects
+	try {
+		LoadProfiler::Scope createTimer = this->loadProfiler.scope(LoadProfiler::Phase::CreateObjects);
+		for (std::uint32_t i = 0; i < header->numObjects; ++i) {
+			const s72pack::Object& obj = objects[i];
+			std::string name(packView<char>(bundle, obj.name, obj.name.size), obj.name.size);
+			std::uint32_t idx = i + 1;
+			switch (obj.type) {
+			case s72pack::ObjectType::Scene:
+			{
+				s72::Scene::Ptr scene(new s72::Scene(idx, name, {}));
+				scene72.scene = scene;
+				scene72.graph.push_back(scene);
+				break;
+			}
+			case s72pack::ObjectType::Node:
+			{
+				const s72pack::Node& packed = obj.node;
+				s72::Node::Ptr node(new s72::Node(
+					idx,
+					name,
+					jjyou::glsl::vec3(packed.translation[0], packed.translation[1], packed.translation[2]),
+					jjyou::glsl::quat(packed.rotation[0], packed.rotation[1], packed.rotation[2], packed.rotation[3]),
+					jjyou::glsl::vec3(packed.scale[0], packed.scale[1], packed.scale[2]),
+					{},
+					{},
+					{},
+					{},
+					{},
+					{}
+				));
+				scene72.graph.push_back(node);
+				break;
+			}
+			case s72pack::ObjectType::Mesh:
+			{
+				const s72pack::Mesh& packed = obj.mesh;
+				if ((packed.indexSize != sizeof(std::uint16_t) && packed.indexSize != sizeof(std::uint32_t)) || packed.stride < PositionVertexFormat::STRIDE)
+					throw std::runtime_error("Packed scene bundle is corrupted.");
+				std::string key = bundleKey.empty() ? std::string() : "pack|" + bundleKey + "|mesh|" + std::to_string(i) + "|" + std::to_string(this->compactVertices);
+				AssetCache::Mesh geometry = this->assetCache.findMesh(key, &uploadBatch);
+				if (geometry == nullptr) {
+					std::uint32_t stride = packed.stride;
+					VkDeviceSize vertexBufferSize = static_cast<VkDeviceSize>(stride) * packed.numVertices;
+					VkDeviceSize indexBufferSize = static_cast<VkDeviceSize>(packed.indexSize) * packed.count;
+					LoadProfiler::Scope meshTimer = this->loadProfiler.scope(LoadProfiler::Phase::ReadMeshes, name);
+					meshTimer.addBytes(vertexBufferSize + indexBufferSize);
+					const char* vertexData = packView<char>(bundle, packed.vertices, vertexBufferSize);
+					const char* indexData = packView<char>(bundle, packed.indices, indexBufferSize);
+					std::vector<char> positions = PositionVertexFormat::extract(vertexData, packed.numVertices, packed.stride);
+					// Bundles store the full layout, so that the vertex format stays a load time choice.
+					std::vector<char> compactVertices;
+					if (this->compactVertices && packed.stride == MaterialVertexFormat::STRIDE) {
+						compactVertices = MaterialVertexFormat::compact(vertexData, packed.numVertices);
+						vertexData = compactVertices.data();
+						vertexBufferSize = compactVertices.size();
+						stride = MaterialVertexFormat::COMPACT_STRIDE;
+					}
+					GeometryArena::Allocation vertices = geometryArena->upload(uploadBatch, vertexData, vertexBufferSize, stride);
+					GeometryArena::Allocation positionRange = geometryArena->upload(uploadBatch, positions.data(), positions.size(), PositionVertexFormat::STRIDE);
+					GeometryArena::Allocation indices = geometryArena->upload(uploadBatch, indexData, indexBufferSize, packed.indexSize);
+					BBox bbox;
+					for (int j = 0; j < 3; ++j) {
+						bbox.center[j] = packed.bboxCenter[j];
+						bbox.extent[j] = packed.bboxExtent[j];
+						for (int k = 0; k < 3; ++k)
+							bbox.axisRotation[j][k] = packed.bboxAxisRotation[j * 3 + k];
+					}
+					geometry = this->assetCache.insertMesh(key, AssetCache::MeshGeometry{
+						.arena = geometryArena,
+						.count = packed.count,
+						.numVertices = packed.numVertices,
+						.vertexBuffer = vertices.buffer,
+						.firstVertex = static_cast<std::int32_t>(vertices.offset / stride),
+						.positionBuffer = positionRange.buffer,
+						.firstPosition = static_cast<std::int32_t>(positionRange.offset / PositionVertexFormat::STRIDE),
+						.indexBuffer = indices.buffer,
+						.firstIndex = static_cast<std::uint32_t>(indices.offset / packed.indexSize),
+						.indexType = (packed.indexSize == sizeof(std::uint16_t)) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+						.bbox = bbox
+					}, uploadBatch);
+				}
+				s72::Mesh::Ptr mesh(new s72::Mesh(
+					idx,
+					name,
+					static_cast<VkPrimitiveTopology>(packed.topology),
+					geometry,
+					{}
+				));
+				scene72.meshes[name] = mesh;
+				scene72.graph.push_back(mesh);
+				break;
+			}
+			case s72pack::ObjectType::Camera:
+			{
+				const s72pack::Camera& packed = obj.camera;
+				s72::Camera::Ptr camera(new s72::PerspectiveCamera(idx, name, packed.vfov, packed.aspect, packed.zNear, packed.zFar));
+				scene72.cameras[name] = camera;
+				scene72.graph.push_back(camera);
+				break;
+			}
+			case s72pack::ObjectType::Driver:
+			{
+				const s72pack::Driver& packed = obj.driver;
+				if (packed.channel > static_cast<std::uint32_t>(s72::Driver::Channel::Rotation) || packed.interpolation > static_cast<std::uint32_t>(s72::Driver::Interpolation::Slerp))
+					throw std::runtime_error("Driver \"" + name + "\" has an unknown channel or interpolation.");
+				s72::Driver::Ptr driver(new s72::Driver(
+					idx,
+					name,
+					{},
+					static_cast<s72::Driver::Channel>(packed.channel),
+					packList(floats, numFloats, packed.times),
+					packList(floats, numFloats, packed.values),
+					static_cast<s72::Driver::Interpolation>(packed.interpolation)
+				));
+				scene72.drivers.push_back(driver);
+				scene72.graph.push_back(driver);
+				break;
+			}
+			case s72pack::ObjectType::Material:
+			{
+				const s72pack::Material& packed = obj.material;
+				s72::Material::Ptr material;
+				Engine::MaterialParameters parameters{};
+				switch (packed.materialType) {
+				case s72pack::MaterialType::Simple:
+					material.reset(new s72::SimpleMaterial(idx, name));
+					break;
+				case s72pack::MaterialType::Mirror:
+					material.reset(new s72::MirrorMaterial(
+						idx,
+						name,
+						createMaterialTexture(packed, 0, parameters, &parameters.normal[0], 3),
+						createMaterialTexture(packed, 1, parameters, &parameters.displacement, 1)
+					));
+					break;
+				case s72pack::MaterialType::Environment:
+					material.reset(new s72::EnvironmentMaterial(
+						idx,
+						name,
+						createMaterialTexture(packed, 0, parameters, &parameters.normal[0], 3),
+						createMaterialTexture(packed, 1, parameters, &parameters.displacement, 1)
+					));
+					break;
+				case s72pack::MaterialType::Lambertian:
+					material.reset(new s72::LambertianMaterial(
+						idx,
+						name,
+						createMaterialTexture(packed, 0, parameters, &parameters.normal[0], 3),
+						createMaterialTexture(packed, 1, parameters, &parameters.displacement, 1),
+						createMaterialTexture(packed, 2, parameters, &parameters.albedo[0], 3)
+					));
+					break;
+				case s72pack::MaterialType::Pbr:
+					material.reset(new s72::PbrMaterial(
+						idx,
+						name,
+						createMaterialTexture(packed, 0, parameters, &parameters.normal[0], 3),
+						createSurfaceTexture(packed, parameters),
+						createMaterialTexture(packed, 2, parameters, &parameters.albedo[0], 3)
+					));
+					break;
+				default:
+					throw std::runtime_error("Material \"" + name + "\" has an unknown material type.");
+				}
+				material->parameters = parameters;
+				scene72.graph.push_back(material);
+				break;
+			}
+			case s72pack::ObjectType::Environment:
+			{
+				const s72pack::Environment& packed = obj.environment;
+				s72::Environment::Ptr environment(new s72::Environment(
+					idx,
+					name,
+					createTexture(packed.textures[0]),
+					createTexture(packed.textures[1]),
+					createTexture(packed.textures[2])
+				));
+				scene72.environment = environment;
+				scene72.graph.push_back(environment);
+				break;
+			}
+			case s72pack::ObjectType::Light:
+			{
+				const s72pack::Light& packed = obj.light;
+				jjyou::glsl::vec3 tint(packed.tint[0], packed.tint[1], packed.tint[2]);
+				const float* params = packed.params;
+				s72::Light::Ptr light;
+				switch (packed.lightType) {
+				case s72pack::LightType::Sun:
+					light.reset(new s72::SunLight(idx, name, tint, packed.shadow, params[0], params[1]));
+					break;
+				case s72pack::LightType::Sphere:
+					light.reset(new s72::SphereLight(idx, name, tint, packed.shadow, params[0], params[1], params[2]));
+					break;
+				case s72pack::LightType::Spot:
+					light.reset(new s72::SpotLight(idx, name, tint, packed.shadow, params[0], params[1], params[2], params[3], params[4]));
+					break;
+				default:
+					throw std::runtime_error("Light \"" + name + "\" has an unknown lighting type.");
+				}
+				scene72.graph.push_back(light);
+				break;
+			}
+			default:
+				throw std::runtime_error("Unknown object type " + std::to_string(static_cast<std::uint32_t>(obj.type)) + ".");
+			}
+		}
+		createTimer.stop();
+		// Wait for all uploads.
+		{
+			LoadProfiler::Scope timer = this->loadProfiler.scope(LoadProfiler::Phase::WaitUploads);
+			uploadBatch.finish();
+		}
+		this->assetCache.commit(uploadBatch);
+		// Assets of earlier scenes that this scene does not share are not needed anymore.
+		this->assetCache.trim();
+
+		// Set objects reference
+		auto reference = [&](std::uint32_t objectIdx, const std::string& type) -> const s72::Object::Ptr& {
+			if (objectIdx == 0 || objectIdx > scene72.graph.size() || scene72.graph[objectIdx - 1]->type != type)
+				throw std::runtime_error("Packed scene bundle is corrupted.");
+			return scene72.graph[objectIdx - 1];
+		};
+		for (std::uint32_t i = 0; i < header->numObjects; ++i) {
+			const s72pack::Object& obj = objects[i];
+			const s72::Object::Ptr& object = scene72.graph[i];
+			if (obj.type == s72pack::ObjectType::Scene) {
+				s72::Scene::Ptr scene = std::reinterpret_pointer_cast<s72::Scene>(object);
+				for (std::uint32_t rootIdx : packList(indices, numIndices, obj.scene.roots))
+					scene->roots.push_back(std::reinterpret_pointer_cast<s72::Node>(reference(rootIdx, "NODE")));
+			}
+			else if (obj.type == s72pack::ObjectType::Node) {
+				s72::Node::Ptr node = std::reinterpret_pointer_cast<s72::Node>(object);
+				if (obj.node.camera != 0)
+					node->camera = std::reinterpret_pointer_cast<s72::Camera>(reference(obj.node.camera, "CAMERA"));
+				if (obj.node.mesh != 0)
+					node->mesh = std::reinterpret_pointer_cast<s72::Mesh>(reference(obj.node.mesh, "MESH"));
+				for (std::uint32_t childIdx : packList(indices, numIndices, obj.node.children))
+					node->children.push_back(std::reinterpret_pointer_cast<s72::Node>(reference(childIdx, "NODE")));
+				if (obj.node.environment != 0)
+					node->environment = std::reinterpret_pointer_cast<s72::Environment>(reference(obj.node.environment, "ENVIRONMENT"));
+				if (obj.node.light != 0)
+					node->light = std::reinterpret_pointer_cast<s72::Light>(reference(obj.node.light, "LIGHT"));
+			}
+			else if (obj.type == s72pack::ObjectType::Mesh) {
+				s72::Mesh::Ptr mesh = std::reinterpret_pointer_cast<s72::Mesh>(object);
+				if (obj.mesh.material != 0)
+					mesh->material = std::reinterpret_pointer_cast<s72::Material>(reference(obj.mesh.material, "MATERIAL"));
+				else
+					mesh->material = scene72.defaultMaterial;
+			}
+			else if (obj.type == s72pack::ObjectType::Driver) {
+				s72::Driver::Ptr driver = std::reinterpret_pointer_cast<s72::Driver>(object);
+				s72::Node::Ptr node = std::reinterpret_pointer_cast<s72::Node>(reference(obj.driver.node, "NODE"));
+				driver->node = node;
+				node->drivers[driver->channel] = driver;
+			}
+		}
+	}
+	catch (const std::exception&) {
+		// Uploads recorded so far may still be running on the GPU.
+		uploadBatch.discard();
+		this->destroy(scene72);
+		throw;
+	}
+	bundle.close();
+
+	// Create shadow maps and descriptor sets
+	this->createSceneResources(scene72);
+	return pScene72;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// On-disk layout of the packed scene bundles written by s72pack and read by Engine::loadPacked.
+//
+// A bundle starts with a Header followed by tables of plain records. Every record is
+// trivially copyable, so the loader reads them in place from a memory mapping.
+// Objects are stored in the order of the source .s72 file and reference each other by
+// their 1-based index in that file (0 means no reference), exactly like the JSON.
+// All sections are aligned to s72pack::ALIGNMENT bytes.
+namespace s72pack {
+
+	inline constexpr char MAGIC[8] = { 'S', '7', '2', 'P', 'A', 'C', 'K', '\0' };
+	inline constexpr std::uint32_t VERSION = 3;
+	inline constexpr std::uint64_t ALIGNMENT = 16;
+
+	// Byte range inside the bundle.
+	struct Range {
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	// Element range inside one of the shared arrays (indices or floats).
+	struct List {
+		std::uint32_t first;
+		std::uint32_t count;
+	};
+
+	enum class ObjectType : std::uint32_t {
+		Scene = 0,
+		Node = 1,
+		Mesh = 2,
+		Camera = 3,
+		Driver = 4,
+		Material = 5,
+		Environment = 6,
+		Light = 7
+	};
+
+	enum class MaterialType : std::uint32_t {
+		Simple = 0,
+		Mirror = 1,
+		Environment = 2,
+		Lambertian = 3,
+		Pbr = 4
+	};
+
+	enum class LightType : std::uint32_t {
+		Sun = 0,
+		Sphere = 1,
+		Spot = 2
+	};
+
+	struct Scene {
+		List roots; // Object indices.
+	};
+
+	struct Node {
+		float translation[3];
+		float rotation[4];
+		float scale[3];
+		std::uint32_t camera;
+		std::uint32_t mesh;
+		std::uint32_t environment;
+		std::uint32_t light;
+		List children; // Object indices.
+	};
+
+	struct Mesh {
+		std::uint32_t topology; // VkPrimitiveTopology
+		std::uint32_t count; // Number of indices.
+		std::uint32_t material; // 0 for the default simple material.
+		std::uint32_t stride;
+		std::uint32_t numVertices;
+		std::uint32_t indexSize; // 2 or 4 bytes.
+		Range vertices; // Welded interleaved vertices, ready to be copied into the vertex buffer.
+		Range indices; // Ready to be copied into the index buffer.
+		float bboxCenter[3];
+		float bboxExtent[3];
+		float bboxAxisRotation[9]; // Column major.
+	};
+
+	struct Camera {
+		float vfov;
+		float aspect;
+		float zNear;
+		float zFar;
+	};
+
+	struct Driver {
+		std::uint32_t node;
+		std::uint32_t channel; // s72::Driver::Channel
+		std::uint32_t interpolation; // s72::Driver::Interpolation
+		List times; // Floats.
+		List values; // Floats.
+	};
+
+	struct Material {
+		MaterialType materialType;
+		std::uint32_t textures[3]; // Indices into the texture table, in the order of s72::Material::texture.
+	};
+
+	struct Environment {
+		std::uint32_t textures[3]; // Radiance, lambertian and environment BRDF.
+	};
+
+	struct Light {
+		LightType lightType;
+		float tint[3];
+		std::uint32_t shadow;
+		float params[5]; // sun: angle, strength; sphere: radius, power, limit; spot: radius, power, fov, blend, limit.
+	};
+
+	struct Object {
+		ObjectType type;
+		Range name; // Characters, not null terminated.
+		union {
+			Scene scene;
+			Node node;
+			Mesh mesh;
+			Camera camera;
+			Driver driver;
+			Material material;
+			Environment environment;
+			Light light;
+		};
+	};
+
+	// Decoded texture payload. All mip levels (and all layers of each level) are stored
+	// back to back, in the layout expected by jjyou::vk::Texture2D::create.
+	struct Texture {
+		std::uint32_t format; // VkFormat
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t mipLevels;
+		std::uint32_t cubeMap;
+		std::uint32_t addressMode; // VkSamplerAddressMode
+		Range data;
+	};
+
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t numObjects;
+		float minTime;
+		float maxTime;
+		Range objects; // Object[numObjects]
+		Range textures; // Texture[]
+		Range indices; // std::uint32_t[]
+		Range floats; // float[]
+	};
+
+}
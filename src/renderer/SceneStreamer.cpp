@@ -0,0 +1,107 @@
+#include "SceneStreamer.hpp"
+#include "Scene72.hpp"
+#include "BlobCache.hpp"
+#include "VertexFormat.hpp"
+
+SceneStreamer::SceneStreamer(
+	std::vector<MeshJob>&& meshes,
+	std::vector<TextureJob>&& textures,
+	ImageDecodePool&& decodePool,
+	bool compactVertices,
+	int numThreads
+) :
+	_meshes(std::move(meshes)),
+	_textures(std::make_move_iterator(textures.begin()), std::make_move_iterator(textures.end())),
+	_decodePool(std::move(decodePool)),
+	_compactVertices(compactVertices),
+	_numThreads(numThreads)
+{
+	this->_worker = std::thread(&SceneStreamer::_run, this);
+}
+
+SceneStreamer::~SceneStreamer(void) {
+	this->_cancel = true;
+	if (this->_worker.joinable())
+		this->_worker.join();
+	// Swapped-out textures must outlive the uploads into them.
+	if (this->uploadBatch != nullptr)
+		this->uploadBatch->finish();
+}
+
+std::vector<SceneStreamer::WeldedMeshJob> SceneStreamer::takeWeldedMeshes(std::size_t maxBytes) {
+	std::vector<WeldedMeshJob> meshes;
+	std::size_t numBytes = 0;
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	while (!this->_welded.empty() && numBytes < maxBytes) {
+		numBytes += this->_welded.front().welded.vertices.size() + this->_welded.front().welded.indices.size();
+		meshes.push_back(std::move(this->_welded.front()));
+		this->_welded.pop_front();
+	}
+	return meshes;
+}
+
+bool SceneStreamer::finished(void) {
+	if (!this->_imagesDecoded || !this->_textures.empty())
+		return false;
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_welded.empty();
+}
+
+std::vector<std::string> SceneStreamer::takeErrors(void) {
+	std::vector<std::string> errors;
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	errors.swap(this->_errors);
+	return errors;
+}
+
+MeshStats SceneStreamer::meshStats(void) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_meshStats;
+}
+
+void SceneStreamer::_run(void) {
+	// Meshes come first: geometry changes the picture more than textures do.
+	BlobCache blobCache;
+	for (MeshJob& job : this->_meshes) {
+		if (this->_cancel)
+			return;
+		const MappedFile* blob = nullptr;
+		try {
+			blob = &blobCache.open(job.path);
+		}
+		catch (const std::exception&) {
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			this->_errors.push_back("Cannot open binary file \"" + job.path.string() + "\".");
+			continue;
+		}
+		if (job.stride < static_cast<int>(PositionVertexFormat::STRIDE)) {
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			this->_errors.push_back("Mesh \"" + job.mesh->name + "\" has a stride smaller than its position.");
+			continue;
+		}
+		if (job.offset < 0 || static_cast<std::size_t>(job.offset) + std::size_t(job.stride) * job.count > blob->size()) {
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			this->_errors.push_back("Mesh \"" + job.mesh->name + "\" reads past the end of binary file \"" + job.path.string() + "\".");
+			continue;
+		}
+		WeldedMeshJob welded{
+			.mesh = std::move(job.mesh),
+			.key = std::move(job.key),
+			.welded = WeldedMesh(blob->data() + job.offset, job.count, job.stride)
+		};
+		std::pair<std::uint64_t, std::uint64_t> cacheMisses = welded.welded.optimize();
+		if (this->_compactVertices && welded.welded.stride == MaterialVertexFormat::STRIDE) {
+			welded.welded.vertices = MaterialVertexFormat::compact(welded.welded.vertices.data(), welded.welded.numVertices);
+			welded.welded.stride = MaterialVertexFormat::COMPACT_STRIDE;
+		}
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_meshStats.add(welded.welded, cacheMisses);
+		this->_welded.push_back(std::move(welded));
+	}
+	this->_meshes.clear();
+	blobCache.clear();
+	if (this->_cancel)
+		return;
+	this->_decodePool.decode(this->_numThreads);
+	this->_imagesDecoded = true;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <jjyou/vk/Vulkan.hpp>
+#include "AssetCache.hpp"
+#include "BlockCompression.hpp"
+#include "ImageDecodePool.hpp"
+#include "MeshWeld.hpp"
+#include "UploadBatch.hpp"
+
+// Finishes a progressively loaded scene while it is rendered.
+// The loader creates every object at once, but leaves meshes without geometry and binds the
+// placeholder texture in place of material images. A worker thread then welds the mesh files
+// and decodes the images, and `Engine::updateStreaming` uploads what is ready from the render
+// loop and swaps it into the scene once the uploads have completed.
+class SceneStreamer {
+
+public:
+
+	// A mesh whose geometry is not resident yet. It is not drawn until it is.
+	struct MeshJob {
+		std::shared_ptr<s72::Mesh> mesh{};
+		std::string key{}; // Asset cache key.
+		std::filesystem::path path{};
+		int offset = 0;
+		int count = 0;
+		int stride = 0;
+	};
+
+	// A mesh welded by the worker, waiting for its upload.
+	struct WeldedMeshJob {
+		std::shared_ptr<s72::Mesh> mesh{};
+		std::string key{};
+		WeldedMesh welded{};
+	};
+
+	// A material texture whose image is not uploaded yet.
+	// The material samples the placeholder and uses default constants until then.
+	struct TextureJob {
+		std::shared_ptr<s72::Material> material{};
+		std::uint32_t slot = 0; // Texture index of the material.
+		std::uint32_t textureMask = 0; // Bits of the material's textureMask set once the texture is bound.
+		std::string key{}; // Asset cache key.
+		std::array<std::filesystem::path, 3> paths{}; // The image, or the channels of a packed surface texture.
+		bool packed = false;
+		int channels = 0;
+		BlockFormat blockFormat = BlockFormat::NONE;
+		VkFormat format = VK_FORMAT_UNDEFINED; // Format of the texture if it is not block-compressed.
+	};
+
+	/** @brief	Start the worker thread.
+	  *			`decodePool` holds the requested images of `textures`, and is decoded with `numThreads` threads.
+	  */
+	SceneStreamer(
+		std::vector<MeshJob>&& meshes,
+		std::vector<TextureJob>&& textures,
+		ImageDecodePool&& decodePool,
+		bool compactVertices,
+		int numThreads
+	);
+
+	SceneStreamer(const SceneStreamer&) = delete;
+
+	SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+	/** @brief	Stop the worker after the mesh it is welding, or after the images if it is decoding them.
+	  *			Uploads that are still in flight are waited for.
+	  */
+	~SceneStreamer(void);
+
+	/** @brief	Take welded meshes in order until about `maxBytes` of geometry is taken.
+	  */
+	std::vector<WeldedMeshJob> takeWeldedMeshes(std::size_t maxBytes);
+
+	/** @brief	Whether the worker has welded every mesh and decoded every image.
+	  *			`decodePool` and `textures` may be used from then on.
+	  */
+	bool imagesDecoded(void) const { return this->_imagesDecoded; }
+
+	const ImageDecodePool& decodePool(void) const { return this->_decodePool; }
+
+	/** @brief	Texture jobs not uploaded yet.
+	  */
+	std::deque<TextureJob>& textures(void) { return this->_textures; }
+
+	/** @brief	Whether every mesh has been taken and every texture job consumed.
+	  */
+	bool finished(void);
+
+	/** @brief	Errors reported by the worker since the last call, such as a mesh reading past the end of its file.
+	  */
+	std::vector<std::string> takeErrors(void);
+
+	/** @brief	Welding statistics of the meshes welded so far.
+	  */
+	MeshStats meshStats(void);
+
+	// Uploads recorded by `Engine::updateStreaming`. One batch is in flight at a time,
+	// and its assets are swapped into the scene once it has completed.
+	std::unique_ptr<UploadBatch> uploadBatch{};
+	std::shared_ptr<GeometryArena> geometryArena{}; // Arena of the meshes that were not cached.
+	std::vector<std::pair<std::shared_ptr<s72::Mesh>, AssetCache::Mesh>> meshSwaps{};
+	std::vector<std::pair<TextureJob, AssetCache::Texture>> textureSwaps{};
+
+private:
+
+	void _run(void);
+
+	std::vector<MeshJob> _meshes;
+	std::deque<TextureJob> _textures;
+	ImageDecodePool _decodePool;
+	bool _compactVertices;
+	int _numThreads;
+
+	std::mutex _mutex{};
+	std::deque<WeldedMeshJob> _welded{};
+	std::vector<std::string> _errors{};
+	MeshStats _meshStats{};
+	std::atomic<bool> _cancel = false;
+	std::atomic<bool> _imagesDecoded = false;
+	std::thread _worker{};
+
+};
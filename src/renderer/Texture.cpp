@@ -1,32 +1,12 @@
 #include "Texture.hpp"
+#include "UploadBatch.hpp"
 
 namespace jjyou {
 
 	namespace vk {
 
-		void Texture2D::create(
-			const Context& context,
-			MemoryAllocator& allocator,
-			VkCommandPool graphicsCommandPool,
-			VkCommandPool transferCommandPool,
-			const void* data,
-			VkFormat format,
-			VkExtent2D extent,
-			int mipLevels,
-			const std::vector<void*>& mipData,
-			bool cubeMap,
-			VkSamplerAddressMode addressMode
-		) {
-			this->_pContext = &context;
-			this->_pAllocator = &allocator;
-			this->_extent = extent;
-			this->_numLayers = (cubeMap ? 6 : 1);
-			this->_mipLevels = mipLevels;
-			this->_format = format;
-			if (mipData.size() != this->_mipLevels - 1U)
-				JJYOU_VK_UTILS_THROW(VK_ERROR_FORMAT_NOT_SUPPORTED);
-			VkDeviceSize elementSize = 0;
-			switch (this->_format) {
+		VkDeviceSize Texture2D::_elementSize(VkFormat format) {
+			switch (format) {
 			case VK_FORMAT_R8_UNORM:
 			case VK_FORMAT_R8_SNORM:
 			case VK_FORMAT_R8_USCALED:
@@ -34,8 +14,7 @@ namespace jjyou {
 			case VK_FORMAT_R8_UINT:
 			case VK_FORMAT_R8_SINT:
 			case VK_FORMAT_R8_SRGB:
-				elementSize = 1;
-				break;
+				return 1;
 			case VK_FORMAT_R8G8B8_UNORM:
 			case VK_FORMAT_R8G8B8_SNORM:
 			case VK_FORMAT_R8G8B8_USCALED:
@@ -50,8 +29,7 @@ namespace jjyou {
 			case VK_FORMAT_B8G8R8_UINT:
 			case VK_FORMAT_B8G8R8_SINT:
 			case VK_FORMAT_B8G8R8_SRGB:
-				elementSize = 3;
-				break;
+				return 3;
 			case VK_FORMAT_R8G8B8A8_UNORM:
 			case VK_FORMAT_R8G8B8A8_SNORM:
 			case VK_FORMAT_R8G8B8A8_USCALED:
@@ -66,33 +44,69 @@ namespace jjyou {
 			case VK_FORMAT_B8G8R8A8_UINT:
 			case VK_FORMAT_B8G8R8A8_SINT:
 			case VK_FORMAT_B8G8R8A8_SRGB:
-				elementSize = 4;
-				break;
+				return 4;
 			case VK_FORMAT_R32_UINT:
 			case VK_FORMAT_R32_SINT:
 			case VK_FORMAT_R32_SFLOAT:
-				elementSize = 4;
-				break;
+			case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+			case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+				return 4;
+			case VK_FORMAT_R16G16B16A16_SFLOAT:
+				return 8;
 			case VK_FORMAT_R32G32_UINT:
 			case VK_FORMAT_R32G32_SINT:
 			case VK_FORMAT_R32G32_SFLOAT:
-				elementSize = 8;
-				break;
+				return 8;
 			case VK_FORMAT_R32G32B32_UINT:
 			case VK_FORMAT_R32G32B32_SINT:
 			case VK_FORMAT_R32G32B32_SFLOAT:
-				elementSize = 12;
-				break;
+				return 12;
 			case VK_FORMAT_R32G32B32A32_UINT:
 			case VK_FORMAT_R32G32B32A32_SINT:
 			case VK_FORMAT_R32G32B32A32_SFLOAT:
-				elementSize = 16;
-				break;
+				return 16;
 			default:
 				JJYOU_VK_UTILS_THROW(VK_ERROR_FORMAT_NOT_SUPPORTED);
 			}
+			return 0;
+		}
+
+		bool Texture2D::supportsMipmapBlits(const Context& context, VkFormat format) {
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(*context.physicalDevice(), format, &formatProperties);
+			VkFormatFeatureFlags features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			return (formatProperties.optimalTilingFeatures & features) == features;
+		}
+
+		VkDeviceSize Texture2D::_levelSize(VkFormat format, VkExtent2D extent) {
+			// Block-compressed formats store 4x4 texel blocks.
+			VkDeviceSize numBlocks = VkDeviceSize((extent.width + 3) / 4) * ((extent.height + 3) / 4);
+			switch (format) {
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+			case VK_FORMAT_BC4_SNORM_BLOCK:
+				return numBlocks * 8;
+			case VK_FORMAT_BC2_UNORM_BLOCK:
+			case VK_FORMAT_BC2_SRGB_BLOCK:
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+			case VK_FORMAT_BC5_SNORM_BLOCK:
+			case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+			case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				return numBlocks * 16;
+			default:
+				return Texture2D::_elementSize(format) * extent.width * extent.height;
+			}
+		}
+
+		void Texture2D::_createImage(bool cubeMap) {
 			std::uint32_t transferQueueFamily = *this->_pContext->queueFamilyIndex(jjyou::vk::Context::QueueType::Transfer);
-			std::uint32_t graphicsQueueFamily = *this->_pContext->queueFamilyIndex(jjyou::vk::Context::QueueType::Main);
 			// Create the image
 			VkImageCreateInfo imageInfo{
 				.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -109,7 +123,7 @@ namespace jjyou {
 				.arrayLayers = this->_numLayers,
 				.samples = VK_SAMPLE_COUNT_1_BIT,
 				.tiling = VK_IMAGE_TILING_OPTIMAL,
-				.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 				.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
 				.queueFamilyIndexCount = 1U,
 				.pQueueFamilyIndices = &transferQueueFamily,
@@ -126,6 +140,79 @@ namespace jjyou {
 			};
 			JJYOU_VK_UTILS_CHECK(this->_pAllocator->allocate(&imageMemoryAllocInfo, this->_imageMemory));
 			vkBindImageMemory(*this->_pContext->device(), this->_image, this->_imageMemory.memory(), this->_imageMemory.offset());
+		}
+
+		void Texture2D::_createImageViewAndSampler(bool cubeMap, VkSamplerAddressMode addressMode) {
+			// Create the image view
+			VkImageViewCreateInfo viewInfo{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+				.pNext = nullptr,
+				.image = this->_image,
+				.viewType = (cubeMap ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D),
+				.format = this->_format,
+				.components = {
+					.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+					.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+					.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+					.a = VK_COMPONENT_SWIZZLE_IDENTITY
+				},
+				.subresourceRange = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.baseMipLevel = 0,
+					.levelCount = this->_mipLevels,
+					.baseArrayLayer = 0,
+					.layerCount = this->_numLayers
+				}
+			};
+			JJYOU_VK_UTILS_CHECK(vkCreateImageView(*this->_pContext->device(), &viewInfo, nullptr, &this->_imageView));
+			// Create the sampler
+			VkSamplerCreateInfo samplerInfo{
+				.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+				.pNext = nullptr,
+				.flags = 0,
+				.magFilter = VK_FILTER_LINEAR,
+				.minFilter = VK_FILTER_LINEAR,
+				.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+				.addressModeU = addressMode,
+				.addressModeV = addressMode,
+				.addressModeW = addressMode,
+				.mipLodBias = 0.0f,
+				.anisotropyEnable = VK_TRUE,
+				.maxAnisotropy = this->_pContext->physicalDevice().getProperties().limits.maxSamplerAnisotropy,
+				.compareEnable = VK_FALSE,
+				.compareOp = VK_COMPARE_OP_ALWAYS,
+				.minLod = 0.0f,
+				.maxLod = VK_LOD_CLAMP_NONE,
+				.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+				.unnormalizedCoordinates = VK_FALSE,
+			};
+			JJYOU_VK_UTILS_CHECK(vkCreateSampler(*this->_pContext->device(), &samplerInfo, nullptr, &this->_sampler));
+		}
+
+		void Texture2D::create(
+			const Context& context,
+			MemoryAllocator& allocator,
+			VkCommandPool graphicsCommandPool,
+			VkCommandPool transferCommandPool,
+			const void* data,
+			VkFormat format,
+			VkExtent2D extent,
+			int mipLevels,
+			const std::vector<void*>& mipData,
+			bool cubeMap,
+			VkSamplerAddressMode addressMode
+		) {
+			this->_pContext = &context;
+			this->_pAllocator = &allocator;
+			this->_extent = extent;
+			this->_numLayers = (cubeMap ? 6 : 1);
+			this->_mipLevels = mipLevels;
+			this->_format = format;
+			if (mipData.size() != this->_mipLevels - 1U)
+				JJYOU_VK_UTILS_THROW(VK_ERROR_FORMAT_NOT_SUPPORTED);
+			std::uint32_t transferQueueFamily = *this->_pContext->queueFamilyIndex(jjyou::vk::Context::QueueType::Transfer);
+			std::uint32_t graphicsQueueFamily = *this->_pContext->queueFamilyIndex(jjyou::vk::Context::QueueType::Main);
+			this->_createImage(cubeMap);
 			// Create and begin transfer command buffer
 			VkCommandBuffer transferCommandBuffer, graphicsCommandBuffer;
 			// Transfer image layout
@@ -158,7 +245,7 @@ namespace jjyou {
 			);
 			Texture2D::_endCommandBuffer(*this->_pContext->device(), transferCommandPool, transferCommandBuffer, **this->_pContext->queue(Context::QueueType::Transfer), nullptr, nullptr);
 			// Create a stagine buffer.
-			const VkDeviceSize maxBufferSize = elementSize * extent.width * extent.height * this->_numLayers;
+			const VkDeviceSize maxBufferSize = Texture2D::_levelSize(this->_format, extent) * this->_numLayers;
 			VkBuffer stagingBuffer = nullptr;
 			Memory stagingBufferMemory{};
 			VkBufferCreateInfo bufferInfo{
@@ -187,7 +274,7 @@ namespace jjyou {
 			VkExtent2D levelExtent = this->_extent;
 			for (std::uint32_t m = 0; m < this->_mipLevels; ++m) {
 				// Copy data to staging buffer
-				const VkDeviceSize bufferSize = elementSize * levelExtent.width * levelExtent.height * this->_numLayers;
+				const VkDeviceSize bufferSize = Texture2D::_levelSize(this->_format, levelExtent) * this->_numLayers;
 				if (m == 0U)
 					std::memcpy(stagingBufferMemory.mappedAddress(), data, bufferSize);
 				else
@@ -313,50 +400,46 @@ namespace jjyou {
 				);
 				Texture2D::_endCommandBuffer(*this->_pContext->device(), transferCommandPool, transferCommandBuffer, **this->_pContext->queue(Context::QueueType::Transfer), nullptr, nullptr);
 			}
-			// Create the image view
-			VkImageViewCreateInfo viewInfo{
-				.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-				.pNext = nullptr,
-				.image = this->_image,
-				.viewType = (cubeMap ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D),
-				.format = this->_format,
-				.components = {
-					.r = VK_COMPONENT_SWIZZLE_IDENTITY,
-					.g = VK_COMPONENT_SWIZZLE_IDENTITY,
-					.b = VK_COMPONENT_SWIZZLE_IDENTITY,
-					.a = VK_COMPONENT_SWIZZLE_IDENTITY
-				},
-				.subresourceRange = {
-					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-					.baseMipLevel = 0,
-					.levelCount = this->_mipLevels,
-					.baseArrayLayer = 0,
-					.layerCount = this->_numLayers
-				}
-			};
-			JJYOU_VK_UTILS_CHECK(vkCreateImageView(*this->_pContext->device(), &viewInfo, nullptr, &this->_imageView));
-			// Create the sampler
-			VkSamplerCreateInfo samplerInfo{
-				.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-				.pNext = nullptr,
-				.flags = 0,
-				.magFilter = VK_FILTER_LINEAR,
-				.minFilter = VK_FILTER_LINEAR,
-				.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
-				.addressModeU = addressMode,
-				.addressModeV = addressMode,
-				.addressModeW = addressMode,
-				.mipLodBias = 0.0f,
-				.anisotropyEnable = VK_TRUE,
-				.maxAnisotropy = this->_pContext->physicalDevice().getProperties().limits.maxSamplerAnisotropy,
-				.compareEnable = VK_FALSE,
-				.compareOp = VK_COMPARE_OP_ALWAYS,
-				.minLod = 0.0f,
-				.maxLod = VK_LOD_CLAMP_NONE,
-				.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
-				.unnormalizedCoordinates = VK_FALSE,
-			};
-			JJYOU_VK_UTILS_CHECK(vkCreateSampler(*this->_pContext->device(), &samplerInfo, nullptr, &this->_sampler));
+			this->_createImageViewAndSampler(cubeMap, addressMode);
+		}
+
+		void Texture2D::create(
+			const Context& context,
+			MemoryAllocator& allocator,
+			UploadBatch& uploadBatch,
+			const void* data,
+			VkFormat format,
+			VkExtent2D extent,
+			int mipLevels,
+			const std::vector<void*>& mipData,
+			bool cubeMap,
+			VkSamplerAddressMode addressMode
+		) {
+			this->_pContext = &context;
+			this->_pAllocator = &allocator;
+			this->_extent = extent;
+			this->_numLayers = (cubeMap ? 6 : 1);
+			this->_mipLevels = mipLevels;
+			this->_format = format;
+			if (mipData.size() > this->_mipLevels - 1U)
+				JJYOU_VK_UTILS_THROW(VK_ERROR_FORMAT_NOT_SUPPORTED);
+			this->_createImage(cubeMap);
+			// Record the copies into the batch. The data is copied into staging memory immediately,
+			// so the caller may free it as soon as this function returns.
+			// Levels without data are generated from the last uploaded one.
+			std::uint32_t numUploadedLevels = static_cast<std::uint32_t>(mipData.size()) + 1U;
+			std::vector<std::pair<const void*, VkDeviceSize>> levels; levels.reserve(numUploadedLevels);
+			VkExtent2D levelExtent = this->_extent;
+			for (std::uint32_t m = 0; m < numUploadedLevels; ++m) {
+				levels.emplace_back(
+					(m == 0U) ? data : mipData[m - 1U],
+					Texture2D::_levelSize(this->_format, levelExtent) * this->_numLayers
+				);
+				levelExtent.width = std::max(levelExtent.width / 2U, 1U);
+				levelExtent.height = std::max(levelExtent.height / 2U, 1U);
+			}
+			uploadBatch.uploadImage(this->_image, this->_extent, this->_numLayers, levels, this->_mipLevels);
+			this->_createImageViewAndSampler(cubeMap, addressMode);
 		}
 
 	}
@@ -10,6 +10,8 @@
 #include <jjyou/vk/Legacy/Memory.hpp>
 #include "utils.hpp"
 
+class UploadBatch;
+
 namespace jjyou {
 
 	namespace vk {
@@ -65,6 +67,28 @@ namespace jjyou {
 				VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT
 			);
 
+			/** @brief	Create a texture whose upload is recorded into an upload batch.
+			  *			The texture can only be sampled after the batch is finished.
+			  *			If `mipData` has fewer than `mipLevels - 1` entries, the remaining levels
+			  *			are generated on the GPU, which requires `supportsMipmapBlits(context, format)`.
+			  */
+			void create(
+				const Context& context,
+				MemoryAllocator& allocator,
+				UploadBatch& uploadBatch,
+				const void* data,
+				VkFormat format,
+				VkExtent2D extent,
+				int mipLevels = 1,
+				const std::vector<void*>& mipData = {},
+				bool cubeMap = false,
+				VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT
+			);
+
+			/** @brief	Check whether mip levels of `format` can be generated by linear blits.
+			  */
+			static bool supportsMipmapBlits(const Context& context, VkFormat format);
+
 			/** @brief	Call the corresponding vkDestroyXXX function to destroy the wrapped instance.
 			  */
 			void destroy(void) {
@@ -131,6 +155,10 @@ namespace jjyou {
 			Memory _imageMemory{};
 			VkImageView _imageView = nullptr;
 			VkSampler _sampler = nullptr;
+			static VkDeviceSize _elementSize(VkFormat format);
+			static VkDeviceSize _levelSize(VkFormat format, VkExtent2D extent);
+			void _createImage(bool cubeMap);
+			void _createImageViewAndSampler(bool cubeMap, VkSamplerAddressMode addressMode);
 			static VkCommandBuffer _beginCommandBuffer(VkDevice device, VkCommandPool commandPool) {
 				VkCommandBuffer commandBuffer;
 				VkCommandBufferAllocateInfo commandBufferAllocInfo{
@@ -52,6 +52,82 @@ void TinyArgParser::parseArgs(int argc, char* argv[]) {
 		else if (std::strcmp(argv[i], "--enable-validation") == 0) {
 			this->enableValidation = true;
 		}
+		else if (std::strcmp(argv[i], "--load-threads") == 0) {
+			if (i == argc - 1)
+				throw std::runtime_error("Please specify the number of loading threads using \"--load-threads N\".");
+			this->loadThreads = std::stoi(argv[i + 1]);
+			if (this->loadThreads < 0)
+				throw std::runtime_error("The number of loading threads must be non-negative.");
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--job-threads") == 0) {
+			if (i == argc - 1)
+				throw std::runtime_error("Please specify the number of frame job threads using \"--job-threads N\".");
+			this->jobThreads = std::stoi(argv[i + 1]);
+			if (this->jobThreads < 0)
+				throw std::runtime_error("The number of frame job threads must be non-negative.");
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--bake-animation") == 0) {
+			if (i == argc - 1)
+				throw std::runtime_error("Please specify the animation sample rate using \"--bake-animation RATE\".");
+			this->bakeAnimation = std::stof(argv[i + 1]);
+			if (!(*this->bakeAnimation > 0.0f))
+				throw std::runtime_error("The animation sample rate must be positive.");
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--quantize-animation") == 0) {
+			this->quantizeAnimation = true;
+		}
+		else if (std::strcmp(argv[i], "--compact-vertices") == 0) {
+			this->compactVertices = true;
+		}
+		else if (std::strcmp(argv[i], "--texture-compression") == 0) {
+			if (i == argc - 1)
+				throw std::runtime_error("Please specify the texture compression using \"--texture-compression none|bc1|bc7\".");
+			if (std::strcmp(argv[i + 1], "none") == 0)
+				this->textureCompression = Engine::TextureCompression::NONE;
+			else if (std::strcmp(argv[i + 1], "bc1") == 0)
+				this->textureCompression = Engine::TextureCompression::BC1;
+			else if (std::strcmp(argv[i + 1], "bc7") == 0)
+				this->textureCompression = Engine::TextureCompression::BC7;
+			else
+				throw std::runtime_error("Unsupported texture compression.");
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--environment-format") == 0) {
+			if (i == argc - 1)
+				throw std::runtime_error("Please specify the environment format using \"--environment-format rgba32f|rgba16f|b10g11r11|e5b9g9r9\".");
+			if (std::strcmp(argv[i + 1], "rgba32f") == 0)
+				this->environmentFormat = HDRFormat::RGBA32F;
+			else if (std::strcmp(argv[i + 1], "rgba16f") == 0)
+				this->environmentFormat = HDRFormat::RGBA16F;
+			else if (std::strcmp(argv[i + 1], "b10g11r11") == 0)
+				this->environmentFormat = HDRFormat::B10G11R11;
+			else if (std::strcmp(argv[i + 1], "e5b9g9r9") == 0)
+				this->environmentFormat = HDRFormat::E5B9G9R9;
+			else
+				throw std::runtime_error("Unsupported environment format.");
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--profile-load") == 0) {
+			if (i == argc - 1)
+				throw std::runtime_error("Please specify the load report file using \"--profile-load \\path\\to\\report.json\".");
+			this->profileLoad = argv[i + 1];
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--streaming-parser") == 0) {
+			this->streamingParser = true;
+		}
+		else if (std::strcmp(argv[i], "--progressive-load") == 0) {
+			this->progressiveLoad = true;
+		}
+		else if (std::strcmp(argv[i], "--next-scene") == 0) {
+			if (i == argc - 1)
+				throw std::runtime_error("Please specify the next scene file using \"--next-scene \\path\\to\\scene_file\".");
+			this->nextScenes.push_back(argv[i + 1]);
+			++i;
+		}
 	}
 	if (this->listPhysicalDevices == true)
 		return;
@@ -5,6 +5,7 @@
 #include <array>
 #include <filesystem>
 #include <optional>
+#include <vector>
 
 #include "Engine.hpp"
 
@@ -32,4 +33,15 @@ public:
 
 	// Additional arguments.
 	bool enableValidation = false;
+	int loadThreads = 0;
+	int jobThreads = 0; // Threads for the animation and transform update of each frame. 0 means all hardware threads.
+	bool compactVertices = false;
+	Engine::TextureCompression textureCompression = Engine::TextureCompression::NONE;
+	HDRFormat environmentFormat = HDRFormat::E5B9G9R9;
+	std::optional<std::filesystem::path> profileLoad = std::nullopt; // Where to write the JSON load report.
+	bool streamingParser = false; // Read .s72 files object by object instead of parsing them into a JSON document.
+	bool progressiveLoad = false; // Start rendering before meshes and material images are loaded.
+	std::vector<std::filesystem::path> nextScenes{}; // Preloaded in the background and switched to in turn with the N key.
+	std::optional<float> bakeAnimation = std::nullopt; // Samples per second of the pre-sampled animation.
+	bool quantizeAnimation = false; // Store the pre-sampled animation as 16-bit values.
 };
\ No newline at end of file
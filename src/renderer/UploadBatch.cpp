@@ -0,0 +1,524 @@
+#include "UploadBatch.hpp"
+
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <tuple>
+
+UploadBatch::UploadBatch(
+	const jjyou::vk::Context& context,
+	jjyou::vk::MemoryAllocator& allocator,
+	VkCommandPool graphicsCommandPool,
+	VkCommandPool transferCommandPool,
+	std::mutex* queueMutex,
+	VkDeviceSize capacity
+) :
+	_pContext(&context),
+	_pAllocator(&allocator),
+	_graphicsCommandPool(graphicsCommandPool),
+	_transferCommandPool(transferCommandPool),
+	_queueMutex(queueMutex),
+	_graphicsQueueFamily(*context.queueFamilyIndex(jjyou::vk::Context::QueueType::Main)),
+	_transferQueueFamily(*context.queueFamilyIndex(jjyou::vk::Context::QueueType::Transfer)),
+	_capacity(capacity)
+{
+	std::tie(this->_ringBuffer, this->_ringMemory) = this->_createStagingBuffer(this->_capacity);
+}
+
+UploadBatch::~UploadBatch(void) {
+	if (this->_pContext == nullptr)
+		return;
+	this->discard();
+	this->_pAllocator->unmap(this->_ringMemory);
+	this->_pAllocator->free(this->_ringMemory);
+	vkDestroyBuffer(*this->_pContext->device(), this->_ringBuffer, nullptr);
+	this->_pContext = nullptr;
+}
+
+void* UploadBatch::stageBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size) {
+	Staging staging = this->_allocate(size);
+	this->_begin();
+	VkBufferCopy copyRegion{
+		.srcOffset = staging.offset,
+		.dstOffset = dstOffset,
+		.size = size
+	};
+	vkCmdCopyBuffer(this->_recording.transferCommandBuffer, staging.buffer, dstBuffer, 1, &copyRegion);
+	return staging.address;
+}
+
+void UploadBatch::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+	std::memcpy(this->stageBuffer(dstBuffer, dstOffset, size), data, size);
+}
+
+void UploadBatch::uploadImage(
+	VkImage image,
+	VkExtent2D extent,
+	std::uint32_t numLayers,
+	const std::vector<std::pair<const void*, VkDeviceSize>>& levels,
+	std::uint32_t mipLevels
+) {
+	std::uint32_t numUploadedLevels = static_cast<std::uint32_t>(levels.size());
+	mipLevels = std::max(mipLevels, numUploadedLevels);
+	bool generateMipmaps = (mipLevels > numUploadedLevels);
+	VkImageSubresourceRange subresourceRange{
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.baseMipLevel = 0,
+		.levelCount = mipLevels,
+		.baseArrayLayer = 0,
+		.layerCount = numLayers
+	};
+	// Transfer image layout
+	this->_begin();
+	VkImageMemoryBarrier imageMemoryBarrier1{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = subresourceRange
+	};
+	vkCmdPipelineBarrier(
+		this->_recording.transferCommandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0, nullptr,
+		0, nullptr,
+		1, &imageMemoryBarrier1
+	);
+	// Copy data to image.
+	// If the ring fills up in the middle, the remaining levels go to the next submission
+	// on the same queue, which keeps the image layout.
+	VkExtent2D levelExtent = extent;
+	for (std::uint32_t m = 0; m < numUploadedLevels; ++m) {
+		Staging staging = this->_allocate(levels[m].second);
+		std::memcpy(staging.address, levels[m].first, levels[m].second);
+		this->_begin();
+		VkBufferImageCopy copyRegion{
+			.bufferOffset = staging.offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = m,
+				.baseArrayLayer = 0,
+				.layerCount = numLayers,
+			},
+			.imageOffset = {
+				.x = 0,
+				.y = 0,
+				.z = 0
+			},
+			.imageExtent = {
+				.width = levelExtent.width,
+				.height = levelExtent.height,
+				.depth = 1
+			}
+		};
+		vkCmdCopyBufferToImage(this->_recording.transferCommandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+		levelExtent.width = std::max(levelExtent.width / 2U, 1U);
+		levelExtent.height = std::max(levelExtent.height / 2U, 1U);
+	}
+	// Generated levels are blitted on the main queue at submission. The image stays in
+	// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL until then; waiting on the semaphore of the
+	// submission makes the copies visible to the blits.
+	if (generateMipmaps) {
+		this->_mipmapJobs.push_back(MipmapJob{
+			.image = image,
+			.extent = extent,
+			.numLayers = numLayers,
+			.firstLevel = numUploadedLevels,
+			.mipLevels = mipLevels
+		});
+		if (this->_transferQueueFamily == this->_graphicsQueueFamily)
+			return;
+	}
+	// Transfer image layout.
+	// If the queue families differ, release the ownership here and acquire it on the main queue at submission.
+	VkImageMemoryBarrier imageMemoryBarrier2{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_NONE,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.srcQueueFamilyIndex = this->_transferQueueFamily,
+		.dstQueueFamilyIndex = this->_graphicsQueueFamily,
+		.image = image,
+		.subresourceRange = subresourceRange
+	};
+	if (generateMipmaps)
+		imageMemoryBarrier2.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	if (this->_transferQueueFamily == this->_graphicsQueueFamily) {
+		imageMemoryBarrier2.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier2.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	}
+	vkCmdPipelineBarrier(
+		this->_recording.transferCommandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0,
+		0, nullptr,
+		0, nullptr,
+		1, &imageMemoryBarrier2
+	);
+	if (this->_transferQueueFamily != this->_graphicsQueueFamily) {
+		VkImageMemoryBarrier imageMemoryBarrier3 = imageMemoryBarrier2;
+		imageMemoryBarrier3.srcAccessMask = VK_ACCESS_NONE;
+		imageMemoryBarrier3.dstAccessMask = generateMipmaps ? (VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT) : VK_ACCESS_SHADER_READ_BIT;
+		this->_acquireBarriers.push_back(imageMemoryBarrier3);
+	}
+}
+
+void UploadBatch::submit(void) {
+	if (this->_recording.transferCommandBuffer == nullptr)
+		return;
+	VkDevice device = *this->_pContext->device();
+	JJYOU_VK_UTILS_CHECK(vkEndCommandBuffer(this->_recording.transferCommandBuffer));
+	VkFenceCreateInfo fenceInfo{
+		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0
+	};
+	JJYOU_VK_UTILS_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &this->_recording.fence));
+	std::unique_lock<std::mutex> queueLock;
+	if (this->_queueMutex != nullptr)
+		queueLock = std::unique_lock<std::mutex>(*this->_queueMutex);
+	if (this->_acquireBarriers.empty() && this->_mipmapJobs.empty()) {
+		VkSubmitInfo submitInfo{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.pNext = nullptr,
+			.waitSemaphoreCount = 0U,
+			.pWaitSemaphores = nullptr,
+			.pWaitDstStageMask = nullptr,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &this->_recording.transferCommandBuffer,
+			.signalSemaphoreCount = 0U,
+			.pSignalSemaphores = nullptr
+		};
+		JJYOU_VK_UTILS_CHECK(vkQueueSubmit(**this->_pContext->queue(jjyou::vk::Context::QueueType::Transfer), 1, &submitInfo, this->_recording.fence));
+	}
+	else {
+		// Acquire the ownership of the uploaded images on the main queue, and generate mip levels.
+		VkCommandBufferAllocateInfo commandBufferAllocInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = this->_graphicsCommandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+		JJYOU_VK_UTILS_CHECK(vkAllocateCommandBuffers(device, &commandBufferAllocInfo, &this->_recording.graphicsCommandBuffer));
+		VkCommandBufferBeginInfo beginInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.pNext = nullptr,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+			.pInheritanceInfo = nullptr
+		};
+		JJYOU_VK_UTILS_CHECK(vkBeginCommandBuffer(this->_recording.graphicsCommandBuffer, &beginInfo));
+		if (!this->_acquireBarriers.empty())
+			vkCmdPipelineBarrier(
+				this->_recording.graphicsCommandBuffer,
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				static_cast<std::uint32_t>(this->_acquireBarriers.size()), this->_acquireBarriers.data()
+			);
+		for (const MipmapJob& job : this->_mipmapJobs)
+			UploadBatch::_generateMipmaps(this->_recording.graphicsCommandBuffer, job);
+		JJYOU_VK_UTILS_CHECK(vkEndCommandBuffer(this->_recording.graphicsCommandBuffer));
+		this->_acquireBarriers.clear();
+		this->_mipmapJobs.clear();
+		VkSemaphoreCreateInfo semaphoreInfo{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0
+		};
+		JJYOU_VK_UTILS_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &this->_recording.semaphore));
+		VkSubmitInfo transferSubmitInfo{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.pNext = nullptr,
+			.waitSemaphoreCount = 0U,
+			.pWaitSemaphores = nullptr,
+			.pWaitDstStageMask = nullptr,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &this->_recording.transferCommandBuffer,
+			.signalSemaphoreCount = 1U,
+			.pSignalSemaphores = &this->_recording.semaphore
+		};
+		JJYOU_VK_UTILS_CHECK(vkQueueSubmit(**this->_pContext->queue(jjyou::vk::Context::QueueType::Transfer), 1, &transferSubmitInfo, nullptr));
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSubmitInfo graphicsSubmitInfo{
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.pNext = nullptr,
+			.waitSemaphoreCount = 1U,
+			.pWaitSemaphores = &this->_recording.semaphore,
+			.pWaitDstStageMask = &waitStage,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &this->_recording.graphicsCommandBuffer,
+			.signalSemaphoreCount = 0U,
+			.pSignalSemaphores = nullptr
+		};
+		JJYOU_VK_UTILS_CHECK(vkQueueSubmit(**this->_pContext->queue(jjyou::vk::Context::QueueType::Main), 1, &graphicsSubmitInfo, this->_recording.fence));
+	}
+	this->_inFlight.push_back(std::move(this->_recording));
+	this->_recording = Submission{};
+	++this->_numSubmits;
+}
+
+void UploadBatch::finish(void) {
+	this->submit();
+	while (!this->_inFlight.empty())
+		this->_retire();
+}
+
+void UploadBatch::discard(void) {
+	if (this->_recording.transferCommandBuffer != nullptr) {
+		vkEndCommandBuffer(this->_recording.transferCommandBuffer);
+		this->_release(this->_recording);
+	}
+	this->_acquireBarriers.clear();
+	this->_mipmapJobs.clear();
+	while (!this->_inFlight.empty())
+		this->_retire();
+	this->_head = 0;
+	this->_tail = 0;
+	this->_live = false;
+}
+
+bool UploadBatch::poll(void) {
+	while (!this->_inFlight.empty() && vkGetFenceStatus(*this->_pContext->device(), this->_inFlight.front().fence) == VK_SUCCESS)
+		this->_retire();
+	return this->_inFlight.empty();
+}
+
+std::pair<VkBuffer, jjyou::vk::Memory> UploadBatch::_createStagingBuffer(VkDeviceSize size) const {
+	VkBufferCreateInfo bufferInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.size = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 1U,
+		.pQueueFamilyIndices = &this->_transferQueueFamily
+	};
+	VkBuffer buffer = nullptr;
+	JJYOU_VK_UTILS_CHECK(vkCreateBuffer(*this->_pContext->device(), &bufferInfo, nullptr, &buffer));
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(*this->_pContext->device(), buffer, &memRequirements);
+	VkMemoryAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.allocationSize = memRequirements.size,
+		.memoryTypeIndex = this->_pContext->findMemoryType(memRequirements.memoryTypeBits, ::vk::MemoryPropertyFlagBits::eHostVisible | ::vk::MemoryPropertyFlagBits::eHostCoherent).value()
+	};
+	jjyou::vk::Memory memory;
+	JJYOU_VK_UTILS_CHECK(this->_pAllocator->allocate(&allocInfo, memory));
+	vkBindBufferMemory(*this->_pContext->device(), buffer, memory.memory(), memory.offset());
+	JJYOU_VK_UTILS_CHECK(this->_pAllocator->map(memory));
+	return std::make_pair(buffer, std::move(memory));
+}
+
+UploadBatch::Staging UploadBatch::_allocate(VkDeviceSize size) {
+	this->_numBytes += size;
+	// Data larger than the whole ring gets its own staging buffer,
+	// which is freed together with the submission.
+	if (size > this->_capacity) {
+		this->_begin();
+		this->_recording.dedicatedBuffers.push_back(this->_createStagingBuffer(size));
+		auto& [buffer, memory] = this->_recording.dedicatedBuffers.back();
+		return Staging{ .buffer = buffer, .offset = 0, .address = memory.mappedAddress() };
+	}
+	std::optional<VkDeviceSize> offset;
+	while (!(offset = this->_tryAllocateRing(size)).has_value()) {
+		// The ring is full. Wait for the oldest submission to free its space,
+		// or submit the commands recorded so far if nothing is in flight.
+		if (!this->_inFlight.empty())
+			this->_retire();
+		else
+			this->submit();
+	}
+	if (!this->_live) {
+		this->_tail = *offset;
+		this->_live = true;
+	}
+	if (!this->_recording.ringBegin.has_value())
+		this->_recording.ringBegin = *offset;
+	this->_head = *offset + size;
+	return Staging{
+		.buffer = this->_ringBuffer,
+		.offset = *offset,
+		.address = reinterpret_cast<char*>(this->_ringMemory.mappedAddress()) + *offset
+	};
+}
+
+std::optional<VkDeviceSize> UploadBatch::_tryAllocateRing(VkDeviceSize size) const {
+	if (!this->_live)
+		return VkDeviceSize(0);
+	VkDeviceSize alignedHead = (this->_head + UploadBatch::_ALIGNMENT - 1) / UploadBatch::_ALIGNMENT * UploadBatch::_ALIGNMENT;
+	if (this->_head > this->_tail) {
+		// Free space is [head, capacity) and [0, tail).
+		if (alignedHead + size <= this->_capacity)
+			return alignedHead;
+		if (size <= this->_tail)
+			return VkDeviceSize(0);
+	}
+	else if (this->_head < this->_tail) {
+		// Free space is [head, tail).
+		if (alignedHead + size <= this->_tail)
+			return alignedHead;
+	}
+	return std::nullopt;
+}
+
+void UploadBatch::_begin(void) {
+	if (this->_recording.transferCommandBuffer != nullptr)
+		return;
+	VkCommandBufferAllocateInfo commandBufferAllocInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = this->_transferCommandPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	};
+	JJYOU_VK_UTILS_CHECK(vkAllocateCommandBuffers(*this->_pContext->device(), &commandBufferAllocInfo, &this->_recording.transferCommandBuffer));
+	VkCommandBufferBeginInfo beginInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr
+	};
+	JJYOU_VK_UTILS_CHECK(vkBeginCommandBuffer(this->_recording.transferCommandBuffer, &beginInfo));
+}
+
+void UploadBatch::_generateMipmaps(VkCommandBuffer commandBuffer, const MipmapJob& job) {
+	VkImageMemoryBarrier barrier{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = job.image,
+		.subresourceRange{
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = job.numLayers
+		}
+	};
+	// Each generated level is blitted from the previous one, which then becomes a transfer source.
+	auto levelExtent = [&job](std::uint32_t level) {
+		return VkOffset3D{
+			.x = static_cast<std::int32_t>(std::max(job.extent.width >> level, 1U)),
+			.y = static_cast<std::int32_t>(std::max(job.extent.height >> level, 1U)),
+			.z = 1
+		};
+	};
+	for (std::uint32_t m = job.firstLevel; m < job.mipLevels; ++m) {
+		barrier.subresourceRange.baseMipLevel = m - 1U;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+		VkImageBlit blit{
+			.srcSubresource{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = m - 1U,
+				.baseArrayLayer = 0,
+				.layerCount = job.numLayers
+			},
+			.srcOffsets = { { 0, 0, 0 }, levelExtent(m - 1U) },
+			.dstSubresource{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = m,
+				.baseArrayLayer = 0,
+				.layerCount = job.numLayers
+			},
+			.dstOffsets = { { 0, 0, 0 }, levelExtent(m) }
+		};
+		vkCmdBlitImage(
+			commandBuffer,
+			job.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			job.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit,
+			VK_FILTER_LINEAR
+		);
+	}
+	// Levels [0, firstLevel - 1) and the last level are still transfer destinations,
+	// the levels in between are transfer sources.
+	std::vector<VkImageMemoryBarrier> barriers;
+	auto transition = [&](std::uint32_t baseLevel, std::uint32_t levelCount, VkImageLayout oldLayout, VkAccessFlags srcAccessMask) {
+		if (levelCount == 0U)
+			return;
+		barriers.push_back(barrier);
+		barriers.back().srcAccessMask = srcAccessMask;
+		barriers.back().dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers.back().oldLayout = oldLayout;
+		barriers.back().newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barriers.back().subresourceRange.baseMipLevel = baseLevel;
+		barriers.back().subresourceRange.levelCount = levelCount;
+	};
+	transition(0, job.firstLevel - 1U, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+	transition(job.firstLevel - 1U, job.mipLevels - job.firstLevel, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT);
+	transition(job.mipLevels - 1U, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		0, nullptr,
+		0, nullptr,
+		static_cast<std::uint32_t>(barriers.size()), barriers.data()
+	);
+}
+
+void UploadBatch::_retire(void) {
+	Submission& submission = this->_inFlight.front();
+	JJYOU_VK_UTILS_CHECK(vkWaitForFences(*this->_pContext->device(), 1, &submission.fence, VK_TRUE, std::numeric_limits<std::uint64_t>::max()));
+	this->_release(submission);
+	this->_inFlight.pop_front();
+	// The oldest live allocation now belongs to the next submission that uses the ring.
+	this->_live = false;
+	for (const Submission& next : this->_inFlight) {
+		if (next.ringBegin.has_value()) {
+			this->_tail = *next.ringBegin;
+			this->_live = true;
+			break;
+		}
+	}
+	if (!this->_live && this->_recording.ringBegin.has_value()) {
+		this->_tail = *this->_recording.ringBegin;
+		this->_live = true;
+	}
+	if (!this->_live) {
+		this->_head = 0;
+		this->_tail = 0;
+	}
+}
+
+void UploadBatch::_release(Submission& submission) {
+	VkDevice device = *this->_pContext->device();
+	if (submission.transferCommandBuffer != nullptr)
+		vkFreeCommandBuffers(device, this->_transferCommandPool, 1, &submission.transferCommandBuffer);
+	if (submission.graphicsCommandBuffer != nullptr)
+		vkFreeCommandBuffers(device, this->_graphicsCommandPool, 1, &submission.graphicsCommandBuffer);
+	if (submission.semaphore != nullptr)
+		vkDestroySemaphore(device, submission.semaphore, nullptr);
+	if (submission.fence != nullptr)
+		vkDestroyFence(device, submission.fence, nullptr);
+	for (auto& [buffer, memory] : submission.dedicatedBuffers) {
+		this->_pAllocator->unmap(memory);
+		this->_pAllocator->free(memory);
+		vkDestroyBuffer(device, buffer, nullptr);
+	}
+	submission = Submission{};
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "fwd.hpp"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <jjyou/vk/Vulkan.hpp>
+#include <jjyou/vk/Legacy/Memory.hpp>
+#include "utils.hpp"
+
+// Batched staging uploads.
+// All data is written into one persistently-mapped staging ring buffer. Buffer copies,
+// image copies and layout transitions are recorded into one transfer command buffer, which
+// is only submitted when the ring runs out of space or when `finish` is called.
+// Each submission is tracked with a single fence.
+class UploadBatch {
+
+public:
+
+	static constexpr inline VkDeviceSize DEFAULT_CAPACITY = VkDeviceSize(64) << 20;
+
+	/** @brief	Construct an upload batch in invalid state.
+	  */
+	UploadBatch(std::nullptr_t) {}
+
+	/** @brief	Create the staging ring buffer.
+	  *			If `queueMutex` is given, it is held around every queue submission,
+	  *			so that batches can be submitted from a thread other than the render loop.
+	  */
+	UploadBatch(
+		const jjyou::vk::Context& context,
+		jjyou::vk::MemoryAllocator& allocator,
+		VkCommandPool graphicsCommandPool,
+		VkCommandPool transferCommandPool,
+		std::mutex* queueMutex = nullptr,
+		VkDeviceSize capacity = UploadBatch::DEFAULT_CAPACITY
+	);
+
+	UploadBatch(const UploadBatch&) = delete;
+
+	UploadBatch& operator=(const UploadBatch&) = delete;
+
+	/** @brief	Wait for all submitted uploads and destroy the staging ring.
+	  *			Commands that have not been submitted are discarded.
+	  */
+	~UploadBatch(void);
+
+	/** @brief	Reserve staging memory for a buffer copy.
+	  *	@return	The mapped staging address. The caller must fill `size` bytes
+	  *			before the next call to any other member function.
+	  */
+	void* stageBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+
+	/** @brief	Copy `size` bytes from `data` into `dstBuffer`.
+	  */
+	void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+	/** @brief	Upload the mip levels of an image.
+	  *
+	  *			The image must be in VK_IMAGE_LAYOUT_UNDEFINED and exclusively owned by
+	  *			the transfer queue family. `levels` holds the data and the byte size of
+	  *			each mip level, including all layers. Once the batch is finished the image
+	  *			is in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and owned by the main queue family.
+	  *
+	  *			If `mipLevels` is larger than the number of uploaded levels, the remaining
+	  *			levels are generated by linear blits on the main queue. The image then needs
+	  *			VK_IMAGE_USAGE_TRANSFER_SRC_BIT and a format that supports linear blits.
+	  */
+	void uploadImage(
+		VkImage image,
+		VkExtent2D extent,
+		std::uint32_t numLayers,
+		const std::vector<std::pair<const void*, VkDeviceSize>>& levels,
+		std::uint32_t mipLevels = 0
+	);
+
+	/** @brief	Submit all recorded commands without waiting.
+	  */
+	void submit(void);
+
+	/** @brief	Submit all recorded commands and wait until every upload has completed.
+	  */
+	void finish(void);
+
+	/** @brief	Drop the commands that have not been submitted, and wait until every submitted upload has completed.
+	  *			Called before destroying the destinations of a batch whose load failed.
+	  */
+	void discard(void);
+
+	/** @brief	Release the submissions that have completed, without waiting.
+	  * @return	Whether every submitted upload has completed. Commands not submitted yet are not counted.
+	  */
+	bool poll(void);
+
+	/** @brief	Number of queue submissions so far.
+	  */
+	std::uint32_t numSubmits(void) const { return this->_numSubmits; }
+
+	/** @brief	Number of bytes copied through the staging memory so far.
+	  */
+	VkDeviceSize numBytes(void) const { return this->_numBytes; }
+
+private:
+
+	struct Staging {
+		VkBuffer buffer = nullptr;
+		VkDeviceSize offset = 0;
+		void* address = nullptr;
+	};
+
+	struct Submission {
+		VkCommandBuffer transferCommandBuffer = nullptr;
+		VkCommandBuffer graphicsCommandBuffer = nullptr;
+		VkSemaphore semaphore = nullptr;
+		VkFence fence = nullptr;
+		std::optional<VkDeviceSize> ringBegin = std::nullopt; // Offset of the first ring allocation.
+		std::vector<std::pair<VkBuffer, jjyou::vk::Memory>> dedicatedBuffers{}; // Staging buffers larger than the ring.
+	};
+
+	const jjyou::vk::Context* _pContext = nullptr;
+	jjyou::vk::MemoryAllocator* _pAllocator = nullptr;
+	VkCommandPool _graphicsCommandPool = nullptr;
+	VkCommandPool _transferCommandPool = nullptr;
+	std::mutex* _queueMutex = nullptr;
+	std::uint32_t _graphicsQueueFamily = 0;
+	std::uint32_t _transferQueueFamily = 0;
+
+	VkDeviceSize _capacity = 0;
+	VkBuffer _ringBuffer = nullptr;
+	jjyou::vk::Memory _ringMemory{};
+	VkDeviceSize _head = 0; // Next free byte.
+	VkDeviceSize _tail = 0; // First byte still in use.
+	bool _live = false; // Whether [tail, head) holds any allocation.
+
+	struct MipmapJob {
+		VkImage image = nullptr;
+		VkExtent2D extent{};
+		std::uint32_t numLayers = 0;
+		std::uint32_t firstLevel = 0; // First level to generate.
+		std::uint32_t mipLevels = 0;
+	};
+
+	Submission _recording{};
+	std::vector<VkImageMemoryBarrier> _acquireBarriers{};
+	std::vector<MipmapJob> _mipmapJobs{};
+	std::deque<Submission> _inFlight{};
+
+	std::uint32_t _numSubmits = 0;
+	VkDeviceSize _numBytes = 0;
+
+	static constexpr inline VkDeviceSize _ALIGNMENT = 16;
+
+	std::pair<VkBuffer, jjyou::vk::Memory> _createStagingBuffer(VkDeviceSize size) const;
+	Staging _allocate(VkDeviceSize size);
+	std::optional<VkDeviceSize> _tryAllocateRing(VkDeviceSize size) const;
+	void _begin(void);
+	static void _generateMipmaps(VkCommandBuffer commandBuffer, const MipmapJob& job);
+	void _retire(void);
+	void _release(Submission& submission);
+
+};
@@ -0,0 +1,66 @@
+#include "VertexFormat.hpp"
+#include "HalfFloat.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+// Round to the nearest snorm16 value.
+static std::int16_t toSnorm16(float value) {
+	return static_cast<std::int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Octahedral mapping of a direction to [-1,1]^2.
+static void octEncode(const float* direction, float& u, float& v) {
+	float l1 = std::abs(direction[0]) + std::abs(direction[1]) + std::abs(direction[2]);
+	if (l1 == 0.0f) {
+		u = v = 0.0f;
+		return;
+	}
+	float x = direction[0] / l1;
+	float y = direction[1] / l1;
+	if (direction[2] < 0.0f) {
+		float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	u = x;
+	v = y;
+}
+
+std::vector<char> MaterialVertexFormat::compact(const char* vertices, std::uint32_t numVertices) {
+	std::vector<char> compactVertices(std::size_t(numVertices) * MaterialVertexFormat::COMPACT_STRIDE);
+	for (std::uint32_t i = 0; i < numVertices; ++i) {
+		const char* src = vertices + std::size_t(i) * MaterialVertexFormat::STRIDE;
+		char* dst = compactVertices.data() + std::size_t(i) * MaterialVertexFormat::COMPACT_STRIDE;
+		float normal[3], tangent[4], texCoord[2];
+		std::memcpy(normal, src + 12, sizeof(normal));
+		std::memcpy(tangent, src + 24, sizeof(tangent));
+		std::memcpy(texCoord, src + 40, sizeof(texCoord));
+		std::int16_t octahedral[4];
+		float u, v;
+		octEncode(normal, u, v);
+		octahedral[0] = toSnorm16(u);
+		octahedral[1] = toSnorm16(v);
+		octEncode(tangent, u, v);
+		// v is remapped to [0,1] and never rounds to zero, so its sign is free to carry the handedness.
+		float handedness = (tangent[3] < 0.0f) ? -1.0f : 1.0f;
+		octahedral[2] = toSnorm16(u);
+		octahedral[3] = toSnorm16(handedness * std::max(v * 0.5f + 0.5f, 1.0f / 32767.0f));
+		std::uint16_t halfTexCoord[2] = { floatToHalf(texCoord[0]), floatToHalf(texCoord[1]) };
+		std::memcpy(dst, src, 12); // Position
+		std::memcpy(dst + 12, octahedral, sizeof(octahedral));
+		std::memcpy(dst + 20, halfTexCoord, sizeof(halfTexCoord));
+		std::memcpy(dst + 24, src + 48, 4); // Color
+	}
+	return compactVertices;
+}
+
+std::vector<char> PositionVertexFormat::extract(const char* vertices, std::uint32_t numVertices, std::uint32_t stride) {
+	std::vector<char> positions(std::size_t(numVertices) * PositionVertexFormat::STRIDE);
+	for (std::uint32_t i = 0; i < numVertices; ++i)
+		std::memcpy(positions.data() + std::size_t(i) * PositionVertexFormat::STRIDE, vertices + std::size_t(i) * stride, PositionVertexFormat::STRIDE);
+	return positions;
+}
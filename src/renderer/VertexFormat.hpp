@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Interleaved vertex layouts of material meshes.
+//
+// Full (52 bytes): float3 position, float3 normal, float4 tangent, float2 uv, rgba8 color.
+// Compact (28 bytes): float3 position, octahedral snorm16x2 normal, octahedral snorm16x2 tangent
+// with the handedness stored in the sign of its second component, half2 uv, rgba8 color.
+// Positions are kept as floats in both layouts, so shadow passes and culling read them the same way.
+class MaterialVertexFormat {
+
+public:
+
+	static constexpr inline std::uint32_t STRIDE = 52;
+	static constexpr inline std::uint32_t COMPACT_STRIDE = 28;
+
+	/** @brief	Convert `numVertices` vertices from the full layout to the compact layout.
+	  */
+	static std::vector<char> compact(const char* vertices, std::uint32_t numVertices);
+
+};
+
+// Tightly packed float3 positions, bound by the shadow passes instead of the full vertices.
+class PositionVertexFormat {
+
+public:
+
+	static constexpr inline std::uint32_t STRIDE = 12;
+
+	/** @brief	Copy the positions of `numVertices` interleaved vertices of `stride` bytes each.
+	  *			Vertices must start with a float3 position.
+	  */
+	static std::vector<char> extract(const char* vertices, std::uint32_t numVertices, std::uint32_t stride);
+
+};
@@ -8,6 +8,8 @@ class BSphere;
 class Engine;
 class EventFile;
 class HostImage;
+class JobSystem;
+class SceneStreamer;
 namespace s72 {
 	class Scene72;
 	class Object;
@@ -22,8 +24,11 @@ namespace s72 {
 	class PbrMaterial;
 	class Environment;
 	class Mesh;
+	class Light;
 	class Node;
 	class Scene;
 	class Driver;
+	class SceneGraph;
+	struct ObjectRecord;
 }
 
@@ -56,22 +56,59 @@ int main(int argc, char* argv[]) {
 		} 
 
 		// Initialize the engine.
+		// Block-compressed textures come from --texture-compression or from packed bundles.
+		bool blockCompression = (argParser.textureCompression != Engine::TextureCompression::NONE) || (argParser.scene.extension() == ".s72pack");
+		for (const std::filesystem::path& nextScene : argParser.nextScenes)
+			blockCompression = blockCompression || (nextScene.extension() == ".s72pack");
 		Engine engine(
 			argParser.physicalDevice,
 			argParser.enableValidation,
 			argParser.headless.has_value(),
 			argParser.drawingSize.has_value() ? (*argParser.drawingSize)[0] : 800,
-			argParser.drawingSize.has_value() ? (*argParser.drawingSize)[1] : 600
+			argParser.drawingSize.has_value() ? (*argParser.drawingSize)[1] : 600,
+			blockCompression,
+			argParser.jobThreads
 		);
 
 		// Load the scene.
-		std::filesystem::path sceneBasePath = argParser.scene.parent_path();
-		const jjyou::io::Json<> s72Json = jjyou::io::Json<>::parse(argParser.scene);
-		s72::Scene72::Ptr pScene72 = engine.load(
-			s72Json,
-			sceneBasePath // We need base path because the json uses relative path to reference b72 file.
-		);
-		engine.setScene(pScene72);
+		engine.setLoadThreads(argParser.loadThreads);
+		engine.setCompactVertices(argParser.compactVertices);
+		engine.setTextureCompression(argParser.textureCompression);
+		engine.setEnvironmentFormat(argParser.environmentFormat);
+		engine.setProfileLoad(argParser.profileLoad.has_value());
+		engine.setProgressiveLoad(argParser.progressiveLoad);
+		auto loadSceneFile = [&](const std::filesystem::path& scenePath) -> s72::Scene72::Ptr {
+			if (scenePath.extension() == ".s72pack") {
+				// Bundle written by s72pack.
+				return engine.loadPacked(scenePath);
+			}
+			if (argParser.streamingParser) {
+				// Objects are created while the file is read, without a JSON document of the whole scene.
+				return engine.loadStreaming(scenePath);
+			}
+			std::filesystem::path sceneBasePath = scenePath.parent_path();
+			LoadProfiler::Scope parseTimer = engine.loadProfiler.scope(LoadProfiler::Phase::ParseJson);
+			std::error_code error;
+			std::uintmax_t sceneSize = std::filesystem::file_size(scenePath, error);
+			parseTimer.addBytes(error ? 0 : sceneSize);
+			const jjyou::io::Json<> s72Json = jjyou::io::Json<>::parse(scenePath);
+			parseTimer.stop();
+			return engine.load(
+				s72Json,
+				sceneBasePath // We need base path because the json uses relative path to reference b72 file.
+			);
+		};
+		auto loadScene = [&](const std::filesystem::path& scenePath) -> s72::Scene72::Ptr {
+			s72::Scene72::Ptr scene = loadSceneFile(scenePath);
+			if (argParser.bakeAnimation.has_value())
+				engine.bakeAnimation(*scene, scenePath, *argParser.bakeAnimation, argParser.quantizeAnimation);
+			return scene;
+		};
+		engine.setScene(loadScene(argParser.scene));
+		if (argParser.profileLoad.has_value()) {
+			engine.loadProfiler.printReport(std::cout);
+			engine.loadProfiler.writeJson(*argParser.profileLoad);
+		}
 
 		// Set culling mode
 		engine.setCullingMode(argParser.culling);
@@ -85,13 +122,27 @@ int main(int argc, char* argv[]) {
 
 		// Main loop.
 		if (!argParser.headless.has_value()) {
+			// The next scene is loaded in the background while the current one is rendered.
+			std::vector<std::filesystem::path> scenes = { argParser.scene };
+			scenes.insert(scenes.end(), argParser.nextScenes.begin(), argParser.nextScenes.end());
+			std::size_t sceneIdx = 0;
+			if (scenes.size() > 1)
+				engine.preload([&, scenePath = scenes[1]]() { return loadScene(scenePath); });
 			engine.resetClockTime();
 			engine.setPlayTime(0.0f);
 			engine.setPlayRate(1.0f);
 			while (!glfwWindowShouldClose(engine.window)) {
 				engine.drawFrame();
 				glfwPollEvents();
-				
+				if (engine.nextSceneRequested && engine.preloadReady()) {
+					engine.nextSceneRequested = false;
+					engine.setScene(engine.takePreloaded());
+					sceneIdx = (sceneIdx + 1) % scenes.size();
+					engine.preload([&, scenePath = scenes[(sceneIdx + 1) % scenes.size()]]() { return loadScene(scenePath); });
+				}
+				else if (scenes.size() == 1) {
+					engine.nextSceneRequested = false;
+				}
 			}
 		}
 		else {
@@ -130,8 +181,13 @@ int main(int argc, char* argv[]) {
 				}
 			}
 		}
-		engine.destroy(*pScene72);
-		pScene72 = nullptr;
+		// Earlier scenes have been destroyed by the engine when they were replaced.
+		// A preload still running uses `loadScene`, so it is finished here.
+		if (engine.preloadFuture.valid()) {
+			s72::Scene72::Ptr pPreloaded = engine.takePreloaded();
+			engine.destroy(*pPreloaded);
+		}
+		engine.destroy(*engine.pScene72);
 	}
 	catch (const std::exception& e) {
 		std::cerr << "Exception: " << e.what() << std::endl;
@@ -8,6 +8,18 @@ layout(set = 0, binding = 0) uniform ViewLevelUniform {
 
 layout (set = 2, binding = 0) uniform sampler2D normalMapSampler;
 layout (set = 2, binding = 1) uniform sampler2D displacementMapSampler;
+layout (set = 2, binding = 2) uniform MaterialParameters {
+	vec4 normal; // In tangent space.
+	vec4 albedo;
+	float displacement;
+	float roughness;
+	float metalness;
+	uint textureMask;
+} material;
+
+// Bits of material.textureMask. The constants are used for textures that are not set.
+const uint NORMAL_MAP = 1u;
+const uint DISPLACEMENT_MAP = 2u;
 
 layout (set = 3, binding = 0) uniform SkyboxUniform {
 	mat4 model;
@@ -43,6 +55,12 @@ vec2 parallaxOcclusionMapping(vec2 uv, vec3 tangentViewDir) {
 	return mix(currUV, prevUV, nextDepth / (nextDepth - prevDepth));
 }
 
+// Where the search above ends for a constant height.
+vec2 constantParallaxMapping(vec2 uv, vec3 tangentViewDir, float height) {
+    const float heightScale = 0.05;
+    return uv - vec2(tangentViewDir.x, -tangentViewDir.y) * heightScale * height / tangentViewDir.z;
+}
+
 void main() {
     vec3 N = normalize(inNormal);
     vec3 T = normalize(inTangent.xyz);
@@ -52,11 +70,19 @@ void main() {
     mat3 TBN = mat3(T, B, N);
     vec3 viewDir = normalize(vec3(viewLevelUniform.viewPos) - inPosition);
     vec3 tangentViewDir = normalize(transpose(TBN) * viewDir);
-    vec2 texCoord = parallaxOcclusionMapping(inTexCoord, tangentViewDir);
+    vec2 texCoord = ((material.textureMask & DISPLACEMENT_MAP) != 0u) ?
+        parallaxOcclusionMapping(inTexCoord, tangentViewDir) :
+        constantParallaxMapping(inTexCoord, tangentViewDir, material.displacement);
     if (texCoord.x < 0.0 || texCoord.x > 1.0 || texCoord.y < 0.0 || texCoord.y > 1.0) {
 		discard;
 	}
-    vec3 normal = TBN * (texture(normalMapSampler, texCoord).xyz * 2.0 - 1.0);
+    vec3 tangentNormal = normalize(material.normal.xyz);
+    if ((material.textureMask & NORMAL_MAP) != 0u) {
+        // Z is reconstructed from X and Y, which is all that BC5 normal maps store.
+        vec2 normalXY = texture(normalMapSampler, texCoord).xy * 2.0 - 1.0;
+        tangentNormal = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+    }
+    vec3 normal = TBN * tangentNormal;
     vec3 envLight = textureLod(skyboxRadianceSampler, mat3(skyboxUniform.model) * normal, 0.0).rgb;
     outColor = vec4(envLight, 1.0);
 
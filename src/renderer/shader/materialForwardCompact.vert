@@ -0,0 +1,41 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform ViewLevelUniform {
+	mat4 projection;
+	mat4 view;
+	vec4 viewPos;
+} viewLevelUniform;
+
+layout(set = 1, binding = 0) uniform ObjectLevelUniform {
+	mat4 model;
+	mat4 normal;
+} objectLevelUniform;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal; // Octahedral
+layout(location = 2) in vec2 inTangent; // Octahedral, handedness in the sign of y
+layout(location = 3) in vec2 inTexCoord;
+layout(location = 4) in vec4 inColor;
+
+layout(location = 0) out vec3 outPosition; // In view space
+layout(location = 1) out vec3 outNormal; // In view space
+layout(location = 2) out vec4 outTangent; // In view space
+layout(location = 3) out vec2 outTexCoord;
+
+
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+void main() {
+	vec3 normal = octDecode(inNormal);
+	vec4 tangent = vec4(octDecode(vec2(inTangent.x, abs(inTangent.y) * 2.0 - 1.0)), inTangent.y < 0.0 ? -1.0 : 1.0);
+	outPosition = vec3(objectLevelUniform.model * vec4(inPosition, 1.0));
+	gl_Position = viewLevelUniform.projection * viewLevelUniform.view * vec4(outPosition, 1.0);
+	outNormal = normalize(mat3(objectLevelUniform.normal) * normal);
+	outTangent = vec4(normalize(mat3(objectLevelUniform.normal) * tangent.xyz), tangent.w);
+	outTexCoord = inTexCoord;
+}
\ No newline at end of file
@@ -1,10 +1,24 @@
 #version 450
 
 layout (set = 2, binding = 0) uniform sampler2D normalMapSampler;
-layout (set = 2, binding = 1) uniform sampler2D displacementMapSampler;
+layout (set = 2, binding = 1) uniform sampler2D surfaceSampler; // R: displacement, G: roughness, B: metalness
 layout (set = 2, binding = 2) uniform sampler2D albedoSampler;
-layout (set = 2, binding = 3) uniform sampler2D roughnessSampler;
-layout (set = 2, binding = 4) uniform sampler2D metalnessSampler;
+layout (set = 2, binding = 3) uniform MaterialParameters {
+	vec4 normal; // In tangent space.
+	vec4 albedo;
+	float displacement;
+	float roughness;
+	float metalness;
+	uint textureMask;
+} material;
+
+// Bits of material.textureMask. The constants are used for textures that are not set.
+// Displacement, roughness and metalness are channels of the surface texture.
+const uint NORMAL_MAP = 1u;
+const uint DISPLACEMENT_MAP = 2u;
+const uint ALBEDO_MAP = 4u;
+const uint ROUGHNESS_MAP = 8u;
+const uint METALNESS_MAP = 16u;
 
 layout(location = 0) in vec3 inPosition; // In view space
 layout(location = 1) in vec3 inNormal; // In view space
@@ -26,18 +40,24 @@ vec2 parallaxOcclusionMapping(vec2 uv, vec3 tangentViewDir) {
 	vec2 deltaUV = tangentViewDir.xy * heightScale / (tangentViewDir.z * numLayers);
     deltaUV.y = -deltaUV.y;
 	vec2 currUV = uv;
-	float height = texture(displacementMapSampler, currUV).x;
+	float height = texture(surfaceSampler, currUV).x;
 	while(height > currLayerDepth) {
 		currLayerDepth += layerDepth;
 		currUV -= deltaUV;
-		height = texture(displacementMapSampler, currUV).x;
+		height = texture(surfaceSampler, currUV).x;
 	}
 	vec2 prevUV = currUV + deltaUV;
 	float nextDepth = height - currLayerDepth;
-	float prevDepth = texture(displacementMapSampler, prevUV).x - currLayerDepth + layerDepth;
+	float prevDepth = texture(surfaceSampler, prevUV).x - currLayerDepth + layerDepth;
 	return mix(currUV, prevUV, nextDepth / (nextDepth - prevDepth));
 }
 
+// Where the search above ends for a constant height.
+vec2 constantParallaxMapping(vec2 uv, vec3 tangentViewDir, float height) {
+    const float heightScale = 0.05;
+    return uv - vec2(tangentViewDir.x, -tangentViewDir.y) * heightScale * height / tangentViewDir.z;
+}
+
 
 void main() {
 
@@ -49,12 +69,21 @@ void main() {
     mat3 TBN = mat3(T, B, N); // tangent space -> view space
     vec3 viewDir = normalize(-inPosition);
     vec3 tangentViewDir = normalize(transpose(TBN) * viewDir);
-    vec2 texCoord = parallaxOcclusionMapping(inTexCoord, tangentViewDir);
+    vec2 texCoord = ((material.textureMask & DISPLACEMENT_MAP) != 0u) ?
+        parallaxOcclusionMapping(inTexCoord, tangentViewDir) :
+        constantParallaxMapping(inTexCoord, tangentViewDir, material.displacement);
     
-    vec3 normal = normalize(TBN * (texture(normalMapSampler, texCoord).xyz * 2.0 - 1.0));
-    vec4 albedo = texture(albedoSampler, texCoord);
-    float roughness = texture(roughnessSampler, texCoord).x;
-    float metalness = texture(metalnessSampler, texCoord).x;
+    vec3 tangentNormal = normalize(material.normal.xyz);
+    if ((material.textureMask & NORMAL_MAP) != 0u) {
+        // Z is reconstructed from X and Y, which is all that BC5 normal maps store.
+        vec2 normalXY = texture(normalMapSampler, texCoord).xy * 2.0 - 1.0;
+        tangentNormal = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+    }
+    vec3 normal = normalize(TBN * tangentNormal);
+    vec4 albedo = ((material.textureMask & ALBEDO_MAP) != 0u) ? texture(albedoSampler, texCoord) : material.albedo;
+    vec3 surface = ((material.textureMask & (ROUGHNESS_MAP | METALNESS_MAP)) != 0u) ? texture(surfaceSampler, texCoord).xyz : vec3(0.0);
+    float roughness = ((material.textureMask & ROUGHNESS_MAP) != 0u) ? surface.y : material.roughness;
+    float metalness = ((material.textureMask & METALNESS_MAP) != 0u) ? surface.z : material.metalness;
 
 	outPositionDepth = vec4(inPosition, gl_FragCoord.z);
 	outNormal = vec4(normal * 0.5 + 0.5, 1.0);